@@ -10,6 +10,27 @@
 #include "PhysicsEngine/BodySetup.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELCORE_API, float, GVoxelCollisionRegisterBudget, 2.f,
+	"voxel.collision.RegisterBudget",
+	"Max time in ms spent registering collision bodies per frame, remaining colliders are registered next frame. 0 to disable");
+
+FVoxelCollisionRegisterBudget::FVoxelCollisionRegisterBudget()
+	: StartTime(FPlatformTime::Seconds())
+{
+}
+
+bool FVoxelCollisionRegisterBudget::HasTimeLeft() const
+{
+	return
+		GVoxelCollisionRegisterBudget <= 0.f ||
+		(FPlatformTime::Seconds() - StartTime) * 1000. < GVoxelCollisionRegisterBudget;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 void UVoxelCollisionComponent::SetBodyInstance(const FBodyInstance& NewBodyInstance)
 {
 	FVoxelGameUtilities::CopyBodyInstance(
@@ -2,14 +2,47 @@
 
 #include "Collision/VoxelCollisionCooker.h"
 #include "Collision/VoxelTriangleMeshCollider.h"
+#include "VoxelDiskCache.h"
+#include "Chaos/ChaosArchive.h"
 #include "Chaos/CollisionConvexMesh.h"
+#include "Hash/CityHash.h"
+#include "Misc/EngineVersion.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 #include "VoxelAABBTree.h"
 
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelCollisionCacheMemory);
+DEFINE_VOXEL_COUNTER(STAT_VoxelCollisionCacheHits);
+DEFINE_VOXEL_COUNTER(STAT_VoxelCollisionCacheMisses);
+
 VOXEL_CONSOLE_VARIABLE(
 	VOXELCORE_API, bool, GVoxelCollisionFastCooking, true,
 	"voxel.collision.FastCooking",
 	"");
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELCORE_API, float, GVoxelCollisionCacheSize, 64.f,
+	"voxel.collision.CacheSize",
+	"Max size in MB of the in-memory cache of cooked collision meshes. 0 to disable");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELCORE_API, bool, GVoxelCollisionDiskCache, false,
+	"voxel.collision.DiskCache",
+	"If true, cooked collision meshes will be saved to Saved/Voxel/CollisionCache and reused across sessions");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELCORE_API, float, GVoxelCollisionDiskCacheSize, 512.f,
+	"voxel.collision.DiskCacheSize",
+	"Max size in MB of Saved/Voxel/CollisionCache, least recently used meshes are deleted first");
+
+VOXEL_CONSOLE_COMMAND(
+	ClearCollisionCache,
+	"voxel.collision.ClearCache",
+	"Clears the in-memory cache of cooked collision meshes")
+{
+	FVoxelCollisionCooker::ClearCache();
+}
+
 namespace Chaos
 {
 struct FCookTriangleDummy;
@@ -165,6 +198,265 @@ struct FTriangleMeshOverlapVisitorNoMTD<FCookTriangleDummy>
 };
 }
 
+FVoxelDiskCache GVoxelCollisionDiskCacheFiles("CollisionCache", GVoxelCollisionDiskCacheSize);
+
+class FVoxelCollisionCache
+{
+public:
+	struct FCookedMesh
+	{
+		TSharedPtr<Chaos::FTriangleMeshImplicitObject> TriangleMesh;
+		FVoxelBox LocalBounds;
+	};
+
+	static uint64 GetHash(
+		const TConstVoxelArrayView<int32> Indices,
+		const TConstVoxelArrayView<FVector3f> Vertices,
+		const TConstVoxelArrayView<uint16> FaceMaterials)
+	{
+		VOXEL_FUNCTION_COUNTER();
+
+		// Fast & slow cooking build different BVHs
+		uint64 Hash = GVoxelCollisionFastCooking ? 1 : 2;
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(Indices.GetData()), Indices.Num() * Indices.GetTypeSize(), Hash);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(Vertices.GetData()), Vertices.Num() * Vertices.GetTypeSize(), Hash);
+		Hash = CityHash64WithSeed(reinterpret_cast<const char*>(FaceMaterials.GetData()), FaceMaterials.Num() * FaceMaterials.GetTypeSize(), Hash);
+		return Hash;
+	}
+
+	TOptional<FCookedMesh> Find(const uint64 Hash)
+	{
+		VOXEL_FUNCTION_COUNTER();
+
+		{
+			VOXEL_SCOPE_LOCK(CriticalSection);
+
+			if (FEntry* Entry = Entries_RequiresLock.Find(Hash))
+			{
+				Entry->LastAccessFrame = GFrameCounter;
+				return Entry->CookedMesh;
+			}
+		}
+
+		if (!GVoxelCollisionDiskCache)
+		{
+			return {};
+		}
+
+		TOptional<FCookedMesh> CookedMesh = LoadFromDisk(Hash);
+		if (CookedMesh)
+		{
+			AddToMemory(Hash, CookedMesh.GetValue());
+		}
+		return CookedMesh;
+	}
+	void Add(const uint64 Hash, const FCookedMesh& CookedMesh)
+	{
+		AddToMemory(Hash, CookedMesh);
+
+		if (GVoxelCollisionDiskCache)
+		{
+			SaveToDisk(Hash, CookedMesh);
+		}
+	}
+	void Clear()
+	{
+		VOXEL_FUNCTION_COUNTER();
+		VOXEL_SCOPE_LOCK(CriticalSection);
+
+		Entries_RequiresLock.Empty();
+		UpdateStats_RequiresLock(0);
+	}
+
+private:
+	struct FEntry
+	{
+		FCookedMesh CookedMesh;
+		int64 AllocatedSize = 0;
+		uint64 LastAccessFrame = 0;
+	};
+
+	FVoxelFastCriticalSection CriticalSection;
+	TVoxelMap<uint64, FEntry> Entries_RequiresLock;
+	int64 AllocatedSize_RequiresLock = 0;
+
+	void UpdateStats_RequiresLock(const int64 NewAllocatedSize)
+	{
+		checkVoxelSlow(CriticalSection.IsLocked());
+
+		DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelCollisionCacheMemory, AllocatedSize_RequiresLock);
+		AllocatedSize_RequiresLock = NewAllocatedSize;
+		INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelCollisionCacheMemory, AllocatedSize_RequiresLock);
+	}
+
+	void AddToMemory(const uint64 Hash, const FCookedMesh& CookedMesh)
+	{
+		if (GVoxelCollisionCacheSize <= 0.f)
+		{
+			return;
+		}
+
+		VOXEL_FUNCTION_COUNTER();
+
+		FVoxelTriangleMeshCollider Collider;
+		Collider.TriangleMesh = CookedMesh.TriangleMesh;
+		const int64 AllocatedSize = Collider.GetAllocatedSize();
+
+		VOXEL_SCOPE_LOCK(CriticalSection);
+
+		if (Entries_RequiresLock.Contains(Hash))
+		{
+			// Cooked concurrently by another thread
+			return;
+		}
+
+		FEntry& Entry = Entries_RequiresLock.Add_CheckNew(Hash);
+		Entry.CookedMesh = CookedMesh;
+		Entry.AllocatedSize = AllocatedSize;
+		Entry.LastAccessFrame = GFrameCounter;
+
+		UpdateStats_RequiresLock(AllocatedSize_RequiresLock + AllocatedSize);
+		Trim_RequiresLock();
+	}
+	void Trim_RequiresLock()
+	{
+		checkVoxelSlow(CriticalSection.IsLocked());
+
+		const int64 MaxSize = FMath::Max<int64>(GVoxelCollisionCacheSize * 1024 * 1024, 0);
+		if (AllocatedSize_RequiresLock <= MaxSize)
+		{
+			return;
+		}
+
+		VOXEL_FUNCTION_COUNTER();
+
+		struct FEntryToTrim
+		{
+			uint64 LastAccessFrame = 0;
+			uint64 Hash = 0;
+		};
+		TVoxelArray<FEntryToTrim> EntriesToTrim;
+		EntriesToTrim.Reserve(Entries_RequiresLock.Num());
+
+		for (const auto& It : Entries_RequiresLock)
+		{
+			EntriesToTrim.Add(FEntryToTrim{ It.Value.LastAccessFrame, It.Key });
+		}
+
+		EntriesToTrim.Sort([](const FEntryToTrim& A, const FEntryToTrim& B)
+		{
+			return A.LastAccessFrame < B.LastAccessFrame;
+		});
+
+		// Trim a bit more than needed so that we don't sort on every cook once the cache is full
+		const int64 TargetSize = MaxSize * 3 / 4;
+
+		int64 NewAllocatedSize = AllocatedSize_RequiresLock;
+		for (const FEntryToTrim& EntryToTrim : EntriesToTrim)
+		{
+			if (NewAllocatedSize <= TargetSize ||
+				EntryToTrim.LastAccessFrame >= GFrameCounter)
+			{
+				// Never trim meshes used this frame, they are likely still being registered
+				break;
+			}
+
+			const FEntry Entry = Entries_RequiresLock.FindAndRemoveChecked(EntryToTrim.Hash);
+			NewAllocatedSize -= Entry.AllocatedSize;
+		}
+
+		UpdateStats_RequiresLock(NewAllocatedSize);
+	}
+
+private:
+	// Bump whenever the file layout changes
+	static constexpr uint32 DiskCacheMagic = 0x564F4343;
+	static constexpr uint32 DiskCacheVersion = 1;
+
+	static TOptional<FCookedMesh> LoadFromDisk(const uint64 Hash)
+	{
+		VOXEL_FUNCTION_COUNTER();
+		VOXEL_ALLOW_MALLOC_SCOPE();
+
+		const TOptional<TArray<uint8>> Data = GVoxelCollisionDiskCacheFiles.Load(Hash);
+		if (!Data)
+		{
+			return {};
+		}
+
+		FMemoryReader Reader(Data.GetValue());
+
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		uint32 EngineChangelist = 0;
+		Reader << Magic;
+		Reader << Version;
+		Reader << EngineChangelist;
+
+		// Chaos serialization depends on the engine version
+		if (Magic != DiskCacheMagic ||
+			Version != DiskCacheVersion ||
+			EngineChangelist != FEngineVersion::Current().GetChangelist())
+		{
+			return {};
+		}
+
+		FCookedMesh CookedMesh;
+		Reader << CookedMesh.LocalBounds.Min;
+		Reader << CookedMesh.LocalBounds.Max;
+
+		TArray<TSharedPtr<Chaos::FTriangleMeshImplicitObject, ESPMode::ThreadSafe>> TriangleMeshes;
+		{
+			Chaos::FChaosArchive ChaosReader(Reader);
+			ChaosReader << TriangleMeshes;
+		}
+
+		if (Reader.IsError() ||
+			TriangleMeshes.Num() != 1 ||
+			!TriangleMeshes[0])
+		{
+			ensureVoxelSlow(false);
+			return {};
+		}
+
+		CookedMesh.TriangleMesh = TriangleMeshes[0];
+		return CookedMesh;
+	}
+	static void SaveToDisk(const uint64 Hash, const FCookedMesh& CookedMesh)
+	{
+		VOXEL_FUNCTION_COUNTER();
+		VOXEL_ALLOW_MALLOC_SCOPE();
+
+		TArray<uint8> Data;
+		FMemoryWriter Writer(Data);
+
+		uint32 Magic = DiskCacheMagic;
+		uint32 Version = DiskCacheVersion;
+		uint32 EngineChangelist = FEngineVersion::Current().GetChangelist();
+		Writer << Magic;
+		Writer << Version;
+		Writer << EngineChangelist;
+
+		FVoxelBox LocalBounds = CookedMesh.LocalBounds;
+		Writer << LocalBounds.Min;
+		Writer << LocalBounds.Max;
+
+		TArray<TSharedPtr<Chaos::FTriangleMeshImplicitObject, ESPMode::ThreadSafe>> TriangleMeshes;
+		TriangleMeshes.Add(CookedMesh.TriangleMesh);
+		{
+			Chaos::FChaosArchive ChaosWriter(Writer);
+			ChaosWriter << TriangleMeshes;
+		}
+
+		GVoxelCollisionDiskCacheFiles.Save(Hash, Data);
+	}
+};
+FVoxelCollisionCache GVoxelCollisionCache;
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 TSharedPtr<FVoxelTriangleMeshCollider> FVoxelCollisionCooker::CookTriangleMesh(
 	const TConstVoxelArrayView<int32> Indices,
 	const TConstVoxelArrayView<FVector3f> Vertices,
@@ -178,6 +470,26 @@ TSharedPtr<FVoxelTriangleMeshCollider> FVoxelCollisionCooker::CookTriangleMesh(
 		return nullptr;
 	}
 
+	const bool bUseCache =
+		GVoxelCollisionCacheSize > 0.f ||
+		GVoxelCollisionDiskCache;
+
+	const uint64 Hash = bUseCache ? FVoxelCollisionCache::GetHash(Indices, Vertices, FaceMaterials) : 0;
+	if (bUseCache)
+	{
+		if (const TOptional<FVoxelCollisionCache::FCookedMesh> CookedMesh = GVoxelCollisionCache.Find(Hash))
+		{
+			INC_VOXEL_COUNTER(STAT_VoxelCollisionCacheHits);
+
+			const TSharedRef<FVoxelTriangleMeshCollider> Collider = MakeVoxelShared<FVoxelTriangleMeshCollider>();
+			Collider->TriangleMesh = CookedMesh->TriangleMesh;
+			Collider->LocalBounds = CookedMesh->LocalBounds;
+			return Collider;
+		}
+
+		INC_VOXEL_COUNTER(STAT_VoxelCollisionCacheMisses);
+	}
+
 	using FCooker = Chaos::FTriangleMeshOverlapVisitorNoMTD<Chaos::FCookTriangleDummy>;
 
 	TSharedPtr<Chaos::FTriangleMeshImplicitObject> TriangleMesh;
@@ -203,5 +515,82 @@ TSharedPtr<FVoxelTriangleMeshCollider> FVoxelCollisionCooker::CookTriangleMesh(
 		Collider->LocalBounds = FVoxelBox::FromPositions(Vertices);
 	}
 
+	if (bUseCache)
+	{
+		GVoxelCollisionCache.Add(Hash, { TriangleMesh, Collider->LocalBounds });
+	}
+
 	return Collider;
+}
+
+void FVoxelCollisionCooker::SimplifyTriangleMesh(
+	const TConstVoxelArrayView<int32> Indices,
+	const TConstVoxelArrayView<FVector3f> Vertices,
+	const float CellSize,
+	TVoxelArray<int32>& OutIndices,
+	TVoxelArray<FVector3f>& OutVertices)
+{
+	VOXEL_FUNCTION_COUNTER_NUM(Indices.Num(), 0);
+	ensure(Indices.Num() % 3 == 0);
+	ensure(CellSize > 0.f);
+
+	OutIndices.Reset();
+	OutVertices.Reset();
+
+	TVoxelArray<int32> NumWeldedVertices;
+	TVoxelArray<int32> VertexToNewVertex;
+	FVoxelUtilities::SetNumFast(VertexToNewVertex, Vertices.Num());
+	{
+		TVoxelIntVectorMap<int32> CellToNewVertex;
+		CellToNewVertex.Reserve(Vertices.Num());
+
+		for (int32 Index = 0; Index < Vertices.Num(); Index++)
+		{
+			const FVector3f& Vertex = Vertices[Index];
+			const FIntVector Cell = FVoxelUtilities::FloorToInt(Vertex / CellSize);
+
+			int32* NewVertexPtr = CellToNewVertex.Find(Cell);
+			if (!NewVertexPtr)
+			{
+				NewVertexPtr = &CellToNewVertex.Add_CheckNew(Cell);
+				*NewVertexPtr = OutVertices.Add(FVector3f(ForceInit));
+				NumWeldedVertices.Add(0);
+			}
+
+			OutVertices[*NewVertexPtr] += Vertex;
+			NumWeldedVertices[*NewVertexPtr]++;
+			VertexToNewVertex[Index] = *NewVertexPtr;
+		}
+	}
+
+	// Use the average of the welded vertices to stay close to the original surface
+	for (int32 Index = 0; Index < OutVertices.Num(); Index++)
+	{
+		OutVertices[Index] /= NumWeldedVertices[Index];
+	}
+
+	OutIndices.Reserve(Indices.Num());
+
+	for (int32 Index = 0; Index < Indices.Num(); Index += 3)
+	{
+		const int32 IndexA = VertexToNewVertex[Indices[Index + 0]];
+		const int32 IndexB = VertexToNewVertex[Indices[Index + 1]];
+		const int32 IndexC = VertexToNewVertex[Indices[Index + 2]];
+
+		if (IndexA == IndexB ||
+			IndexA == IndexC ||
+			IndexB == IndexC)
+		{
+			continue;
+		}
+
+		OutIndices.Add(IndexA);
+		OutIndices.Add(IndexB);
+		OutIndices.Add(IndexC);
+	}
+}
+
+void FVoxelCollisionCooker::ClearCache()
+{
+	GVoxelCollisionCache.Clear();
 }
\ No newline at end of file
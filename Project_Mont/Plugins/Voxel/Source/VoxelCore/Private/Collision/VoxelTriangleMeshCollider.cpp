@@ -77,10 +77,36 @@ void FVoxelTriangleMeshCollider::AddToBodySetup(UBodySetup& BodySetup) const
 	BodySetup.ChaosTriMeshes.Add(TriangleMesh);
 }
 
+TSharedRef<FVoxelTriangleMeshCollider> FVoxelTriangleMeshCollider::CopyWithNavmesh(
+	const FVoxelBox& ChunkBounds,
+	const FVoxelNavmeshSettings& Settings) const
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const TSharedRef<FVoxelTriangleMeshCollider> Result = MakeVoxelShared<FVoxelTriangleMeshCollider>(*this);
+	Result->PrecomputedNavmesh = nullptr;
+
+	if (const TSharedPtr<const FVoxelNavmesh> RawNavmesh = GetNavmesh())
+	{
+		Result->PrecomputedNavmesh = FVoxelNavmesh::Create(
+			RawNavmesh->Offset,
+			RawNavmesh->Indices,
+			RawNavmesh->Vertices,
+			ChunkBounds.ShiftBy(-RawNavmesh->Offset),
+			Settings);
+	}
+	return Result;
+}
+
 TSharedPtr<const FVoxelNavmesh> FVoxelTriangleMeshCollider::GetNavmesh() const
 {
 	VOXEL_FUNCTION_COUNTER();
 
+	if (PrecomputedNavmesh)
+	{
+		return PrecomputedNavmesh.GetValue();
+	}
+
 	if (!TriangleMesh)
 	{
 		return nullptr;
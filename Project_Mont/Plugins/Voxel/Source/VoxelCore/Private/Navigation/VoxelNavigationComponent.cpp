@@ -15,6 +15,16 @@ void UVoxelNavigationComponent::SetNavigationMesh(const TSharedPtr<const FVoxelN
 {
 	VOXEL_FUNCTION_COUNTER();
 
+	if (NavigationMesh == NewNavigationMesh ||
+		(NavigationMesh &&
+		NewNavigationMesh &&
+		NavigationMesh->Identical(*NewNavigationMesh)))
+	{
+		// Edits invalidate whole chunks, but often don't change the navigable geometry
+		// Skip the update so that the nav system doesn't rebuild the tiles overlapping this chunk
+		return;
+	}
+
 	NavigationMesh = NewNavigationMesh;
 
 	if (NavigationMesh)
@@ -1,5 +1,183 @@
 // Copyright Voxel Plugin, Inc. All Rights Reserved.
 
 #include "Navigation/VoxelNavmesh.h"
+#include "Collision/VoxelCollisionCooker.h"
 
-DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelNavigationMeshMemory);
\ No newline at end of file
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelNavigationMeshMemory);
+
+bool FVoxelNavmesh::Identical(const FVoxelNavmesh& Other) const
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	return
+		Offset == Other.Offset &&
+		Indices.Num() == Other.Indices.Num() &&
+		Vertices.Num() == Other.Vertices.Num() &&
+		FVoxelUtilities::MemoryEqual(Indices, Other.Indices) &&
+		FVoxelUtilities::MemoryEqual(Vertices, Other.Vertices);
+}
+
+TSharedPtr<FVoxelNavmesh> FVoxelNavmesh::Create(
+	const FVector& Offset,
+	TConstVoxelArrayView<int32> Indices,
+	TConstVoxelArrayView<FVector3f> Vertices,
+	const FVoxelBox& ChunkBounds,
+	const FVoxelNavmeshSettings& Settings)
+{
+	VOXEL_FUNCTION_COUNTER_NUM(Indices.Num(), 0);
+	ensure(Indices.Num() % 3 == 0);
+
+	TVoxelArray<int32> WeldedIndices;
+	TVoxelArray<FVector3f> WeldedVertices;
+	if (Settings.WeldSize > 0.f)
+	{
+		FVoxelCollisionCooker::SimplifyTriangleMesh(
+			Indices,
+			Vertices,
+			Settings.WeldSize,
+			WeldedIndices,
+			WeldedVertices);
+
+		Indices = WeldedIndices;
+		Vertices = WeldedVertices;
+	}
+
+	const int32 NumTriangles = Indices.Num() / 3;
+	if (NumTriangles == 0)
+	{
+		return nullptr;
+	}
+
+	const FVoxelBox Bounds = FVoxelBox::FromPositions(Vertices);
+	const float MinWalkableNormalZ = FMath::Cos(FMath::DegreesToRadians(Settings.MaxSlope));
+
+	TVoxelArray<bool> IsWalkable;
+	FVoxelUtilities::SetNumFast(IsWalkable, NumTriangles);
+	for (int32 Index = 0; Index < NumTriangles; Index++)
+	{
+		const FVector3f Normal = FVoxelUtilities::GetTriangleNormal(
+			Vertices[Indices[3 * Index + 0]],
+			Vertices[Indices[3 * Index + 1]],
+			Vertices[Indices[3 * Index + 2]]);
+
+		IsWalkable[Index] = Normal.Z >= MinWalkableNormalZ;
+	}
+
+	// For each XY column, the Z ranges covered by walkable triangles
+	// Non-walkable triangles only matter if they are within AgentHeight above one of these
+	constexpr int32 GridSize = 16;
+	const FVector2D ColumnSize = FVector2D(Bounds.Size()) / GridSize + UE_KINDA_SMALL_NUMBER;
+
+	struct FRange
+	{
+		float Min = 0.f;
+		float Max = 0.f;
+	};
+	TVoxelArray<TVoxelArray<FRange>> Columns;
+	Columns.SetNum(GridSize * GridSize);
+
+	const auto GetTriangleBounds = [&](const int32 TriangleIndex)
+	{
+		const FVector3f A = Vertices[Indices[3 * TriangleIndex + 0]];
+		const FVector3f B = Vertices[Indices[3 * TriangleIndex + 1]];
+		const FVector3f C = Vertices[Indices[3 * TriangleIndex + 2]];
+		return FVoxelBox(
+			FVoxelUtilities::ComponentMin3(A, B, C),
+			FVoxelUtilities::ComponentMax3(A, B, C));
+	};
+	const auto ForeachColumn = [&](const FVoxelBox& TriangleBounds, auto&& Lambda)
+	{
+		const FIntPoint Min = FVoxelUtilities::FloorToInt((FVector2D(TriangleBounds.Min) - FVector2D(Bounds.Min)) / ColumnSize)
+			.ComponentMax(FIntPoint(0))
+			.ComponentMin(FIntPoint(GridSize - 1));
+		const FIntPoint Max = FVoxelUtilities::FloorToInt((FVector2D(TriangleBounds.Max) - FVector2D(Bounds.Min)) / ColumnSize)
+			.ComponentMax(FIntPoint(0))
+			.ComponentMin(FIntPoint(GridSize - 1));
+
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 X = Min.X; X <= Max.X; X++)
+			{
+				if (!Lambda(Columns[X + GridSize * Y]))
+				{
+					return;
+				}
+			}
+		}
+	};
+
+	for (int32 Index = 0; Index < NumTriangles; Index++)
+	{
+		if (!IsWalkable[Index])
+		{
+			continue;
+		}
+
+		const FVoxelBox TriangleBounds = GetTriangleBounds(Index);
+		ForeachColumn(TriangleBounds, [&](TVoxelArray<FRange>& Ranges)
+		{
+			Ranges.Add(FRange{ float(TriangleBounds.Min.Z), float(TriangleBounds.Max.Z) });
+			return true;
+		});
+	}
+
+	const TSharedRef<FVoxelNavmesh> Navmesh = MakeVoxelShared<FVoxelNavmesh>();
+	Navmesh->Offset = Offset;
+	Navmesh->Indices.Reserve(Indices.Num());
+
+	TVoxelArray<int32> OldToNewVertex;
+	FVoxelUtilities::SetNum(OldToNewVertex, Vertices.Num());
+	FVoxelUtilities::Memset(OldToNewVertex, 0xFF);
+
+	for (int32 Index = 0; Index < NumTriangles; Index++)
+	{
+		if (!IsWalkable[Index])
+		{
+			const FVoxelBox TriangleBounds = GetTriangleBounds(Index);
+
+			// Walkable triangles in the chunk below might need this one for clearance
+			// Use the chunk bounds, the mesh might not reach the chunk lower face
+			bool bKeep = TriangleBounds.Min.Z - Settings.AgentHeight <= ChunkBounds.Min.Z;
+			if (!bKeep)
+			{
+				ForeachColumn(TriangleBounds, [&](const TVoxelArray<FRange>& Ranges)
+				{
+					for (const FRange& Range : Ranges)
+					{
+						if (Range.Min <= TriangleBounds.Max.Z &&
+							Range.Max >= TriangleBounds.Min.Z - Settings.AgentHeight)
+						{
+							bKeep = true;
+							return false;
+						}
+					}
+					return true;
+				});
+			}
+
+			if (!bKeep)
+			{
+				continue;
+			}
+		}
+
+		for (int32 Vertex = 0; Vertex < 3; Vertex++)
+		{
+			const int32 OldIndex = Indices[3 * Index + Vertex];
+			int32& NewIndex = OldToNewVertex[OldIndex];
+			if (NewIndex == -1)
+			{
+				NewIndex = Navmesh->Vertices.Add(Vertices[OldIndex]);
+			}
+			Navmesh->Indices.Add(NewIndex);
+		}
+	}
+
+	if (Navmesh->Indices.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	Navmesh->LocalBounds = FVoxelBox::FromPositions(Navmesh->Vertices);
+	return Navmesh;
+}
@@ -269,6 +269,12 @@ FPrimitiveViewRelevance FVoxelMeshSceneProxy::GetViewRelevance(const FSceneView*
 
 	MaterialRelevance.SetPrimitiveViewRelevance(Result);
 
+	if (Result.bDrawRelevance ||
+		Result.bShadowRelevance)
+	{
+		Mesh->OnVisible_AnyThread();
+	}
+
 	return Result;
 }
 
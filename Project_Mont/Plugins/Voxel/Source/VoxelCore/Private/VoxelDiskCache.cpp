@@ -0,0 +1,171 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#include "VoxelDiskCache.h"
+#include "Async/Async.h"
+#include "Misc/QueuedThreadPool.h"
+
+FString FVoxelDiskCache::GetDirectory() const
+{
+	return FPaths::ProjectSavedDir() / "Voxel" / Name;
+}
+
+FString FVoxelDiskCache::GetPath(const uint64 Key) const
+{
+	return GetDirectory() / FString::Printf(TEXT("%016llx.bin"), Key);
+}
+
+TOptional<TArray<uint8>> FVoxelDiskCache::Load(const uint64 Key)
+{
+	VOXEL_FUNCTION_COUNTER();
+	VOXEL_ALLOW_MALLOC_SCOPE();
+
+	const FString Path = GetPath(Key);
+
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Path, FILEREAD_Silent))
+	{
+		return {};
+	}
+
+	// Used to delete the least recently used files first
+	IFileManager::Get().SetTimeStamp(*Path, FDateTime::UtcNow());
+
+	return Data;
+}
+
+void FVoxelDiskCache::Save(const uint64 Key, const TArray<uint8>& Data)
+{
+	VOXEL_FUNCTION_COUNTER();
+	VOXEL_ALLOW_MALLOC_SCOPE();
+
+	const FString Path = GetPath(Key);
+	const FString TempPath = Path + "." + FGuid::NewGuid().ToString() + ".tmp";
+
+	if (!FFileHelper::SaveArrayToFile(Data, *TempPath) ||
+		!IFileManager::Get().Move(*Path, *TempPath, true, true, false, true))
+	{
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return;
+	}
+
+	if (!bTotalSizeKnown.Load() ||
+		TotalSize.Add(Data.Num()) + Data.Num() > GetMaxSize())
+	{
+		Trim();
+	}
+}
+
+void FVoxelDiskCache::Clear()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	IFileManager::Get().DeleteDirectory(*GetDirectory(), false, true);
+	TotalSize.Set(0);
+	bTotalSizeKnown.Store(true);
+}
+
+void FVoxelDiskCache::LoadAsync(const uint64 Key, TVoxelUniqueFunction<void(TOptional<TArray<uint8>> Data)> OnLoaded)
+{
+	RunOnIOThreadPool([this, Key, OnLoaded = MoveTemp(OnLoaded)]
+	{
+		OnLoaded(Load(Key));
+	});
+}
+
+void FVoxelDiskCache::SaveAsync(const uint64 Key, TArray<uint8>&& Data)
+{
+	RunOnIOThreadPool([this, Key, Data = MoveTemp(Data)]
+	{
+		Save(Key, Data);
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+int64 FVoxelDiskCache::GetMaxSize() const
+{
+	return FMath::Max<int64>(MaxSizeInMB * 1024 * 1024, 0);
+}
+
+void FVoxelDiskCache::Trim()
+{
+	bool bExpected = false;
+	if (!bIsTrimming.CompareExchangeStrong(bExpected, true))
+	{
+		return;
+	}
+	ON_SCOPE_EXIT
+	{
+		bIsTrimming.Store(false);
+	};
+
+	VOXEL_FUNCTION_COUNTER();
+
+	struct FFile
+	{
+		FString Path;
+		FDateTime Timestamp;
+		int64 Size = 0;
+	};
+	TArray<FFile> Files;
+	int64 NewTotalSize = 0;
+
+	IFileManager::Get().IterateDirectoryStat(*GetDirectory(), [&](const TCHAR* Path, const FFileStatData& StatData)
+	{
+		if (StatData.bIsDirectory ||
+			!FStringView(Path).EndsWith(TEXT(".bin")))
+		{
+			return true;
+		}
+
+		Files.Add(FFile{ Path, StatData.ModificationTime, StatData.FileSize });
+		NewTotalSize += StatData.FileSize;
+		return true;
+	});
+
+	const int64 MaxSize = GetMaxSize();
+	if (NewTotalSize > MaxSize)
+	{
+		Files.Sort([](const FFile& A, const FFile& B)
+		{
+			return A.Timestamp < B.Timestamp;
+		});
+
+		// Trim a bit more than needed so that we don't scan the directory on every save once the cache is full
+		const int64 TargetSize = MaxSize * 3 / 4;
+
+		for (const FFile& File : Files)
+		{
+			if (NewTotalSize <= TargetSize)
+			{
+				break;
+			}
+
+			if (IFileManager::Get().Delete(*File.Path, false, false, true))
+			{
+				NewTotalSize -= File.Size;
+			}
+		}
+	}
+
+	TotalSize.Set(NewTotalSize);
+	bTotalSizeKnown.Store(true);
+}
+
+void FVoxelDiskCache::RunOnIOThreadPool(TVoxelUniqueFunction<void()>&& Lambda)
+{
+	if (!GIOThreadPool)
+	{
+		// No multithreading
+		Lambda();
+		return;
+	}
+
+	AsyncPool(*GIOThreadPool, [Lambda = MoveTemp(Lambda)]
+	{
+		VOXEL_SCOPE_COUNTER("FVoxelDiskCache::RunOnIOThreadPool");
+		Lambda();
+	});
+}
@@ -1,6 +1,7 @@
 // Copyright Voxel Plugin, Inc. All Rights Reserved.
 
 #include "VoxelDistanceFieldUtilities_Old.h"
+#include "VoxelDistanceFieldUtilitiesImpl.ispc.generated.h"
 
 void FVoxelDistanceFieldUtilities::JumpFlood(
 	const FIntVector& Size,
@@ -49,6 +50,7 @@ void FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(
 	const FIntVector& Size,
 	TVoxelArrayView<const FVector3f> SurfacePositions,
 	TVoxelArrayView<float> InOutDistances,
+	const bool bParallel,
 	const FVoxelIntBox* InBounds)
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -62,7 +64,7 @@ void FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(
 
 	const FVoxelIntBox Bounds = InBounds ? *InBounds : DefaultBounds;
 
-	for (int32 Z = Bounds.Min.Z; Z < Bounds.Max.Z; Z++)
+	const auto DoWork = [&](const int32 Z)
 	{
 		for (int32 Y = Bounds.Min.Y; Y < Bounds.Max.Y; Y++)
 		{
@@ -86,6 +88,21 @@ void FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(
 				ensureVoxelSlow(FMath::Abs(Distance) < Size.Size() * 2);
 			}
 		}
+	};
+
+	if (bParallel)
+	{
+		ParallelFor(Bounds.Size().Z, [&](const int32 Index)
+		{
+			DoWork(Bounds.Min.Z + Index);
+		});
+	}
+	else
+	{
+		for (int32 Z = Bounds.Min.Z; Z < Bounds.Max.Z; Z++)
+		{
+			DoWork(Z);
+		}
 	}
 }
 
@@ -262,12 +279,6 @@ void FVoxelDistanceFieldUtilities::GetSurfacePositionsFromDensities(
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-template<int32 Value>
-struct FInt
-{
- 	constexpr operator int32() const { return Value; }
-};
-
 void FVoxelDistanceFieldUtilities::JumpFloodStep_CPU(
 	const FIntVector& Size,
 	const FVoxelIntBox& Bounds,
@@ -281,78 +292,16 @@ void FVoxelDistanceFieldUtilities::JumpFloodStep_CPU(
 	check(InData.Num() == OutData.Num());
 	check(InData.Num() == Size.X * Size.Y * Size.Z);
 
-	const auto DoWork = [&](auto StaticStep, int32 Z)
+	const auto DoWork = [&](int32 Z)
 	{
-		for (int32 Y = Bounds.Min.Y; Y < Bounds.Max.Y; Y++)
-		{
-			int32 Index = FVoxelUtilities::Get3DIndex<int32>(Size, FIntVector(Bounds.Min.X, Y, Z));
-			for (int32 X = Bounds.Min.X; X < Bounds.Max.X; X++)
-			{
-				ON_SCOPE_EXIT
-				{
-					Index++;
-				};
-
-				float BestDistance = MAX_flt;
-				FVector3f BestSurfacePosition = MakeInvalidSurfacePosition();
-
-#define CheckNeighbor_DX(DX, DY, DZ) \
-				{ \
-					const int32 NeighborIndex = Index + DX * StaticStep + DY * StaticStep * Size.X + DZ * StaticStep * Size.X * Size.Y; \
-					checkVoxelSlow(NeighborIndex == FVoxelUtilities::Get3DIndex<int32>(Size, FIntVector(X, Y, Z) + FIntVector(DX * StaticStep, DY * StaticStep, DZ * StaticStep))); \
-					const FVector3f NeighborSurfacePosition = InData[NeighborIndex]; \
-					const float Distance = FVector3f::DistSquared(NeighborSurfacePosition, FVector3f(X, Y, Z)); \
-					if (Distance < BestDistance) \
-					{ \
-						BestDistance = Distance; \
-						BestSurfacePosition = NeighborSurfacePosition; \
-					} \
-				}
-
-#define CheckNeighbor_DY(DY, DZ) \
-				if (X - StaticStep >= Bounds.Min.X) { CheckNeighbor_DX(-1, DY, DZ); } \
-				CheckNeighbor_DX(+0, DY, DZ); \
-				if (X + StaticStep < Bounds.Max.X) { CheckNeighbor_DX(+1, DY, DZ); }
-
-#define CheckNeighbor_DZ(DZ) \
-				if (Y - StaticStep >= Bounds.Min.Y) { CheckNeighbor_DY(-1, DZ); } \
-				CheckNeighbor_DY(+0, DZ); \
-				if (Y + StaticStep < Bounds.Max.Y) { CheckNeighbor_DY(+1, DZ); }
-
-#define CheckNeighbor() \
-				if (Z - StaticStep >= Bounds.Min.Z) { CheckNeighbor_DZ(-1); } \
-				CheckNeighbor_DZ(+0); \
-				if (Z + StaticStep < Bounds.Max.Z) { CheckNeighbor_DZ(+1); }
-
-				CheckNeighbor();
-
-				OutData[Index] = BestSurfacePosition;
-
-#undef CheckNeighbor
-#undef CheckNeighbor_DX
-#undef CheckNeighbor_DY
-#undef CheckNeighbor_DZ
-			}
-		}
-	};
-
-	const auto DispatchDoWork = [&](int32 Z)
-	{
-		switch (Step)
-		{
-#define CASE(X) case X: DoWork(FInt<X>(), Z); break;
-			CASE(1);
-			CASE(2);
-			CASE(4);
-			CASE(8);
-			CASE(16);
-			CASE(32);
-			CASE(64);
-			CASE(128);
-			CASE(256);
-#undef CASE
-		default: DoWork(Step, Z); break;
-		}
+		ispc::DistanceFieldUtilities_JumpFloodStep(
+			GetISPCValue(Size),
+			GetISPCValue(Bounds.Min),
+			GetISPCValue(Bounds.Max),
+			Z,
+			Step,
+			ReinterpretCastPtr<float>(InData.GetData()),
+			ReinterpretCastPtr<float>(OutData.GetData()));
 	};
 
 	if (bParallel)
@@ -370,7 +319,7 @@ void FVoxelDistanceFieldUtilities::JumpFloodStep_CPU(
 
 			for (int32 Index = StartIndex; Index < EndIndex; Index++)
 			{
-				DispatchDoWork(Bounds.Min.Z + Index);
+				DoWork(Bounds.Min.Z + Index);
 			}
 		});
 	}
@@ -378,7 +327,7 @@ void FVoxelDistanceFieldUtilities::JumpFloodStep_CPU(
 	{
 		for (int32 Z = Bounds.Min.Z; Z < Bounds.Max.Z; Z++)
 		{
-			DispatchDoWork(Z);
+			DoWork(Z);
 		}
 	}
 }
\ No newline at end of file
@@ -132,13 +132,43 @@ void Voxelize(
 	case EVoxelAxis::Z: IndexI = 0; IndexJ = 1; IndexK = 2; break;
 	}
 
-	// We begin by initializing distances near the mesh, and figuring out intersection counts
+	// Every voxel a triangle writes to, be it a distance or an intersection count, is within the triangle bounds along I
+	// Bin the triangles into slabs along I so that slabs can be processed in parallel without any lock
+	// Triangles are kept in order within a slab, so the result is the same as a serial voxelization
+	const int32 SlabSize = FMath::Max(FVoxelUtilities::DivideCeil_Positive(Size[IndexI], 4 * FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1)), 1);
+	const int32 NumSlabs = FVoxelUtilities::DivideCeil_Positive(Size[IndexI], SlabSize);
+
+	TVoxelArray<TVoxelArray<int32>> SlabTriangles;
+	SlabTriangles.SetNum(NumSlabs);
 	{
-		VOXEL_SCOPE_COUNTER("Intersections");
+		VOXEL_SCOPE_COUNTER("Bin triangles");
+
 		for (int32 TriangleIndex = 0; TriangleIndex < Indices.Num(); TriangleIndex += 3)
 		{
-			VOXEL_SCOPE_COUNTER("Process triangle");
+			const float VertexA = Vertices[Indices[TriangleIndex + 0]][IndexI] - Origin[IndexI];
+			const float VertexB = Vertices[Indices[TriangleIndex + 1]][IndexI] - Origin[IndexI];
+			const float VertexC = Vertices[Indices[TriangleIndex + 2]][IndexI] - Origin[IndexI];
+
+			const int32 Start = FMath::Clamp(FMath::FloorToInt(FMath::Min3(VertexA, VertexB, VertexC)), 0, Size[IndexI] - 1);
+			const int32 End = FMath::Clamp(FMath::CeilToInt(FMath::Max3(VertexA, VertexB, VertexC)), 0, Size[IndexI] - 1);
+
+			for (int32 SlabIndex = Start / SlabSize; SlabIndex <= End / SlabSize; SlabIndex++)
+			{
+				SlabTriangles[SlabIndex].Add(TriangleIndex);
+			}
+		}
+	}
 
+	// We begin by initializing distances near the mesh, and figuring out intersection counts
+	ParallelFor(NumSlabs, [&](const int32 SlabIndex)
+	{
+		VOXEL_SCOPE_COUNTER_FORMAT("Intersections %d triangles", SlabTriangles[SlabIndex].Num());
+
+		const int32 SlabStart = SlabIndex * SlabSize;
+		const int32 SlabEnd = FMath::Min(SlabStart + SlabSize, Size[IndexI]) - 1;
+
+		for (const int32 TriangleIndex : SlabTriangles[SlabIndex])
+		{
 			const int32 IndexA = Indices[TriangleIndex + 0];
 			const int32 IndexB = Indices[TriangleIndex + 1];
 			const int32 IndexC = Indices[TriangleIndex + 2];
@@ -166,8 +196,10 @@ void Voxelize(
 			{
 				VOXEL_SCOPE_COUNTER("Compute distance");
 
-				const FIntVector Start = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(MinVoxelVertex), FIntVector(0), Size - 1);
-				const FIntVector End = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(MaxVoxelVertex), FIntVector(0), Size - 1);
+				FIntVector Start = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(MinVoxelVertex), FIntVector(0), Size - 1);
+				FIntVector End = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(MaxVoxelVertex), FIntVector(0), Size - 1);
+				Start[IndexI] = FMath::Max(Start[IndexI], SlabStart);
+				End[IndexI] = FMath::Min(End[IndexI], SlabEnd);
 
 				// Do distances nearby
 				for (int32 Z = Start.Z; Z <= End.Z; Z++)
@@ -205,8 +237,10 @@ void Voxelize(
 			{
 				VOXEL_SCOPE_COUNTER("Compute intersections");
 
-				const FIntVector Start = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(MinVoxelVertex), FIntVector(0), Size - 1);
-				const FIntVector End = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(MaxVoxelVertex), FIntVector(0), Size - 1);
+				FIntVector Start = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(MinVoxelVertex), FIntVector(0), Size - 1);
+				FIntVector End = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(MaxVoxelVertex), FIntVector(0), Size - 1);
+				Start[IndexI] = FMath::Max(Start[IndexI], SlabStart);
+				End[IndexI] = FMath::Min(End[IndexI], SlabEnd);
 
 				// Do intersection counts. Make sure to follow SweepDirection!
 				FIntVector Position;
@@ -234,15 +268,19 @@ void Voxelize(
 				}
 			}
 		}
-	}
+	});
 
-	int32 NumLeaks = 0;
+	FThreadSafeCounter NumLeaks;
+	ParallelFor(NumSlabs, [&](const int32 SlabIndex)
 	{
 		VOXEL_SCOPE_COUNTER("Compute Signs");
 
+		const int32 SlabStart = SlabIndex * SlabSize;
+		const int32 SlabEnd = FMath::Min(SlabStart + SlabSize, Size[IndexI]);
+
 		// Then figure out signs (inside/outside) from intersection counts
 		FIntVector Position;
-		for (int32 I = 0; I < Size[IndexI]; I++)
+		for (int32 I = SlabStart; I < SlabEnd; I++)
 		{
 			Position[IndexI] = I;
 			for (int32 J = 0; J < Size[IndexJ]; J++)
@@ -264,7 +302,7 @@ void Voxelize(
 						if (Count % 2 == 1)
 						{
 							// For watertight meshes, we're expecting to come in and out of the mesh
-							NumLeaks++;
+							NumLeaks.Increment();
 							continue;
 						}
 					}
@@ -273,7 +311,7 @@ void Voxelize(
 						if (Count == 0)
 						{
 							// For other meshes, only skip when there was no hit
-							NumLeaks++;
+							NumLeaks.Increment();
 							continue;
 						}
 					}
@@ -296,11 +334,11 @@ void Voxelize(
 				}
 			}
 		}
-	}
+	});
 
 	if (OutNumLeaks)
 	{
-		*OutNumLeaks = NumLeaks;
+		*OutNumLeaks = NumLeaks.GetValue();
 	}
 }
 
@@ -201,7 +201,7 @@ bool UVoxelMeshVoxelizerLibrary::VoxelizeMesh(
 
 	// Propagate distances
 	FVoxelDistanceFieldUtilities::JumpFlood(Size, OutSurfacePositions, bMultiThreaded);
-	FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(Size, OutSurfacePositions, OutDistances);
+	FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(Size, OutSurfacePositions, OutDistances, bMultiThreaded);
 
 	return true;
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "VoxelMinimal.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/GameViewportClient.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
 
 #if WITH_EDITOR
 #include "Selection.h"
@@ -14,6 +16,11 @@ VOXEL_CONSOLE_VARIABLE(
 	"voxel.FreezeCamera",
 	"");
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELCORE_API, float, GVoxelRemoteViewWeight, 1.f,
+	"voxel.RemoteViewWeight",
+	"Weight of the views of remote players on servers when computing LODs. 0 to only use local players");
+
 FViewport* FVoxelGameUtilities::GetViewport(const UWorld* World)
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -190,6 +197,84 @@ bool FVoxelGameUtilities::GetCameraView(const UWorld* World, FVector& OutPositio
 	return true;
 }
 
+class FVoxelViewOriginSubsystem : public IVoxelWorldSubsystem
+{
+public:
+	GENERATED_VOXEL_WORLD_SUBSYSTEM_BODY(FVoxelViewOriginSubsystem);
+
+	// Last views, used by voxel.FreezeCamera
+	TOptional<TArray<FVoxelViewOrigin>> CachedViews;
+};
+
+bool FVoxelGameUtilities::GetViewOrigins(const UWorld* World, TArray<FVoxelViewOrigin>& OutViews)
+{
+	VOXEL_FUNCTION_COUNTER();
+	ensure(IsInGameThread());
+
+	OutViews.Reset();
+
+	if (!World)
+	{
+		return false;
+	}
+
+	if (!World->IsGameWorld())
+	{
+		FVector Position;
+		if (!GetCameraView(World, Position))
+		{
+			return false;
+		}
+
+		OutViews.Add({ Position, 1.f });
+		return true;
+	}
+
+	const TSharedRef<FVoxelViewOriginSubsystem> Subsystem = FVoxelViewOriginSubsystem::Get(World);
+
+	if (GVoxelFreezeCamera &&
+		Subsystem->CachedViews.IsSet())
+	{
+		OutViews = Subsystem->CachedViews.GetValue();
+		return OutViews.Num() > 0;
+	}
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (!PlayerController)
+		{
+			continue;
+		}
+
+		if (PlayerController->IsLocalController())
+		{
+			if (!PlayerController->PlayerCameraManager)
+			{
+				continue;
+			}
+
+			OutViews.Add({ PlayerController->PlayerCameraManager->GetCameraLocation(), 1.f, PlayerController });
+			continue;
+		}
+
+		// Only servers have remote player controllers
+		if (GVoxelRemoteViewWeight <= 0.f)
+		{
+			continue;
+		}
+
+		FVector Position;
+		FRotator Rotation;
+		PlayerController->GetPlayerViewPoint(Position, Rotation);
+
+		OutViews.Add({ Position, GVoxelRemoteViewWeight, PlayerController });
+	}
+
+	Subsystem->CachedViews = OutViews;
+	return OutViews.Num() > 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
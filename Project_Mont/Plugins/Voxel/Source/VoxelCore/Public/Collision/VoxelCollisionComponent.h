@@ -8,6 +8,21 @@
 
 struct FVoxelCollider;
 
+extern VOXELCORE_API float GVoxelCollisionRegisterBudget;
+
+// Registering bodies is expensive, use this to spread it over several frames
+// See voxel.collision.RegisterBudget
+class VOXELCORE_API FVoxelCollisionRegisterBudget
+{
+public:
+	FVoxelCollisionRegisterBudget();
+
+	bool HasTimeLeft() const;
+
+private:
+	const double StartTime;
+};
+
 UCLASS()
 class VOXELCORE_API UVoxelCollisionComponent final : public UPrimitiveComponent
 {
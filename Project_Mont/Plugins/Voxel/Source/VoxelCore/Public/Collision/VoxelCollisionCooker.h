@@ -6,10 +6,32 @@
 
 struct FVoxelTriangleMeshCollider;
 
+DECLARE_VOXEL_MEMORY_STAT(VOXELCORE_API, STAT_VoxelCollisionCacheMemory, "Voxel Collision Cache Memory");
+DECLARE_VOXEL_COUNTER(VOXELCORE_API, STAT_VoxelCollisionCacheHits, "Collision Cache Hits");
+DECLARE_VOXEL_COUNTER(VOXELCORE_API, STAT_VoxelCollisionCacheMisses, "Collision Cache Misses");
+
+extern VOXELCORE_API float GVoxelCollisionCacheSize;
+extern VOXELCORE_API bool GVoxelCollisionDiskCache;
+extern VOXELCORE_API float GVoxelCollisionDiskCacheSize;
+
 struct VOXELCORE_API FVoxelCollisionCooker
 {
+	// Cooked meshes are cached by content, see voxel.collision.CacheSize & voxel.collision.DiskCache
+	// Identical chunks (flat terrain, chunks recomputed after an unrelated edit) will share the same chaos mesh
+	// Offset & PhysicalMaterials are not set
 	static TSharedPtr<FVoxelTriangleMeshCollider> CookTriangleMesh(
 		TConstVoxelArrayView<int32> Indices,
 		TConstVoxelArrayView<FVector3f> Vertices,
 		TConstVoxelArrayView<uint16> FaceMaterials);
-};
\ No newline at end of file
+
+	// Welds all the vertices in the same CellSize cell and removes the triangles that collapsed
+	// Used for distant chunks that only need coarse collision
+	static void SimplifyTriangleMesh(
+		TConstVoxelArrayView<int32> Indices,
+		TConstVoxelArrayView<FVector3f> Vertices,
+		float CellSize,
+		TVoxelArray<int32>& OutIndices,
+		TVoxelArray<FVector3f>& OutVertices);
+
+	static void ClearCache();
+};
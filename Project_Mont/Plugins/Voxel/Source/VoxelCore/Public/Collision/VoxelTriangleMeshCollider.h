@@ -11,6 +11,8 @@
 #include "Rendering/StaticMeshVertexBuffer.h"
 #include "VoxelTriangleMeshCollider.generated.h"
 
+struct FVoxelNavmeshSettings;
+
 USTRUCT()
 struct VOXELCORE_API FVoxelTriangleMeshCollider : public FVoxelCollider
 {
@@ -21,6 +23,15 @@ struct VOXELCORE_API FVoxelTriangleMeshCollider : public FVoxelCollider
 	FVoxelBox LocalBounds;
 	TSharedPtr<Chaos::FTriangleMeshImplicitObject> TriangleMesh;
 	TArray<TWeakObjectPtr<UPhysicalMaterial>> PhysicalMaterials;
+	// If set, returned by GetNavmesh instead of the raw collision triangles
+	// Built in the voxel task pool with FVoxelNavmesh::Create, null if nothing is relevant for navigation
+	TOptional<TSharedPtr<const FVoxelNavmesh>> PrecomputedNavmesh;
+
+	// Returns a copy with PrecomputedNavmesh set, expensive
+	// ChunkBounds is in the same space as the collider, ie before Offset is applied
+	TSharedRef<FVoxelTriangleMeshCollider> CopyWithNavmesh(
+		const FVoxelBox& ChunkBounds,
+		const FVoxelNavmeshSettings& Settings) const;
 
 	virtual FVector GetOffset() const override { return Offset; }
 	virtual FVoxelBox GetLocalBounds() const override { return LocalBounds.Extend(0.0001); }
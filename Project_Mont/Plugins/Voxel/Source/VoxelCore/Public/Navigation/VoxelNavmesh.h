@@ -7,6 +7,16 @@
 
 DECLARE_VOXEL_MEMORY_STAT(VOXELCORE_API, STAT_VoxelNavigationMeshMemory, "Voxel Navigation Mesh Memory");
 
+struct VOXELCORE_API FVoxelNavmeshSettings
+{
+	// Triangles steeper than this are not walkable, in degrees
+	float MaxSlope = 44.f;
+	// Non-walkable triangles higher than this above every walkable triangle can never block an agent and are removed
+	float AgentHeight = 200.f;
+	// Vertices in the same cell of this size are welded, 0 to disable
+	float WeldSize = 0.f;
+};
+
 USTRUCT()
 struct VOXELCORE_API FVoxelNavmesh
 {
@@ -23,4 +33,17 @@ struct VOXELCORE_API FVoxelNavmesh
 	{
 		return Indices.GetAllocatedSize() + Vertices.GetAllocatedSize();
 	}
-};
\ No newline at end of file
+
+	bool Identical(const FVoxelNavmesh& Other) const;
+
+	// Filters and simplifies a surface for the nav system, expensive, call from the voxel task pool
+	// Z is assumed to be up
+	// ChunkBounds is in the same space as Vertices, non-walkable triangles near its lower face are kept for the chunk below
+	// Returns null if no triangle is left
+	static TSharedPtr<FVoxelNavmesh> Create(
+		const FVector& Offset,
+		TConstVoxelArrayView<int32> Indices,
+		TConstVoxelArrayView<FVector3f> Vertices,
+		const FVoxelBox& ChunkBounds,
+		const FVoxelNavmeshSettings& Settings);
+};
@@ -49,6 +49,9 @@ public:
 
 	virtual bool ShouldDrawVelocity() const { return true; }
 
+	// Called by the scene proxy whenever the mesh is visible in a view, can be called from render worker threads
+	virtual void OnVisible_AnyThread() const {}
+
 protected:
 	virtual void Initialize_GameThread() {}
 	virtual void Initialize_RenderThread(FRHICommandList& RHICmdList, ERHIFeatureLevel::Type FeatureLevel) {}
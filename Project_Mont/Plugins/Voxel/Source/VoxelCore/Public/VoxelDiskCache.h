@@ -0,0 +1,46 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "VoxelMinimal.h"
+
+// Files keyed by hash in Saved/Voxel/Name, reused across sessions
+// Once the directory is bigger than MaxSizeInMB, the least recently used files are deleted first
+class VOXELCORE_API FVoxelDiskCache
+{
+public:
+	// MaxSizeInMB is usually a console variable and is read on every save
+	FVoxelDiskCache(const FString& Name, const float& MaxSizeInMB)
+		: Name(Name)
+		, MaxSizeInMB(MaxSizeInMB)
+	{
+	}
+	UE_NONCOPYABLE(FVoxelDiskCache);
+
+	FString GetDirectory() const;
+	FString GetPath(uint64 Key) const;
+
+	TOptional<TArray<uint8>> Load(uint64 Key);
+	// Written to a temporary file first so that concurrent loads of the same key never see a partial file
+	void Save(uint64 Key, const TArray<uint8>& Data);
+	void Clear();
+
+	// Same as above, but the file IO is done on the IO thread pool so that workers never block on the disk
+	// OnLoaded is called on the IO thread pool
+	void LoadAsync(uint64 Key, TVoxelUniqueFunction<void(TOptional<TArray<uint8>> Data)> OnLoaded);
+	void SaveAsync(uint64 Key, TArray<uint8>&& Data);
+
+private:
+	const FString Name;
+	const float& MaxSizeInMB;
+
+	// Approximate, files saved while trimming might not be counted
+	FThreadSafeCounter64 TotalSize;
+	TVoxelAtomic<bool> bTotalSizeKnown = false;
+	TVoxelAtomic<bool> bIsTrimming = false;
+
+	int64 GetMaxSize() const;
+	void Trim();
+
+	static void RunOnIOThreadPool(TVoxelUniqueFunction<void()>&& Lambda);
+};
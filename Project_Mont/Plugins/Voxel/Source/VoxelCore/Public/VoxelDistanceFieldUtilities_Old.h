@@ -29,6 +29,7 @@ public:
 		const FIntVector& Size,
 		TVoxelArrayView<const FVector3f> SurfacePositions,
 		TVoxelArrayView<float> InOutDistances,
+		bool bParallel = false,
 		const FVoxelIntBox* Bounds = nullptr);
 
 public:
@@ -68,6 +68,15 @@ public:
 	{
 		return ArrayNum;
 	}
+	// Number of distinct values
+	FORCEINLINE int32 PaletteNum() const
+	{
+		return Palette.Num();
+	}
+	FORCEINLINE bool IsConstant() const
+	{
+		return Palette.Num() == 1;
+	}
 	FORCEINLINE bool IsValidIndex(int32 Index) const
 	{
 		return 0 <= Index && Index <= Num();
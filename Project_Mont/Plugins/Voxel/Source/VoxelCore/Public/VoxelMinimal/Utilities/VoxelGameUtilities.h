@@ -6,6 +6,15 @@
 
 class FViewport;
 
+struct FVoxelViewOrigin
+{
+	FVector Position = FVector(ForceInit);
+	// Scales the screen size of everything seen from this view, 0 to ignore it
+	float Weight = 1.f;
+	// Player controller of this view, null for the editor camera. Identifies the view across frames
+	FObjectKey PlayerController;
+};
+
 struct VOXELCORE_API FVoxelGameUtilities
 {
 public:
@@ -18,6 +27,9 @@ public:
 		float FOV;
 		return GetCameraView(World, OutPosition, Rotation, FOV);
 	}
+	// All the viewpoints of World: every local player (split screen, spectators),
+	// remote players on servers (weighted by voxel.RemoteViewWeight) and the editor camera
+	static bool GetViewOrigins(const UWorld* World, TArray<FVoxelViewOrigin>& OutViews);
 
 public:
 #if WITH_EDITOR
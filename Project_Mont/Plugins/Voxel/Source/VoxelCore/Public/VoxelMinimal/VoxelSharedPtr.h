@@ -119,7 +119,7 @@ FORCEINLINE const TWeakPtr<T>& GetSharedFromThisWeakPtr(const TSharedFromThis<T>
 }
 
 template<typename T>
-FORCEINLINE bool IsSharedFromThisUnique(const TSharedFromThis<T>* SharedFromThis)
+FORCEINLINE int32 GetSharedFromThisReferenceCount(const TSharedFromThis<T>* SharedFromThis)
 {
 	const TWeakPtr<T>& WeakPtr = GetSharedFromThisWeakPtr(SharedFromThis);
 	const SharedPointerInternals::TReferenceControllerBase<ESPMode::ThreadSafe>* ReferenceController = GetWeakPtrReferenceController(WeakPtr);
@@ -127,7 +127,13 @@ FORCEINLINE bool IsSharedFromThisUnique(const TSharedFromThis<T>* SharedFromThis
 
 	const int32 ReferenceCount = ReferenceController->GetSharedReferenceCount();
 	checkVoxelSlow(ReferenceCount >= 1);
-	return ReferenceCount == 1;
+	return ReferenceCount;
+}
+
+template<typename T>
+FORCEINLINE bool IsSharedFromThisUnique(const TSharedFromThis<T>* SharedFromThis)
+{
+	return GetSharedFromThisReferenceCount(SharedFromThis) == 1;
 }
 
 // Useful when creating shared ptrs that are supposed to never expire, typically for default shared values
@@ -11,6 +11,7 @@ void FVoxelComputedMaterialParameter::Append(const FVoxelComputedMaterialParamet
 	TextureParameters.Append(Other.TextureParameters);
 	DynamicParameters.Append(Other.DynamicParameters);
 	Resources.Append(Other.Resources);
+	DetailTextureAllocations.Append(Other.DetailTextureAllocations);
 }
 
 TSharedRef<FVoxelMaterialRef> FVoxelComputedMaterial::MakeMaterial_GameThread() const
@@ -31,7 +31,7 @@ EVoxelSuccess UVoxelPointFunctionLibrary::MakePointHandleFromHitResult(const FHi
 		return EVoxelSuccess::Failed;
 	}
 
-	if (!Provider->TryGetPointHandle(HitResult.Item, Handle))
+	if (!Provider->TryGetPointHandleFromHit(HitResult, Handle))
 	{
 		return EVoxelSuccess::Failed;
 	}
@@ -11,6 +11,30 @@
 #include "VoxelDependency.h"
 #include "VoxelPositionQueryParameter.h"
 
+class FVoxelSculptActorTransformProvider : public IVoxelTransformProvider
+{
+public:
+	const FMatrix Transform;
+
+	explicit FVoxelSculptActorTransformProvider(const FMatrix& Transform)
+		: Transform(Transform)
+	{
+	}
+
+	virtual FName GetName() const override
+	{
+		return "SculptActorTransform";
+	}
+	virtual FMatrix GetTransform() const override
+	{
+		return Transform;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 void UVoxelSculptFunctionLibrary::ApplySculpt(
 	AVoxelActor* TargetActor,
 	AVoxelActor* SculptActor)
@@ -28,28 +52,56 @@ void UVoxelSculptFunctionLibrary::ApplySculpt(
 		return;
 	}
 
-	if (!TargetActor->IsRuntimeCreated())
+	if (!ensure(TargetActor->SculptStorageComponent))
 	{
-		VOXEL_MESSAGE(Error, "{0}: TargetActor voxel runtime is not created", TargetActor);
 		return;
 	}
-	if (!SculptActor->IsRuntimeCreated())
+
+	if (TargetActor->SculptStorageComponent->IsReplicatingEdits())
 	{
-		VOXEL_MESSAGE(Error, "{0}: SculptActor voxel runtime is not created", SculptActor);
+		if (!TargetActor->HasAuthority())
+		{
+			VOXEL_MESSAGE(Error, "{0}: sculpt is replicated, ApplySculpt needs to be called on the server", TargetActor);
+			return;
+		}
+
+		TargetActor->SculptStorageComponent->ApplyReplicatedEdit(*SculptActor);
 		return;
 	}
 
-	if (!ensure(TargetActor->SculptStorageComponent))
+	ApplySculptLocal(*TargetActor, *SculptActor);
+}
+
+TOptional<FVoxelIntBox> UVoxelSculptFunctionLibrary::ApplySculptLocal(
+	AVoxelActor& TargetActor,
+	AVoxelActor& SculptActor,
+	const TOptional<FTransform>& SculptActorToWorld,
+	const TOptional<FVoxelIntBox>& Bounds)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!TargetActor.IsRuntimeCreated())
 	{
-		return;
+		VOXEL_MESSAGE(Error, "{0}: TargetActor voxel runtime is not created", &TargetActor);
+		return {};
+	}
+	if (!SculptActor.IsRuntimeCreated())
+	{
+		VOXEL_MESSAGE(Error, "{0}: SculptActor voxel runtime is not created", &SculptActor);
+		return {};
 	}
 
-	const TSharedPtr<const FVoxelRuntimeParameter_SculptStorage> SculptStorageParameter = TargetActor->DefaultRuntimeParameters.Find<FVoxelRuntimeParameter_SculptStorage>();
+	if (!ensure(TargetActor.SculptStorageComponent))
+	{
+		return {};
+	}
+
+	const TSharedPtr<const FVoxelRuntimeParameter_SculptStorage> SculptStorageParameter = TargetActor.DefaultRuntimeParameters.Find<FVoxelRuntimeParameter_SculptStorage>();
 	if (!ensure(SculptStorageParameter))
 	{
-		return;
+		return {};
 	}
-	ensure(SculptStorageParameter->Data == TargetActor->SculptStorageComponent->GetData());
+	ensure(SculptStorageParameter->Data == TargetActor.SculptStorageComponent->GetData());
 
 	const float VoxelSize = SculptStorageParameter->VoxelSize;
 	const TSharedPtr<const TVoxelComputeValue<FVoxelSurface>> Compute = INLINE_LAMBDA
@@ -60,72 +112,102 @@ void UVoxelSculptFunctionLibrary::ApplySculpt(
 
 	if (!Compute)
 	{
-		VOXEL_MESSAGE(Error, "{0}: missing Set Sculpt Source Surface", TargetActor);
-		return;
+		VOXEL_MESSAGE(Error, "{0}: missing Set Sculpt Source Surface", &TargetActor);
+		return {};
 	}
 
-	const TSharedPtr<const FVoxelRuntimeParameter_EditSculptSurface> EditSculptSurfaceParameter = SculptActor->DefaultRuntimeParameters.Find<FVoxelRuntimeParameter_EditSculptSurface>();
+	const TSharedPtr<const FVoxelRuntimeParameter_EditSculptSurface> EditSculptSurfaceParameter = SculptActor.DefaultRuntimeParameters.Find<FVoxelRuntimeParameter_EditSculptSurface>();
 	if (!ensure(EditSculptSurfaceParameter))
 	{
-		return;
+		return {};
 	}
 
 	const TSharedPtr<FVoxelEditSculptSurfaceExecNodeRuntime> NodeRuntime = EditSculptSurfaceParameter->WeakRuntime.Pin();
 	if (!NodeRuntime)
 	{
-		VOXEL_MESSAGE(Error, "{0}: No Edit Sculpt Surface node", SculptActor);
-		return;
+		VOXEL_MESSAGE(Error, "{0}: No Edit Sculpt Surface node", &SculptActor);
+		return {};
 	}
 
-	const TOptional<FVoxelBounds> OptionalLocalBounds = FVoxelTaskGroup::TryRunSynchronously(NodeRuntime->GetContext(), [&]
+	TSharedRef<FVoxelQueryContext> SculptContext = NodeRuntime->GetContext();
+
+	// Evaluate the sculpt graph at SculptActorToWorld instead of moving the sculpt actor there
+	TSharedPtr<FVoxelRuntimeInfo> SculptRuntimeInfo;
+	if (SculptActorToWorld)
 	{
-		const FVoxelQuery Query = FVoxelQuery::Make(
-			FVoxelQueryContext::Make(TargetActor->GetRuntime()->GetRuntimeInfoRef().AsShared()),
-			MakeVoxelShared<FVoxelQueryParameters>(),
-			FVoxelDependencyTracker::Create("VoxelSculpt"))
-			.MakeNewQuery(NodeRuntime->GetContext());
+		SculptRuntimeInfo = SculptContext->RuntimeInfo->MakeWithLocalToWorld(FVoxelTransformRef::Make(
+			MakeVoxelShared<FVoxelSculptActorTransformProvider>(SculptActorToWorld->ToMatrixWithScale())));
 
-		return NodeRuntime->GetNodeRuntime().Get(NodeRuntime->Node.BoundsPin, Query);
-	});
+		SculptContext = SculptContext->MakeWithRuntimeInfo(SculptRuntimeInfo.ToSharedRef());
+	}
+	ON_SCOPE_EXIT
+	{
+		if (SculptRuntimeInfo)
+		{
+			SculptRuntimeInfo->Destroy();
+		}
+	};
 
-	if (!ensure(OptionalLocalBounds))
+	FVoxelIntBox IntBounds;
+	if (Bounds)
 	{
-		return;
+		ensure(Bounds->IsMultipleOf(FVoxelSculptStorageData::ChunkSize));
+		IntBounds = Bounds.GetValue();
 	}
+	else
+	{
+		const TOptional<FVoxelBounds> OptionalLocalBounds = FVoxelTaskGroup::TryRunSynchronously(SculptContext, [&]
+		{
+			const FVoxelQuery Query = FVoxelQuery::Make(
+				FVoxelQueryContext::Make(TargetActor.GetRuntime()->GetRuntimeInfoRef().AsShared()),
+				MakeVoxelShared<FVoxelQueryParameters>(),
+				FVoxelDependencyTracker::Create("VoxelSculpt"))
+				.MakeNewQuery(SculptContext);
+
+			return NodeRuntime->GetNodeRuntime().Get(NodeRuntime->Node.BoundsPin, Query);
+		});
 
-	const FVoxelBox LocalBounds = OptionalLocalBounds->GetBox_NoDependency(
-		FScaleMatrix(VoxelSize) *
-		TargetActor->ActorToWorld().ToMatrixWithScale());
+		if (!ensure(OptionalLocalBounds))
+		{
+			return {};
+		}
 
-	// MakeMultipleOf to not have to handle partial chunk updates & querying the source data manually again
-	const FVoxelIntBox IntBounds = FVoxelIntBox::FromFloatBox_WithPadding(LocalBounds)
-		.MakeMultipleOfBigger(FVoxelSculptStorageData::ChunkSize);
+		const FVoxelBox LocalBounds = OptionalLocalBounds->GetBox_NoDependency(
+			FScaleMatrix(VoxelSize) *
+			TargetActor.ActorToWorld().ToMatrixWithScale());
+
+		// MakeMultipleOf to not have to handle partial chunk updates & querying the source data manually again
+		IntBounds = FVoxelIntBox::FromFloatBox_WithPadding(LocalBounds)
+			.MakeMultipleOfBigger(FVoxelSculptStorageData::ChunkSize);
+	}
 
 	if (IntBounds.Count_LargeBox() > 1024 * 1024)
 	{
 		VOXEL_MESSAGE(Error, "Cannot apply tool: more than 1M voxels would be computed");
-		return;
+		return {};
 	}
 
 	const TSharedRef<FVoxelQueryParameters> QueryParameters = MakeVoxelShared<FVoxelQueryParameters>();
 	QueryParameters->Add<FVoxelLODQueryParameter>().LOD = 0;
+	// Baked into the sculpt data, can't be refined once streamed data finishes loading
+	QueryParameters->Add<FVoxelPersistentQueryParameter>();
 	QueryParameters->Add<FVoxelPositionQueryParameter>().InitializeGrid(FVector3f(IntBounds.Min) * VoxelSize, VoxelSize, IntBounds.Size());
 	{
 		const TSharedRef<FVoxelSculptStorageQueryParameter> Parameter = MakeVoxelShared<FVoxelSculptStorageQueryParameter>();
-		Parameter->SurfaceToWorld = FVoxelTransformRef::Make(*TargetActor);
-		Parameter->Data = TargetActor->SculptStorageComponent->GetData();
+		Parameter->SurfaceToWorld = FVoxelTransformRef::Make(TargetActor);
+		Parameter->Data = TargetActor.SculptStorageComponent->GetData();
 		Parameter->VoxelSize = VoxelSize;
 		Parameter->Compute = Compute;
 		QueryParameters->Add(Parameter);
 	}
 
-	const TOptional<FVoxelFloatBuffer> SurfaceDistances = FVoxelTaskGroup::TryRunSynchronously(NodeRuntime->GetContext(), [&]
+	const TOptional<FVoxelFloatBuffer> SurfaceDistances = FVoxelTaskGroup::TryRunSynchronously(SculptContext, [&]
 	{
 		const FVoxelQuery Query = FVoxelQuery::Make(
-			FVoxelQueryContext::Make(TargetActor->GetRuntime()->GetRuntimeInfoRef().AsShared()),
+			FVoxelQueryContext::Make(TargetActor.GetRuntime()->GetRuntimeInfoRef().AsShared()),
 			QueryParameters,
 			FVoxelDependencyTracker::Create("VoxelSculpt"))
-			.MakeNewQuery(NodeRuntime->GetContext());
+			.MakeNewQuery(SculptContext);
 
 		const TVoxelFutureValue<FVoxelSurface> Surface = NodeRuntime->GetNodeRuntime().Get(NodeRuntime->Node.NewSurfacePin, Query);
 		return
@@ -139,14 +221,14 @@ void UVoxelSculptFunctionLibrary::ApplySculpt(
 
 	if (!ensure(SurfaceDistances))
 	{
-		return;
+		return {};
 	}
 
 	if (SurfaceDistances->Num() != 1 &&
 		SurfaceDistances->Num() != IntBounds.Count_SmallBox())
 	{
 		VOXEL_MESSAGE(Error, "{0}: Surface has a different buffer size than Positions", NodeRuntime.Get());
-		return;
+		return {};
 	}
 
 	TVoxelArray<float> Distances;
@@ -159,6 +241,110 @@ void UVoxelSculptFunctionLibrary::ApplySculpt(
 		Distance /= VoxelSize;
 	}
 
-	TargetActor->SculptStorageComponent->GetData()->SetDistances(IntBounds, Distances);
+	TargetActor.SculptStorageComponent->GetData()->SetDistances(IntBounds, Distances);
+	TargetActor.MarkPackageDirty();
+
+	return IntBounds;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelSculptFunctionLibrary::BeginSculptStroke(AVoxelActor* TargetActor)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!TargetActor)
+	{
+		VOXEL_MESSAGE(Error, "TargetActor is null");
+		return;
+	}
+
+	if (!ensure(TargetActor->SculptStorageComponent))
+	{
+		return;
+	}
+
+	TargetActor->SculptStorageComponent->GetData()->BeginStroke();
+}
+
+void UVoxelSculptFunctionLibrary::EndSculptStroke(AVoxelActor* TargetActor)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!TargetActor)
+	{
+		VOXEL_MESSAGE(Error, "TargetActor is null");
+		return;
+	}
+
+	if (!ensure(TargetActor->SculptStorageComponent))
+	{
+		return;
+	}
+
+	TargetActor->SculptStorageComponent->GetData()->EndStroke();
+}
+
+bool UVoxelSculptFunctionLibrary::UndoSculpt(AVoxelActor* TargetActor)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!TargetActor)
+	{
+		VOXEL_MESSAGE(Error, "TargetActor is null");
+		return false;
+	}
+
+	if (!ensure(TargetActor->SculptStorageComponent))
+	{
+		return false;
+	}
+
+	if (TargetActor->SculptStorageComponent->IsReplicatingEdits())
+	{
+		// Late joiners don't have the history
+		VOXEL_MESSAGE(Error, "{0}: cannot undo replicated sculpt", TargetActor);
+		return false;
+	}
+
+	if (!TargetActor->SculptStorageComponent->GetData()->Undo())
+	{
+		return false;
+	}
+
+	TargetActor->MarkPackageDirty();
+	return true;
+}
+
+bool UVoxelSculptFunctionLibrary::RedoSculpt(AVoxelActor* TargetActor)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!TargetActor)
+	{
+		VOXEL_MESSAGE(Error, "TargetActor is null");
+		return false;
+	}
+
+	if (!ensure(TargetActor->SculptStorageComponent))
+	{
+		return false;
+	}
+
+	if (TargetActor->SculptStorageComponent->IsReplicatingEdits())
+	{
+		// Late joiners don't have the history
+		VOXEL_MESSAGE(Error, "{0}: cannot redo replicated sculpt", TargetActor);
+		return false;
+	}
+
+	if (!TargetActor->SculptStorageComponent->GetData()->Redo())
+	{
+		return false;
+	}
+
 	TargetActor->MarkPackageDirty();
+	return true;
 }
\ No newline at end of file
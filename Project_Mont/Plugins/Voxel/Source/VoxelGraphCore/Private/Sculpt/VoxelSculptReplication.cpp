@@ -0,0 +1,769 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#include "Sculpt/VoxelSculptReplication.h"
+#include "Sculpt/VoxelSculptStorage.h"
+#include "VoxelActor.h"
+#include "VoxelRuntime.h"
+#include "VoxelSurface.h"
+#include "VoxelTaskGroup.h"
+#include "VoxelDependency.h"
+#include "VoxelPositionQueryParameter.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Compression/OodleDataCompressionUtil.h"
+
+DEFINE_VOXEL_COUNTER(STAT_VoxelSculptReplicatedBytesPerSecond);
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelSculptSnapshotBytesPerTick, 32 * 1024,
+	"voxel.sculpt.SnapshotBytesPerTick",
+	"Max number of sculpt snapshot bytes sent to each late joiner per tick");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelSculptSnapshotChunkSize, 8 * 1024,
+	"voxel.sculpt.SnapshotChunkSize",
+	"Size of each reliable RPC used to send sculpt snapshots, needs to stay well below the max bunch size");
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelSculptEdit::SetSculptActorTransform(const FTransform& Transform)
+{
+	const FVector NewLocation = Transform.GetLocation();
+	const FRotator NewRotation = Transform.Rotator();
+	const FVector NewScale = Transform.GetScale3D();
+
+	Location = FInt64Vector(
+		FMath::RoundToInt64(NewLocation.X * 10.),
+		FMath::RoundToInt64(NewLocation.Y * 10.),
+		FMath::RoundToInt64(NewLocation.Z * 10.));
+
+	Rotation = FIntVector(
+		FRotator::CompressAxisToShort(NewRotation.Pitch),
+		FRotator::CompressAxisToShort(NewRotation.Yaw),
+		FRotator::CompressAxisToShort(NewRotation.Roll));
+
+	Scale = FIntVector(
+		FMath::RoundToInt(NewScale.X * 100.),
+		FMath::RoundToInt(NewScale.Y * 100.),
+		FMath::RoundToInt(NewScale.Z * 100.));
+}
+
+FTransform FVoxelSculptEdit::GetSculptActorTransform() const
+{
+	return FTransform(
+		FRotator(
+			FRotator::DecompressAxisFromShort(uint16(Rotation.X)),
+			FRotator::DecompressAxisFromShort(uint16(Rotation.Y)),
+			FRotator::DecompressAxisFromShort(uint16(Rotation.Z))),
+		FVector(Location.X, Location.Y, Location.Z) / 10.,
+		FVector(Scale.X, Scale.Y, Scale.Z) / 100.);
+}
+
+bool FVoxelSculptEdit::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	bOutSuccess = false;
+
+	if (!ensure(Map))
+	{
+		return true;
+	}
+
+	const auto SerializeInt = [](FArchive& Archive, int32& Value)
+	{
+		// Zigzag so that small negative values stay small
+		uint32 Packed = (uint32(Value) << 1) ^ uint32(Value >> 31);
+		Archive.SerializeIntPacked(Packed);
+		Value = int32(Packed >> 1) ^ -int32(Packed & 1);
+	};
+	const auto SerializeInt64 = [](FArchive& Archive, int64& Value)
+	{
+		uint64 Packed = (uint64(Value) << 1) ^ uint64(Value >> 63);
+		Archive.SerializeIntPacked64(Packed);
+		Value = int64(Packed >> 1) ^ -int64(Packed & 1);
+	};
+
+	const auto SerializeImpl = [&](FArchive& Archive)
+	{
+		Archive.SerializeIntPacked(SequenceId);
+
+		// When loading, the object is null if it isn't replicated to us yet: ApplyEdit resolves it later from the NetGUID
+		UObject* Object = SculptActor.Get();
+		if (!Map->SerializeObject(Archive, AVoxelActor::StaticClass(), Object, &SculptActorNetGUID) &&
+			Archive.IsSaving())
+		{
+			return false;
+		}
+		SculptActor = Cast<AVoxelActor>(Object);
+
+		// Bounds are chunk aligned, send them in chunks
+		FIntVector ChunkMin = FVoxelUtilities::DivideFloor(Bounds.Min, FVoxelSculptStorageData::ChunkSize);
+		FIntVector ChunkSize = Bounds.Size() / FVoxelSculptStorageData::ChunkSize;
+		for (int32 Index = 0; Index < 3; Index++)
+		{
+			SerializeInt(Archive, ChunkMin[Index]);
+			SerializeInt(Archive, ChunkSize[Index]);
+		}
+		Bounds = FVoxelIntBox(
+			ChunkMin * FVoxelSculptStorageData::ChunkSize,
+			(ChunkMin + ChunkSize) * FVoxelSculptStorageData::ChunkSize);
+
+		for (int32 Index = 0; Index < 3; Index++)
+		{
+			SerializeInt64(Archive, Location[Index]);
+
+			uint16 CompressedRotation = uint16(Rotation[Index]);
+			Archive << CompressedRotation;
+			Rotation[Index] = CompressedRotation;
+
+			SerializeInt(Archive, Scale[Index]);
+		}
+
+		return !Archive.IsError();
+	};
+
+	if (Ar.IsSaving())
+	{
+		ensure(Bounds.IsMultipleOf(FVoxelSculptStorageData::ChunkSize));
+
+		// Write to a separate writer to track how many bytes are sent
+		FBitWriter Writer(0, true);
+		if (!SerializeImpl(Writer))
+		{
+			return true;
+		}
+
+		Ar.SerializeBits(Writer.GetData(), Writer.GetNumBits());
+		FVoxelSculptReplicationUtilities::AddReplicatedBytes(Writer.GetNumBytes());
+	}
+	else if (ensure(Ar.IsLoading()))
+	{
+		if (!SerializeImpl(Ar))
+		{
+			return true;
+		}
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool FVoxelSculptSnapshotBuilder::BuildAsync(
+	const AVoxelActor& Actor,
+	const FVoxelSculptStorageData& Data,
+	FOnBuilt&& OnBuilt)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	using FChunk = FVoxelSculptStorageData::FChunk;
+	constexpr int32 ChunkSize = FVoxelSculptStorageData::ChunkSize;
+	constexpr int32 ChunkCount = FVoxelSculptStorageData::ChunkCount;
+
+	struct FState
+	{
+		FVoxelFastCriticalSection CriticalSection;
+		TVoxelMap<FIntVector, FChunkDelta> KeyToChunkDelta_RequiresLock;
+		FThreadSafeCounter NumPending;
+		FOnBuilt OnBuilt;
+	};
+	const TSharedRef<FState> State = MakeVoxelShared<FState>();
+	State->OnBuilt = MoveTemp(OnBuilt);
+
+	const TVoxelArray<TPair<FIntVector, TSharedRef<FChunk>>> Chunks = Data.GetChunks();
+
+	TVoxelArray<TPair<FIntVector, TSharedRef<FChunk>>> ChunksToCompute;
+	State->KeyToChunkDelta_RequiresLock.Reserve(Chunks.Num());
+
+	for (const TPair<FIntVector, TSharedRef<FChunk>>& It : Chunks)
+	{
+		// Chunks are never written to once added, the delta is still valid if the chunk is the same
+		if (const FChunkDelta* ChunkDelta = KeyToChunkDelta.Find(It.Key))
+		{
+			if (ChunkDelta->Chunk.Pin() == It.Value)
+			{
+				State->KeyToChunkDelta_RequiresLock.Add_CheckNew(It.Key, *ChunkDelta);
+				continue;
+			}
+		}
+
+		ChunksToCompute.Add(It);
+	}
+
+	const TSharedPtr<const FSourceSurface> SourceSurface = ChunksToCompute.Num() > 0 ? FindSourceSurface(Actor) : nullptr;
+	if (ChunksToCompute.Num() > 0 &&
+		!SourceSurface)
+	{
+		return false;
+	}
+
+	const auto Finalize = [WeakThis = AsWeak(), State]
+	{
+		check(IsInGameThread());
+
+		const TSharedPtr<FVoxelSculptSnapshotBuilder> This = WeakThis.Pin();
+		if (!This)
+		{
+			return;
+		}
+
+		This->KeyToChunkDelta = MoveTemp(State->KeyToChunkDelta_RequiresLock);
+
+		const TSharedRef<TArray<uint8>> SnapshotData = MakeVoxelShared<TArray<uint8>>();
+		FMemoryWriter Writer(*SnapshotData);
+
+		int32 NumChunks = This->KeyToChunkDelta.Num();
+		Writer << NumChunks;
+
+		for (const auto& It : This->KeyToChunkDelta)
+		{
+			FIntVector Key = It.Key;
+			int32 CompressedSize = It.Value.CompressedDelta->Num();
+
+			Writer << Key;
+			Writer << CompressedSize;
+			Writer.Serialize(ConstCast(It.Value.CompressedDelta->GetData()), CompressedSize);
+		}
+
+		State->OnBuilt(SnapshotData);
+	};
+
+	if (ChunksToCompute.Num() == 0)
+	{
+		Finalize();
+		return true;
+	}
+
+	State->NumPending.Set(ChunksToCompute.Num());
+
+	for (const TPair<FIntVector, TSharedRef<FChunk>>& It : ChunksToCompute)
+	{
+		ComputeSourceDistancesAsync(
+			*SourceSurface,
+			FVoxelIntBox(It.Key * ChunkSize, (It.Key + 1) * ChunkSize),
+			[State, Key = It.Key, Chunk = It.Value, Finalize](const TConstVoxelArrayView<float> SourceDistances)
+			{
+				VOXEL_SCOPE_COUNTER("Compress sculpt chunk delta");
+
+				if (ensure(SourceDistances.Num() == ChunkCount))
+				{
+					if (!Chunk->IsLoaded())
+					{
+						Chunk->Load();
+					}
+
+					FVoxelSculptStorageData::FDenseChunk Densities(NoInit);
+					Chunk->CopyTo(Densities);
+
+					// Wrap around, the client does the opposite with the same source
+					TVoxelArray<uint16> Delta;
+					FVoxelUtilities::SetNumFast(Delta, ChunkCount);
+					for (int32 Index = 0; Index < ChunkCount; Index++)
+					{
+						Delta[Index] = uint16(uint16(Densities[Index]) - uint16(FVoxelSculptStorageData::ToDensity(SourceDistances[Index])));
+					}
+
+					const TSharedRef<TArray64<uint8>> CompressedDelta = MakeVoxelShared<TArray64<uint8>>();
+					ensure(FOodleCompressedArray::CompressData64(
+						*CompressedDelta,
+						Delta.GetData(),
+						Delta.Num() * Delta.GetTypeSize(),
+						FOodleDataCompression::ECompressor::Kraken,
+						FOodleDataCompression::ECompressionLevel::Normal));
+
+					VOXEL_SCOPE_LOCK(State->CriticalSection);
+
+					FChunkDelta& ChunkDelta = State->KeyToChunkDelta_RequiresLock.Add_CheckNew(Key);
+					ChunkDelta.Chunk = Chunk;
+					ChunkDelta.CompressedDelta = CompressedDelta;
+				}
+
+				if (State->NumPending.Decrement() == 0)
+				{
+					FVoxelUtilities::RunOnGameThread(CopyTemp(Finalize));
+				}
+			});
+	}
+
+	return true;
+}
+
+bool FVoxelSculptSnapshotBuilder::ApplyAsync(
+	const AVoxelActor& Actor,
+	const TSharedRef<FVoxelSculptStorageData>& Data,
+	const TSharedRef<const TArray<uint8>>& SnapshotData,
+	FOnApplied&& OnApplied)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	using FChunk = FVoxelSculptStorageData::FChunk;
+	constexpr int32 ChunkSize = FVoxelSculptStorageData::ChunkSize;
+	constexpr int32 ChunkCount = FVoxelSculptStorageData::ChunkCount;
+
+	struct FCompressedChunk
+	{
+		FIntVector Key;
+		// View into SnapshotData
+		TConstArrayView64<uint8> CompressedDelta;
+	};
+	TVoxelArray<FCompressedChunk> CompressedChunks;
+	{
+		FMemoryReader Reader(*SnapshotData);
+
+		int32 NumChunks = 0;
+		Reader << NumChunks;
+
+		if (!ensure(NumChunks >= 0))
+		{
+			NumChunks = 0;
+		}
+		CompressedChunks.Reserve(NumChunks);
+
+		for (int32 Index = 0; Index < NumChunks; Index++)
+		{
+			FIntVector Key;
+			int32 CompressedSize = 0;
+
+			Reader << Key;
+			Reader << CompressedSize;
+
+			if (!ensure(!Reader.IsError()) ||
+				!ensure(CompressedSize >= 0) ||
+				!ensure(Reader.Tell() + CompressedSize <= SnapshotData->Num()))
+			{
+				break;
+			}
+
+			CompressedChunks.Add(FCompressedChunk
+			{
+				Key,
+				TConstArrayView64<uint8>(SnapshotData->GetData() + Reader.Tell(), CompressedSize)
+			});
+
+			Reader.Seek(Reader.Tell() + CompressedSize);
+		}
+	}
+
+	const TSharedPtr<const FSourceSurface> SourceSurface = CompressedChunks.Num() > 0 ? FindSourceSurface(Actor) : nullptr;
+	if (CompressedChunks.Num() > 0 &&
+		!SourceSurface)
+	{
+		return false;
+	}
+
+	struct FState
+	{
+		FVoxelFastCriticalSection CriticalSection;
+		TVoxelArray<TPair<FIntVector, TSharedRef<FChunk>>> NewChunks_RequiresLock;
+		FThreadSafeCounter NumPending;
+		FOnApplied OnApplied;
+	};
+	const TSharedRef<FState> State = MakeVoxelShared<FState>();
+	State->NewChunks_RequiresLock.Reserve(CompressedChunks.Num());
+	State->OnApplied = MoveTemp(OnApplied);
+
+	const auto Finalize = [WeakData = MakeWeakPtr(Data), State]
+	{
+		check(IsInGameThread());
+
+		const TSharedPtr<FVoxelSculptStorageData> PinnedData = WeakData.Pin();
+		if (!PinnedData)
+		{
+			return;
+		}
+
+		PinnedData->SetChunks(State->NewChunks_RequiresLock);
+		State->OnApplied();
+	};
+
+	if (CompressedChunks.Num() == 0)
+	{
+		Finalize();
+		return true;
+	}
+
+	State->NumPending.Set(CompressedChunks.Num());
+
+	for (const FCompressedChunk& CompressedChunk : CompressedChunks)
+	{
+		ComputeSourceDistancesAsync(
+			*SourceSurface,
+			FVoxelIntBox(CompressedChunk.Key * ChunkSize, (CompressedChunk.Key + 1) * ChunkSize),
+			[State, SnapshotData, CompressedChunk, Finalize](const TConstVoxelArrayView<float> SourceDistances)
+			{
+				VOXEL_SCOPE_COUNTER("Decompress sculpt chunk delta");
+
+				TArray64<uint8> CompressedDelta(CompressedChunk.CompressedDelta);
+
+				TArray64<uint8> Delta;
+				if (ensure(SourceDistances.Num() == ChunkCount) &&
+					ensure(FOodleCompressedArray::DecompressToTArray64(Delta, CompressedDelta)) &&
+					ensure(Delta.Num() == ChunkCount * sizeof(uint16)))
+				{
+					const uint16* DeltaData = reinterpret_cast<const uint16*>(Delta.GetData());
+
+					const TSharedRef<FChunk> Chunk = MakeVoxelShared<FChunk>();
+					FVoxelSculptStorageData::FDenseChunk& Densities = Chunk->GetDenseData();
+					for (int32 Index = 0; Index < ChunkCount; Index++)
+					{
+						const uint16 Source = uint16(FVoxelSculptStorageData::ToDensity(SourceDistances[Index]));
+						Densities[Index] = FVoxelSculptStorageData::FDensity(uint16(Source + DeltaData[Index]));
+					}
+					Chunk->Compact();
+
+					VOXEL_SCOPE_LOCK(State->CriticalSection);
+					State->NewChunks_RequiresLock.Add({ CompressedChunk.Key, Chunk });
+				}
+
+				if (State->NumPending.Decrement() == 0)
+				{
+					FVoxelUtilities::RunOnGameThread(CopyTemp(Finalize));
+				}
+			});
+	}
+
+	return true;
+}
+
+TSharedPtr<const FVoxelSculptSnapshotBuilder::FSourceSurface> FVoxelSculptSnapshotBuilder::FindSourceSurface(const AVoxelActor& Actor)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const TSharedPtr<FVoxelRuntime> Runtime = Actor.GetRuntime();
+	if (!Runtime)
+	{
+		return nullptr;
+	}
+
+	const TSharedPtr<const FVoxelRuntimeParameter_SculptStorage> SculptStorageParameter = Actor.DefaultRuntimeParameters.Find<FVoxelRuntimeParameter_SculptStorage>();
+	if (!ensure(SculptStorageParameter))
+	{
+		return nullptr;
+	}
+
+	const TSharedRef<FSourceSurface> SourceSurface = MakeVoxelShared<FSourceSurface>();
+	{
+		VOXEL_SCOPE_LOCK(SculptStorageParameter->CriticalSection);
+		SourceSurface->VoxelSize = SculptStorageParameter->VoxelSize;
+		SourceSurface->Compute = SculptStorageParameter->Compute_RequiresLock;
+	}
+
+	if (!SourceSurface->Compute)
+	{
+		return nullptr;
+	}
+
+	SourceSurface->Context = FVoxelQueryContext::Make(Runtime->GetRuntimeInfoRef().AsShared());
+	return SourceSurface;
+}
+
+void FVoxelSculptSnapshotBuilder::ComputeSourceDistancesAsync(
+	const FSourceSurface& SourceSurface,
+	const FVoxelIntBox& Bounds,
+	TFunction<void(TConstVoxelArrayView<float> Distances)> OnComputed)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const float VoxelSize = SourceSurface.VoxelSize;
+
+	const TSharedRef<FVoxelQueryParameters> QueryParameters = MakeVoxelShared<FVoxelQueryParameters>();
+	QueryParameters->Add<FVoxelLODQueryParameter>().LOD = 0;
+	// Baked into the sculpt data, can't be refined once streamed data finishes loading
+	QueryParameters->Add<FVoxelPersistentQueryParameter>();
+	QueryParameters->Add<FVoxelPositionQueryParameter>().InitializeGrid(FVector3f(Bounds.Min) * VoxelSize, VoxelSize, Bounds.Size());
+
+	FVoxelTaskGroup::StartAsyncTask<FVoxelFloatBuffer>(
+		STATIC_FNAME("SculptSnapshotSourceDistances"),
+		SourceSurface.Context.ToSharedRef(),
+		[Context = SourceSurface.Context.ToSharedRef(), Compute = SourceSurface.Compute, QueryParameters]() -> TVoxelFutureValue<FVoxelFloatBuffer>
+		{
+			const FVoxelQuery Query = FVoxelQuery::Make(
+				Context,
+				QueryParameters,
+				FVoxelDependencyTracker::Create("VoxelSculptReplication"));
+
+			const TVoxelFutureValue<FVoxelSurface> Surface = (*Compute)(Query);
+			return
+				MakeVoxelTask()
+				.Dependency(Surface)
+				.Execute<FVoxelFloatBuffer>([=]
+				{
+					return Surface.Get_CheckCompleted().GetDistance(Query);
+				});
+		},
+		[Bounds, VoxelSize, OnComputed = MoveTemp(OnComputed)](const FVoxelFloatBuffer& SurfaceDistances)
+		{
+			if (!ensure(SurfaceDistances.Num() == 1 || SurfaceDistances.Num() == Bounds.Count_SmallBox()))
+			{
+				OnComputed({});
+				return;
+			}
+
+			TVoxelArray<float> Distances;
+			FVoxelUtilities::SetNumFast(Distances, Bounds.Count_SmallBox());
+
+			SurfaceDistances.GetStorage().CopyTo(Distances);
+
+			for (float& Distance : Distances)
+			{
+				Distance /= VoxelSize;
+			}
+
+			OnComputed(Distances);
+		});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+UVoxelSculptSnapshotStreamer::UVoxelSculptSnapshotStreamer()
+{
+	SetIsReplicatedByDefault(true);
+
+	// Only enabled while snapshots are being sent
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UVoxelSculptSnapshotStreamer::BeginPlay()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	Super::BeginPlay();
+
+	const APlayerController* PlayerController = Cast<APlayerController>(GetOwner());
+	if (!PlayerController ||
+		PlayerController->HasAuthority() ||
+		!PlayerController->IsLocalController())
+	{
+		return;
+	}
+
+	// Storages that began play before the player controller was replicated
+	ForEachObjectOfClass<UVoxelSculptStorage>([&](UVoxelSculptStorage* Storage)
+	{
+		if (Storage->GetWorld() == GetWorld())
+		{
+			Storage->RequestSnapshot();
+		}
+	});
+}
+
+void UVoxelSculptSnapshotStreamer::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	ON_SCOPE_EXIT
+	{
+		SetComponentTickEnabled(PendingSnapshots.Num() > 0);
+	};
+
+	UNetConnection* Connection = GetOwner()->GetNetConnection();
+	if (!Connection)
+	{
+		PendingSnapshots.Reset();
+		return;
+	}
+
+	int32 NumBytesLeft = GVoxelSculptSnapshotBytesPerTick;
+	while (
+		PendingSnapshots.Num() > 0 &&
+		NumBytesLeft > 0 &&
+		// Don't fill the reliable buffer, the rest is sent on the next ticks
+		Connection->IsNetReady(false))
+	{
+		FPendingSnapshot& Snapshot = PendingSnapshots[0];
+
+		UVoxelSculptStorage* Storage = Snapshot.Storage.Get();
+		if (!Storage)
+		{
+			PendingSnapshots.RemoveAt(0);
+			continue;
+		}
+
+		const int32 TotalSize = Snapshot.Data->Num();
+		const int32 NumToSend = FMath::Min3(
+			TotalSize - Snapshot.NumSent,
+			NumBytesLeft,
+			FMath::Max(GVoxelSculptSnapshotChunkSize, 1));
+
+		ClientReceiveSnapshotChunk(
+			Storage,
+			Snapshot.SequenceId,
+			TotalSize,
+			TArray<uint8>(Snapshot.Data->GetData() + Snapshot.NumSent, NumToSend));
+
+		FVoxelSculptReplicationUtilities::AddReplicatedBytes(NumToSend);
+
+		Snapshot.NumSent += NumToSend;
+		NumBytesLeft -= NumToSend;
+
+		if (Snapshot.NumSent == TotalSize)
+		{
+			PendingSnapshots.RemoveAt(0);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelSculptSnapshotStreamer::AddToPlayerController(APlayerController& PlayerController)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	if (!ensure(PlayerController.HasAuthority()) ||
+		PlayerController.FindComponentByClass<UVoxelSculptSnapshotStreamer>())
+	{
+		return;
+	}
+
+	UVoxelSculptSnapshotStreamer* Streamer = NewObject<UVoxelSculptSnapshotStreamer>(&PlayerController);
+	Streamer->RegisterComponent();
+}
+
+UVoxelSculptSnapshotStreamer* UVoxelSculptSnapshotStreamer::FindLocal(const UWorld* World)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	const APlayerController* PlayerController = World->GetFirstPlayerController();
+	if (!PlayerController ||
+		!PlayerController->IsLocalController())
+	{
+		return nullptr;
+	}
+
+	UVoxelSculptSnapshotStreamer* Streamer = PlayerController->FindComponentByClass<UVoxelSculptSnapshotStreamer>();
+	if (!Streamer ||
+		!Streamer->HasBegunPlay())
+	{
+		return nullptr;
+	}
+	return Streamer;
+}
+
+void UVoxelSculptSnapshotStreamer::RequestSnapshot(UVoxelSculptStorage& Storage)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	ServerRequestSnapshot(&Storage);
+}
+
+void UVoxelSculptSnapshotStreamer::SendSnapshot(
+	UVoxelSculptStorage& Storage,
+	const uint32 SequenceId,
+	const TSharedRef<const TArray<uint8>>& SnapshotData)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	FPendingSnapshot& Snapshot = PendingSnapshots.Emplace_GetRef();
+	Snapshot.Storage = &Storage;
+	Snapshot.SequenceId = SequenceId;
+	Snapshot.Data = SnapshotData;
+
+	SetComponentTickEnabled(true);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelSculptSnapshotStreamer::ServerRequestSnapshot_Implementation(UVoxelSculptStorage* Storage)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!Storage ||
+		!Storage->IsReplicatingEdits())
+	{
+		return;
+	}
+
+	Storage->AddSnapshotRequest(*this);
+}
+
+void UVoxelSculptSnapshotStreamer::ClientReceiveSnapshotChunk_Implementation(
+	UVoxelSculptStorage* Storage,
+	const uint32 SequenceId,
+	const int32 TotalSize,
+	const TArray<uint8>& Chunk)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!Storage)
+	{
+		// Storage was destroyed or streamed out
+		return;
+	}
+
+	Storage->ReceiveSnapshotChunk(SequenceId, TotalSize, Chunk);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+VOXEL_RUN_ON_STARTUP_GAME(RegisterVoxelSculptSnapshotStreamer)
+{
+	FGameModeEvents::GameModePostLoginEvent.AddLambda([](AGameModeBase*, APlayerController* PlayerController)
+	{
+		if (!PlayerController ||
+			PlayerController->IsLocalController())
+		{
+			// Listen server host doesn't need snapshots
+			return;
+		}
+
+		UVoxelSculptSnapshotStreamer::AddToPlayerController(*PlayerController);
+	});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelSculptReplicationUtilities::AddReplicatedBytes(const int64 NumBytes)
+{
+	check(IsInGameThread());
+
+	static double WindowStartTime = FPlatformTime::Seconds();
+	static int64 WindowNumBytes = 0;
+	static int64 LastBytesPerSecond = 0;
+
+	WindowNumBytes += NumBytes;
+
+	const double Time = FPlatformTime::Seconds();
+	if (Time - WindowStartTime < 1.)
+	{
+		return;
+	}
+
+	const int64 BytesPerSecond = FMath::RoundToInt64(WindowNumBytes / (Time - WindowStartTime));
+
+	DEC_VOXEL_COUNTER_BY(STAT_VoxelSculptReplicatedBytesPerSecond, LastBytesPerSecond);
+	INC_VOXEL_COUNTER_BY(STAT_VoxelSculptReplicatedBytesPerSecond, BytesPerSecond);
+
+	LastBytesPerSecond = BytesPerSecond;
+	WindowStartTime = Time;
+	WindowNumBytes = 0;
+}
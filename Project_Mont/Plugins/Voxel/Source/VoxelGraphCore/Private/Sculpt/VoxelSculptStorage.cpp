@@ -2,6 +2,25 @@
 
 #include "Sculpt/VoxelSculptStorage.h"
 #include "Sculpt/VoxelSculptStorageData.h"
+#include "Sculpt/VoxelSculptFunctionLibrary.h"
+#include "VoxelActor.h"
+#include "Engine/NetDriver.h"
+#include "Engine/PackageMapClient.h"
+#include "GameFramework/PlayerController.h"
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, float, GVoxelSculptMaxSculptActorWaitTime, 30.f,
+	"voxel.sculpt.MaxSculptActorWaitTime",
+	"Max time in seconds a replicated sculpt edit waits for its sculpt actor to be replicated before being skipped");
+
+UVoxelSculptStorage::UVoxelSculptStorage()
+{
+	SetIsReplicatedByDefault(true);
+
+	// Only enabled while replicated edits are waiting for the runtimes
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
 
 void UVoxelSculptStorage::Serialize(FArchive& Ar)
 {
@@ -25,6 +44,66 @@ void UVoxelSculptStorage::Serialize(FArchive& Ar)
 	});
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelSculptStorage::BeginPlay()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	Super::BeginPlay();
+
+	const AActor* Owner = GetOwner();
+	if (!IsReplicatingEdits() ||
+		!ensure(Owner))
+	{
+		return;
+	}
+
+	if (Owner->HasAuthority())
+	{
+		// Player controllers that logged in before this storage was loaded
+		for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+		{
+			APlayerController* PlayerController = It->Get();
+			if (PlayerController &&
+				!PlayerController->IsLocalController())
+			{
+				UVoxelSculptSnapshotStreamer::AddToPlayerController(*PlayerController);
+			}
+		}
+		return;
+	}
+
+	// Edits received before the snapshot is applied are queued
+	SnapshotState = EVoxelSculptSnapshotState::WaitingForStreamer;
+	RequestSnapshot();
+}
+
+void UVoxelSculptStorage::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Roll the bytes/s window even when nothing is sent
+	FVoxelSculptReplicationUtilities::AddReplicatedBytes(0);
+}
+
+void UVoxelSculptStorage::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	FlushPendingEdits();
+	ProcessSnapshotRequests();
+	UpdateTickEnabled();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 void UVoxelSculptStorage::ClearData()
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -48,4 +127,369 @@ TSharedRef<FVoxelSculptStorageData> UVoxelSculptStorage::GetData()
 		Data = MakeVoxelShared<FVoxelSculptStorageData>(GetFName());
 	}
 	return Data.ToSharedRef();
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool UVoxelSculptStorage::IsReplicatingEdits() const
+{
+	const AVoxelActor* Owner = Cast<AVoxelActor>(GetOwner());
+	return
+		Owner &&
+		Owner->bReplicateSculpt &&
+		Owner->GetIsReplicated() &&
+		Owner->GetNetMode() != NM_Standalone;
+}
+
+void UVoxelSculptStorage::ApplyReplicatedEdit(AVoxelActor& SculptActor)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	AVoxelActor* Owner = Cast<AVoxelActor>(GetOwner());
+	if (!ensure(Owner) ||
+		!ensure(Owner->HasAuthority()))
+	{
+		return;
+	}
+
+	if (!SculptActor.IsNameStableForNetworking() &&
+		!SculptActor.GetIsReplicated())
+	{
+		VOXEL_MESSAGE(Error, "{0}: sculpt actor {1} is neither placed in the level nor replicated, clients can't apply its edits", Owner, &SculptActor);
+		return;
+	}
+
+	FVoxelSculptEdit Edit;
+	Edit.SequenceId = LastSequenceId + 1;
+	Edit.SculptActor = &SculptActor;
+	Edit.SetSculptActorTransform(SculptActor.GetActorTransform());
+
+	// Apply with the quantized transform so that the server matches the clients
+	const TOptional<FVoxelIntBox> Bounds = UVoxelSculptFunctionLibrary::ApplySculptLocal(
+		*Owner,
+		SculptActor,
+		Edit.GetSculptActorTransform());
+
+	if (!Bounds)
+	{
+		return;
+	}
+
+	Edit.Bounds = Bounds.GetValue();
+	LastSequenceId = Edit.SequenceId;
+
+	// Outdated, new requests need this edit
+	SnapshotData.Reset();
+
+	MulticastEdit(Edit);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelSculptStorage::AddSnapshotRequest(UVoxelSculptSnapshotStreamer& Streamer)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	const AActor* Owner = GetOwner();
+	if (!ensure(Owner) ||
+		!ensure(Owner->HasAuthority()))
+	{
+		return;
+	}
+
+	// The client receives all the edits made after its request through MulticastEdit
+	FSnapshotRequest& Request = SnapshotRequests.Emplace_GetRef();
+	Request.Streamer = &Streamer;
+	Request.SequenceId = LastSequenceId;
+
+	ProcessSnapshotRequests();
+	UpdateTickEnabled();
+}
+
+void UVoxelSculptStorage::ProcessSnapshotRequests()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (SnapshotData)
+	{
+		SnapshotRequests.RemoveAll([&](const FSnapshotRequest& Request)
+		{
+			if (Request.SequenceId > SnapshotSequenceId)
+			{
+				return false;
+			}
+
+			if (UVoxelSculptSnapshotStreamer* Streamer = Request.Streamer.Get())
+			{
+				Streamer->SendSnapshot(*this, SnapshotSequenceId, SnapshotData.ToSharedRef());
+			}
+			return true;
+		});
+	}
+
+	if (SnapshotRequests.Num() == 0 ||
+		bIsBuildingSnapshot)
+	{
+		return;
+	}
+
+	const AVoxelActor* Owner = Cast<AVoxelActor>(GetOwner());
+	if (!ensure(Owner) ||
+		!Owner->IsRuntimeCreated())
+	{
+		return;
+	}
+
+	const uint32 SequenceId = LastSequenceId;
+
+	// Will retry on the next tick if the source isn't ready
+	bIsBuildingSnapshot = SnapshotBuilder->BuildAsync(
+		*Owner,
+		*GetData(),
+		[WeakThis = TWeakObjectPtr<UVoxelSculptStorage>(this), SequenceId](const TSharedRef<const TArray<uint8>>& NewSnapshotData)
+		{
+			UVoxelSculptStorage* This = WeakThis.Get();
+			if (!This)
+			{
+				return;
+			}
+
+			This->bIsBuildingSnapshot = false;
+			This->SnapshotSequenceId = SequenceId;
+			This->SnapshotData = NewSnapshotData;
+
+			// Requests made during the build
+			This->ProcessSnapshotRequests();
+			This->UpdateTickEnabled();
+		});
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelSculptStorage::RequestSnapshot()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (SnapshotState != EVoxelSculptSnapshotState::WaitingForStreamer)
+	{
+		return;
+	}
+
+	UVoxelSculptSnapshotStreamer* Streamer = UVoxelSculptSnapshotStreamer::FindLocal(GetWorld());
+	if (!Streamer)
+	{
+		// Requested in UVoxelSculptSnapshotStreamer::BeginPlay
+		return;
+	}
+
+	Streamer->RequestSnapshot(*this);
+	SnapshotState = EVoxelSculptSnapshotState::Requested;
+}
+
+void UVoxelSculptStorage::ReceiveSnapshotChunk(
+	const uint32 SequenceId,
+	const int32 TotalSize,
+	const TConstArrayView<uint8> Chunk)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!ensure(SnapshotState == EVoxelSculptSnapshotState::Requested))
+	{
+		return;
+	}
+
+	if (ReceivedSnapshotData.Num() == 0)
+	{
+		ReceivedSnapshotData.Reserve(TotalSize);
+	}
+	ReceivedSnapshotData.Append(Chunk);
+
+	if (ReceivedSnapshotData.Num() < TotalSize)
+	{
+		return;
+	}
+	ensure(ReceivedSnapshotData.Num() == TotalSize);
+
+	SnapshotState = EVoxelSculptSnapshotState::Received;
+	ReceivedSnapshotSequenceId = SequenceId;
+
+	FlushPendingEdits();
+	UpdateTickEnabled();
+}
+
+void UVoxelSculptStorage::MulticastEdit_Implementation(const FVoxelSculptEdit& Edit)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const AActor* Owner = GetOwner();
+	if (!Owner ||
+		Owner->HasAuthority())
+	{
+		// Already applied in ApplyReplicatedEdit
+		return;
+	}
+
+	PendingEdits.Add(Edit);
+	FlushPendingEdits();
+	UpdateTickEnabled();
+}
+
+bool UVoxelSculptStorage::ApplyEdit(const FVoxelSculptEdit& Edit)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	AVoxelActor* Owner = Cast<AVoxelActor>(GetOwner());
+	if (!Owner ||
+		!Owner->IsRuntimeCreated())
+	{
+		return false;
+	}
+
+	AVoxelActor* SculptActor = Edit.SculptActor.Get();
+	if (!SculptActor &&
+		Edit.SculptActorNetGUID.IsValid())
+	{
+		// The edit might have been received before the sculpt actor was replicated
+		const UNetDriver* NetDriver = Owner->GetNetDriver();
+		if (NetDriver &&
+			NetDriver->GuidCache)
+		{
+			SculptActor = Cast<AVoxelActor>(NetDriver->GuidCache->GetObjectFromNetGUID(Edit.SculptActorNetGUID, false));
+		}
+	}
+
+	if (!SculptActor)
+	{
+		const double Time = FPlatformTime::Seconds();
+		if (SculptActorWaitStartTime == 0)
+		{
+			SculptActorWaitStartTime = Time;
+		}
+
+		if (Edit.SculptActorNetGUID.IsValid() &&
+			Time - SculptActorWaitStartTime < GVoxelSculptMaxSculptActorWaitTime)
+		{
+			// Not replicated yet
+			return false;
+		}
+
+		LOG_VOXEL(Error, "%s: skipping sculpt edit %u, its sculpt actor can't be resolved. Sculpt data will diverge from the server",
+			*GetPathName(),
+			Edit.SequenceId);
+
+		SculptActorWaitStartTime = 0;
+		return true;
+	}
+	SculptActorWaitStartTime = 0;
+
+	if (!SculptActor->IsRuntimeCreated())
+	{
+		return false;
+	}
+
+	UVoxelSculptFunctionLibrary::ApplySculptLocal(
+		*Owner,
+		*SculptActor,
+		Edit.GetSculptActorTransform(),
+		Edit.Bounds);
+
+	return true;
+}
+
+void UVoxelSculptStorage::FlushPendingEdits()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (SnapshotState == EVoxelSculptSnapshotState::Received)
+	{
+		const AVoxelActor* Owner = Cast<AVoxelActor>(GetOwner());
+		if (!Owner ||
+			!Owner->IsRuntimeCreated())
+		{
+			return;
+		}
+
+		const TSharedRef<const TArray<uint8>> NewSnapshotData = MakeVoxelShared<TArray<uint8>>(MoveTemp(ReceivedSnapshotData));
+		ReceivedSnapshotData.Reset();
+
+		if (!FVoxelSculptSnapshotBuilder::ApplyAsync(
+			*Owner,
+			GetData(),
+			NewSnapshotData,
+			[WeakThis = TWeakObjectPtr<UVoxelSculptStorage>(this)]
+			{
+				UVoxelSculptStorage* This = WeakThis.Get();
+				if (!This)
+				{
+					return;
+				}
+
+				This->SnapshotState = EVoxelSculptSnapshotState::None;
+				This->LastSequenceId = This->ReceivedSnapshotSequenceId;
+
+				This->FlushPendingEdits();
+				This->UpdateTickEnabled();
+			}))
+		{
+			// Source isn't ready, retry on the next tick
+			ReceivedSnapshotData = *NewSnapshotData;
+			return;
+		}
+
+		// ApplyAsync might have already completed
+		if (SnapshotState == EVoxelSculptSnapshotState::Received)
+		{
+			SnapshotState = EVoxelSculptSnapshotState::Applying;
+		}
+	}
+
+	if (SnapshotState != EVoxelSculptSnapshotState::None)
+	{
+		return;
+	}
+
+	int32 NumProcessed = 0;
+	for (const FVoxelSculptEdit& Edit : PendingEdits)
+	{
+		if (Edit.SequenceId <= LastSequenceId)
+		{
+			// Already in the snapshot
+			NumProcessed++;
+			continue;
+		}
+
+		if (Edit.SequenceId != LastSequenceId + 1)
+		{
+			LOG_VOXEL(Warning, "%s: missing sculpt edits %u to %u, sculpt data will diverge from the server",
+				*GetPathName(),
+				LastSequenceId + 1,
+				Edit.SequenceId - 1);
+		}
+
+		if (!ApplyEdit(Edit))
+		{
+			break;
+		}
+
+		LastSequenceId = Edit.SequenceId;
+		NumProcessed++;
+	}
+
+	PendingEdits.RemoveAt(0, NumProcessed);
+}
+
+void UVoxelSculptStorage::UpdateTickEnabled()
+{
+	SetComponentTickEnabled(
+		SnapshotState == EVoxelSculptSnapshotState::Received ||
+		(SnapshotState == EVoxelSculptSnapshotState::None && PendingEdits.Num() > 0) ||
+		(SnapshotRequests.Num() > 0 && !bIsBuildingSnapshot));
+}
@@ -6,6 +6,241 @@
 #include "Serialization/LargeMemoryReader.h"
 #include "Compression/OodleDataCompressionUtil.h"
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, float, GVoxelSculptMaxUndoMemory, 64.f,
+	"voxel.sculpt.MaxUndoMemory",
+	"Max memory in MB used to store sculpt chunks replaced by strokes that can be undone. Oldest strokes are discarded first");
+
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelSculptStorageMemory);
+
+int64 FVoxelSculptStorageData::FChunk::GetAllocatedSize() const
+{
+	int64 AllocatedSize = GetAllocatedSize_NoCompressedData();
+	if (CompressedData_RequiresLock)
+	{
+		AllocatedSize += CompressedData_RequiresLock->GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+FVoxelSculptStorageData::FDenseChunk& FVoxelSculptStorageData::FChunk::GetDenseData()
+{
+	if (!IsLoaded())
+	{
+		Load();
+	}
+
+	{
+		// Chunk is being written to, cached compressed data is now outdated
+		VOXEL_SCOPE_LOCK(CompressionCriticalSection);
+		CompressedData_RequiresLock.Reset();
+	}
+
+	if (DenseData)
+	{
+		return *DenseData;
+	}
+
+	DenseData = MakeVoxelUnique<FDenseChunk>(NoInit);
+
+	if (PaletteData.Num() > 0)
+	{
+		checkVoxelSlow(PaletteData.Num() == ChunkCount);
+
+		for (int32 Index = 0; Index < ChunkCount; Index++)
+		{
+			(*DenseData)[Index] = PaletteData[Index];
+		}
+	}
+
+	PaletteData = {};
+	UpdateStats();
+
+	return *DenseData;
+}
+
+void FVoxelSculptStorageData::FChunk::Compact()
+{
+	if (!DenseData)
+	{
+		return;
+	}
+
+	const FDenseChunk& Data = *DenseData;
+
+	TVoxelArray<FDensity, TInlineAllocator<MaxPaletteSize>> Palette;
+	Palette.Add(Data[0]);
+
+	FDensity LastValue = Data[0];
+	for (int32 Index = 1; Index < ChunkCount; Index++)
+	{
+		const FDensity Value = Data[Index];
+		if (Value == LastValue)
+		{
+			continue;
+		}
+		LastValue = Value;
+
+		if (Palette.Contains(Value))
+		{
+			continue;
+		}
+
+		if (Palette.Num() == MaxPaletteSize)
+		{
+			// Too many distinct values, keep the chunk dense
+			return;
+		}
+
+		Palette.Add(Value);
+	}
+
+	PaletteData.Initialize(ChunkCount, [&](const int32 Index)
+	{
+		return Data[Index];
+	});
+	DenseData.Reset();
+
+	UpdateStats();
+}
+
+void FVoxelSculptStorageData::FChunk::SetData(const FDenseChunk& Data)
+{
+	GetDenseData() = Data;
+	Compact();
+}
+
+void FVoxelSculptStorageData::FChunk::CopyTo(FDenseChunk& Data) const
+{
+	if (DenseData)
+	{
+		Data = *DenseData;
+		return;
+	}
+
+	if (IsUniform())
+	{
+		Data = PaletteData[0];
+		return;
+	}
+
+	for (int32 Index = 0; Index < ChunkCount; Index++)
+	{
+		Data[Index] = PaletteData[Index];
+	}
+}
+
+void FVoxelSculptStorageData::FChunk::Serialize(FArchive& Ar)
+{
+	bool bIsDense = IsDense();
+	Ar << bIsDense;
+
+	if (bIsDense)
+	{
+		if (Ar.IsLoading())
+		{
+			DenseData = MakeVoxelUnique<FDenseChunk>(NoInit);
+			PaletteData = {};
+		}
+
+		Ar << *DenseData;
+	}
+	else
+	{
+		if (Ar.IsLoading())
+		{
+			DenseData.Reset();
+		}
+
+		Ar << PaletteData;
+		ensure(PaletteData.Num() == ChunkCount);
+	}
+
+	if (Ar.IsLoading())
+	{
+		UpdateStats();
+	}
+}
+
+void FVoxelSculptStorageData::FChunk::Load()
+{
+	VOXEL_FUNCTION_COUNTER();
+	VOXEL_SCOPE_LOCK(CompressionCriticalSection);
+
+	if (IsLoaded())
+	{
+		return;
+	}
+
+	ON_SCOPE_EXIT
+	{
+		bIsLoaded.Store(true);
+	};
+
+	if (!ensure(CompressedData_RequiresLock))
+	{
+		PaletteData.InitializeUnique(ChunkCount, 0);
+		return;
+	}
+
+	TArray64<uint8> Data;
+	if (!ensure(FOodleCompressedArray::DecompressToTArray64(Data, *CompressedData_RequiresLock)))
+	{
+		PaletteData.InitializeUnique(ChunkCount, 0);
+		return;
+	}
+
+	FLargeMemoryReader Reader(Data.GetData(), Data.Num());
+	Serialize(Reader);
+	ensure(!Reader.IsError());
+}
+
+void FVoxelSculptStorageData::FChunk::SetCompressedData(const TSharedRef<const TArray64<uint8>>& NewCompressedData)
+{
+	VOXEL_SCOPE_LOCK(CompressionCriticalSection);
+
+	DenseData.Reset();
+	PaletteData = {};
+
+	CompressedData_RequiresLock = NewCompressedData;
+	bIsLoaded.Store(false);
+
+	UpdateStats();
+}
+
+TSharedRef<const TArray64<uint8>> FVoxelSculptStorageData::FChunk::GetCompressedData()
+{
+	VOXEL_SCOPE_LOCK(CompressionCriticalSection);
+
+	if (CompressedData_RequiresLock)
+	{
+		return CompressedData_RequiresLock.ToSharedRef();
+	}
+	ensure(IsLoaded());
+
+	VOXEL_FUNCTION_COUNTER();
+
+	FLargeMemoryWriter Writer;
+	Serialize(Writer);
+
+	const TSharedRef<TArray64<uint8>> CompressedData = MakeVoxelShared<TArray64<uint8>>();
+	ensure(FOodleCompressedArray::CompressData64(
+		*CompressedData,
+		Writer.GetData(),
+		Writer.TotalSize(),
+		FOodleDataCompression::ECompressor::Kraken,
+		FOodleDataCompression::ECompressionLevel::Normal));
+
+	CompressedData_RequiresLock = CompressedData;
+	UpdateStats();
+
+	return CompressedData;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 FVoxelSculptStorageData::FVoxelSculptStorageData(const FName Name)
 	: Name(Name)
 	, Dependency(FVoxelDependency::Create(STATIC_FNAME("SculptStorage"), Name))
@@ -50,16 +285,32 @@ void FVoxelSculptStorageData::SetDistances(
 
 	FVoxelScopeLock_Write Lock(CriticalSection);
 
+	const bool bIsImplicitStroke = !Stroke_RequiresLock.IsValid();
+	if (bIsImplicitStroke)
+	{
+		Stroke_RequiresLock = MakeVoxelShared<FStroke>();
+	}
+	RedoStack_RequiresLock.Reset();
+
 	Bounds.IterateChunks(ChunkSize, [&](const FVoxelIntBox& ChunkBounds)
 	{
 		const FIntVector Key = FVoxelUtilities::DivideFloor(ChunkBounds.Min, ChunkSize);
 		TSharedPtr<FChunk>& Chunk = Chunks.FindOrAdd(Key);
-		if (!Chunk)
+		const bool bIsNewChunk = !Chunk.IsValid();
+
+		// Only keep the chunk as it was before the stroke
+		if (!Stroke_RequiresLock->KeyToChunkHistory.Contains(Key))
 		{
-			Chunk = MakeVoxelShared<FChunk>(NoInit);
-			// We're not going to query the source data, Distances needs to have everything we need
-			ensure(ChunkBounds == ChunkBounds.MakeMultipleOfBigger(ChunkSize));
+			Stroke_RequiresLock->KeyToChunkHistory.Add(Key).Before = Chunk;
+		}
 
+		// Never write to existing chunks: Serialize reads them outside of the lock
+		// We're not going to query the source data, Distances needs to have everything we need
+		ensure(ChunkBounds == ChunkBounds.MakeMultipleOfBigger(ChunkSize));
+		Chunk = MakeVoxelShared<FChunk>();
+
+		if (bIsNewChunk)
+		{
 			Octree->TraverseBounds(FVoxelIntBox(Key), [&](const FOctree::FNodeRef& NodeRef)
 			{
 				if (NodeRef.GetHeight() > 0)
@@ -71,7 +322,7 @@ void FVoxelSculptStorageData::SetDistances(
 
 		const FIntVector Size = Bounds.Size();
 		const FIntVector Offset = ChunkBounds.Min - Bounds.Min;
-		FChunk& ChunkData = *Chunk;
+		FDenseChunk& ChunkData = Chunk->GetDenseData();
 
 		for (int32 Z = 0; Z < ChunkSize; Z++)
 		{
@@ -85,7 +336,14 @@ void FVoxelSculptStorageData::SetDistances(
 				}
 			}
 		}
+
+		Chunk->Compact();
 	});
+
+	if (bIsImplicitStroke)
+	{
+		EndStroke_RequiresLock();
+	}
 }
 
 void FVoxelSculptStorageData::ClearData()
@@ -96,59 +354,336 @@ void FVoxelSculptStorageData::ClearData()
 		FVoxelScopeLock_Write Lock(CriticalSection);
 		Octree = MakeVoxelShared<FOctree>();
 		Chunks.Empty();
+
+		Stroke_RequiresLock.Reset();
+		UndoStack_RequiresLock.Empty();
+		RedoStack_RequiresLock.Empty();
 	}
 
 	Dependency->Invalidate();
 }
 
+TVoxelArray<TPair<FIntVector, TSharedRef<FVoxelSculptStorageData::FChunk>>> FVoxelSculptStorageData::GetChunks() const
+{
+	VOXEL_FUNCTION_COUNTER();
+	FVoxelScopeLock_Read Lock(CriticalSection);
+
+	TVoxelArray<TPair<FIntVector, TSharedRef<FChunk>>> Result;
+	Result.Reserve(Chunks.Num());
+	for (const auto& It : Chunks)
+	{
+		if (!It.Value)
+		{
+			// Chunk creation was undone
+			continue;
+		}
+
+		Result.Add({ It.Key, It.Value.ToSharedRef() });
+	}
+	return Result;
+}
+
+void FVoxelSculptStorageData::SetChunks(const TConstVoxelArrayView<TPair<FIntVector, TSharedRef<FChunk>>> NewChunks)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	{
+		FVoxelScopeLock_Write Lock(CriticalSection);
+
+		Octree = MakeVoxelShared<FOctree>();
+		Chunks.Empty();
+		Chunks.Reserve(NewChunks.Num());
+
+		Stroke_RequiresLock.Reset();
+		UndoStack_RequiresLock.Empty();
+		RedoStack_RequiresLock.Empty();
+
+		for (const TPair<FIntVector, TSharedRef<FChunk>>& It : NewChunks)
+		{
+			Chunks.Add_CheckNew(It.Key, It.Value);
+
+			Octree->TraverseBounds(FVoxelIntBox(It.Key), [&](const FOctree::FNodeRef& NodeRef)
+			{
+				if (NodeRef.GetHeight() > 0)
+				{
+					Octree->CreateAllChildren(NodeRef);
+				}
+			});
+		}
+	}
+
+	Dependency->Invalidate();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelSculptStorageData::BeginStroke()
+{
+	VOXEL_FUNCTION_COUNTER();
+	FVoxelScopeLock_Write Lock(CriticalSection);
+
+	if (!ensureMsgf(!Stroke_RequiresLock, TEXT("BeginStroke called twice")))
+	{
+		EndStroke_RequiresLock();
+	}
+
+	Stroke_RequiresLock = MakeVoxelShared<FStroke>();
+}
+
+void FVoxelSculptStorageData::EndStroke()
+{
+	VOXEL_FUNCTION_COUNTER();
+	FVoxelScopeLock_Write Lock(CriticalSection);
+
+	if (!ensureMsgf(Stroke_RequiresLock, TEXT("EndStroke called without BeginStroke")))
+	{
+		return;
+	}
+
+	EndStroke_RequiresLock();
+}
+
+bool FVoxelSculptStorageData::CanUndo() const
+{
+	FVoxelScopeLock_Read Lock(CriticalSection);
+	return
+		!Stroke_RequiresLock &&
+		UndoStack_RequiresLock.Num() > 0;
+}
+
+bool FVoxelSculptStorageData::CanRedo() const
+{
+	FVoxelScopeLock_Read Lock(CriticalSection);
+	return
+		!Stroke_RequiresLock &&
+		RedoStack_RequiresLock.Num() > 0;
+}
+
+bool FVoxelSculptStorageData::Undo()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FVoxelIntBox Bounds;
+	{
+		FVoxelScopeLock_Write Lock(CriticalSection);
+
+		// The stroke in progress is owned by its caller, who will still call EndStroke
+		if (Stroke_RequiresLock ||
+			UndoStack_RequiresLock.Num() == 0)
+		{
+			return false;
+		}
+
+		const TSharedPtr<FStroke> Stroke = UndoStack_RequiresLock.Pop(false);
+		Bounds = ApplyStroke_RequiresLock(*Stroke, true);
+		RedoStack_RequiresLock.Add(Stroke);
+	}
+
+	FVoxelDependency::FInvalidationParameters Parameters;
+	Parameters.Bounds = Bounds.ToVoxelBox();
+	Dependency->Invalidate(Parameters);
+
+	return true;
+}
+
+bool FVoxelSculptStorageData::Redo()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FVoxelIntBox Bounds;
+	{
+		FVoxelScopeLock_Write Lock(CriticalSection);
+
+		if (Stroke_RequiresLock ||
+			RedoStack_RequiresLock.Num() == 0)
+		{
+			return false;
+		}
+
+		const TSharedPtr<FStroke> Stroke = RedoStack_RequiresLock.Pop(false);
+		Bounds = ApplyStroke_RequiresLock(*Stroke, false);
+		UndoStack_RequiresLock.Add(Stroke);
+	}
+
+	FVoxelDependency::FInvalidationParameters Parameters;
+	Parameters.Bounds = Bounds.ToVoxelBox();
+	Dependency->Invalidate(Parameters);
+
+	return true;
+}
+
+void FVoxelSculptStorageData::ClearHistory()
+{
+	VOXEL_FUNCTION_COUNTER();
+	FVoxelScopeLock_Write Lock(CriticalSection);
+
+	UndoStack_RequiresLock.Empty();
+	RedoStack_RequiresLock.Empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+int64 FVoxelSculptStorageData::FStroke::GetAllocatedSize() const
+{
+	int64 AllocatedSize = KeyToChunkHistory.GetAllocatedSize();
+	for (const auto& It : KeyToChunkHistory)
+	{
+		// After is either in the storage or in Before of a later stroke
+		if (It.Value.Before)
+		{
+			AllocatedSize += It.Value.Before->GetAllocatedSize_NoCompressedData();
+		}
+	}
+	return AllocatedSize;
+}
+
+void FVoxelSculptStorageData::EndStroke_RequiresLock()
+{
+	VOXEL_FUNCTION_COUNTER();
+	checkVoxelSlow(CriticalSection.IsLocked_Write_Debug());
+
+	const TSharedPtr<FStroke> Stroke = MoveTemp(Stroke_RequiresLock);
+	if (!ensure(Stroke) ||
+		Stroke->KeyToChunkHistory.Num() == 0)
+	{
+		return;
+	}
+
+	for (auto& It : Stroke->KeyToChunkHistory)
+	{
+		It.Value.After = Chunks.FindChecked(It.Key);
+	}
+
+	UndoStack_RequiresLock.Add(Stroke);
+	TrimHistory_RequiresLock();
+}
+
+void FVoxelSculptStorageData::TrimHistory_RequiresLock()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const int64 MaxMemory = int64(GVoxelSculptMaxUndoMemory * 1024 * 1024);
+
+	int64 Memory = 0;
+	for (const TSharedPtr<FStroke>& Stroke : RedoStack_RequiresLock)
+	{
+		Memory += Stroke->GetAllocatedSize();
+	}
+
+	// Keep the newest strokes
+	int32 NumStrokesToKeep = 0;
+	for (int32 Index = UndoStack_RequiresLock.Num() - 1; Index >= 0; Index--)
+	{
+		Memory += UndoStack_RequiresLock[Index]->GetAllocatedSize();
+		if (Memory > MaxMemory)
+		{
+			break;
+		}
+		NumStrokesToKeep++;
+	}
+
+	const int32 NumStrokesToRemove = UndoStack_RequiresLock.Num() - NumStrokesToKeep;
+	if (NumStrokesToRemove > 0)
+	{
+		UndoStack_RequiresLock.RemoveAt(0, NumStrokesToRemove);
+	}
+}
+
+FVoxelIntBox FVoxelSculptStorageData::ApplyStroke_RequiresLock(const FStroke& Stroke, const bool bUndo)
+{
+	VOXEL_FUNCTION_COUNTER();
+	checkVoxelSlow(CriticalSection.IsLocked_Write_Debug());
+	check(Stroke.KeyToChunkHistory.Num() > 0);
+
+	FIntVector Min = FIntVector(MAX_int32);
+	FIntVector Max = FIntVector(MIN_int32);
+
+	for (const auto& It : Stroke.KeyToChunkHistory)
+	{
+		const FIntVector& Key = It.Key;
+		const TSharedPtr<FChunk>& NewChunk = bUndo ? It.Value.Before : It.Value.After;
+
+		TSharedPtr<FChunk>& Chunk = Chunks.FindOrAdd(Key);
+		if (!Chunk &&
+			NewChunk)
+		{
+			Octree->TraverseBounds(FVoxelIntBox(Key), [&](const FOctree::FNodeRef& NodeRef)
+			{
+				if (NodeRef.GetHeight() > 0)
+				{
+					Octree->CreateAllChildren(NodeRef);
+				}
+			});
+		}
+		// Octree nodes of removed chunks are kept, HasChunks is conservative & FindChunk will return null
+		Chunk = NewChunk;
+
+		Min = FVoxelUtilities::ComponentMin(Min, Key);
+		Max = FVoxelUtilities::ComponentMax(Max, Key);
+	}
+
+	return FVoxelIntBox(Min * ChunkSize, (Max + 1) * ChunkSize);
+}
+
 void FVoxelSculptStorageData::Serialize(FArchive& Ar)
 {
 	VOXEL_FUNCTION_COUNTER();
 
 	using FVersion = DECLARE_VOXEL_VERSION
 	(
-		FirstVersion
+		FirstVersion,
+		CompressChunks,
+		CompressChunksIndividually
 	);
 
 	int32 Version = FVersion::LatestVersion;
 	Ar << Version;
-	check(Version == FVersion::FirstVersion);
+	check(Version <= FVersion::LatestVersion);
 
 	if (Ar.IsSaving())
 	{
-		FLargeMemoryWriter Writer;
-		{
-			FVoxelScopeLock_Read Lock(CriticalSection);
+		// Chunks are never written to once added, only hold the lock to copy the map
+		const TVoxelArray<TPair<FIntVector, TSharedRef<FChunk>>> KeyAndChunks = GetChunks();
 
-			int32 DensitySize = sizeof(FDensity);
-			Writer << DensitySize;
-
-			TVoxelArray<FIntVector> Keys;
-			Keys.Reserve(Chunks.Num());
-			for (const auto& It : Chunks)
-			{
-				Keys.Add(It.Key);
-			}
-			Writer << Keys;
+		TVoxelArray<TSharedPtr<const TArray64<uint8>>> CompressedChunks;
+		CompressedChunks.Reserve(KeyAndChunks.Num());
+		{
+			VOXEL_SCOPE_COUNTER_FORMAT("Compress Num=%d", KeyAndChunks.Num());
 
-			for (const FIntVector& Key : Keys)
+			for (const auto& It : KeyAndChunks)
 			{
-				Writer << *Chunks[Key];
+				CompressedChunks.Add(It.Value->GetCompressedData());
 			}
 		}
 
-		TArray64<uint8> CompressedData;
+		int32 DensitySize = sizeof(FDensity);
+		Ar << DensitySize;
+
+		int32 NumChunks = KeyAndChunks.Num();
+		Ar << NumChunks;
+
+		// Header first so that chunks can be seeked to
+		for (int32 Index = 0; Index < NumChunks; Index++)
 		{
-			VOXEL_SCOPE_COUNTER("Compress");
-			ensure(FOodleCompressedArray::CompressData64(
-				CompressedData,
-				Writer.GetData(),
-				Writer.TotalSize(),
-				FOodleDataCompression::ECompressor::Kraken,
-				FOodleDataCompression::ECompressionLevel::Normal));
+			FIntVector Key = KeyAndChunks[Index].Key;
+			int64 CompressedSize = CompressedChunks[Index]->Num();
+
+			Ar << Key;
+			Ar << CompressedSize;
 		}
 
-		CompressedData.BulkSerialize(Ar);
+		{
+			VOXEL_SCOPE_COUNTER("Write");
+
+			for (const TSharedPtr<const TArray64<uint8>>& CompressedChunk : CompressedChunks)
+			{
+				Ar.Serialize(ConstCast(CompressedChunk->GetData()), CompressedChunk->Num());
+			}
+		}
 	}
 	else
 	{
@@ -157,9 +692,89 @@ void FVoxelSculptStorageData::Serialize(FArchive& Ar)
 		// Invalidate outside of the lock
 		FVoxelDependencyInvalidationScope InvalidationScope;
 
+		FVoxelScopeLock_Write Lock(CriticalSection);
+
 		Octree = MakeVoxelShared<FOctree>();
 		Chunks.Empty();
 
+		Stroke_RequiresLock.Reset();
+		UndoStack_RequiresLock.Empty();
+		RedoStack_RequiresLock.Empty();
+
+		ON_SCOPE_EXIT
+		{
+			Dependency->Invalidate();
+		};
+
+		const auto AddChunk = [&](const FIntVector& Key, const TSharedRef<FChunk>& Chunk)
+		{
+			Chunks.Add_CheckNew(Key, Chunk);
+
+			Octree->TraverseBounds(FVoxelIntBox(Key), [&](const FOctree::FNodeRef& NodeRef)
+			{
+				if (NodeRef.GetHeight() > 0)
+				{
+					Octree->CreateAllChildren(NodeRef);
+				}
+			});
+		};
+
+		if (Version >= FVersion::CompressChunksIndividually)
+		{
+			int32 DensitySize = 0;
+			Ar << DensitySize;
+
+			if (!ensure(DensitySize == sizeof(FDensity)))
+			{
+				return;
+			}
+
+			int32 NumChunks = 0;
+			Ar << NumChunks;
+
+			TVoxelArray<FIntVector> Keys;
+			TVoxelArray<int64> CompressedSizes;
+			Keys.Reserve(NumChunks);
+			CompressedSizes.Reserve(NumChunks);
+
+			for (int32 Index = 0; Index < NumChunks; Index++)
+			{
+				FIntVector Key;
+				int64 CompressedSize = 0;
+
+				Ar << Key;
+				Ar << CompressedSize;
+
+				if (!ensure(CompressedSize >= 0) ||
+					!ensure(!Ar.IsError()))
+				{
+					return;
+				}
+
+				Keys.Add(Key);
+				CompressedSizes.Add(CompressedSize);
+			}
+
+			for (int32 Index = 0; Index < NumChunks; Index++)
+			{
+				const TSharedRef<TArray64<uint8>> CompressedData = MakeVoxelShared<TArray64<uint8>>();
+				CompressedData->SetNumUninitialized(CompressedSizes[Index]);
+				Ar.Serialize(CompressedData->GetData(), CompressedData->Num());
+
+				if (!ensure(!Ar.IsError()))
+				{
+					return;
+				}
+
+				// Decompressed on first access
+				const TSharedRef<FChunk> Chunk = MakeVoxelShared<FChunk>();
+				Chunk->SetCompressedData(CompressedData);
+				AddChunk(Keys[Index], Chunk);
+			}
+
+			return;
+		}
+
 		TArray64<uint8> CompressedData;
 		CompressedData.BulkSerialize(Ar);
 
@@ -174,8 +789,6 @@ void FVoxelSculptStorageData::Serialize(FArchive& Ar)
 
 		FLargeMemoryReader Reader(Data.GetData(), Data.Num());
 
-		FVoxelScopeLock_Write Lock(CriticalSection);
-
 		int32 DensitySize = 0;
 		Reader << DensitySize;
 
@@ -189,19 +802,17 @@ void FVoxelSculptStorageData::Serialize(FArchive& Ar)
 
 		for (const FIntVector& Key : Keys)
 		{
-			const TSharedRef<FChunk> Chunk = MakeVoxelShared<FChunk>(ForceInit);
-			Reader << *Chunk;
-			Chunks.Add_CheckNew(Key, Chunk);
-
-			Octree->TraverseBounds(FVoxelIntBox(Key), [&](const FOctree::FNodeRef& NodeRef)
+			const TSharedRef<FChunk> Chunk = MakeVoxelShared<FChunk>();
+			if (Version < FVersion::CompressChunks)
 			{
-				if (NodeRef.GetHeight() > 0)
-				{
-					Octree->CreateAllChildren(NodeRef);
-				}
-			});
+				Reader << Chunk->GetDenseData();
+				Chunk->Compact();
+			}
+			else
+			{
+				Chunk->Serialize(Reader);
+			}
+			AddChunk(Key, Chunk);
 		}
-
-		Dependency->Invalidate();
 	}
 }
\ No newline at end of file
@@ -92,6 +92,14 @@ void AVoxelActor::BeginPlay()
 
 	Super::BeginPlay();
 
+	if (bReplicateSculpt &&
+		HasAuthority() &&
+		!GetIsReplicated())
+	{
+		bAlwaysRelevant = true;
+		SetReplicates(true);
+	}
+
 	if (bCreateRuntimeOnBeginPlay &&
 		!IsRuntimeCreated())
 	{
@@ -175,6 +183,13 @@ void AVoxelActor::PostLoad()
 		SculptStorageComponent = NewObject<UVoxelSculptStorage>(this, "VoxelSculptStorage");
 	}
 
+	if (bReplicateSculpt)
+	{
+		// Needs to be set on both server & clients before BeginPlay for placed actors
+		bReplicates = true;
+		bAlwaysRelevant = true;
+	}
+
 	if (UVoxelGraphInterface* Graph = Graph_DEPRECATED.LoadSynchronous())
 	{
 		ensure(!ParameterContainer->Provider);
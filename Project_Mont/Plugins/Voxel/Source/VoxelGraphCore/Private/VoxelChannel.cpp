@@ -18,6 +18,10 @@ DEFINE_VOXEL_FACTORY(UVoxelChannelRegistry);
 DEFINE_VOXEL_INSTANCE_COUNTER(FVoxelBrush);
 DEFINE_VOXEL_INSTANCE_COUNTER(FVoxelRuntimeChannel);
 
+DEFINE_VOXEL_COUNTER(STAT_VoxelNumBrushLookups);
+DEFINE_VOXEL_COUNTER(STAT_VoxelNumBrushesVisited);
+DEFINE_VOXEL_COUNTER(STAT_VoxelBrushLookupTime);
+
 FVoxelChannelManager* GVoxelChannelManager = MakeVoxelSingleton(FVoxelChannelManager);
 
 VOXEL_CONSOLE_VARIABLE(
@@ -25,6 +29,21 @@ VOXEL_CONSOLE_VARIABLE(
 	"voxel.ShowBrushBounds",
 	"");
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, float, GVoxelBrushGridCellSize, 10000.f,
+	"voxel.BrushGridCellSize",
+	"Size of the sparse grid cells used to accelerate brush lookups. Only applies to new runtime channels");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelBrushGridMaxCellsPerBrush, 64,
+	"voxel.BrushGridMaxCellsPerBrush",
+	"Brushes spanning more cells than this are checked by every lookup instead of being added to the grid");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelBrushListCacheSize, 4096,
+	"voxel.BrushListCacheSize",
+	"Max number of query bounds to cache brush lists for, per runtime channel");
+
 VOXEL_CONSOLE_COMMAND(
 	LogAllBrushes,
 	"voxel.LogAllBrushes",
@@ -170,38 +189,53 @@ TSharedPtr<const FVoxelBrush> FVoxelRuntimeChannel::GetNextBrush(
 {
 	VOXEL_FUNCTION_COUNTER();
 
+	int32 FirstBrushIndex = 0;
+	const TSharedRef<const FBrushList> Brushes = GetBrushes(Query, Bounds, Priority, FirstBrushIndex);
+
+	if (!Brushes->IsValidIndex(FirstBrushIndex))
+	{
+		return nullptr;
+	}
+
+	const TSharedRef<const FVoxelBrush>& Brush = (*Brushes)[FirstBrushIndex];
+	ensure(Brush->Priority < Priority);
+	return Brush;
+}
+
+TSharedRef<const FVoxelRuntimeChannel::FBrushList> FVoxelRuntimeChannel::GetBrushes(
+	const FVoxelQuery& Query,
+	const FVoxelBox& Bounds,
+	const FVoxelBrushPriority Priority,
+	int32& OutFirstBrushIndex) const
+{
+	VOXEL_FUNCTION_COUNTER();
+
 	Query.GetDependencyTracker().AddDependency(
 		Dependency,
 		Bounds,
 		Priority.Raw);
 
-	VOXEL_SCOPE_LOCK(CriticalSection);
+	const uint64 StartTime = FPlatformTime::Cycles64();
 
-	TSharedPtr<const FVoxelBrush> BestBrush;
-	for (const auto& It : RuntimeBrushes_RequiresLock)
+	TSharedPtr<const FBrushList> Brushes;
 	{
-		const FRuntimeBrush& Brush = *It.Value;
-
-		if (Brush.Priority >= Priority ||
-			// Can happen due to race condition in FVoxelRuntimeChannel::AddBrush
-			!ensureVoxelSlow(Brush.RuntimeBounds_RequiresLock.IsSet()) ||
-			!Brush.RuntimeBounds_RequiresLock.GetValue().Intersect(Bounds))
-		{
-			continue;
-		}
+		VOXEL_SCOPE_LOCK(CriticalSection);
+		Brushes = GetBrushList_RequiresLock(Bounds);
+	}
 
-		if (BestBrush &&
-			BestBrush->Priority > Brush.Priority)
-		{
-			continue;
-		}
+	// Brushes are sorted by decreasing priority, skip the ones above us
+	OutFirstBrushIndex = 0;
+	while (
+		OutFirstBrushIndex < Brushes->Num() &&
+		(*Brushes)[OutFirstBrushIndex]->Priority >= Priority)
+	{
+		OutFirstBrushIndex++;
+	}
 
-		ensure(Brush.Priority < Priority);
-		ensure(!BestBrush || BestBrush->Priority < Brush.Priority);
+	INC_VOXEL_COUNTER(STAT_VoxelNumBrushLookups);
+	INC_VOXEL_COUNTER_BY(STAT_VoxelBrushLookupTime, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartTime) * 1.e6);
 
-		BestBrush = Brush.Brush;
-	}
-	return BestBrush;
+	return Brushes.ToSharedRef();
 }
 
 FVoxelFutureValue FVoxelRuntimeChannel::Get(const FVoxelQuery& Query) const
@@ -289,6 +323,7 @@ FVoxelRuntimeChannel::FVoxelRuntimeChannel(
 	, Definition(WorldChannel->Definition)
 	, RuntimeLocalToWorld(RuntimeLocalToWorld)
 	, Dependency(FVoxelDependency::Create(STATIC_FNAME("Channel"), WorldChannel->Definition.Name))
+	, GridCellSize(FMath::Max(GVoxelBrushGridCellSize, 1.f))
 {
 }
 
@@ -306,10 +341,17 @@ void FVoxelRuntimeChannel::AddBrush(
 		RuntimeBrushes_RequiresLock.Add(BrushId, RuntimeBrush);
 	}
 
-	BrushToRuntime.AddOnChanged(MakeWeakPtrDelegate(RuntimeBrush, MakeWeakPtrLambda(this, [this, &RuntimeBrush = *RuntimeBrush](const FMatrix& NewTransform)
+	BrushToRuntime.AddOnChanged(MakeWeakPtrDelegate(RuntimeBrush, MakeWeakPtrLambda(this, [this, BrushId, &RuntimeBrush = *RuntimeBrush](const FMatrix& NewTransform)
 	{
 		VOXEL_SCOPE_LOCK(CriticalSection);
 
+		// RemoveBrush might have run since the delegate was called, or the id might have been reused for a new brush
+		if (RuntimeBrush.bRemoved_RequiresLock ||
+			RuntimeBrushes_RequiresLock.FindRef(BrushId).Get() != &RuntimeBrush)
+		{
+			return;
+		}
+
 		if (RuntimeBrush.RuntimeBounds_RequiresLock.IsSet())
 		{
 			FVoxelDependency::FInvalidationParameters Parameters;
@@ -318,6 +360,8 @@ void FVoxelRuntimeChannel::AddBrush(
 			Dependency->Invalidate(Parameters);
 		}
 
+		RemoveFromGrid_RequiresLock(RuntimeBrush);
+
 		RuntimeBrush.RuntimeBounds_RequiresLock = RuntimeBrush.Brush->LocalBounds.TransformBy(NewTransform);
 
 		if (RuntimeBrush.Brush->LocalBounds.IsInfinite())
@@ -325,6 +369,8 @@ void FVoxelRuntimeChannel::AddBrush(
 			RuntimeBrush.RuntimeBounds_RequiresLock = FVoxelBox::Infinite;
 		}
 
+		AddToGrid_RequiresLock(RuntimeBrush);
+
 		FVoxelDependency::FInvalidationParameters Parameters;
 		Parameters.Bounds = RuntimeBrush.RuntimeBounds_RequiresLock.GetValue();
 		Parameters.LessOrEqualTag = RuntimeBrush.Priority.Raw;
@@ -345,6 +391,9 @@ void FVoxelRuntimeChannel::RemoveBrush(
 		{
 			return;
 		}
+
+		RuntimeBrush->bRemoved_RequiresLock = true;
+		RemoveFromGrid_RequiresLock(*RuntimeBrush);
 	}
 
 	FVoxelDependency::FInvalidationParameters Parameters;
@@ -353,6 +402,222 @@ void FVoxelRuntimeChannel::RemoveBrush(
 	Dependency->Invalidate(Parameters);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool FVoxelRuntimeChannel::GetGridBounds(
+	const FVoxelBox& Bounds,
+	const double CellSize,
+	const int64 MaxNumCells,
+	FIntVector& OutMin,
+	FIntVector& OutMax)
+{
+	if (Bounds.IsInfinite())
+	{
+		return false;
+	}
+
+	const FVector3d Min = FVector3d(
+		FMath::FloorToDouble(Bounds.Min.X / CellSize),
+		FMath::FloorToDouble(Bounds.Min.Y / CellSize),
+		FMath::FloorToDouble(Bounds.Min.Z / CellSize));
+
+	const FVector3d Max = FVector3d(
+		FMath::FloorToDouble(Bounds.Max.X / CellSize),
+		FMath::FloorToDouble(Bounds.Max.Y / CellSize),
+		FMath::FloorToDouble(Bounds.Max.Z / CellSize));
+
+	const FVector3d Size = Max - Min + 1.;
+	if (Size.X * Size.Y * Size.Z > MaxNumCells ||
+		Min.GetAbsMax() > MAX_int32 / 2 ||
+		Max.GetAbsMax() > MAX_int32 / 2)
+	{
+		return false;
+	}
+
+	OutMin = FIntVector(Min.X, Min.Y, Min.Z);
+	OutMax = FIntVector(Max.X, Max.Y, Max.Z);
+	return true;
+}
+
+TSharedRef<const FVoxelRuntimeChannel::FBrushList> FVoxelRuntimeChannel::GetBrushList_RequiresLock(const FVoxelBox& Bounds) const
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	if (const TSharedPtr<const FBrushList>* BrushList = BrushListCache_RequiresLock.Find(Bounds))
+	{
+		return BrushList->ToSharedRef();
+	}
+
+	VOXEL_FUNCTION_COUNTER();
+
+	const uint64 VisitSerial = ++VisitSerial_RequiresLock;
+
+	TVoxelArray<FRuntimeBrush*> Candidates;
+	const auto Visit = [&](FRuntimeBrush& RuntimeBrush)
+	{
+		// A brush can be in multiple cells
+		if (RuntimeBrush.LastVisitSerial_RequiresLock == VisitSerial)
+		{
+			return;
+		}
+		RuntimeBrush.LastVisitSerial_RequiresLock = VisitSerial;
+
+		INC_VOXEL_COUNTER(STAT_VoxelNumBrushesVisited);
+
+		if (!RuntimeBrush.RuntimeBounds_RequiresLock.GetValue().Intersect(Bounds))
+		{
+			return;
+		}
+
+		Candidates.Add(&RuntimeBrush);
+	};
+
+	for (FRuntimeBrush* RuntimeBrush : LargeBrushes_RequiresLock)
+	{
+		Visit(*RuntimeBrush);
+	}
+
+	FIntVector Min;
+	FIntVector Max;
+	if (GetGridBounds(Bounds, GridCellSize, GridCells_RequiresLock.Num(), Min, Max))
+	{
+		for (int32 X = Min.X; X <= Max.X; X++)
+		{
+			for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+			{
+				for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+				{
+					const TVoxelArray<FRuntimeBrush*>* Cell = GridCells_RequiresLock.Find(FIntVector(X, Y, Z));
+					if (!Cell)
+					{
+						continue;
+					}
+
+					for (FRuntimeBrush* RuntimeBrush : *Cell)
+					{
+						Visit(*RuntimeBrush);
+					}
+				}
+			}
+		}
+	}
+	else
+	{
+		// Query spans more cells than there are allocated: iterate the allocated cells instead
+		for (const auto& It : GridCells_RequiresLock)
+		{
+			for (FRuntimeBrush* RuntimeBrush : It.Value)
+			{
+				Visit(*RuntimeBrush);
+			}
+		}
+	}
+
+	Candidates.Sort([](const FRuntimeBrush& A, const FRuntimeBrush& B)
+	{
+		return A.Priority > B.Priority;
+	});
+
+	const TSharedRef<FBrushList> BrushList = MakeVoxelShared<FBrushList>();
+	BrushList->Reserve(Candidates.Num());
+
+	for (const FRuntimeBrush* RuntimeBrush : Candidates)
+	{
+		BrushList->Add(RuntimeBrush->Brush);
+	}
+
+	if (BrushListCache_RequiresLock.Num() >= GVoxelBrushListCacheSize)
+	{
+		BrushListCache_RequiresLock.Reset();
+	}
+	BrushListCache_RequiresLock.Add_CheckNew(Bounds, BrushList);
+
+	return BrushList;
+}
+
+void FVoxelRuntimeChannel::AddToGrid_RequiresLock(FRuntimeBrush& RuntimeBrush)
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+	check(!RuntimeBrush.bIsInGrid_RequiresLock);
+
+	RuntimeBrush.bIsInGrid_RequiresLock = true;
+	BrushListCache_RequiresLock.Reset();
+
+	if (!GetGridBounds(
+		RuntimeBrush.RuntimeBounds_RequiresLock.GetValue(),
+		GridCellSize,
+		GVoxelBrushGridMaxCellsPerBrush,
+		RuntimeBrush.GridMin_RequiresLock,
+		RuntimeBrush.GridMax_RequiresLock))
+	{
+		RuntimeBrush.bIsLarge_RequiresLock = true;
+		LargeBrushes_RequiresLock.Add(&RuntimeBrush);
+		return;
+	}
+
+	RuntimeBrush.bIsLarge_RequiresLock = false;
+
+	const FIntVector Min = RuntimeBrush.GridMin_RequiresLock;
+	const FIntVector Max = RuntimeBrush.GridMax_RequiresLock;
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				GridCells_RequiresLock.FindOrAdd(FIntVector(X, Y, Z)).Add(&RuntimeBrush);
+			}
+		}
+	}
+}
+
+void FVoxelRuntimeChannel::RemoveFromGrid_RequiresLock(FRuntimeBrush& RuntimeBrush)
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	if (!RuntimeBrush.bIsInGrid_RequiresLock)
+	{
+		return;
+	}
+
+	RuntimeBrush.bIsInGrid_RequiresLock = false;
+	BrushListCache_RequiresLock.Reset();
+
+	if (RuntimeBrush.bIsLarge_RequiresLock)
+	{
+		ensure(LargeBrushes_RequiresLock.RemoveSwap(&RuntimeBrush) == 1);
+		return;
+	}
+
+	const FIntVector Min = RuntimeBrush.GridMin_RequiresLock;
+	const FIntVector Max = RuntimeBrush.GridMax_RequiresLock;
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+		{
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				const FIntVector Key(X, Y, Z);
+
+				TVoxelArray<FRuntimeBrush*>* Cell = GridCells_RequiresLock.Find(Key);
+				if (!ensure(Cell))
+				{
+					continue;
+				}
+
+				ensure(Cell->RemoveSwap(&RuntimeBrush) == 1);
+
+				if (Cell->Num() == 0)
+				{
+					GridCells_RequiresLock.Remove(Key);
+				}
+			}
+		}
+	}
+}
+
 TSharedRef<FVoxelRuntimeChannelCache> FVoxelRuntimeChannelCache::Create()
 {
 	ensure(IsInGameThread());
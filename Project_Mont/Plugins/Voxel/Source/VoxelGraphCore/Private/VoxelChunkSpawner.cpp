@@ -14,6 +14,60 @@ VOXEL_CONSOLE_VARIABLE(
 	"voxel.chunkspawner.CameraRefreshThreshold",
 	"");
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, float, GVoxelChunkSpawnerPredictionPriorityOffset, 100000.f,
+	"voxel.chunkspawner.PredictionPriorityOffset",
+	"Priority offset of predicted chunks, in cm. Predicted chunks are computed as if they were this much further away than visible ones");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, float, GVoxelChunkSpawnerPredictionSmoothing, 0.25f,
+	"voxel.chunkspawner.PredictionSmoothing",
+	"Time in seconds over which invoker & view velocities are smoothed");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, float, GVoxelChunkSpawnerPredictionMaxSpeed, 20000.f,
+	"voxel.chunkspawner.PredictionMaxSpeed",
+	"Invokers & views moving faster than this, in cm/s, are considered teleported and not predicted");
+
+DEFINE_VOXEL_COUNTER(STAT_VoxelChunkSpawnerPredictedChunks);
+DEFINE_VOXEL_COUNTER(STAT_VoxelChunkSpawnerPredictionHits);
+DEFINE_VOXEL_COUNTER(STAT_VoxelChunkSpawnerMissingChunks);
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelChunkSpawnerVelocity::Update(const FVector& NewPosition, const double NewTime)
+{
+	const double DeltaTime = NewTime - Time;
+	if (Time == 0. ||
+		DeltaTime <= 0.)
+	{
+		Position = NewPosition;
+		Time = NewTime;
+		return;
+	}
+
+	const FVector NewVelocity = (NewPosition - Position) / DeltaTime;
+
+	Position = NewPosition;
+	Time = NewTime;
+
+	if (NewVelocity.Size() > GVoxelChunkSpawnerPredictionMaxSpeed)
+	{
+		Velocity = FVector::ZeroVector;
+		return;
+	}
+
+	// Frame rate independent exponential smoothing
+	const double Alpha = 1. - FMath::Exp(-DeltaTime / FMath::Max(GVoxelChunkSpawnerPredictionSmoothing, 0.001f));
+	Velocity = FMath::Lerp(Velocity, NewVelocity, Alpha);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 TSharedRef<FVoxelChunkRef> FVoxelChunkSpawner::CreateChunk(
 	const int32 LOD,
 	const int32 ChunkSize,
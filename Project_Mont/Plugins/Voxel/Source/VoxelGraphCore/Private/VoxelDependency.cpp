@@ -4,6 +4,9 @@
 #include "VoxelTask.h"
 
 DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelDependencies);
+DEFINE_VOXEL_COUNTER(STAT_VoxelDependencyInvalidations);
+DEFINE_VOXEL_COUNTER(STAT_VoxelDependencyTrackersTested);
+DEFINE_VOXEL_COUNTER(STAT_VoxelDependencyTrackersInvalidated);
 DEFINE_VOXEL_INSTANCE_COUNTER(FVoxelDependencyTracker);
 
 thread_local FVoxelDependencyInvalidationScope* GVoxelDependencyInvalidationScope = nullptr;
@@ -92,6 +95,32 @@ void FVoxelDependencyInvalidationScope::Invalidate()
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+FORCEINLINE static FVector FloorVector(const FVector& Vector)
+{
+	return FVector(
+		FMath::FloorToDouble(Vector.X),
+		FMath::FloorToDouble(Vector.Y),
+		FMath::FloorToDouble(Vector.Z));
+}
+
+int64 FVoxelDependency::GetAllocatedSize() const
+{
+	int64 AllocatedSize = TrackerRefs_RequiresLock.GetAllocatedSize();
+	AllocatedSize += UnboundedTrackers_RequiresLock.GetAllocatedSize();
+
+	for (const TVoxelIntVectorMap<TVoxelArray<int32>>& Cells : LevelToCells_RequiresLock)
+	{
+		AllocatedSize += Cells.GetAllocatedSize();
+
+		for (const auto& It : Cells)
+		{
+			AllocatedSize += It.Value.GetAllocatedSize();
+		}
+	}
+
+	return AllocatedSize;
+}
+
 void FVoxelDependency::Invalidate(const FInvalidationParameters Parameters)
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -124,8 +153,13 @@ void FVoxelDependency::Invalidate(const FInvalidationParameters Parameters)
 		}
 	}
 
-	TrackerRefs_RequiresLock.Foreach([&](const FTrackerRef& TrackerRef)
+	int64 NumTested = 0;
+	int64 NumInvalidated = 0;
+
+	const auto Visit = [&](const FTrackerRef& TrackerRef)
 	{
+		NumTested++;
+
 		if (bCheckBounds &&
 			TrackerRef.bHasBounds &&
 			!Bounds.Intersect(TrackerRef.Bounds))
@@ -140,8 +174,145 @@ void FVoxelDependency::Invalidate(const FInvalidationParameters Parameters)
 			return;
 		}
 
+		NumInvalidated++;
 		RootScope.Trackers.Add(TrackerRef.WeakTracker);
-	});
+	};
+	const auto VisitCell = [&](const TVoxelArray<int32>& Cell)
+	{
+		for (const int32 Index : Cell)
+		{
+			Visit(TrackerRefs_RequiresLock[Index]);
+		}
+	};
+
+	if (!bCheckBounds ||
+		!Bounds.IsValid())
+	{
+		TrackerRefs_RequiresLock.Foreach(Visit);
+	}
+	else
+	{
+		VisitCell(UnboundedTrackers_RequiresLock);
+
+		for (int32 Level = 0; Level < NumLevels; Level++)
+		{
+			const TVoxelIntVectorMap<TVoxelArray<int32>>& Cells = LevelToCells_RequiresLock[Level];
+			if (Cells.Num() == 0)
+			{
+				continue;
+			}
+
+			const double CellSize = BaseCellSize * double(1ull << Level);
+
+			// Trackers extend up to one cell past the cell they're stored in
+			const FVector QueryMin = FloorVector(Bounds.Min / CellSize) - 1;
+			const FVector QueryMax = FloorVector(Bounds.Max / CellSize);
+			const FVector QuerySize = QueryMax - QueryMin + 1;
+
+			if (QuerySize.X * QuerySize.Y * QuerySize.Z > Cells.Num())
+			{
+				// Cheaper to go through all the cells
+				for (const auto& It : Cells)
+				{
+					if (QueryMin.X <= It.Key.X && It.Key.X <= QueryMax.X &&
+						QueryMin.Y <= It.Key.Y && It.Key.Y <= QueryMax.Y &&
+						QueryMin.Z <= It.Key.Z && It.Key.Z <= QueryMax.Z)
+					{
+						VisitCell(It.Value);
+					}
+				}
+				continue;
+			}
+
+			for (int32 X = int32(QueryMin.X); X <= int32(QueryMax.X); X++)
+			{
+				for (int32 Y = int32(QueryMin.Y); Y <= int32(QueryMax.Y); Y++)
+				{
+					for (int32 Z = int32(QueryMin.Z); Z <= int32(QueryMax.Z); Z++)
+					{
+						if (const TVoxelArray<int32>* Cell = Cells.Find(FIntVector(X, Y, Z)))
+						{
+							VisitCell(*Cell);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	INC_VOXEL_COUNTER(STAT_VoxelDependencyInvalidations);
+	INC_VOXEL_COUNTER_BY(STAT_VoxelDependencyTrackersTested, NumTested);
+	INC_VOXEL_COUNTER_BY(STAT_VoxelDependencyTrackersInvalidated, NumInvalidated);
+}
+
+int32 FVoxelDependency::AddTrackerRef_RequiresLock(const FTrackerRef& TrackerRef)
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	const int32 Index = TrackerRefs_RequiresLock.Add(TrackerRef);
+	FTrackerRef& NewTrackerRef = TrackerRefs_RequiresLock[Index];
+
+	if (NewTrackerRef.bHasBounds &&
+		NewTrackerRef.Bounds.IsValid())
+	{
+		const double Size = NewTrackerRef.Bounds.Size().GetMax();
+		const int32 Level = Size <= BaseCellSize ? 0 : FMath::CeilLogTwo64(uint64(FMath::CeilToDouble(Size / BaseCellSize)));
+
+		if (Level < NumLevels)
+		{
+			const double CellSize = BaseCellSize * double(1ull << Level);
+			const FVector Cell = FloorVector(NewTrackerRef.Bounds.Min / CellSize);
+
+			if (FMath::Abs(Cell.X) < MAX_int32 / 2 &&
+				FMath::Abs(Cell.Y) < MAX_int32 / 2 &&
+				FMath::Abs(Cell.Z) < MAX_int32 / 2)
+			{
+				NewTrackerRef.Level = Level;
+				NewTrackerRef.Cell = FIntVector(Cell.X, Cell.Y, Cell.Z);
+			}
+		}
+	}
+
+	TVoxelArray<int32>& Cell = GetCell_RequiresLock(NewTrackerRef);
+	NewTrackerRef.IndexInCell = Cell.Add(Index);
+
+	return Index;
+}
+
+void FVoxelDependency::RemoveTrackerRef_RequiresLock(const int32 Index)
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	const FTrackerRef& TrackerRef = TrackerRefs_RequiresLock[Index];
+	TVoxelArray<int32>& Cell = GetCell_RequiresLock(TrackerRef);
+
+	const int32 IndexInCell = TrackerRef.IndexInCell;
+	checkVoxelSlow(Cell[IndexInCell] == Index);
+
+	Cell.RemoveAtSwap(IndexInCell, 1, false);
+
+	if (Cell.IsValidIndex(IndexInCell))
+	{
+		TrackerRefs_RequiresLock[Cell[IndexInCell]].IndexInCell = IndexInCell;
+	}
+	else if (
+		Cell.Num() == 0 &&
+		TrackerRef.Level != -1)
+	{
+		LevelToCells_RequiresLock[TrackerRef.Level].Remove(TrackerRef.Cell);
+	}
+
+	TrackerRefs_RequiresLock.RemoveAt(Index);
+}
+
+TVoxelArray<int32>& FVoxelDependency::GetCell_RequiresLock(const FTrackerRef& TrackerRef)
+{
+	if (TrackerRef.Level == -1)
+	{
+		return UnboundedTrackers_RequiresLock;
+	}
+
+	return LevelToCells_RequiresLock[TrackerRef.Level].FindOrAdd(TrackerRef.Cell);
 }
 
 FVoxelDependency::FVoxelDependency(const FName ClassName, const FName InstanceName)
@@ -208,7 +379,7 @@ void FVoxelDependencyTracker::AddDependency(
 	int32 Index;
 	{
 		VOXEL_SCOPE_LOCK(Dependency->CriticalSection);
-		Index = Dependency->TrackerRefs_RequiresLock.Add(TrackerRef);
+		Index = Dependency->AddTrackerRef_RequiresLock(TrackerRef);
 	}
 	Dependency->UpdateStats();
 
@@ -253,7 +424,7 @@ void FVoxelDependencyTracker::Unregister_RequiresLock()
 		VOXEL_SCOPE_LOCK(Dependency->CriticalSection);
 
 		checkVoxelSlow(GetWeakPtrObject_Unsafe(Dependency->TrackerRefs_RequiresLock[DependencyRef.Index].WeakTracker) == this);
-		Dependency->TrackerRefs_RequiresLock.RemoveAt(DependencyRef.Index);
+		Dependency->RemoveTrackerRef_RequiresLock(DependencyRef.Index);
 	}
 	DependencyRefs.Empty();
 }
\ No newline at end of file
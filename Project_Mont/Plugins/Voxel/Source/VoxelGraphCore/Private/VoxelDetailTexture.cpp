@@ -13,9 +13,36 @@ DEFINE_VOXEL_FACTORY(UVoxelMaterialIdDetailTexture);
 DEFINE_VOXEL_FACTORY(UVoxelNormalDetailTexture);
 
 DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelDetailTextureMemory);
+DEFINE_VOXEL_COUNTER(STAT_VoxelDetailTextureEvictions);
+DEFINE_VOXEL_COUNTER(STAT_VoxelDetailTextureRelocations);
 
 FVoxelDetailTextureManager* GVoxelDetailTextureManager = MakeVoxelSingleton(FVoxelDetailTextureManager);
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelDetailTextureBudget, 0,
+	"voxel.DetailTextureBudget",
+	"Max memory in MB used by all the detail texture atlases. Atlases don't grow past it: the least recently rendered chunks are evicted to make room instead. 0 to disable");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelDetailTextureMinEvictionAge, 300,
+	"voxel.DetailTextureMinEvictionAge",
+	"Detail texture allocations created or rendered less than this many frames ago are never evicted");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelDetailTextureMaxEvictionsPerFrame, 64,
+	"voxel.DetailTextureMaxEvictionsPerFrame",
+	"Max number of detail texture allocations to evict per frame and per atlas when out of space");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, float, GVoxelDetailTextureCompactionThreshold, 0.5f,
+	"voxel.DetailTextureCompactionThreshold",
+	"A detail texture atlas is compacted to half its size when its used blocks would fill less than this fraction of the smaller atlas");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelDetailTextureMaxRelocationsPerFrame, 64,
+	"voxel.DetailTextureMaxRelocationsPerFrame",
+	"Max number of detail texture allocations to relocate per frame and per atlas when compacting");
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -140,6 +167,8 @@ FVoxelDetailTextureAllocator::FVoxelDetailTextureAllocator(
 FVoxelDetailTextureAllocator::~FVoxelDetailTextureAllocator()
 {
 	ensure(Textures_GameThread.Num() == NumTextures);
+
+	GVoxelDetailTextureManager->AllocatedMemory.Subtract(GetMemorySize(SizeInBlocks_RequiresLock));
 }
 
 void FVoxelDetailTextureAllocator::AddReferencedObjects(FReferenceCollector& Collector)
@@ -165,15 +194,15 @@ TSharedRef<FVoxelDetailTextureAllocation> FVoxelDetailTextureAllocator::Allocate
 	VOXEL_SCOPE_LOCK(CriticalSection);
 
 	const TSharedRef<FVoxelDetailTextureAllocation> Allocation(new FVoxelDetailTextureAllocation(*this, Num));
+	Allocations_RequiresLock.Add(Allocation.Get());
 
 	if (SizeInBlocks_RequiresLock == 0)
 	{
 		ensure(FreeRanges_RequiresLock.Num() == 0);
 
-		SizeInBlocks_RequiresLock = 512;
-		GVoxelDetailTextureManager->AllocatorsToUpdate.Enqueue(AsWeak());
+		Resize_RequiresLock(512);
 
-		for (int32 Y = 0; Y < SizeInBlocks_RequiresLock; Y++)
+		for (int32 Y = SizeInBlocks_RequiresLock - 1; Y >= 0; Y--)
 		{
 			FreeRanges_RequiresLock.Add(
 			{
@@ -187,33 +216,59 @@ TSharedRef<FVoxelDetailTextureAllocation> FVoxelDetailTextureAllocator::Allocate
 	int32 NumLeft = Num;
 	while (NumLeft > 0)
 	{
+		if (FreeRanges_RequiresLock.Num() == 0 &&
+			UsableSizeInBlocks_RequiresLock < SizeInBlocks_RequiresLock)
+		{
+			// We're out of space while compacting, cancel the compaction
+			UsableSizeInBlocks_RequiresLock = SizeInBlocks_RequiresLock;
+			RebuildFreeRanges_RequiresLock();
+			continue;
+		}
+
 		if (FreeRanges_RequiresLock.Num() == 0)
 		{
 			// Reallocate
 
-			if (!ensure(2 * SizeInBlocks_RequiresLock * TextureSize <= 16384))
+			if (2 * SizeInBlocks_RequiresLock * TextureSize > 16384 ||
+				!CanGrow_RequiresLock())
 			{
+				if (!bLoggedBudgetWarning_RequiresLock)
+				{
+					bLoggedBudgetWarning_RequiresLock = true;
+					LOG_VOXEL(Warning, "Detail texture %s TextureSize=%d: atlas full, evicting off-screen chunks. Consider increasing voxel.DetailTextureBudget",
+						*Name.ToString(),
+						TextureSize);
+				}
+
+				// Give back what we got so far, Compact_GameThread will make room & retry
+				for (const FVoxelDetailTextureAllocationRange& Range : Allocation->Ranges)
+				{
+					AddFreeRange_RequiresLock(Range);
+					NumAllocatedBlocks_RequiresLock -= Range.Num;
+				}
+				Allocation->Ranges.Reset();
+				Allocation->bIsOutOfSpace = true;
 				return Allocation;
 			}
 
-			for (int32 Y = 0; Y < SizeInBlocks_RequiresLock; Y++)
+			const int32 OldSizeInBlocks = SizeInBlocks_RequiresLock;
+			Resize_RequiresLock(2 * OldSizeInBlocks);
+
+			for (int32 Y = OldSizeInBlocks - 1; Y >= 0; Y--)
 			{
 				FreeRanges_RequiresLock.Add(
 				{
-					SizeInBlocks_RequiresLock,
+					OldSizeInBlocks,
 					Y,
-					SizeInBlocks_RequiresLock
+					OldSizeInBlocks
 				});
 				FreeRanges_RequiresLock.Add(
 				{
 					0,
-					SizeInBlocks_RequiresLock + Y,
-					2 * SizeInBlocks_RequiresLock
+					OldSizeInBlocks + Y,
+					2 * OldSizeInBlocks
 				});
 			}
-
-			SizeInBlocks_RequiresLock *= 2;
-			GVoxelDetailTextureManager->AllocatorsToUpdate.Enqueue(AsWeak());
 		}
 
 		const FVoxelDetailTextureAllocationRange Range = FreeRanges_RequiresLock.Pop(false);
@@ -223,6 +278,7 @@ TSharedRef<FVoxelDetailTextureAllocation> FVoxelDetailTextureAllocator::Allocate
 		Allocation->Ranges.Add({ Range.X, Range.Y, NumInRange });
 
 		NumLeft -= NumInRange;
+		NumAllocatedBlocks_RequiresLock += NumInRange;
 
 		if (NumInRange < Range.Num)
 		{
@@ -285,8 +341,7 @@ void FVoxelDetailTextureAllocator::Update_GameThread()
 		Textures_GameThread[Index] = Texture;
 	}
 
-	const FPixelFormatInfo& Format = GPixelFormats[PixelFormat];
-	DetailTextureMemory = Size * Size * Format.BlockBytes * NumTextures / (Format.BlockSizeX * Format.BlockSizeY);
+	DetailTextureMemory = GetMemorySize(SizeInBlocks_RequiresLock);
 
 	DynamicParameter->Textures = TArray<TWeakObjectPtr<UTexture2D>>(Textures_GameThread);
 	DynamicParameter->OnChangedMulticast.Broadcast();
@@ -304,8 +359,14 @@ void FVoxelDetailTextureAllocator::Update_GameThread()
 		FTextureResource* OldResource = OldTexture->GetResource();
 		FTextureResource* NewResource = NewTexture->GetResource();
 
+		// The atlas can shrink after a compaction, in which case everything still allocated is in the lower part
 		FRHICopyTextureInfo CopyInfo;
-		CopyInfo.Size = { OldTexture->GetSizeX(), OldTexture->GetSizeY(), 1 };
+		CopyInfo.Size =
+		{
+			FMath::Min(OldTexture->GetSizeX(), NewTexture->GetSizeX()),
+			FMath::Min(OldTexture->GetSizeY(), NewTexture->GetSizeY()),
+			1
+		};
 
 		VOXEL_ENQUEUE_RENDER_COMMAND(FVoxelDetailTextureAllocator_Reallocate)([OldResource, NewResource, CopyInfo](FRHICommandListImmediate& RHICmdList)
 		{
@@ -317,6 +378,296 @@ void FVoxelDetailTextureAllocator::Update_GameThread()
 	}
 }
 
+void FVoxelDetailTextureAllocator::Compact_GameThread()
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	EvictForRefusedAllocations_RequiresLock();
+
+	if (SizeInBlocks_RequiresLock <= 512)
+	{
+		return;
+	}
+
+	if (UsableSizeInBlocks_RequiresLock == SizeInBlocks_RequiresLock)
+	{
+		const int32 TargetSizeInBlocks = SizeInBlocks_RequiresLock / 2;
+		if (NumAllocatedBlocks_RequiresLock > GVoxelDetailTextureCompactionThreshold * FMath::Square(TargetSizeInBlocks))
+		{
+			return;
+		}
+
+		LOG_VOXEL(Verbose, "Compacting detail texture %s TextureSize=%d: %d blocks used out of %d",
+			*Name.ToString(),
+			TextureSize,
+			NumAllocatedBlocks_RequiresLock,
+			FMath::Square(SizeInBlocks_RequiresLock));
+
+		UsableSizeInBlocks_RequiresLock = TargetSizeInBlocks;
+		RebuildFreeRanges_RequiresLock();
+	}
+
+	const int32 UsableSize = UsableSizeInBlocks_RequiresLock;
+
+	bool bAllInside = true;
+	int32 NumRelocations = 0;
+	for (FVoxelDetailTextureAllocation* Allocation : Allocations_RequiresLock)
+	{
+		const bool bIsInside = INLINE_LAMBDA
+		{
+			for (const FVoxelDetailTextureAllocationRange& Range : Allocation->Ranges)
+			{
+				if (Range.Y >= UsableSize ||
+					Range.X + Range.Num > UsableSize)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		if (bIsInside)
+		{
+			continue;
+		}
+
+		bAllInside = false;
+
+		if (
+			Allocation->bRelocationRequested_RequiresLock ||
+			NumRelocations >= GVoxelDetailTextureMaxRelocationsPerFrame)
+		{
+			continue;
+		}
+
+		// Recompute the chunk: the new allocation will be in the lower part, and the old one freed once the mesh is swapped
+		Allocation->bRelocationRequested_RequiresLock = true;
+		GVoxelDetailTextureManager->DependenciesToInvalidate.Enqueue(Allocation->Dependency);
+
+		NumRelocations++;
+		INC_VOXEL_COUNTER(STAT_VoxelDetailTextureRelocations);
+	}
+
+	if (!bAllInside)
+	{
+		return;
+	}
+
+	LOG_VOXEL(Log, "Shrinking detail texture %s TextureSize=%d to %dx%d",
+		*Name.ToString(),
+		TextureSize,
+		UsableSize * TextureSize,
+		UsableSize * TextureSize);
+
+	Resize_RequiresLock(UsableSize);
+	RebuildFreeRanges_RequiresLock();
+}
+
+int64 FVoxelDetailTextureAllocator::GetMemorySize(const int32 SizeInBlocks) const
+{
+	const FPixelFormatInfo& Format = GPixelFormats[PixelFormat];
+	const int64 Size = int64(SizeInBlocks) * TextureSize;
+	return Size * Size * Format.BlockBytes * NumTextures / (Format.BlockSizeX * Format.BlockSizeY);
+}
+
+void FVoxelDetailTextureAllocator::Resize_RequiresLock(const int32 NewSizeInBlocks)
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	GVoxelDetailTextureManager->AllocatedMemory.Add(GetMemorySize(NewSizeInBlocks) - GetMemorySize(SizeInBlocks_RequiresLock));
+
+	SizeInBlocks_RequiresLock = NewSizeInBlocks;
+	UsableSizeInBlocks_RequiresLock = NewSizeInBlocks;
+	GVoxelDetailTextureManager->AllocatorsToUpdate.Enqueue(AsWeak());
+}
+
+bool FVoxelDetailTextureAllocator::CanGrow_RequiresLock() const
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	if (GVoxelDetailTextureBudget <= 0)
+	{
+		return true;
+	}
+
+	const int64 NewMemory =
+		GVoxelDetailTextureManager->AllocatedMemory.GetValue() +
+		GetMemorySize(2 * SizeInBlocks_RequiresLock) -
+		GetMemorySize(SizeInBlocks_RequiresLock);
+
+	return NewMemory <= int64(GVoxelDetailTextureBudget) * 1024 * 1024;
+}
+
+int32 FVoxelDetailTextureAllocator::AddFreeRange_RequiresLock(const FVoxelDetailTextureAllocationRange& Range)
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+	CheckRange(Range);
+
+	// Drop anything outside of the usable area, it'll be reclaimed if the compaction is canceled
+	if (Range.Y >= UsableSizeInBlocks_RequiresLock ||
+		Range.X >= UsableSizeInBlocks_RequiresLock)
+	{
+		return 0;
+	}
+
+	const int32 Num = FMath::Min<int32>(Range.Num, UsableSizeInBlocks_RequiresLock - Range.X);
+	FreeRanges_RequiresLock.Add({ Range.X, Range.Y, Num });
+	return Num;
+}
+
+void FVoxelDetailTextureAllocator::RebuildFreeRanges_RequiresLock()
+{
+	VOXEL_FUNCTION_COUNTER();
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	const int32 Size = SizeInBlocks_RequiresLock;
+	const int32 UsableSize = UsableSizeInBlocks_RequiresLock;
+
+	FVoxelBitArray32 IsUsed;
+	IsUsed.SetNumZeroed(Size * Size);
+
+	for (const FVoxelDetailTextureAllocation* Allocation : Allocations_RequiresLock)
+	{
+		for (const FVoxelDetailTextureAllocationRange& Range : Allocation->Ranges)
+		{
+			CheckRange(Range);
+			IsUsed.SetRange(Range.X + Size * Range.Y, Range.Num, true);
+		}
+	}
+
+	// Also merges fragmented ranges
+	FreeRanges_RequiresLock.Reset();
+
+	// Free ranges are popped from the end, add the top rows first so that the bottom rows are used first
+	for (int32 Y = UsableSize - 1; Y >= 0; Y--)
+	{
+		int32 X = 0;
+		while (X < UsableSize)
+		{
+			if (IsUsed[X + Size * Y])
+			{
+				X++;
+				continue;
+			}
+
+			const int32 StartX = X;
+			while (
+				X < UsableSize &&
+				!IsUsed[X + Size * Y])
+			{
+				X++;
+			}
+
+			const FVoxelDetailTextureAllocationRange Range{ StartX, Y, X - StartX };
+			CheckRange(Range);
+			FreeRanges_RequiresLock.Add(Range);
+		}
+	}
+}
+
+void FVoxelDetailTextureAllocator::EvictForRefusedAllocations_RequiresLock()
+{
+	VOXEL_FUNCTION_COUNTER();
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	TVoxelArray<FVoxelDetailTextureAllocation*> RefusedAllocations;
+	int64 NumRefusedBlocks = 0;
+	for (FVoxelDetailTextureAllocation* Allocation : Allocations_RequiresLock)
+	{
+		if (Allocation->bIsOutOfSpace &&
+			!Allocation->bRetryRequested_RequiresLock)
+		{
+			RefusedAllocations.Add(Allocation);
+			NumRefusedBlocks += Allocation->Num;
+		}
+	}
+
+	if (RefusedAllocations.Num() == 0)
+	{
+		return;
+	}
+
+	const auto GetNumFreeBlocks = [&]
+	{
+		return int64(FMath::Square(SizeInBlocks_RequiresLock)) - NumAllocatedBlocks_RequiresLock;
+	};
+
+	if (GetNumFreeBlocks() < NumRefusedBlocks)
+	{
+		// Evict the least recently rendered allocations first
+		// Allocations rendered or created recently are skipped, so that we don't evict what's on screen
+		const uint64 MinAge = FMath::Max(GVoxelDetailTextureMinEvictionAge, 1);
+		const uint64 MaxLastUsedFrame = GFrameCounter > MinAge ? GFrameCounter - MinAge : 0;
+
+		TVoxelArray<FVoxelDetailTextureAllocation*> Candidates;
+		for (FVoxelDetailTextureAllocation* Allocation : Allocations_RequiresLock)
+		{
+			if (Allocation->bIsEvicted_RequiresLock ||
+				Allocation->bIsOutOfSpace ||
+				Allocation->LastUsedFrame.Load() > MaxLastUsedFrame)
+			{
+				continue;
+			}
+			Candidates.Add(Allocation);
+		}
+
+		Candidates.Sort([](const FVoxelDetailTextureAllocation& A, const FVoxelDetailTextureAllocation& B)
+		{
+			return A.LastUsedFrame.Load() < B.LastUsedFrame.Load();
+		});
+
+		int32 NumEvictions = 0;
+		for (FVoxelDetailTextureAllocation* Allocation : Candidates)
+		{
+			if (NumEvictions >= GVoxelDetailTextureMaxEvictionsPerFrame ||
+				GetNumFreeBlocks() >= NumRefusedBlocks)
+			{
+				break;
+			}
+
+			Evict_RequiresLock(*Allocation);
+			NumEvictions++;
+		}
+	}
+
+	// Retry the refused allocations that now fit, oldest first
+	int64 NumFreeBlocks = GetNumFreeBlocks();
+	for (FVoxelDetailTextureAllocation* Allocation : RefusedAllocations)
+	{
+		if (Allocation->Num > NumFreeBlocks)
+		{
+			continue;
+		}
+
+		NumFreeBlocks -= Allocation->Num;
+		Allocation->bRetryRequested_RequiresLock = true;
+		GVoxelDetailTextureManager->DependenciesToInvalidate.Enqueue(Allocation->Dependency);
+	}
+}
+
+void FVoxelDetailTextureAllocator::Evict_RequiresLock(FVoxelDetailTextureAllocation& Allocation)
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+	check(IsInGameThread());
+	ensure(!Allocation.bIsEvicted_RequiresLock);
+
+	// The chunk wasn't rendered for a while, it's fine for its mesh to sample freed blocks until it's recomputed
+	// Uploads only happen right after allocating, and are flushed on the game thread after this
+	for (const FVoxelDetailTextureAllocationRange& Range : Allocation.Ranges)
+	{
+		AddFreeRange_RequiresLock(Range);
+		NumAllocatedBlocks_RequiresLock -= Range.Num;
+	}
+	Allocation.Ranges.Reset();
+	Allocation.bIsEvicted_RequiresLock = true;
+
+	GVoxelDetailTextureManager->DependenciesToInvalidate.Enqueue(Allocation.Dependency);
+	INC_VOXEL_COUNTER(STAT_VoxelDetailTextureEvictions);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -376,12 +727,13 @@ FVoxelDetailTextureAllocation::~FVoxelDetailTextureAllocation()
 
 	VOXEL_SCOPE_LOCK(Allocator->CriticalSection);
 
+	ensure(Allocator->Allocations_RequiresLock.Remove(this) == 1);
+
 	for (const FVoxelDetailTextureAllocationRange& Range : Ranges)
 	{
-		Allocator->CheckRange(Range);
+		Allocator->AddFreeRange_RequiresLock(Range);
+		Allocator->NumAllocatedBlocks_RequiresLock -= Range.Num;
 	}
-
-	Allocator->FreeRanges_RequiresLock.Append(Ranges);
 }
 
 TSharedRef<FVoxelDetailTextureDynamicMaterialParameter> FVoxelDetailTextureAllocation::GetTexture() const
@@ -404,6 +756,8 @@ FVoxelDetailTextureAllocation::FVoxelDetailTextureAllocation(
 	, NumTextures(Allocator.NumTextures)
 	, Num(Num)
 	, WeakAllocator(Allocator.AsWeak())
+	, Dependency(FVoxelDependency::Create(STATIC_FNAME("DetailTexture Allocation"), Allocator.Name))
+	, LastUsedFrame(GFrameCounter)
 {
 }
 
@@ -494,69 +848,6 @@ FVoxelDummyFutureValue FVoxelDetailTextureUpload::Upload()
 	return Dummy;
 }
 
-void FVoxelDetailTextureUpload::BeginUpload_GameThread()
-{
-	VOXEL_FUNCTION_COUNTER();
-	check(IsInGameThread());
-
-	const TSharedPtr<FVoxelDetailTextureAllocator> Allocator = Allocation->WeakAllocator.Pin();
-	if (!Allocator ||
-		!ensure(Allocator->Textures_GameThread.IsValidIndex(TextureIndex)) ||
-		!ensure(Allocator->Textures_GameThread[TextureIndex]))
-	{
-		return;
-	}
-
-	const FTextureResource* Resource = Allocator->Textures_GameThread[TextureIndex]->GetResource();
-	if (!ensure(Resource))
-	{
-		return;
-	}
-
-	VOXEL_ENQUEUE_RENDER_COMMAND(FVoxelDetailTextureUpload_Upload)([This = AsShared(), Resource](FRHICommandListImmediate& RHICmdList)
-	{
-		This->Upload_RenderThread(*Resource);
-	});
-}
-
-void FVoxelDetailTextureUpload::Upload_RenderThread(const FTextureResource& Resource)
-{
-	VOXEL_FUNCTION_COUNTER();
-	check(IsInRenderingThread());
-
-	FRHITexture* TextureRHI = Resource.GetTexture2DRHI();
-	if (!ensure(TextureRHI))
-	{
-		return;
-	}
-
-	int32 Index = 0;
-	for (const FVoxelDetailTextureAllocationRange& Range : Allocation->Ranges)
-	{
-		const FUpdateTextureRegion2D UpdateRegion(
-			TextureSize * Range.X,
-			TextureSize * Range.Y,
-			// DX12 RHI is bugged, Src is not used
-			0,
-			0,
-			TextureSize * Range.Num,
-			TextureSize);
-
-		VOXEL_SCOPE_COUNTER_FORMAT("RHIUpdateTexture2D %s Num=%d", *Allocation->Name.ToString(), TextureSize * TextureSize * Range.Num);
-		RHIUpdateTexture2D_Safe(
-			TextureRHI,
-			0,
-			UpdateRegion,
-			Allocation->Num * TextureSize * BytesPerPixel,
-			MakeVoxelArrayView(UploadData).RightChop(TextureSize * Index * BytesPerPixel));
-
-		Index += Range.Num;
-	}
-	ensure(Index == Allocation->Num);
-
-	OnUploadComplete();
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -610,7 +901,9 @@ TSharedRef<FVoxelDetailTextureAllocation> FVoxelDetailTexturePool::Allocate_AnyT
 		}
 	}
 
-	return TextureAllocator->Allocate_AnyThread(Num);
+	const TSharedRef<FVoxelDetailTextureAllocation> Allocation = TextureAllocator->Allocate_AnyThread(Num);
+	Query.GetDependencyTracker().AddDependency(Allocation->Dependency);
+	return Allocation;
 }
 
 void FVoxelDetailTexturePool::UpdateTextureSize_GameThread()
@@ -693,6 +986,26 @@ void FVoxelDetailTexturePool::UpdatePixelFormat_GameThread()
 	PixelFormatDependency->Invalidate();
 }
 
+void FVoxelDetailTexturePool::Compact_GameThread()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	TVoxelArray<TSharedPtr<FVoxelDetailTextureAllocator>> Allocators;
+	{
+		VOXEL_SCOPE_LOCK(CriticalSection);
+
+		for (const auto& It : TextureSizeToTextureAllocator_RequiresLock)
+		{
+			Allocators.Add(It.Value);
+		}
+	}
+
+	for (const TSharedPtr<FVoxelDetailTextureAllocator>& Allocator : Allocators)
+	{
+		Allocator->Compact_GameThread();
+	}
+}
+
 int32 FVoxelDetailTexturePool::GetTextureSize_AnyThread(const int32 LOD, const FVoxelQuery& Query)
 {
 	TSharedPtr<FVoxelDependency> Dependency;
@@ -776,11 +1089,211 @@ void FVoxelDetailTextureManager::Tick()
 		}
 	}
 
+	for (const auto& It : TextureToPool)
+	{
+		It.Value->Compact_GameThread();
+	}
+
+	{
+		// Recompute evicted or relocated chunks
+		FVoxelDependencyInvalidationScope InvalidationScope;
+
+		TWeakPtr<FVoxelDependency> WeakDependency;
+		while (DependenciesToInvalidate.Dequeue(WeakDependency))
+		{
+			if (const TSharedPtr<FVoxelDependency> Dependency = WeakDependency.Pin())
+			{
+				Dependency->Invalidate();
+			}
+		}
+	}
+
 	// Then upload data
-	TSharedPtr<FVoxelDetailTextureUpload> Upload;
-	while (PendingUploads.Dequeue(Upload))
+	FlushUploads_GameThread();
+}
+
+void FVoxelDetailTextureManager::FlushUploads_GameThread()
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	TVoxelArray<TSharedPtr<FVoxelDetailTextureUpload>> Uploads;
+	{
+		TSharedPtr<FVoxelDetailTextureUpload> Upload;
+		while (PendingUploads.Dequeue(Upload))
+		{
+			Uploads.Add(Upload);
+		}
+	}
+
+	if (Uploads.Num() == 0)
+	{
+		return;
+	}
+
+	// All the blocks going to the same texture this frame are packed into a single staging texture,
+	// which is uploaded once and then copied into the atlas on the GPU
+	TVoxelMap<TPair<FVoxelDetailTextureAllocator*, int32>, TSharedPtr<FUploadBatch>> Batches;
+	TVoxelArray<TSharedPtr<FVoxelDetailTextureUpload>> SkippedUploads;
+
+	for (const TSharedPtr<FVoxelDetailTextureUpload>& Upload : Uploads)
 	{
-		Upload->BeginUpload_GameThread();
+		const TSharedPtr<FVoxelDetailTextureAllocator> Allocator = Upload->Allocation->WeakAllocator.Pin();
+		if (!Allocator ||
+			!ensure(Allocator->Textures_GameThread.IsValidIndex(Upload->TextureIndex)) ||
+			!ensure(Allocator->Textures_GameThread[Upload->TextureIndex]))
+		{
+			SkippedUploads.Add(Upload);
+			continue;
+		}
+
+		const FTextureResource* Resource = Allocator->Textures_GameThread[Upload->TextureIndex]->GetResource();
+		if (!ensure(Resource))
+		{
+			SkippedUploads.Add(Upload);
+			continue;
+		}
+
+		VOXEL_SCOPE_LOCK(Allocator->CriticalSection);
+
+		// Evicted allocations gave their blocks back, don't overwrite them
+		if (Upload->Allocation->bIsEvicted_RequiresLock)
+		{
+			SkippedUploads.Add(Upload);
+			continue;
+		}
+
+		TSharedPtr<FUploadBatch>& Batch = Batches.FindOrAdd({ Allocator.Get(), Upload->TextureIndex });
+		if (!Batch)
+		{
+			Batch = MakeVoxelShared<FUploadBatch>();
+			Batch->Resource = Resource;
+			Batch->TextureSize = Allocator->TextureSize;
+			Batch->BytesPerPixel = GPixelFormats[Allocator->PixelFormat].BlockBytes;
+			Batch->PixelFormat = Allocator->PixelFormat;
+			Batch->StagingSizeInBlocks = FIntPoint(Allocator->SizeInBlocks_RequiresLock, 0);
+		}
+		ensure(Batch->Resource == Resource);
+
+		const int32 UploadIndex = Batch->Uploads.Add(Upload);
+
+		int32 SourceOffset = 0;
+		for (const FVoxelDetailTextureAllocationRange& Range : Upload->Allocation->Ranges)
+		{
+			// Shelf packing, each range stays contiguous so that it's a single copy
+			FIntPoint& StagingSize = Batch->StagingSizeInBlocks;
+			StagingSize.X = FMath::Max(StagingSize.X, Range.Num);
+
+			if (StagingSize.Y == 0 ||
+				Batch->StagingCursorX + Range.Num > StagingSize.X)
+			{
+				StagingSize.Y++;
+				Batch->StagingCursorX = 0;
+			}
+
+			FUploadCopy& Copy = Batch->Copies.Emplace_GetRef();
+			Copy.UploadIndex = UploadIndex;
+			Copy.SourceOffset = SourceOffset;
+			Copy.StagingPosition = FIntPoint(Batch->StagingCursorX, StagingSize.Y - 1);
+			Copy.Range = Range;
+
+			Batch->StagingCursorX += Range.Num;
+			checkVoxelSlow(Copy.StagingPosition.X + Range.Num <= StagingSize.X);
+
+			SourceOffset += Range.Num;
+		}
+		ensure(SourceOffset == Upload->Allocation->Num);
+	}
+
+	for (const TSharedPtr<FVoxelDetailTextureUpload>& Upload : SkippedUploads)
+	{
+		Upload->OnUploadComplete();
+	}
+
+	for (const auto& It : Batches)
+	{
+		VOXEL_ENQUEUE_RENDER_COMMAND(FVoxelDetailTextureManager_Upload)([Batch = It.Value.ToSharedRef()](FRHICommandListImmediate& RHICmdList)
+		{
+			Upload_RenderThread(RHICmdList, *Batch);
+		});
+	}
+}
+
+void FVoxelDetailTextureManager::Upload_RenderThread(FRHICommandListImmediate& RHICmdList, const FUploadBatch& Batch)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInRenderingThread());
+
+	ON_SCOPE_EXIT
+	{
+		for (const TSharedPtr<FVoxelDetailTextureUpload>& Upload : Batch.Uploads)
+		{
+			Upload->OnUploadComplete();
+		}
+	};
+
+	FRHITexture* TextureRHI = Batch.Resource->GetTexture2DRHI();
+	if (!ensure(TextureRHI))
+	{
+		return;
+	}
+
+	const int32 TextureSize = Batch.TextureSize;
+	const int32 BytesPerPixel = Batch.BytesPerPixel;
+
+	VOXEL_SCOPE_COUNTER_FORMAT("Upload NumCopies=%d", Batch.Copies.Num());
+
+	const TRefCountPtr<FRHITexture2D> StagingTextureRHI = RHICreateTexture(
+		FRHITextureCreateDesc::Create2D(TEXT("VoxelDetailTextureStaging"))
+		.SetExtent(Batch.StagingSizeInBlocks.X * TextureSize, Batch.StagingSizeInBlocks.Y * TextureSize)
+		.SetFormat(Batch.PixelFormat)
+		.SetNumMips(1)
+		.SetNumSamples(1)
+		.SetFlags(TexCreate_ShaderResource));
+
+	if (!ensure(StagingTextureRHI.IsValid()))
+	{
+		return;
+	}
+
+	{
+		VOXEL_SCOPE_COUNTER("Copy to staging");
+
+		uint32 Stride = 0;
+		uint8* LockedData = static_cast<uint8*>(RHILockTexture2D(StagingTextureRHI, 0, RLM_WriteOnly, Stride, false, false));
+		if (!ensure(LockedData))
+		{
+			return;
+		}
+
+		for (const FUploadCopy& Copy : Batch.Copies)
+		{
+			const FVoxelDetailTextureUpload& Upload = *Batch.Uploads[Copy.UploadIndex];
+			const int32 SourcePitch = Upload.Allocation->Num * TextureSize * BytesPerPixel;
+			const int32 NumBytes = Copy.Range.Num * TextureSize * BytesPerPixel;
+
+			for (int32 Y = 0; Y < TextureSize; Y++)
+			{
+				FMemory::Memcpy(
+					LockedData + (Copy.StagingPosition.Y * TextureSize + Y) * Stride + Copy.StagingPosition.X * TextureSize * BytesPerPixel,
+					Upload.UploadData.GetData() + Y * SourcePitch + Copy.SourceOffset * TextureSize * BytesPerPixel,
+					NumBytes);
+			}
+		}
+
+		RHIUnlockTexture2D(StagingTextureRHI, 0, false, false);
+	}
+
+	VOXEL_SCOPE_COUNTER("CopyTexture");
+
+	for (const FUploadCopy& Copy : Batch.Copies)
+	{
+		FRHICopyTextureInfo CopyInfo;
+		CopyInfo.Size = FIntVector(Copy.Range.Num * TextureSize, TextureSize, 1);
+		CopyInfo.SourcePosition = FIntVector(Copy.StagingPosition.X * TextureSize, Copy.StagingPosition.Y * TextureSize, 0);
+		CopyInfo.DestPosition = FIntVector(Copy.Range.X * TextureSize, Copy.Range.Y * TextureSize, 0);
+
+		RHICmdList.CopyTexture(StagingTextureRHI, TextureRHI, CopyInfo);
 	}
 }
 
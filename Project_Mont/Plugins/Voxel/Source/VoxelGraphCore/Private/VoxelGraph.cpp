@@ -113,6 +113,11 @@ void UVoxelGraph::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedE
 	FixupParameters();
 	FixupInlineMacroCategories();
 
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_OWN_MEMBER_NAME(bFuseISPCNodes))
+	{
+		ForceRecompile();
+	}
+
 	if (PropertyChangedEvent.GetMemberPropertyName() == GET_OWN_MEMBER_NAME(Category))
 	{
 		if (UVoxelGraph* ParentGraph = GetTypedOuter<UVoxelGraph>())
@@ -6,6 +6,7 @@
 #include "VoxelExecNode.h"
 #include "VoxelExecNodes.h"
 #include "VoxelDebugNode.h"
+#include "VoxelISPCNode.h"
 #include "VoxelTemplateNode.h"
 #include "VoxelFunctionNode.h"
 #include "VoxelParameterNode.h"
@@ -1153,6 +1154,355 @@ void FVoxelGraphCompiler::CheckForLoops(FGraph& Graph)
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+void FVoxelGraphCompiler::Optimize(FGraph& Graph, const FString& DebugName)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const int32 NumNodes = Graph.GetNodes().Num();
+
+	int32 NumFolded = 0;
+	int32 NumPruned = 0;
+	int32 NumMerged = 0;
+
+	const auto RunPass = [&](bool (*Pass)(FGraph&), int32& NumRemoved)
+	{
+		const int32 NumNodesBefore = Graph.GetNodes().Num();
+		if (!Pass(Graph))
+		{
+			return false;
+		}
+
+		// Passes only relink pins, remove whatever they made unreachable
+		RemoveUnusedNodes(Graph);
+		NumRemoved += NumNodesBefore - Graph.GetNodes().Num();
+		return true;
+	};
+
+	// Each pass can enable the others, eg a folded index pruning a select can make two noises identical
+	while (true)
+	{
+		bool bChanged = false;
+		bChanged |= RunPass(FoldConstants, NumFolded);
+		bChanged |= RunPass(PruneConstantBranches, NumPruned);
+		bChanged |= RunPass(RemoveDuplicateNodes, NumMerged);
+
+		if (!bChanged)
+		{
+			break;
+		}
+	}
+
+	LOG_VOXEL(Verbose, "%s: %d nodes -> %d nodes. FoldConstants: %d removed, PruneConstantBranches: %d removed, RemoveDuplicateNodes: %d removed",
+		*DebugName,
+		NumNodes,
+		Graph.GetNodes().Num(),
+		NumFolded,
+		NumPruned,
+		NumMerged);
+}
+
+bool FVoxelGraphCompiler::FoldConstants(FGraph& Graph)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	bool bChanged = false;
+	for (FNode& Node : Graph.GetNodes())
+	{
+		if (Node.Type != ENodeType::Struct)
+		{
+			continue;
+		}
+
+		const FVoxelISPCNode* ISPCNode = Cast<FVoxelISPCNode>(Node.GetVoxelNode());
+		if (!ISPCNode)
+		{
+			continue;
+		}
+
+		bool bHasLinkedOutput = false;
+		for (const FPin& Pin : Node.GetOutputPins())
+		{
+			bHasLinkedOutput |= Pin.GetLinkedTo().Num() > 0;
+		}
+
+		if (!bHasLinkedOutput)
+		{
+			continue;
+		}
+
+		TVoxelArray<FVoxelRuntimePinValue> InputValues;
+		const bool bIsConstant = INLINE_LAMBDA
+		{
+			for (const FVoxelPin& VoxelPin : ISPCNode->GetPins())
+			{
+				if (!VoxelPin.bIsInput)
+				{
+					continue;
+				}
+
+				const FPin* Pin = Node.FindInput(VoxelPin.Name);
+				if (!ensure(Pin) ||
+					Pin->GetLinkedTo().Num() > 0 ||
+					!Pin->Type.HasPinDefaultValue())
+				{
+					return false;
+				}
+
+				const FVoxelRuntimePinValue Value = FVoxelPinType::MakeRuntimeValueFromInnerValue(
+					Pin->Type.GetInnerType(),
+					Pin->GetDefaultValue());
+
+				if (!Value.IsValid())
+				{
+					return false;
+				}
+
+				InputValues.Add(Value);
+			}
+			return true;
+		};
+
+		TVoxelArray<FVoxelRuntimePinValue> OutputValues;
+		if (!bIsConstant ||
+			!ISPCNode->ComputeConstants(InputValues, OutputValues))
+		{
+			continue;
+		}
+
+		int32 OutputIndex = 0;
+		for (const FVoxelPin& VoxelPin : ISPCNode->GetPins())
+		{
+			if (VoxelPin.bIsInput)
+			{
+				continue;
+			}
+
+			FPin& OutputPin = Node.FindOutputChecked(VoxelPin.Name);
+			if (!ensure(OutputValues.IsValidIndex(OutputIndex)))
+			{
+				break;
+			}
+
+			const FVoxelPinValue Value = FVoxelPinType::MakeExposedInnerValue(OutputValues[OutputIndex++]);
+			if (!Value.IsValid())
+			{
+				continue;
+			}
+
+			for (FPin* LinkedTo : OutputPin.GetLinkedTo().Array())
+			{
+				// Pins without default values, eg buffer arrays, keep the link
+				if (!LinkedTo->Type.HasPinDefaultValue() ||
+					!Value.GetType().CanBeCastedTo(LinkedTo->Type.GetPinDefaultValueType()))
+				{
+					continue;
+				}
+
+				OutputPin.BreakLinkTo(*LinkedTo);
+				LinkedTo->SetDefaultValue(Value);
+				bChanged = true;
+			}
+		}
+	}
+	return bChanged;
+}
+
+bool FVoxelGraphCompiler::PruneConstantBranches(FGraph& Graph)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	bool bChanged = false;
+	for (FNode& Node : Graph.GetNodes())
+	{
+		if (Node.Type != ENodeType::Struct)
+		{
+			continue;
+		}
+
+		TVoxelMap<FName, FVoxelPinValue> ConstantInputs;
+		for (const FPin& Pin : Node.GetInputPins())
+		{
+			if (Pin.GetLinkedTo().Num() == 0 &&
+				Pin.Type.HasPinDefaultValue())
+			{
+				ConstantInputs.Add_CheckNew(Pin.Name, Pin.GetDefaultValue());
+			}
+		}
+
+		if (ConstantInputs.Num() == 0)
+		{
+			continue;
+		}
+
+		for (FPin& OutputPin : Node.GetOutputPins())
+		{
+			if (OutputPin.GetLinkedTo().Num() == 0)
+			{
+				continue;
+			}
+
+			const FName InputPinName = Node.GetVoxelNode().GetConstantPassthroughPin(OutputPin.Name, ConstantInputs);
+			if (InputPinName.IsNone())
+			{
+				continue;
+			}
+
+			const FPin* InputPin = Node.FindInput(InputPinName);
+			if (!ensure(InputPin))
+			{
+				continue;
+			}
+
+			for (FPin* LinkedTo : OutputPin.GetLinkedTo().Array())
+			{
+				if (InputPin->GetLinkedTo().Num() == 0 &&
+					!LinkedTo->Type.HasPinDefaultValue())
+				{
+					continue;
+				}
+
+				OutputPin.BreakLinkTo(*LinkedTo);
+				InputPin->CopyInputPinTo(*LinkedTo);
+				bChanged = true;
+			}
+		}
+	}
+	return bChanged;
+}
+
+bool FVoxelGraphCompiler::RemoveDuplicateNodes(FGraph& Graph)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const auto CanMerge = [](const FNode& Node)
+	{
+		if (Node.Type != ENodeType::Struct ||
+			!Node.GetVoxelNode().IsPureNode())
+		{
+			return false;
+		}
+
+		for (const FVoxelPin& Pin : Node.GetVoxelNode().GetPins())
+		{
+			// Virtual pins are computed from the node ref, two nodes can have different inputs
+			if (Pin.Metadata.bVirtualPin)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	const auto GetHash = [](const FNode& Node)
+	{
+		uint32 Hash = Node.GetVoxelNode().GetNodeHash();
+		int32 Index = 0;
+		for (const FPin& Pin : Node.GetInputPins())
+		{
+			const uint32 PinHash =
+				Pin.GetLinkedTo().Num() > 0
+				? GetTypeHash(&Pin.GetLinkedTo()[0])
+				: Pin.GetDefaultValue().IsValid()
+				? Pin.GetDefaultValue().GetHash()
+				: 0;
+
+			Hash ^= FVoxelUtilities::MurmurHash(PinHash, Index++);
+		}
+		return Hash;
+	};
+
+	const auto AreIdentical = [](const FNode& A, const FNode& B)
+	{
+		if (A.GetInputPins().Num() != B.GetInputPins().Num() ||
+			A.GetOutputPins().Num() != B.GetOutputPins().Num())
+		{
+			return false;
+		}
+
+		for (int32 Index = 0; Index < A.GetInputPins().Num(); Index++)
+		{
+			const FPin& PinA = A.GetInputPin(Index);
+			const FPin& PinB = B.GetInputPin(Index);
+
+			if (PinA.Name != PinB.Name ||
+				PinA.Type != PinB.Type ||
+				PinA.GetLinkedTo().Num() != PinB.GetLinkedTo().Num())
+			{
+				return false;
+			}
+
+			if (PinA.GetLinkedTo().Num() > 0)
+			{
+				if (&PinA.GetLinkedTo()[0] != &PinB.GetLinkedTo()[0])
+				{
+					return false;
+				}
+			}
+			else if (PinA.GetDefaultValue() != PinB.GetDefaultValue())
+			{
+				return false;
+			}
+		}
+
+		for (int32 Index = 0; Index < A.GetOutputPins().Num(); Index++)
+		{
+			if (A.GetOutputPin(Index).Name != B.GetOutputPin(Index).Name ||
+				A.GetOutputPin(Index).Type != B.GetOutputPin(Index).Type)
+			{
+				return false;
+			}
+		}
+
+		return A.GetVoxelNode().IsNodeIdentical(B.GetVoxelNode());
+	};
+
+	bool bChanged = false;
+	TVoxelAddOnlyMap<uint32, TVoxelArray<FNode*, TVoxelInlineAllocator<1>>> HashToNodes;
+
+	for (FNode& Node : Graph.GetNodes())
+	{
+		if (!CanMerge(Node))
+		{
+			continue;
+		}
+
+		TVoxelArray<FNode*, TVoxelInlineAllocator<1>>& Nodes = HashToNodes.FindOrAdd(GetHash(Node));
+
+		FNode* ExistingNode = nullptr;
+		for (FNode* OtherNode : Nodes)
+		{
+			if (AreIdentical(*OtherNode, Node))
+			{
+				ExistingNode = OtherNode;
+				break;
+			}
+		}
+
+		if (!ExistingNode)
+		{
+			Nodes.Add(&Node);
+			continue;
+		}
+
+		for (FPin& OutputPin : Node.GetOutputPins())
+		{
+			if (OutputPin.GetLinkedTo().Num() == 0)
+			{
+				continue;
+			}
+
+			OutputPin.CopyOutputPinTo(ExistingNode->FindOutputChecked(OutputPin.Name));
+			OutputPin.BreakAllLinks();
+			bChanged = true;
+		}
+	}
+	return bChanged;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 bool FVoxelGraphCompiler::ReplaceTemplatesImpl(FGraph& Graph)
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -3,8 +3,94 @@
 #include "VoxelISPCNode.h"
 #include "VoxelISPCNodeImpl.h"
 #include "VoxelBuffer.h"
+#include "VoxelTaskGroup.h"
 #include "VoxelQueryCache.h"
 
+VOXEL_CONSOLE_COMMAND(
+	BenchmarkISPCFusion,
+	"voxel.BenchmarkISPCFusion",
+	"Compare the throughput of a chain of 8 multiply nodes on 1M voxels, with and without fusion")
+{
+	const FVoxelNodeISPCPtr Ptr = GVoxelNodeISPCPtrs.FindRef("VoxelNode_Multiply_Float");
+	if (!ensure(Ptr))
+	{
+		return;
+	}
+
+	constexpr int32 NumNodes = 8;
+	constexpr int32 Num = 1024 * 1024;
+	constexpr int32 NumPerChunk = FVoxelBufferDefinitions::NumPerChunk;
+
+	float Constant = 1.0001f;
+
+	TVoxelArray<TVoxelArray<float>> Buffers;
+	for (int32 Index = 0; Index < NumNodes + 1; Index++)
+	{
+		Buffers.Emplace_GetRef().Init(1.f, Num);
+	}
+
+	double UnfusedTime;
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		// Each node streams the previous node output back from memory
+		for (int32 NodeIndex = 0; NodeIndex < NumNodes; NodeIndex++)
+		{
+			for (int32 Index = 0; Index < Num; Index += NumPerChunk)
+			{
+				const ispc::FVoxelBuffer ISPCBuffers[] =
+				{
+					{ &Buffers[NodeIndex][Index], false },
+					{ &Constant, true },
+					{ &Buffers[NodeIndex + 1][Index], false }
+				};
+				Ptr(ISPCBuffers, FMath::Min(NumPerChunk, Num - Index));
+			}
+		}
+
+		UnfusedTime = FPlatformTime::Seconds() - StartTime;
+	}
+
+	double FusedTime;
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		TVoxelArray<float> Scratch;
+		FVoxelUtilities::SetNumFast(Scratch, 2 * NumPerChunk);
+
+		// Intermediates stay in a chunk-sized scratch buffer
+		for (int32 Index = 0; Index < Num; Index += NumPerChunk)
+		{
+			for (int32 NodeIndex = 0; NodeIndex < NumNodes; NodeIndex++)
+			{
+				float* Input = NodeIndex == 0 ? &Buffers[0][Index] : &Scratch[(NodeIndex % 2) * NumPerChunk];
+				float* Output = NodeIndex == NumNodes - 1 ? &Buffers[NumNodes][Index] : &Scratch[((NodeIndex + 1) % 2) * NumPerChunk];
+
+				const ispc::FVoxelBuffer ISPCBuffers[] =
+				{
+					{ Input, false },
+					{ &Constant, true },
+					{ Output, false }
+				};
+				Ptr(ISPCBuffers, FMath::Min(NumPerChunk, Num - Index));
+			}
+		}
+
+		FusedTime = FPlatformTime::Seconds() - StartTime;
+	}
+
+	LOG_VOXEL(Log, "ISPC fusion benchmark: %d nodes, %d voxels. Unfused: %.3fns/voxel Fused: %.3fns/voxel (x%.2f)",
+		NumNodes,
+		Num,
+		UnfusedTime * 1.e9 / Num,
+		FusedTime * 1.e9 / Num,
+		UnfusedTime / FMath::Max(FusedTime, UE_SMALL_NUMBER));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 void FVoxelISPCNode::PreCompile()
 {
 	ensure(!CachedPtr);
@@ -20,6 +106,11 @@ void FVoxelISPCNode::PreCompile()
 			GetNodeRuntime().GetPinData(Pin.Name).PinId
 		});
 	}
+
+	if (CachedPtr)
+	{
+		CompileFusedKernel();
+	}
 }
 
 FVoxelComputeValue FVoxelISPCNode::CompileCompute(const FName ReturnPinName) const
@@ -45,26 +136,32 @@ FVoxelComputeValue FVoxelISPCNode::CompileCompute(const FName ReturnPinName) con
 
 		using FAllocatorType = TVoxelInlineAllocator<16>;
 
+		// Kernel is only set on the game thread before the first query
+		const TSharedRef<const FKernel> LocalKernel = Kernel.ToSharedRef();
+
 		TVoxelArray<FVoxelFutureValue, FAllocatorType> InputValues;
+		for (const FKernel::FInput& Input : LocalKernel->Inputs)
+		{
+			InputValues.Add(Input.Node->GetNodeRuntime().Get(FVoxelPinRef(Input.PinName), Query));
+		}
+
 		TVoxelArray<TSharedRef<FVoxelFutureValueStateImpl>, FAllocatorType> OutputStates;
 		for (const FCachedPin& CachedPin : CachedPins)
 		{
 			if (CachedPin.bIsInput)
 			{
-				InputValues.Add(GetNodeRuntime().Get(FVoxelPinRef(CachedPin.Name), Query));
+				continue;
 			}
-			else
-			{
-				FVoxelQueryCache::FEntry& Entry = Query.GetQueryCache().FindOrAddEntry(CachedPin.PinId);
-				VOXEL_SCOPE_LOCK(Entry.CriticalSection);
 
-				const TSharedRef<FVoxelFutureValueStateImpl> State = MakeVoxelShared<FVoxelFutureValueStateImpl>(CachedPin.PinType);
+			FVoxelQueryCache::FEntry& Entry = Query.GetQueryCache().FindOrAddEntry(CachedPin.PinId);
+			VOXEL_SCOPE_LOCK(Entry.CriticalSection);
 
-				ensure(!Entry.Value.IsValid());
-				Entry.Value = FVoxelFutureValue(State);
+			const TSharedRef<FVoxelFutureValueStateImpl> State = MakeVoxelShared<FVoxelFutureValueStateImpl>(CachedPin.PinType);
 
-				OutputStates.Add(State);
-			}
+			ensure(!Entry.Value.IsValid());
+			Entry.Value = FVoxelFutureValue(State);
+
+			OutputStates.Add(State);
 		}
 
 		MakeVoxelTask(STATIC_FNAME("FVoxelISPCNode"))
@@ -117,65 +214,76 @@ FVoxelComputeValue FVoxelISPCNode::CompileCompute(const FName ReturnPinName) con
 
 			TVoxelArray<TSharedRef<FVoxelBuffer>, FAllocatorType> InputBuffers;
 			TVoxelArray<TSharedRef<FVoxelBuffer>, FAllocatorType> OutputBuffers;
-			InputBuffers.Reserve(CachedPins.Num());
-			OutputBuffers.Reserve(CachedPins.Num());
+			InputBuffers.Reserve(LocalKernel->Inputs.Num());
+			OutputBuffers.Reserve(OutputStates.Num());
 
-			TVoxelArray<const FVoxelBuffer*, FAllocatorType> Buffers;
-			Buffers.Reserve(CachedPins.Num());
+			TVoxelArray<const FVoxelBuffer*, FAllocatorType> Inputs;
+			Inputs.Reserve(LocalKernel->Inputs.Num());
 
-			int32 InputIndex = 0;
-			int32 NumTerminalBuffers = 0;
-			for (const FCachedPin& CachedPin : CachedPins)
+			for (int32 InputIndex = 0; InputIndex < LocalKernel->Inputs.Num(); InputIndex++)
 			{
-				const FVoxelBuffer* Buffer;
-				if (CachedPin.bIsInput)
-				{
-					const FVoxelRuntimePinValue& Value = InputValues[InputIndex++].GetValue_CheckCompleted();
-					checkVoxelSlow(Value.GetType().CanBeCastedTo(CachedPin.PinType));
+				const FKernel::FInput& Input = LocalKernel->Inputs[InputIndex];
+				const FVoxelRuntimePinValue& Value = InputValues[InputIndex].GetValue_CheckCompleted();
+				checkVoxelSlow(Value.GetType().CanBeCastedTo(Input.PinType));
 
-					if (CachedPin.PinType.IsBuffer())
-					{
-						Buffer = &Value.Get<FVoxelBuffer>();
-					}
-					else
-					{
-						const TSharedRef<FVoxelBuffer> InputBuffer = FVoxelBuffer::Make(CachedPin.PinType);
-						InputBuffer->InitializeFromConstant(Value);
-						InputBuffers.Add(InputBuffer);
-						Buffer = &InputBuffer.Get();
-					}
+				if (Input.PinType.IsBuffer())
+				{
+					Inputs.Add(&Value.Get<FVoxelBuffer>());
 				}
 				else
 				{
-					const TSharedRef<FVoxelBuffer> OutputBuffer = FVoxelBuffer::Make(CachedPin.PinType.GetInnerType());
-					for (FVoxelTerminalBuffer& TerminalBuffer : OutputBuffer->GetTerminalBuffers())
-					{
-						FVoxelSimpleTerminalBuffer& SimpleBuffer = CastChecked<FVoxelSimpleTerminalBuffer>(TerminalBuffer);
-						const TSharedRef<FVoxelBufferStorage> Storage = SimpleBuffer.MakeNewStorage();
-						Storage->Allocate(Num);
-						SimpleBuffer.SetStorage(Storage);
-					}
-					OutputBuffers.Add(OutputBuffer);
-					Buffer = &OutputBuffer.Get();
+					const TSharedRef<FVoxelBuffer> InputBuffer = FVoxelBuffer::Make(Input.PinType);
+					InputBuffer->InitializeFromConstant(Value);
+					InputBuffers.Add(InputBuffer);
+					Inputs.Add(&InputBuffer.Get());
 				}
-				Buffers.Add(Buffer);
-				NumTerminalBuffers += Buffer->NumTerminalBuffers();
 			}
 
+			int64 NumOutputBytes = 0;
+			for (const TSharedRef<FVoxelFutureValueStateImpl>& State : OutputStates)
 			{
-				VOXEL_SCOPE_COUNTER_FORMAT("%s Num=%d", *GetStruct()->GetName(), Num);
-				checkVoxelSlow(CachedPtr);
+				const TSharedRef<FVoxelBuffer> OutputBuffer = FVoxelBuffer::Make(State->Type.GetInnerType());
+				for (FVoxelTerminalBuffer& TerminalBuffer : OutputBuffer->GetTerminalBuffers())
+				{
+					FVoxelSimpleTerminalBuffer& SimpleBuffer = CastChecked<FVoxelSimpleTerminalBuffer>(TerminalBuffer);
+					const TSharedRef<FVoxelBufferStorage> Storage = SimpleBuffer.MakeNewStorage();
+					Storage->Allocate(Num);
+					SimpleBuffer.SetStorage(Storage);
+					NumOutputBytes += int64(Num) * Storage->GetTypeSize();
+				}
+				OutputBuffers.Add(OutputBuffer);
+			}
+
+			{
+				VOXEL_SCOPE_COUNTER_FORMAT("%s Num=%d NumFused=%d", *GetStruct()->GetName(), Num, LocalKernel->Steps.Num() - 1);
 				FVoxelNodeStatScope StatScope(*this, Num);
+				StatScope.SetNumBytes(NumOutputBytes);
+
+				// ParallelFor workers don't have the group TLS set
+				FVoxelTaskGroupArena& Arena = FVoxelTaskGroup::Get().Arena;
 
 				ForeachVoxelBufferChunk(Num, [&](const FVoxelBufferIterator& Iterator)
 				{
-					TVoxelArray<ispc::FVoxelBuffer, TVoxelInlineAllocator<16>> ISPCBuffers;
-					ISPCBuffers.Reserve(NumTerminalBuffers);
-					for (int32 Index = 0; Index < CachedPins.Num(); Index++)
+					// Fused nodes outputs only live for the duration of a buffer chunk
+					uint8* Scratch = nullptr;
+					if (LocalKernel->ScratchSize > 0)
 					{
-						const FVoxelBuffer* Buffer = Buffers[Index];
+						Scratch = static_cast<uint8*>(Arena.AllocateScratch(LocalKernel->ScratchSize));
+					}
+					ON_SCOPE_EXIT
+					{
+						if (Scratch)
+						{
+							Arena.ReleaseScratch(Scratch, LocalKernel->ScratchSize);
+						}
+					};
+
+					TVoxelArray<ispc::FVoxelBuffer, TVoxelInlineAllocator<16>> ISPCBuffers;
+					ISPCBuffers.Reserve(LocalKernel->MaxNumTerminalBuffers);
 
-						for (const FVoxelTerminalBuffer& TerminalBuffer : Buffer->GetTerminalBuffers())
+					const auto AddBuffer = [&](const FVoxelBuffer& Buffer)
+					{
+						for (const FVoxelTerminalBuffer& TerminalBuffer : Buffer.GetTerminalBuffers())
 						{
 							const FVoxelSimpleTerminalBuffer& SimpleTerminalBuffer = CastChecked<FVoxelSimpleTerminalBuffer>(TerminalBuffer);
 							check(SimpleTerminalBuffer.IsConstant() || SimpleTerminalBuffer.Num() == Num);
@@ -184,9 +292,42 @@ FVoxelComputeValue FVoxelISPCNode::CompileCompute(const FName ReturnPinName) con
 							ISPCBuffer.Data = ConstCast(SimpleTerminalBuffer.GetStorage().GetByteData(Iterator));
 							ISPCBuffer.bIsConstant = SimpleTerminalBuffer.Num() == 1;
 						}
-					}
+					};
 
-					(*CachedPtr)(ISPCBuffers.GetData(), Iterator.Num());
+					for (const FKernel::FStep& Step : LocalKernel->Steps)
+					{
+						ISPCBuffers.Reset();
+
+						for (const FKernel::FBufferRef& BufferRef : Step.Buffers)
+						{
+							switch (BufferRef.Type)
+							{
+							default: VOXEL_ASSUME(false);
+							case FKernel::EBufferType::Input:
+							{
+								AddBuffer(*Inputs[BufferRef.Index]);
+							}
+							break;
+							case FKernel::EBufferType::Output:
+							{
+								AddBuffer(*OutputBuffers[BufferRef.Index]);
+							}
+							break;
+							case FKernel::EBufferType::Scratch:
+							{
+								for (const int32 Offset : LocalKernel->ScratchOffsets[BufferRef.Index])
+								{
+									ispc::FVoxelBuffer& ISPCBuffer = ISPCBuffers.Emplace_GetRef();
+									ISPCBuffer.Data = Scratch + Offset;
+									ISPCBuffer.bIsConstant = false;
+								}
+							}
+							break;
+							}
+						}
+
+						(*Step.Ptr)(ISPCBuffers.GetData(), Iterator.Num());
+					}
 				});
 			}
 
@@ -216,4 +357,205 @@ FVoxelComputeValue FVoxelISPCNode::CompileCompute(const FName ReturnPinName) con
 		ensure(Entry.Value.IsValid());
 		return Entry.Value;
 	};
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool FVoxelISPCNode::CanBeFused() const
+{
+	if (!CachedPtr)
+	{
+		return false;
+	}
+
+	int32 NumOutputs = 0;
+	for (const FCachedPin& CachedPin : CachedPins)
+	{
+		if (CachedPin.bIsInput)
+		{
+			continue;
+		}
+
+		// Uniform nodes are only computed once, don't run them for every buffer chunk
+		if (!CachedPin.PinType.IsBuffer())
+		{
+			return false;
+		}
+
+		NumOutputs++;
+	}
+	return NumOutputs == 1;
+}
+
+void FVoxelISPCNode::FuseInput(const FName InputPinName, const FVoxelISPCNode& NodeToFuse)
+{
+	check(IsInGameThread());
+	ensure(CachedPtr);
+	ensure(NodeToFuse.CanBeFused());
+	ensure(!FusedInputs.Contains(InputPinName));
+
+	FusedInputs.Add(InputPinName, &NodeToFuse);
+}
+
+void FVoxelISPCNode::CompileFusedKernel()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const TSharedRef<FKernel> NewKernel = MakeVoxelShared<FKernel>();
+
+	int32 ScratchIndex = -1;
+	AddKernelStep(*NewKernel, *this, true, ScratchIndex);
+	ensure(ScratchIndex == -1);
+
+	Kernel = NewKernel;
+}
+
+bool FVoxelISPCNode::ComputeConstants(
+	const TConstVoxelArrayView<FVoxelRuntimePinValue> InputValues,
+	TVoxelArray<FVoxelRuntimePinValue>& OutOutputValues) const
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const FVoxelNodeISPCPtr Ptr = GVoxelNodeISPCPtrs.FindRef(GetStruct()->GetFName());
+	if (!Ptr)
+	{
+		return false;
+	}
+
+	TVoxelArray<TSharedRef<FVoxelBuffer>, TVoxelInlineAllocator<8>> Buffers;
+	TVoxelArray<TPair<FVoxelPinType, TSharedRef<FVoxelBuffer>>, TVoxelInlineAllocator<4>> OutputBuffers;
+
+	int32 InputIndex = 0;
+	for (const FVoxelPin& Pin : GetPins())
+	{
+		const TSharedRef<FVoxelBuffer> Buffer = FVoxelBuffer::Make(Pin.GetType().GetInnerType());
+
+		if (Pin.bIsInput)
+		{
+			if (!ensure(InputValues.IsValidIndex(InputIndex)))
+			{
+				return false;
+			}
+
+			Buffer->InitializeFromConstant(InputValues[InputIndex++]);
+		}
+		else
+		{
+			for (FVoxelTerminalBuffer& TerminalBuffer : Buffer->GetTerminalBuffers())
+			{
+				FVoxelSimpleTerminalBuffer& SimpleBuffer = CastChecked<FVoxelSimpleTerminalBuffer>(TerminalBuffer);
+				const TSharedRef<FVoxelBufferStorage> Storage = SimpleBuffer.MakeNewStorage();
+				Storage->Allocate(1);
+				SimpleBuffer.SetStorage(Storage);
+			}
+
+			OutputBuffers.Add({ Pin.GetType().GetInnerType(), Buffer });
+		}
+
+		Buffers.Add(Buffer);
+	}
+	ensure(InputIndex == InputValues.Num());
+
+	ForeachVoxelBufferChunk(1, [&](const FVoxelBufferIterator& Iterator)
+	{
+		TVoxelArray<ispc::FVoxelBuffer, TVoxelInlineAllocator<16>> ISPCBuffers;
+		for (const TSharedRef<FVoxelBuffer>& Buffer : Buffers)
+		{
+			for (const FVoxelTerminalBuffer& TerminalBuffer : Buffer->GetTerminalBuffers())
+			{
+				const FVoxelSimpleTerminalBuffer& SimpleTerminalBuffer = CastChecked<FVoxelSimpleTerminalBuffer>(TerminalBuffer);
+
+				ispc::FVoxelBuffer& ISPCBuffer = ISPCBuffers.Emplace_GetRef();
+				ISPCBuffer.Data = ConstCast(SimpleTerminalBuffer.GetStorage().GetByteData(Iterator));
+				ISPCBuffer.bIsConstant = true;
+			}
+		}
+
+		(*Ptr)(ISPCBuffers.GetData(), Iterator.Num());
+	});
+
+	for (const auto& It : OutputBuffers)
+	{
+		OutOutputValues.Add(It.Value->GetGenericConstant().WithType(It.Key));
+	}
+	return true;
+}
+
+void FVoxelISPCNode::AddKernelStep(
+	FKernel& Kernel,
+	const FVoxelISPCNode& Node,
+	const bool bIsRoot,
+	int32& OutScratchIndex)
+{
+	const auto GetTypeSizes = [](const FVoxelPinType& Type)
+	{
+		TVoxelArray<int32, TVoxelInlineAllocator<4>> TypeSizes;
+
+		const TSharedRef<FVoxelBuffer> Buffer = FVoxelBuffer::Make(Type.GetInnerType());
+		for (FVoxelTerminalBuffer& TerminalBuffer : Buffer->GetTerminalBuffers())
+		{
+			TypeSizes.Add(CastChecked<FVoxelSimpleTerminalBuffer>(TerminalBuffer).MakeNewStorage()->GetTypeSize());
+		}
+		return TypeSizes;
+	};
+
+	FKernel::FStep Step;
+	Step.Ptr = Node.CachedPtr;
+	check(Step.Ptr);
+
+	int32 NumOutputs = 0;
+	int32 NumTerminalBuffers = 0;
+
+	for (const FCachedPin& CachedPin : Node.CachedPins)
+	{
+		NumTerminalBuffers += GetTypeSizes(CachedPin.PinType).Num();
+
+		if (CachedPin.bIsInput)
+		{
+			if (const FVoxelISPCNode* FusedNode = Node.FusedInputs.FindRef(CachedPin.Name))
+			{
+				// Add the fused node first so that its output is computed before we run
+				int32 ScratchIndex = -1;
+				AddKernelStep(Kernel, *FusedNode, false, ScratchIndex);
+				check(ScratchIndex != -1);
+
+				Step.Buffers.Add({ FKernel::EBufferType::Scratch, ScratchIndex });
+			}
+			else
+			{
+				const int32 InputIndex = Kernel.Inputs.Add(FKernel::FInput
+				{
+					&Node,
+					CachedPin.Name,
+					CachedPin.PinType
+				});
+
+				Step.Buffers.Add({ FKernel::EBufferType::Input, InputIndex });
+			}
+			continue;
+		}
+
+		if (bIsRoot)
+		{
+			Step.Buffers.Add({ FKernel::EBufferType::Output, NumOutputs++ });
+			continue;
+		}
+
+		ensure(NumOutputs++ == 0);
+
+		TVoxelArray<int32>& Offsets = Kernel.ScratchOffsets.Emplace_GetRef();
+		for (const int32 TypeSize : GetTypeSizes(CachedPin.PinType))
+		{
+			Offsets.Add(Kernel.ScratchSize);
+			Kernel.ScratchSize += Align(FVoxelBufferDefinitions::NumPerChunk * TypeSize, FVoxelBufferDefinitions::Alignment);
+		}
+
+		OutScratchIndex = Kernel.ScratchOffsets.Num() - 1;
+		Step.Buffers.Add({ FKernel::EBufferType::Scratch, OutScratchIndex });
+	}
+
+	Kernel.MaxNumTerminalBuffers = FMath::Max(Kernel.MaxNumTerminalBuffers, NumTerminalBuffers);
+	Kernel.Steps.Add(MoveTemp(Step));
+}
@@ -22,6 +22,21 @@ VOXEL_CONSOLE_WORLD_COMMAND(
 	FVoxelInvokerManager::Get(World)->LogInvokers();
 }
 
+VOXEL_CONSOLE_WORLD_COMMAND(
+	BenchmarkInvokers,
+	"voxel.BenchmarkInvokers",
+	"Benchmark invoker updates. Args: NumInvokers (default 8) Radius (default 800) NumTicks (default 100)")
+{
+	const int32 NumInvokers = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 8;
+	const float Radius = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 800.f;
+	const int32 NumTicks = Args.Num() > 2 ? FCString::Atoi(*Args[2]) : 100;
+
+	FVoxelInvokerView::Benchmark(
+		FMath::Max(NumInvokers, 1),
+		FMath::Max(Radius, 0.f),
+		FMath::Max(NumTicks, 1));
+}
+
 DEFINE_VOXEL_INSTANCE_COUNTER(FVoxelInvokerView);
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,7 +50,7 @@ void FVoxelInvokerView::Bind(
 	VOXEL_FUNCTION_COUNTER();
 	VOXEL_SCOPE_LOCK(CriticalSection);
 
-	(void)OnAddChunk.ExecuteIfBound(Chunks_RequiresLock);
+	(void)OnAddChunk.ExecuteIfBound(GetChunks_RequiresLock());
 
 	OnAddChunkMulticast_RequiresLock.Add(OnAddChunk);
 	OnRemoveChunkMulticast_RequiresLock.Add(OnRemoveChunk);
@@ -48,7 +63,7 @@ void FVoxelInvokerView::Bind_Async(
 	VOXEL_FUNCTION_COUNTER();
 	VOXEL_SCOPE_LOCK(CriticalSection);
 
-	AsyncVoxelTask([OnAddChunk, Chunks = Chunks_RequiresLock]
+	AsyncVoxelTask([OnAddChunk, Chunks = GetChunks_RequiresLock()]
 	{
 		(void)OnAddChunk.ExecuteIfBound(Chunks);
 	});
@@ -77,6 +92,7 @@ void FVoxelInvokerView::Tick(
 
 		Invokers.Add(FInvoker
 		{
+			FInvokerKey{ InvokerComponent },
 			InvokerComponent->GetComponentLocation(),
 			InvokerComponent->Radius
 		});
@@ -89,12 +105,18 @@ void FVoxelInvokerView::Tick(
 		{
 			Invokers.Add(FInvoker
 			{
+				FInvokerKey(),
 				Position,
 				0.f
 			});
 		}
 	}
 
+	if (PredictionTime > 0.f)
+	{
+		PredictInvokers(Invokers);
+	}
+
 	if (!ensureVoxelSlow(!bTaskInProgress))
 	{
 		LOG_VOXEL(Warning,
@@ -114,53 +136,176 @@ void FVoxelInvokerView::Tick(
 	}));
 }
 
+void FVoxelInvokerView::PredictInvokers(TVoxelArray<FInvoker>& Invokers)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	const double Time = FPlatformTime::Seconds();
+
+	TVoxelMap<const void*, FVoxelChunkSpawnerVelocity> NewSourceToVelocity;
+	NewSourceToVelocity.Reserve(Invokers.Num());
+
+	TVoxelArray<FInvoker> PredictedInvokers;
+	PredictedInvokers.Reserve(Invokers.Num() * MaxPredictionSamples);
+
+	for (const FInvoker& Invoker : Invokers)
+	{
+		checkVoxelSlow(Invoker.Key.Sample == 0);
+
+		FVoxelChunkSpawnerVelocity Velocity = SourceToVelocity_GameThread.FindRef(Invoker.Key.Source);
+		Velocity.Update(Invoker.Center, Time);
+		NewSourceToVelocity.Add(Invoker.Key.Source, Velocity);
+
+		const FVector PredictedCenter = Velocity.Predict(PredictionTime);
+		const double Distance = FVector::Distance(Invoker.Center, PredictedCenter);
+
+		// Space the samples by the invoker radius so that the path has no gap
+		const int32 NumSamples = FMath::Clamp(FMath::CeilToInt(Distance / FMath::Max<double>(Invoker.Radius + Offset, ChunkSize)), 1, MaxPredictionSamples);
+
+		for (int32 Sample = 0; Sample < NumSamples; Sample++)
+		{
+			PredictedInvokers.Add(FInvoker
+			{
+				FInvokerKey{ Invoker.Key.Source, Sample },
+				FMath::Lerp(Invoker.Center, PredictedCenter, (Sample + 1.) / NumSamples),
+				Invoker.Radius
+			});
+		}
+	}
+
+	SourceToVelocity_GameThread = MoveTemp(NewSourceToVelocity);
+	Invokers = MoveTemp(PredictedInvokers);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelInvokerView::Tick_Async(TVoxelArray<FInvoker> Invokers)
+FIntVector FVoxelInvokerView::FChunkedInvoker::GetMin() const
 {
-	VOXEL_FUNCTION_COUNTER();
-	VOXEL_SCOPE_COUNTER_FORMAT("%s Invokers.Num = %d", *Channel.ToString(), Invokers.Num());
+	// Offset due to chunk position being the chunk lower corner
+	return FVoxelUtilities::FloorToInt(Center - RadiusInChunks - 0.5);
+}
+
+FIntVector FVoxelInvokerView::FChunkedInvoker::GetMax() const
+{
+	return FVoxelUtilities::CeilToInt(Center + RadiusInChunks - 0.5);
+}
 
-	Invokers.Sort([](const FInvoker& A, const FInvoker& B)
+bool FVoxelInvokerView::FChunkedInvoker::GetColumn(
+	const int32 X,
+	const int32 Y,
+	int32& OutMinZ,
+	int32& OutMaxZ) const
+{
+	// Offset due to chunk position being the chunk lower corner
+	constexpr double ChunkOffset = 0.5;
+	// We want to check the chunk against invoker, not the chunk center
+	// To avoid a somewhat expensive box-to-point distance, we offset the invoker radius by the chunk diagonal
+	// (from chunk center to any chunk corner)
+	constexpr double ChunkHalfDiagonal = UE_SQRT_3 / 2.;
+
+	const double RadiusSquared = FMath::Square(RadiusInChunks + ChunkHalfDiagonal);
+	const double DistanceSquaredXY =
+		FMath::Square(X + ChunkOffset - Center.X) +
+		FMath::Square(Y + ChunkOffset - Center.Y);
+
+	if (DistanceSquaredXY > RadiusSquared)
 	{
-		return A.Radius > B.Radius;
-	});
+		return false;
+	}
+
+	const double HalfHeight = FMath::Sqrt(RadiusSquared - DistanceSquaredXY);
+
+	OutMinZ = FMath::Max(GetMin().Z, FMath::CeilToInt(Center.Z - ChunkOffset - HalfHeight));
+	OutMaxZ = FMath::Min(GetMax().Z, FMath::FloorToInt(Center.Z - ChunkOffset + HalfHeight));
+	return OutMinZ <= OutMaxZ;
+}
 
+TVoxelAddOnlySet<FIntVector> FVoxelInvokerView::GetChunks_RequiresLock() const
+{
+	VOXEL_FUNCTION_COUNTER();
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	TVoxelAddOnlySet<FIntVector> Chunks;
+	Chunks.Reserve(ChunkToNumInvokers_RequiresLock.Num());
+
+	for (const auto& It : ChunkToNumInvokers_RequiresLock)
 	{
-		VOXEL_SCOPE_COUNTER("Remove duplicates");
+		Chunks.Add_NoRehash(It.Key);
+	}
+	return Chunks;
+}
 
-		for (int32 IndexA = 0; IndexA < Invokers.Num(); IndexA++)
+template<typename LambdaType>
+void FVoxelInvokerView::DiffInvoker(
+	const FChunkedInvoker* Old,
+	const FChunkedInvoker* New,
+	LambdaType&& Lambda)
+{
+	checkVoxelSlow(Old || New);
+
+	const FIntVector Min = FVoxelUtilities::ComponentMin(
+		Old ? Old->GetMin() : New->GetMin(),
+		New ? New->GetMin() : Old->GetMin());
+
+	const FIntVector Max = FVoxelUtilities::ComponentMax(
+		Old ? Old->GetMax() : New->GetMax(),
+		New ? New->GetMax() : Old->GetMax());
+
+	// Only the Z interval of each column is computed: a moving invoker costs its area, not its volume
+	for (int32 X = Min.X; X <= Max.X; X++)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
 		{
-			const FInvoker InvokerA = Invokers[IndexA];
-			for (int32 IndexB = 0; IndexB < IndexA; IndexB++)
+			int32 OldMinZ = 0;
+			int32 OldMaxZ = -1;
+			if (Old)
 			{
-				const FInvoker InvokerB = Invokers[IndexB];
+				Old->GetColumn(X, Y, OldMinZ, OldMaxZ);
+			}
 
-				const float RadiusDelta = InvokerB.Radius - InvokerA.Radius;
-				ensureVoxelSlow(RadiusDelta >= 0);
+			int32 NewMinZ = 0;
+			int32 NewMaxZ = -1;
+			if (New)
+			{
+				New->GetColumn(X, Y, NewMinZ, NewMaxZ);
+			}
 
-				if (FVector::DistSquared(InvokerA.Center, InvokerB.Center) > FMath::Square(RadiusDelta))
+			for (int32 Z = OldMinZ; Z <= OldMaxZ; Z++)
+			{
+				if (NewMinZ <= Z && Z <= NewMaxZ)
+				{
+					// Skip the overlap
+					Z = NewMaxZ;
+					continue;
+				}
+
+				Lambda(FIntVector(X, Y, Z), -1);
+			}
+
+			for (int32 Z = NewMinZ; Z <= NewMaxZ; Z++)
+			{
+				if (OldMinZ <= Z && Z <= OldMaxZ)
 				{
+					Z = OldMaxZ;
 					continue;
 				}
 
-				// If distance between two centers is less than the different of radius, then A is fully contained in B
-				Invokers.RemoveAtSwap(IndexA);
-				IndexA--;
-				break;
+				Lambda(FIntVector(X, Y, Z), 1);
 			}
 		}
 	}
+}
 
-	struct FChunkedInvoker
-	{
-		FVector Center;
-		double RadiusInChunks;
-	};
-	TVoxelArray<FChunkedInvoker> ChunkedInvokers;
-	ChunkedInvokers.Reserve(Invokers.Num());
+int64 FVoxelInvokerView::Tick_Async(const TVoxelArray<FInvoker>& Invokers)
+{
+	VOXEL_FUNCTION_COUNTER();
+	VOXEL_SCOPE_COUNTER_FORMAT("%s Invokers.Num = %d", *Channel.ToString(), Invokers.Num());
+
+	TVoxelMap<FInvokerKey, FChunkedInvoker> NewKeyToChunkedInvoker;
+	NewKeyToChunkedInvoker.Reserve(Invokers.Num());
 	{
 		VOXEL_SCOPE_COUNTER("Make ChunkedInvokers");
 
@@ -175,91 +320,108 @@ void FVoxelInvokerView::Tick_Async(TVoxelArray<FInvoker> Invokers)
 			FChunkedInvoker ChunkedInvoker;
 			ChunkedInvoker.Center = LocalPosition / ChunkSize;
 			ChunkedInvoker.RadiusInChunks = LocalRadius / ChunkSize;
-			ChunkedInvokers.Add(ChunkedInvoker);
+			ensureVoxelSlow(!NewKeyToChunkedInvoker.Contains(Invoker.Key));
+			NewKeyToChunkedInvoker.Add(Invoker.Key, ChunkedInvoker);
 		}
 	}
 
-	int64 MaxNumChunks = 0;
-	for (const FChunkedInvoker& Invoker : ChunkedInvokers)
+	// Net change in the number of invokers overlapping each chunk
+	// Overlapping invokers are handled by the counts, no need to remove contained invokers
+	TVoxelIntVectorMap<int32> ChunkToDelta;
 	{
-		MaxNumChunks += FMath::Cube(2 * Invoker.RadiusInChunks + 1);
-	}
+		VOXEL_SCOPE_COUNTER("Diff invokers");
 
-	TVoxelAddOnlySet<FIntVector> Chunks;
-	Chunks.Reserve(FMath::Min(MaxNumChunks, 32768));
+		const auto AddDelta = [&](const FIntVector& Chunk, const int32 Delta)
+		{
+			ChunkToDelta.FindOrAdd(Chunk) += Delta;
+		};
 
-	for (const FChunkedInvoker& Invoker : ChunkedInvokers)
-	{
-		VOXEL_SCOPE_COUNTER_FORMAT("Add invoker Radius=%f chunks", Invoker.RadiusInChunks);
+		const auto CheckNumChunks = [&]
+		{
+			if (ChunkToDelta.Num() + ChunkToNumInvokers_RequiresLock.Num() <= 1024 * 1024) // Not thread safe but fine for just Num
+			{
+				return true;
+			}
 
-		// Offset due to chunk position being the chunk lower corner
-		constexpr double ChunkOffset = 0.5;
-		// We want to check the chunk against invoker, not the chunk center
-		// To avoid a somewhat expensive box-to-point distance, we offset the invoker radius by the chunk diagonal
-		// (from chunk center to any chunk corner)
-		constexpr double ChunkHalfDiagonal = UE_SQRT_3 / 2.;
+			VOXEL_MESSAGE(Error, "More than 1M chunks generated by invoker channel {0} for chunk size {1}, abording",
+				Channel,
+				ChunkSize);
 
-		const FIntVector Min = FVoxelUtilities::FloorToInt(Invoker.Center - Invoker.RadiusInChunks - ChunkOffset);
-		const FIntVector Max = FVoxelUtilities::CeilToInt(Invoker.Center + Invoker.RadiusInChunks - ChunkOffset);
-		const double RadiusSquared = FMath::Square(Invoker.RadiusInChunks + ChunkHalfDiagonal);
+			return false;
+		};
 
-		for (int32 X = Min.X; X <= Max.X; X++)
+		for (const auto& It : NewKeyToChunkedInvoker)
 		{
-			for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+			const FChunkedInvoker* Old = KeyToChunkedInvoker.Find(It.Key);
+			if (Old &&
+				*Old == It.Value)
 			{
-				for (int32 Z = Min.Z; Z <= Max.Z; Z++)
-				{
-					const double DistanceSquared = (FVector(X, Y, Z) + ChunkOffset - Invoker.Center).SizeSquared();
-					if (DistanceSquared > RadiusSquared)
-					{
-						continue;
-					}
+				// Static invokers are free
+				continue;
+			}
 
-					Chunks.Add(FIntVector(X, Y, Z));
-				}
+			VOXEL_SCOPE_COUNTER_FORMAT("Diff invoker Radius=%f chunks", It.Value.RadiusInChunks);
+			DiffInvoker(Old, &It.Value, AddDelta);
 
-				if (Chunks.Num() > 1024 * 1024)
-				{
-					VOXEL_MESSAGE(Error, "More than 1M chunks generated by invoker channel {0} for chunk size {1}, abording",
-						Channel,
-						ChunkSize);
+			if (!CheckNumChunks())
+			{
+				ensure(bTaskInProgress);
+				bTaskInProgress = false;
+				return 0;
+			}
+		}
 
-					ensure(bTaskInProgress);
-					bTaskInProgress = false;
-					return;
-				}
+		for (const auto& It : KeyToChunkedInvoker)
+		{
+			if (NewKeyToChunkedInvoker.Contains(It.Key))
+			{
+				continue;
 			}
+
+			VOXEL_SCOPE_COUNTER_FORMAT("Remove invoker Radius=%f chunks", It.Value.RadiusInChunks);
+			DiffInvoker(&It.Value, nullptr, AddDelta);
 		}
 	}
 
+	KeyToChunkedInvoker = MoveTemp(NewKeyToChunkedInvoker);
+
 	TVoxelAddOnlySet<FIntVector> ChunksToAdd;
 	TVoxelAddOnlySet<FIntVector> ChunksToRemove;
-	ChunksToAdd.Reserve(Chunks.Num());
-	ChunksToRemove.Reserve(Chunks_RequiresLock.Num()); // Not thread safe but fine for just Num
+	ChunksToAdd.Reserve(ChunkToDelta.Num());
+	ChunksToRemove.Reserve(ChunkToDelta.Num());
 
 	FOnChangedMulticast OnAddChunkMulticast;
 	FOnChangedMulticast OnRemoveChunkMulticast;
 	{
-		VOXEL_SCOPE_COUNTER("Diff");
+		VOXEL_SCOPE_COUNTER("Apply");
 		VOXEL_SCOPE_LOCK(CriticalSection);
 
-		for (const FIntVector& Chunk : Chunks)
+		for (const auto& It : ChunkToDelta)
 		{
-			if (!Chunks_RequiresLock.Contains(Chunk))
+			if (It.Value == 0)
 			{
-				ChunksToAdd.Add_NoRehash(Chunk);
+				continue;
 			}
-		}
 
-		for (const FIntVector& Chunk : Chunks_RequiresLock)
-		{
-			if (!Chunks.Contains(Chunk))
+			int32& NumInvokers = ChunkToNumInvokers_RequiresLock.FindOrAdd(It.Key);
+			const int32 OldNumInvokers = NumInvokers;
+			NumInvokers += It.Value;
+			ensureVoxelSlow(NumInvokers >= 0);
+
+			if (OldNumInvokers == 0 &&
+				NumInvokers > 0)
+			{
+				ChunksToAdd.Add_NoRehash(It.Key);
+			}
+			else if (
+				OldNumInvokers > 0 &&
+				NumInvokers <= 0)
 			{
-				ChunksToRemove.Add_NoRehash(Chunk);
+				ChunkToNumInvokers_RequiresLock.Remove(It.Key);
+				ChunksToRemove.Add_NoRehash(It.Key);
 			}
 		}
 
-		Chunks_RequiresLock = MoveTemp(Chunks);
 		OnAddChunkMulticast = OnAddChunkMulticast_RequiresLock;
 		OnRemoveChunkMulticast = OnRemoveChunkMulticast_RequiresLock;
 	}
@@ -278,6 +440,80 @@ void FVoxelInvokerView::Tick_Async(TVoxelArray<FInvoker> Invokers)
 
 	ensure(bTaskInProgress);
 	bTaskInProgress = false;
+
+	return ChunksToAdd.Num() + ChunksToRemove.Num();
+}
+
+FVoxelInvokerView::FBenchmarkResult FVoxelInvokerView::Benchmark(
+	const int32 NumInvokers,
+	const float Radius,
+	const int32 NumTicks,
+	const int32 Seed)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	constexpr int32 ChunkSize = 32;
+	const TSharedRef<FVoxelInvokerView> View = MakeVoxelShared<FVoxelInvokerView>(
+		STATIC_FNAME("Benchmark"),
+		ChunkSize,
+		0,
+		FVoxelTransformRef::Identity());
+
+	// Fake keys, never dereferenced
+	TVoxelArray<uint8> Keys;
+	Keys.SetNumZeroed(NumInvokers);
+
+	FRandomStream Stream(Seed);
+
+	TVoxelArray<FInvoker> Invokers;
+	TVoxelArray<FVector> Velocities;
+	for (int32 Index = 0; Index < NumInvokers; Index++)
+	{
+		Invokers.Add(FInvoker
+		{
+			FInvokerKey{ &Keys[Index] },
+			Stream.VRand() * Stream.FRandRange(0.f, 4.f * Radius),
+			Radius
+		});
+
+		// Between walking and flying speed, assuming 60 ticks a second
+		Velocities.Add(Stream.VRand() * Stream.FRandRange(5.f, 50.f));
+	}
+
+	{
+		// First tick isn't incremental
+		View->bTaskInProgress = true;
+		View->Tick_Async(Invokers);
+	}
+
+	int64 NumChunks = 0;
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 Tick = 0; Tick < NumTicks; Tick++)
+	{
+		for (int32 Index = 0; Index < NumInvokers; Index++)
+		{
+			Invokers[Index].Center += Velocities[Index];
+		}
+
+		View->bTaskInProgress = true;
+		NumChunks += View->Tick_Async(Invokers);
+	}
+
+	const double Time = FPlatformTime::Seconds() - StartTime;
+
+	LOG_VOXEL(Log, "Invoker benchmark: %d invokers, radius %f, %d ticks: %fms/tick, %lld chunks updated, %f chunks/s",
+		NumInvokers,
+		Radius,
+		NumTicks,
+		Time * 1000. / FMath::Max(NumTicks, 1),
+		NumChunks,
+		NumChunks / FMath::Max(Time, UE_SMALL_NUMBER));
+
+	FBenchmarkResult Result;
+	Result.Time = Time;
+	Result.NumChunks = NumChunks;
+	return Result;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -313,7 +549,8 @@ TSharedRef<FVoxelInvokerView> FVoxelInvokerManager::MakeView(
 	const FName Channel,
 	const int32 ChunkSize,
 	const int32 Offset,
-	const FVoxelTransformRef& LocalToWorld)
+	const FVoxelTransformRef& LocalToWorld,
+	const float PredictionTime)
 {
 	VOXEL_SCOPE_LOCK(CriticalSection);
 
@@ -322,7 +559,8 @@ TSharedRef<FVoxelInvokerView> FVoxelInvokerManager::MakeView(
 		Channel,
 		ChunkSize,
 		Offset,
-		LocalToWorld
+		LocalToWorld,
+		PredictionTime
 	};
 
 	TSharedPtr<FVoxelInvokerView>& View = KeyToView_RequiresLock.FindOrAdd(Key);
@@ -332,7 +570,8 @@ TSharedRef<FVoxelInvokerView> FVoxelInvokerManager::MakeView(
 			Channel,
 			ChunkSize,
 			Offset,
-			LocalToWorld);
+			LocalToWorld,
+			PredictionTime);
 	}
 	return View.ToSharedRef();
 }
@@ -0,0 +1,465 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#include "VoxelNodeProfiler.h"
+#include "VoxelGraphInterface.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, bool, GVoxelEnableNodeProfiler, false,
+	"voxel.profiler.Enable",
+	"If true, will record the time spent in each graph node. Use voxel.profiler.Dump to write a report");
+
+FVoxelNodeProfiler* GVoxelNodeProfiler = MakeVoxelSingleton(FVoxelNodeProfiler);
+
+VOXEL_CONSOLE_COMMAND(
+	StartNodeProfiler,
+	"voxel.profiler.Start",
+	"Clear the node profiler stats and start recording")
+{
+	GVoxelNodeProfiler->Reset();
+	GVoxelEnableNodeProfiler = true;
+}
+
+VOXEL_CONSOLE_COMMAND(
+	StopNodeProfiler,
+	"voxel.profiler.Stop",
+	"Stop recording node profiler stats")
+{
+	GVoxelEnableNodeProfiler = false;
+}
+
+VOXEL_CONSOLE_WORLD_COMMAND(
+	DumpNodeProfiler,
+	"voxel.profiler.Dump",
+	"[Path] Log the slowest nodes and write the node profiler report to Path, or to Saved/Profiling/Voxel if not set. Path can end with .csv or .json")
+{
+	const FVoxelNodeProfilerReport Report = GVoxelNodeProfiler->MakeReport();
+	Report.Log(20);
+
+	FString Path;
+	if (Args.Num() > 0)
+	{
+		Path = FString::Join(Args, TEXT(" ")).TrimQuotes();
+	}
+	else
+	{
+		Path = FPaths::ProfilingDir() / "Voxel" / "NodeProfile-" + FDateTime::Now().ToString() + ".csv";
+	}
+
+	if (!Report.Save(Path))
+	{
+		LOG_VOXEL(Error, "Failed to write %s", *Path);
+		return;
+	}
+
+	LOG_VOXEL(Log, "Node profiler report written to %s", *FPaths::ConvertRelativePathToFull(Path));
+}
+
+VOXEL_CONSOLE_WORLD_COMMAND(
+	CompareNodeProfiler,
+	"voxel.profiler.Compare",
+	"[OldPath] [NewPath] [Threshold=0.1] [MinTimeMs=1] Compare two node profiler reports and log an error for every node that got slower by more than Threshold (0.1 = 10%)")
+{
+	if (Args.Num() < 2)
+	{
+		UE_LOG(LogConsoleResponse, Warning, TEXT("Missing arguments"));
+		return;
+	}
+
+	const TOptional<FVoxelNodeProfilerReport> Old = FVoxelNodeProfilerReport::Load(Args[0]);
+	const TOptional<FVoxelNodeProfilerReport> New = FVoxelNodeProfilerReport::Load(Args[1]);
+	if (!Old ||
+		!New)
+	{
+		return;
+	}
+
+	const float Threshold = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 0.1f;
+	const double MinTime = (Args.Num() > 3 ? FCString::Atod(*Args[3]) : 1.) / 1000.;
+
+	const int32 NumRegressions = FVoxelNodeProfilerReport::Compare(*Old, *New, Threshold, MinTime);
+	LOG_VOXEL(Log, "%d regressions found", NumRegressions);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+double FVoxelNodeProfilerReport::FEntry::GetNormalizedTime() const
+{
+	if (NumElements > 0)
+	{
+		return Time / NumElements;
+	}
+	if (NumCalls > 0)
+	{
+		return Time / NumCalls;
+	}
+	return 0.;
+}
+
+void FVoxelNodeProfilerReport::Log(const int32 MaxEntries) const
+{
+	LOG_VOXEL(Log, "Voxel node profiler: %d entries recorded over %s", Entries.Num(), *FVoxelUtilities::ConvertToTimeText(Duration).ToString());
+
+	for (int32 Index = 0; Index < FMath::Min(Entries.Num(), MaxEntries); Index++)
+	{
+		const FEntry& Entry = Entries[Index];
+
+		LOG_VOXEL(Log, "\t%s %s: %s (%lld calls, %lld elements, %s per element, %lldKB)",
+			*Entry.Graph,
+			Entry.IsGraphTotal() ? TEXT("[Total]") : *Entry.Node,
+			*FVoxelUtilities::ConvertToTimeText(Entry.Time).ToString(),
+			Entry.NumCalls,
+			Entry.NumElements,
+			*FVoxelUtilities::ConvertToTimeText(Entry.NumElements > 0 ? Entry.Time / Entry.NumElements : 0., 3).ToString(),
+			Entry.NumBytes / 1024);
+	}
+}
+
+bool FVoxelNodeProfilerReport::Save(const FString& Path) const
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FString Text;
+
+	if (Path.EndsWith(".json"))
+	{
+		TArray<TSharedPtr<FJsonValue>> JsonEntries;
+		for (const FEntry& Entry : Entries)
+		{
+			const TSharedRef<FJsonObject> JsonEntry = MakeShared<FJsonObject>();
+			JsonEntry->SetStringField("Graph", Entry.Graph);
+			JsonEntry->SetStringField("Node", Entry.Node);
+			JsonEntry->SetNumberField("NumCalls", Entry.NumCalls);
+			JsonEntry->SetNumberField("NumElements", Entry.NumElements);
+			JsonEntry->SetNumberField("NumBytes", Entry.NumBytes);
+			JsonEntry->SetNumberField("Time", Entry.Time);
+			JsonEntries.Add(MakeShared<FJsonValueObject>(JsonEntry));
+		}
+
+		const TSharedRef<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+		JsonObject->SetNumberField("Duration", Duration);
+		JsonObject->SetArrayField("Entries", JsonEntries);
+
+		if (!FJsonSerializer::Serialize(JsonObject, TJsonWriterFactory<>::Create(&Text)))
+		{
+			return false;
+		}
+	}
+	else
+	{
+		const auto Escape = [](const FString& Value)
+		{
+			return "\"" + Value.Replace(TEXT("\""), TEXT("\"\"")) + "\"";
+		};
+
+		Text += FString::Printf(TEXT("Duration,%f\n"), Duration);
+		Text += "Graph,Node,NumCalls,NumElements,NumBytes,Time\n";
+
+		for (const FEntry& Entry : Entries)
+		{
+			Text += FString::Printf(TEXT("%s,%s,%lld,%lld,%lld,%.9f\n"),
+				*Escape(Entry.Graph),
+				*Escape(Entry.Node),
+				Entry.NumCalls,
+				Entry.NumElements,
+				Entry.NumBytes,
+				Entry.Time);
+		}
+	}
+
+	return FFileHelper::SaveStringToFile(Text, *Path);
+}
+
+TOptional<FVoxelNodeProfilerReport> FVoxelNodeProfilerReport::Load(const FString& Path)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *Path))
+	{
+		LOG_VOXEL(Error, "Failed to read %s", *Path);
+		return {};
+	}
+
+	FVoxelNodeProfilerReport Report;
+
+	if (Path.EndsWith(".json"))
+	{
+		TSharedPtr<FJsonObject> JsonObject;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), JsonObject) ||
+			!JsonObject)
+		{
+			LOG_VOXEL(Error, "Failed to parse %s", *Path);
+			return {};
+		}
+
+		Report.Duration = JsonObject->GetNumberField("Duration");
+
+		for (const TSharedPtr<FJsonValue>& JsonValue : JsonObject->GetArrayField("Entries"))
+		{
+			const TSharedPtr<FJsonObject> JsonEntry = JsonValue->AsObject();
+			if (!JsonEntry)
+			{
+				continue;
+			}
+
+			FEntry& Entry = Report.Entries.Emplace_GetRef();
+			Entry.Graph = JsonEntry->GetStringField("Graph");
+			Entry.Node = JsonEntry->GetStringField("Node");
+			Entry.NumCalls = JsonEntry->GetNumberField("NumCalls");
+			Entry.NumElements = JsonEntry->GetNumberField("NumElements");
+			Entry.NumBytes = JsonEntry->GetNumberField("NumBytes");
+			Entry.Time = JsonEntry->GetNumberField("Time");
+		}
+
+		return Report;
+	}
+
+	const auto ParseLine = [](const FString& Line)
+	{
+		TArray<FString> Fields;
+
+		FString Field;
+		bool bInQuotes = false;
+		for (int32 Index = 0; Index < Line.Len(); Index++)
+		{
+			const TCHAR Char = Line[Index];
+			if (bInQuotes)
+			{
+				if (Char != TEXT('"'))
+				{
+					Field.AppendChar(Char);
+				}
+				else if (Index + 1 < Line.Len() && Line[Index + 1] == TEXT('"'))
+				{
+					Field.AppendChar(Char);
+					Index++;
+				}
+				else
+				{
+					bInQuotes = false;
+				}
+			}
+			else if (Char == TEXT('"'))
+			{
+				bInQuotes = true;
+			}
+			else if (Char == TEXT(','))
+			{
+				Fields.Add(MoveTemp(Field));
+				Field.Reset();
+			}
+			else
+			{
+				Field.AppendChar(Char);
+			}
+		}
+		Fields.Add(MoveTemp(Field));
+
+		return Fields;
+	};
+
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+
+	for (int32 LineIndex = 0; LineIndex < Lines.Num(); LineIndex++)
+	{
+		const TArray<FString> Fields = ParseLine(Lines[LineIndex]);
+
+		if (LineIndex == 0)
+		{
+			if (Fields.Num() == 2 &&
+				Fields[0] == "Duration")
+			{
+				Report.Duration = FCString::Atod(*Fields[1]);
+			}
+			continue;
+		}
+		if (LineIndex == 1)
+		{
+			// Header
+			continue;
+		}
+
+		if (Fields.Num() != 6)
+		{
+			LOG_VOXEL(Error, "%s:%d: invalid line", *Path, LineIndex + 1);
+			return {};
+		}
+
+		FEntry& Entry = Report.Entries.Emplace_GetRef();
+		Entry.Graph = Fields[0];
+		Entry.Node = Fields[1];
+		Entry.NumCalls = FCString::Atoi64(*Fields[2]);
+		Entry.NumElements = FCString::Atoi64(*Fields[3]);
+		Entry.NumBytes = FCString::Atoi64(*Fields[4]);
+		Entry.Time = FCString::Atod(*Fields[5]);
+	}
+
+	return Report;
+}
+
+int32 FVoxelNodeProfilerReport::Compare(
+	const FVoxelNodeProfilerReport& Old,
+	const FVoxelNodeProfilerReport& New,
+	const float Threshold,
+	const double MinTime)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	TVoxelMap<TPair<FString, FString>, const FEntry*> OldEntries;
+	OldEntries.Reserve(Old.Entries.Num());
+
+	for (const FEntry& Entry : Old.Entries)
+	{
+		OldEntries.Add({ Entry.Graph, Entry.Node }, &Entry);
+	}
+
+	int32 NumRegressions = 0;
+	for (const FEntry& NewEntry : New.Entries)
+	{
+		const FEntry* const* OldEntryPtr = OldEntries.Find({ NewEntry.Graph, NewEntry.Node });
+		if (!OldEntryPtr)
+		{
+			if (NewEntry.Time >= MinTime)
+			{
+				LOG_VOXEL(Warning, "%s %s: new entry, %s",
+					*NewEntry.Graph,
+					NewEntry.IsGraphTotal() ? TEXT("[Total]") : *NewEntry.Node,
+					*FVoxelUtilities::ConvertToTimeText(NewEntry.Time).ToString());
+			}
+			continue;
+		}
+		const FEntry& OldEntry = **OldEntryPtr;
+
+		if (OldEntry.Time < MinTime &&
+			NewEntry.Time < MinTime)
+		{
+			continue;
+		}
+
+		const double OldTime = OldEntry.GetNormalizedTime();
+		const double NewTime = NewEntry.GetNormalizedTime();
+		if (OldTime <= 0. ||
+			NewTime <= OldTime * (1. + Threshold))
+		{
+			continue;
+		}
+
+		NumRegressions++;
+
+		LOG_VOXEL(Error, "%s %s: %s -> %s per %s (+%.1f%%)",
+			*NewEntry.Graph,
+			NewEntry.IsGraphTotal() ? TEXT("[Total]") : *NewEntry.Node,
+			*FVoxelUtilities::ConvertToTimeText(OldTime, 3).ToString(),
+			*FVoxelUtilities::ConvertToTimeText(NewTime, 3).ToString(),
+			NewEntry.NumElements > 0 ? TEXT("element") : TEXT("call"),
+			100. * (NewTime / OldTime - 1.));
+	}
+
+	return NumRegressions;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelNodeProfiler::Record(
+	const FVoxelGraphNodeRef& NodeRef,
+	const double Duration,
+	const int64 NumElements,
+	const int64 NumBytes)
+{
+	Queue.Enqueue(
+	{
+		NodeRef,
+		Duration,
+		NumElements,
+		NumBytes
+	});
+}
+
+void FVoxelNodeProfiler::Reset()
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	Flush();
+
+	NodeToStats.Empty();
+	StartTime = FPlatformTime::Seconds();
+}
+
+FVoxelNodeProfilerReport FVoxelNodeProfiler::MakeReport()
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	Flush();
+
+	FVoxelNodeProfilerReport Report;
+	Report.Duration = FPlatformTime::Seconds() - StartTime;
+
+	// Template instances of the same node are merged
+	TMap<TPair<FString, FString>, FVoxelNodeProfilerReport::FEntry> Entries;
+
+	const auto AddStats = [&](const FString& Graph, const FString& Node, const FStats& Stats)
+	{
+		FVoxelNodeProfilerReport::FEntry& Entry = Entries.FindOrAdd({ Graph, Node });
+		Entry.Graph = Graph;
+		Entry.Node = Node;
+		Entry.NumCalls += Stats.NumCalls;
+		Entry.NumElements += Stats.NumElements;
+		Entry.NumBytes += Stats.NumBytes;
+		Entry.Time += Stats.Time;
+	};
+
+	for (const auto& It : NodeToStats)
+	{
+		const UVoxelGraphInterface* Graph = It.Key.Graph.Get();
+		const FString GraphName = Graph ? Graph->GetPathName() : "<deleted>";
+		const FString NodeName = It.Key.EdGraphNodeTitle.ToString() + " (" + It.Key.NodeId.ToString() + ")";
+
+		AddStats(GraphName, NodeName, It.Value);
+		AddStats(GraphName, {}, It.Value);
+	}
+
+	Entries.GenerateValueArray(Report.Entries);
+
+	Report.Entries.Sort([](const FVoxelNodeProfilerReport::FEntry& A, const FVoxelNodeProfilerReport::FEntry& B)
+	{
+		return A.Time > B.Time;
+	});
+
+	return Report;
+}
+
+void FVoxelNodeProfiler::Tick()
+{
+	Flush();
+}
+
+void FVoxelNodeProfiler::Flush()
+{
+	if (Queue.IsEmpty())
+	{
+		return;
+	}
+
+	VOXEL_FUNCTION_COUNTER();
+
+	FQueuedStat QueuedStat;
+	while (Queue.Dequeue(QueuedStat))
+	{
+		FStats& Stats = NodeToStats.FindOrAdd(QueuedStat.NodeRef);
+		Stats.NumCalls++;
+		Stats.NumElements += QueuedStat.NumElements;
+		Stats.NumBytes += QueuedStat.NumBytes;
+		Stats.Time += QueuedStat.Duration;
+	}
+}
@@ -96,14 +96,26 @@ FVoxelNodeStatManager* GVoxelNodeStatManager = MakeVoxelSingleton(FVoxelNodeStat
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-#if WITH_EDITOR
 void FVoxelNodeStatScope::RecordStats(const double Duration) const
 {
-	GVoxelNodeStatManager->Queue.Enqueue(
+#if WITH_EDITOR
+	if (GVoxelEnableNodeStats)
+	{
+		GVoxelNodeStatManager->Queue.Enqueue(
+		{
+			Node->GetNodeRef(),
+			Duration,
+			Count
+		});
+	}
+#endif
+
+	if (GVoxelEnableNodeProfiler)
 	{
-		Node->GetNodeRef(),
-		Duration,
-		Count
-	});
-}
-#endif
\ No newline at end of file
+		GVoxelNodeProfiler->Record(
+			Node->GetNodeRef(),
+			Duration,
+			Count,
+			NumBytes);
+	}
+}
\ No newline at end of file
@@ -216,6 +216,19 @@ void FVoxelRuntimeInfo::AddReferencedObjects(FReferenceCollector& Collector)
 	}
 }
 
+TSharedRef<FVoxelRuntimeInfo> FVoxelRuntimeInfo::MakeWithLocalToWorld(const FVoxelTransformRef& NewLocalToWorld) const
+{
+	VOXEL_FUNCTION_COUNTER();
+	ensure(!IsDestroyed());
+
+	FVoxelRuntimeInfoBase RuntimeInfoBase = *this;
+	RuntimeInfoBase.LocalToWorld = NewLocalToWorld;
+	// Only keep the weak subsystems, otherwise Destroy would destroy them
+	RuntimeInfoBase.SubsystemRefs.Reset();
+
+	return MakeVoxelShareable(new (GVoxelMemory) FVoxelRuntimeInfo(RuntimeInfoBase));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -253,6 +266,21 @@ TSharedRef<FVoxelQueryContext> FVoxelQueryContext::Make(
 		nullptr));
 }
 
+TSharedRef<FVoxelQueryContext> FVoxelQueryContext::MakeWithRuntimeInfo(const TSharedRef<const FVoxelRuntimeInfo>& NewRuntimeInfo) const
+{
+	return MakeVoxelShareable(new (GVoxelMemory) FVoxelQueryContext(
+		Path,
+		Callstack,
+		NewRuntimeInfo,
+		AsWeak(),
+		ParameterPath,
+		ParameterValues,
+		ComputeInputContext,
+		ComputeInputMap,
+		GraphArrayIndex,
+		GraphArray));
+}
+
 TSharedRef<FVoxelQueryContext> FVoxelQueryContext::EnterScope(const FVoxelGraphNodeRef& Node)
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -0,0 +1,80 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#include "VoxelQueryCache.h"
+
+FVoxelQueryCache::FVoxelQueryCache()
+	: FirstTable(FirstTableSize)
+{
+}
+
+FVoxelQueryCache::~FVoxelQueryCache()
+{
+	FTable* Table = FirstTable.Next.Load();
+	while (Table)
+	{
+		FTable* Next = Table->Next.Load();
+		delete Table;
+		Table = Next;
+	}
+}
+
+FVoxelQueryCache::FEntry& FVoxelQueryCache::FindOrAddEntry(const FVoxelPinRuntimeId PinId)
+{
+	checkVoxelSlow(PinId.IsValid());
+
+	const uint64 Hash = FVoxelUtilities::MurmurHash64(PinId.GetId());
+
+	FTable* Table = &FirstTable;
+	while (true)
+	{
+		if (FEntry* Entry = FindOrAddEntry(*Table, PinId.GetId(), Hash))
+		{
+			return *Entry;
+		}
+
+		// All the probed slots are used by other pins, and will never be freed:
+		// this pin can only be in the next table
+		FTable* Next = Table->Next.Load();
+		if (!Next)
+		{
+			VOXEL_SCOPE_COUNTER("Allocate table");
+
+			FTable* NewTable = new FTable(2 * Table->Size);
+			if (Table->Next.CompareExchangeStrong(Next, NewTable))
+			{
+				Next = NewTable;
+			}
+			else
+			{
+				// Another thread added a table first, Next was updated
+				delete NewTable;
+			}
+		}
+		Table = Next;
+	}
+}
+
+FVoxelQueryCache::FEntry* FVoxelQueryCache::FindOrAddEntry(FTable& Table, const uint64 PinId, const uint64 Hash)
+{
+	const int32 Mask = Table.Size - 1;
+
+	for (int32 Probe = 0; Probe < NumProbes; Probe++)
+	{
+		FSlot& Slot = Table.Slots[(Hash + Probe) & Mask];
+
+		uint64 SlotPinId = Slot.PinId.Load(std::memory_order_acquire);
+		if (SlotPinId == 0 &&
+			Slot.PinId.CompareExchangeStrong(SlotPinId, PinId))
+		{
+			return &Slot.Entry;
+		}
+
+		// Either already used, or another thread claimed it first: SlotPinId is up to date
+		if (SlotPinId == PinId)
+		{
+			return &Slot.Entry;
+		}
+	}
+
+	return nullptr;
+}
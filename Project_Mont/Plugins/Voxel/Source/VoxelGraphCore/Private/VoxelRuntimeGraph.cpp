@@ -4,6 +4,7 @@
 #include "VoxelGraph.h"
 #include "VoxelBuffer.h"
 #include "VoxelRootNode.h"
+#include "VoxelISPCNode.h"
 #include "VoxelFunctionNode.h"
 #include "VoxelGraphCompiler.h"
 #include "VoxelFunctionCallNode.h"
@@ -12,6 +13,16 @@
 #include "EdGraph/EdGraph.h"
 #endif
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, bool, GVoxelFuseISPCNodes, true,
+	"voxel.FuseISPCNodes",
+	"If false, ISPC nodes will never be fused, even in graphs with bFuseISPCNodes set");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, bool, GVoxelOptimizeGraphs, true,
+	"voxel.graph.Optimize",
+	"If true, graphs are optimized when compiled: constants are folded, duplicated pure nodes merged and selects with a constant index pruned. Use log LogVoxel Verbose to see how many nodes were removed");
+
 VOXEL_RUN_ON_STARTUP_GAME(RegisterOnNodeMessageLogged)
 {
 #if WITH_EDITOR
@@ -251,6 +262,19 @@ TSharedPtr<FVoxelGraphExecutor> UVoxelRuntimeGraph::CreateExecutor(const FVoxelG
 		return nullptr;
 	}
 
+	if (GVoxelOptimizeGraphs)
+	{
+		// After FlushErrors so that errors of nodes folded away are still reported
+		FVoxelGraphCompiler::Optimize(*Graph, GraphPinRef.ToString());
+
+		Graph->Check();
+
+		if (Scope.HasError())
+		{
+			return nullptr;
+		}
+	}
+
 	FNode& RuntimeRootNode = Graph->NewNode(RootNode.NodeRef);
 	{
 		const FVoxelPinType Type = RootNode.GetInputPin(0).Type;
@@ -395,6 +419,59 @@ TSharedPtr<FVoxelGraphExecutor> UVoxelRuntimeGraph::CreateExecutor(const FVoxelG
 		}
 	}
 
+	if (GVoxelFuseISPCNodes &&
+		GetOuterUVoxelGraph()->bFuseISPCNodes)
+	{
+		VOXEL_SCOPE_COUNTER("Fuse ISPC nodes");
+
+		TVoxelSet<const FVoxelISPCNode*> FusedNodes;
+		for (const auto& It : Nodes)
+		{
+			FVoxelISPCNode* Consumer = Cast<FVoxelISPCNode>(*It.Value);
+			if (!Consumer ||
+				!Consumer->CanBeFused())
+			{
+				continue;
+			}
+
+			for (const FPin& InputPin : It.Key->GetInputPins())
+			{
+				if (InputPin.GetLinkedTo().Num() != 1 ||
+					!InputPin.Type.IsBuffer())
+				{
+					continue;
+				}
+
+				const FPin& OutputPin = InputPin.GetLinkedTo()[0];
+				const FVoxelISPCNode* Producer = Cast<FVoxelISPCNode>(*Nodes[&OutputPin.Node]);
+
+				// Only fuse producers with a single consumer, otherwise we'd compute them several times
+				if (!Producer ||
+					!Producer->CanBeFused() ||
+					OutputPin.GetLinkedTo().Num() != 1)
+				{
+					continue;
+				}
+
+				Consumer->FuseInput(InputPin.Name, *Producer);
+				FusedNodes.Add(Producer);
+			}
+		}
+
+		for (const auto& It : Nodes)
+		{
+			FVoxelISPCNode* Node = Cast<FVoxelISPCNode>(*It.Value);
+			if (!Node ||
+				FusedNodes.Contains(Node))
+			{
+				continue;
+			}
+
+			// Fused nodes are compiled into the kernel of the node consuming them
+			Node->CompileFusedKernel();
+		}
+	}
+
 	for (const auto& It : Nodes)
 	{
 		It.Value->RemoveEditorData();
@@ -9,6 +9,21 @@ VOXEL_CONSOLE_VARIABLE(
 	"voxel.NumThreads",
 	"The number of threads to use to process voxel tasks");
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, bool, GVoxelThreadingUseAllCores, false,
+	"voxel.threading.UseAllCores",
+	"If true, voxel.NumThreads is ignored and the pool is sized to the number of cores, minus the game & render threads");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelThreadingMaxThreadsPerGroup, 4,
+	"voxel.threading.MaxThreadsPerGroup",
+	"Max number of threads that can process the async tasks of a single task group at once");
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHCORE_API, int32, GVoxelThreadingMinTasksToSplitGroup, 8,
+	"voxel.threading.MinTasksToSplitGroup",
+	"A task group will be offered to other threads if it has more than this many queued async tasks");
+
 VOXEL_CONSOLE_VARIABLE(
 	VOXELGRAPHCORE_API, bool, GVoxelHideTaskCount, false,
 	"voxel.HideTaskCount",
@@ -60,6 +75,9 @@ VOXEL_CONSOLE_COMMAND(
 
 FVoxelTaskExecutor* GVoxelTaskExecutor = MakeVoxelSingleton(FVoxelTaskExecutor);
 
+// Index + 1 of the voxel thread running on this thread, 0 if not a voxel thread
+const uint32 GVoxelTaskExecutorThreadTLS = FPlatformTLS::AllocTlsSlot();
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -92,6 +110,40 @@ void FVoxelTaskExecutor::AddGroup(const TSharedRef<FVoxelTaskGroup>& Group)
 	Event.Trigger();
 }
 
+void FVoxelTaskExecutor::EnqueueGroup(FVoxelTaskGroup& Group)
+{
+	if (IsExiting() ||
+		Group.bIsQueued.Load(std::memory_order_relaxed) ||
+		Group.bIsQueued.Exchange(true))
+	{
+		return;
+	}
+
+	int32 QueueIndex = int32(UPTRINT(FPlatformTLS::GetTlsValue(GVoxelTaskExecutorThreadTLS))) - 1;
+	if (QueueIndex == -1)
+	{
+		// Not a voxel thread, spread the groups among the active queues
+		QueueIndex = uint32(NextWorkQueue.Increment()) % uint32(NumActiveWorkQueues.Load());
+	}
+	checkVoxelSlow(0 <= QueueIndex && QueueIndex < MaxThreads);
+
+	WorkQueues[QueueIndex].Push(FWorkQueue::GetBucket(Group.Priority), Group.AsWeak());
+
+	VOXEL_SCOPE_COUNTER("Trigger");
+	Event.Trigger();
+}
+
+int32 FVoxelTaskExecutor::GetTargetNumThreads()
+{
+	if (GVoxelThreadingUseAllCores)
+	{
+		// Leave room for the game & render threads
+		return FMath::Clamp(FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 2, 1, MaxThreads);
+	}
+
+	return FMath::Clamp(GVoxelNumThreads, 1, MaxThreads);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -103,6 +155,11 @@ void FVoxelTaskExecutor::Initialize()
 		bIsExiting.Store(true);
 		Groups.Reset();
 
+		for (FWorkQueue& WorkQueue : WorkQueues)
+		{
+			WorkQueue.Reset();
+		}
+
 		VOXEL_SCOPE_LOCK(ThreadsCriticalSection);
 		Threads.Reset();
 	};
@@ -127,11 +184,12 @@ void FVoxelTaskExecutor::Tick()
 	}
 
 	const int32 CurrentNumTasks = NumTasks();
+	const int32 TargetNumThreads = GetTargetNumThreads();
 
 	if (!GVoxelHideTaskCount &&
 		CurrentNumTasks > 0)
 	{
-		const FString Message = FString::Printf(TEXT("%d voxel tasks left using %d threads"), CurrentNumTasks, GVoxelNumThreads);
+		const FString Message = FString::Printf(TEXT("%d voxel tasks left using %d threads"), CurrentNumTasks, TargetNumThreads);
 		GEngine->AddOnScreenDebugMessage(uint64(0x557D0C945D26), FApp::GetDeltaTime() * 1.5f, FColor::White, Message);
 	}
 
@@ -166,22 +224,25 @@ void FVoxelTaskExecutor::Tick()
 
 	GVoxelNumThreads = FMath::Max(GVoxelNumThreads, 1);
 
-	if (Threads.Num() != GVoxelNumThreads)
+	if (Threads.Num() != TargetNumThreads)
 	{
-		AsyncVoxelTask([this]
+		AsyncVoxelTask([this, TargetNumThreads]
 		{
 			VOXEL_SCOPE_LOCK(ThreadsCriticalSection);
 
-			while (Threads.Num() < GVoxelNumThreads)
+			while (Threads.Num() < TargetNumThreads)
 			{
-				Threads.Add(MakeUnique<FThread>());
+				Threads.Add(MakeUnique<FThread>(Threads.Num()));
 				Event.Trigger();
 			}
 
-			while (Threads.Num() > GVoxelNumThreads)
+			while (Threads.Num() > TargetNumThreads)
 			{
 				Threads.Pop(false);
 			}
+
+			// Queues of removed threads will be drained by the remaining threads stealing from them
+			NumActiveWorkQueues.Store(TargetNumThreads);
 		});
 	}
 
@@ -379,7 +440,178 @@ void FVoxelTaskExecutor::FTaskGroupArray::UpdatePriorities()
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-FVoxelTaskExecutor::FThread::FThread()
+void FVoxelTaskExecutor::FWorkQueue::Push(const int32 Bucket, const TWeakPtr<FVoxelTaskGroup>& Group)
+{
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	Buckets[Bucket].Groups.Add(Group);
+	NumGroups.Store(NumGroups.Load() + 1);
+	TopBucket.Store(FMath::Min(TopBucket.Load(), Bucket));
+}
+
+TWeakPtr<FVoxelTaskGroup> FVoxelTaskExecutor::FWorkQueue::Pop(const bool bSteal, int32& OutBucket)
+{
+	if (Num() == 0)
+	{
+		return {};
+	}
+
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; BucketIndex++)
+	{
+		FBucket& Bucket = Buckets[BucketIndex];
+
+		const int32 NumInBucket = Bucket.Groups.Num() - Bucket.Head;
+		checkVoxelSlow(NumInBucket >= 0);
+
+		if (NumInBucket == 0)
+		{
+			continue;
+		}
+
+		NumGroups.Store(NumGroups.Load() - 1);
+		OutBucket = BucketIndex;
+
+		ON_SCOPE_EXIT
+		{
+			UpdateTopBucket_RequiresLock();
+		};
+
+		if (!bSteal)
+		{
+			// Most recent group first: its data is more likely to still be in cache
+			TWeakPtr<FVoxelTaskGroup> Group = Bucket.Groups.Pop(false);
+			if (NumInBucket == 1)
+			{
+				Bucket.Groups.Reset();
+				Bucket.Head = 0;
+			}
+			return Group;
+		}
+
+		// Steal the oldest group
+		TWeakPtr<FVoxelTaskGroup> Group = MoveTemp(Bucket.Groups[Bucket.Head]);
+		Bucket.Head++;
+
+		if (Bucket.Head == Bucket.Groups.Num())
+		{
+			Bucket.Groups.Reset();
+			Bucket.Head = 0;
+		}
+		else if (Bucket.Head > 1024 && Bucket.Head > Bucket.Groups.Num() / 2)
+		{
+			Bucket.Groups.RemoveAt(0, Bucket.Head, false);
+			Bucket.Head = 0;
+		}
+
+		return Group;
+	}
+
+	ensure(false);
+	return {};
+}
+
+void FVoxelTaskExecutor::FWorkQueue::Rebucket()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	TVoxelArray<TWeakPtr<FVoxelTaskGroup>> WeakGroups;
+	{
+		VOXEL_SCOPE_LOCK(CriticalSection);
+
+		for (FBucket& Bucket : Buckets)
+		{
+			for (int32 Index = Bucket.Head; Index < Bucket.Groups.Num(); Index++)
+			{
+				WeakGroups.Add(MoveTemp(Bucket.Groups[Index]));
+			}
+			Bucket.Groups.Reset();
+			Bucket.Head = 0;
+		}
+
+		NumGroups.Store(0);
+		TopBucket.Store(NumBuckets);
+	}
+
+	if (WeakGroups.Num() == 0)
+	{
+		return;
+	}
+
+	// Pin outside of the lock: releasing the last ref of a group destroys it
+	TVoxelArray<TPair<int32, TWeakPtr<FVoxelTaskGroup>>> BucketedGroups;
+	BucketedGroups.Reserve(WeakGroups.Num());
+	for (TWeakPtr<FVoxelTaskGroup>& WeakGroup : WeakGroups)
+	{
+		const TSharedPtr<FVoxelTaskGroup> Group = WeakGroup.Pin();
+		if (!Group)
+		{
+			continue;
+		}
+
+		BucketedGroups.Add({ GetBucket(Group->Priority), MoveTemp(WeakGroup) });
+	}
+
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	for (TPair<int32, TWeakPtr<FVoxelTaskGroup>>& It : BucketedGroups)
+	{
+		Buckets[It.Key].Groups.Add(MoveTemp(It.Value));
+	}
+
+	NumGroups.Store(NumGroups.Load() + BucketedGroups.Num());
+	UpdateTopBucket_RequiresLock();
+}
+
+void FVoxelTaskExecutor::FWorkQueue::Reset()
+{
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	for (FBucket& Bucket : Buckets)
+	{
+		Bucket.Groups.Empty();
+		Bucket.Head = 0;
+	}
+	NumGroups.Store(0);
+	TopBucket.Store(NumBuckets);
+}
+
+void FVoxelTaskExecutor::FWorkQueue::UpdateTopBucket_RequiresLock()
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	for (int32 BucketIndex = 0; BucketIndex < NumBuckets; BucketIndex++)
+	{
+		if (Buckets[BucketIndex].Groups.Num() > Buckets[BucketIndex].Head)
+		{
+			TopBucket.Store(BucketIndex);
+			return;
+		}
+	}
+	TopBucket.Store(NumBuckets);
+}
+
+int32 FVoxelTaskExecutor::FWorkQueue::GetBucket(const FVoxelTaskPriority& Priority)
+{
+	const double Value = Priority.GetPriority();
+	if (Value <= 0)
+	{
+		// Top priority
+		return 0;
+	}
+
+	// Priority is a squared distance: bucket on the log2 of the distance in meters
+	const double DistanceInMeters = FMath::Sqrt(Value) / 100.;
+	return FMath::Min<int32>(1 + FMath::FloorLog2(uint32(FMath::Min(DistanceInMeters, double(MAX_uint32 - 1)) + 1)), NumBuckets - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelTaskExecutor::FThread::FThread(const int32 ThreadIndex)
+	: ThreadIndex(ThreadIndex)
 {
 	UE::Trace::ThreadGroupBegin(TEXT("VoxelThreadPool"));
 
@@ -417,6 +649,8 @@ uint32 FVoxelTaskExecutor::FThread::Run()
 
 	const TUniquePtr<FVoxelMemoryScope> MemoryScope = MakeUnique<FVoxelMemoryScope>();
 
+	FPlatformTLS::SetTlsValue(GVoxelTaskExecutorThreadTLS, reinterpret_cast<void*>(UPTRINT(ThreadIndex + 1)));
+
 Wait:
 	if (bTimeToDie.Load())
 	{
@@ -435,28 +669,38 @@ GetNextTask:
 		return 0;
 	}
 
-	TSharedPtr<FVoxelTaskGroup> TmpGroup = GVoxelTaskExecutor->GetGroupToProcess(this);
+	TSharedPtr<FVoxelTaskGroup> TmpGroup = GVoxelTaskExecutor->GetGroupToProcess(*this);
 	if (!TmpGroup)
 	{
 		goto Wait;
 	}
 
-	FVoxelTaskGroupScope Scope;
-	if (!Scope.Initialize(*TmpGroup))
 	{
-		// Exiting
-		goto Wait;
-	}
+		FVoxelTaskGroupScope Scope;
+		if (!Scope.Initialize(*TmpGroup))
+		{
+			// Exiting
+			TmpGroup->RemoveAsyncProcessor();
+			goto Wait;
+		}
 
-	// Reset to only have one valid group ref for ShouldExit
-	TmpGroup.Reset();
+		// Reset to only have one valid group ref for ShouldExit
+		TmpGroup.Reset();
 
-	checkVoxelSlow(Scope.GetGroup().AsyncProcessor.Load() == this);
+		FVoxelTaskGroup& Group = Scope.GetGroup();
+		checkVoxelSlow(Group.NumAsyncProcessors.Load() > 0);
 
-	Scope.GetGroup().ProcessAsyncTasks();
+		Group.ProcessAsyncTasks();
+		Group.RemoveAsyncProcessor();
 
-	const void* Old = Scope.GetGroup().AsyncProcessor.Exchange(nullptr);
-	checkVoxelSlow(Old == this);
+		// A task might have been queued after we stopped dequeuing but before we released the group,
+		// in which case whoever popped the group from the work queue couldn't process it
+		if (Group.HasAsyncTasks() &&
+			!Group.ShouldExit())
+		{
+			GVoxelTaskExecutor->EnqueueGroup(Group);
+		}
+	}
 
 	goto GetNextTask;
 }
@@ -465,29 +709,117 @@ GetNextTask:
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-TSharedPtr<FVoxelTaskGroup> FVoxelTaskExecutor::GetGroupToProcess(const FThread* Thread)
+TSharedPtr<FVoxelTaskGroup> FVoxelTaskExecutor::GetGroupToProcess(const FThread& Thread)
 {
 	VOXEL_FUNCTION_COUNTER();
 
-	TSharedPtr<FVoxelTaskGroup> GroupToProcess;
-	Groups.ForeachGroup([&](FVoxelTaskGroup& Group)
+	const int32 MaxThreadsPerGroup = FMath::Max(GVoxelThreadingMaxThreadsPerGroup, 1);
+
+	// Priorities change as the camera moves, rebucket every PriorityDuration
 	{
-		if (!Group.HasAsyncTasks())
+		const double Time = FPlatformTime::Seconds();
+		double LastTime = LastRebucketTime.Load();
+		if (LastTime + GVoxelThreadingPriorityDuration < Time &&
+			LastRebucketTime.CompareExchangeStrong(LastTime, Time))
 		{
-			return true;
+			VOXEL_SCOPE_COUNTER("Rebucket");
+
+			for (FWorkQueue& WorkQueue : WorkQueues)
+			{
+				WorkQueue.Rebucket();
+			}
 		}
+	}
 
-		const void* Expected = nullptr;
-		if (!Group.AsyncProcessor.CompareExchangeStrong(Expected, Thread))
+	const auto TryProcess = [&](FWorkQueue& WorkQueue, const bool bSteal) -> TSharedPtr<FVoxelTaskGroup>
+	{
+		int32 Bucket = 0;
+		const TSharedPtr<FVoxelTaskGroup> Group = WorkQueue.Pop(bSteal, Bucket).Pin();
+		if (!Group)
 		{
-			return true;
+			return nullptr;
 		}
-		checkVoxelSlow(Expected == nullptr);
 
-		ensure(!GroupToProcess);
-		GroupToProcess = Group.AsShared();
-		return false;
-	});
+		// Further away than when it was pushed, let closer groups go first
+		// Only moves to later buckets, so this terminates
+		const int32 NewBucket = FWorkQueue::GetBucket(Group->Priority);
+		if (NewBucket > Bucket)
+		{
+			WorkQueue.Push(NewBucket, Group);
+			return nullptr;
+		}
+
+		// Clear before checking for tasks: any task queued from now on will re-enqueue the group
+		Group->bIsQueued.Store(false);
+
+		if (!Group->HasAsyncTasks() ||
+			!Group->TryAddAsyncProcessor(MaxThreadsPerGroup))
+		{
+			return nullptr;
+		}
+
+		// Large group: let other threads help
+		if (Group->NumAsyncProcessors.Load() < MaxThreadsPerGroup &&
+			Group->NumAsyncTasks() > GVoxelThreadingMinTasksToSplitGroup)
+		{
+			EnqueueGroup(*Group);
+		}
+
+		return Group;
+	};
+
+	FWorkQueue& OwnWorkQueue = WorkQueues[Thread.ThreadIndex];
+
+	// Steal first if another queue has closer groups than our own
+	{
+		int32 BestQueueIndex = -1;
+		int32 BestBucket = OwnWorkQueue.GetTopBucket();
+		for (int32 Offset = 1; Offset < MaxThreads; Offset++)
+		{
+			const int32 QueueIndex = (Thread.ThreadIndex + Offset) % MaxThreads;
+			const int32 TopBucket = WorkQueues[QueueIndex].GetTopBucket();
+			if (TopBucket < BestBucket)
+			{
+				BestQueueIndex = QueueIndex;
+				BestBucket = TopBucket;
+			}
+		}
+
+		if (BestQueueIndex != -1)
+		{
+			VOXEL_SCOPE_COUNTER("Steal closer group");
+
+			if (TSharedPtr<FVoxelTaskGroup> Group = TryProcess(WorkQueues[BestQueueIndex], true))
+			{
+				return Group;
+			}
+		}
+	}
+
+	// Then our own queue
+	while (OwnWorkQueue.Num() > 0)
+	{
+		if (TSharedPtr<FVoxelTaskGroup> Group = TryProcess(OwnWorkQueue, false))
+		{
+			return Group;
+		}
+	}
+
+	// Steal from other queues, including the ones of threads that were removed
+	for (int32 Offset = 1; Offset < MaxThreads; Offset++)
+	{
+		FWorkQueue& WorkQueue = WorkQueues[(Thread.ThreadIndex + Offset) % MaxThreads];
+
+		while (WorkQueue.Num() > 0)
+		{
+			VOXEL_SCOPE_COUNTER("Steal");
+
+			if (TSharedPtr<FVoxelTaskGroup> Group = TryProcess(WorkQueue, true))
+			{
+				return Group;
+			}
+		}
+	}
 
-	return GroupToProcess;
+	return nullptr;
 }
\ No newline at end of file
@@ -84,6 +84,90 @@ FVoxelExecNodeStatManager* GVoxelExecNodeStatManager = MakeVoxelSingleton(FVoxel
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelTaskGroupArenaMemory);
+DEFINE_VOXEL_COUNTER(STAT_VoxelTaskGroupArenaNumAllocations);
+
+FVoxelTaskGroupArena::~FVoxelTaskGroupArena()
+{
+	if (Blocks_RequiresLock.Num() == 0)
+	{
+		return;
+	}
+
+	VOXEL_SCOPE_COUNTER_FORMAT("FVoxelTaskGroupArena Free %lld allocations %fMB", NumAllocations_RequiresLock, BlocksSize_RequiresLock / double(1 << 20));
+
+	for (void* Block : Blocks_RequiresLock)
+	{
+		FVoxelMemory::Free(Block);
+	}
+
+	DEC_VOXEL_MEMORY_STAT_BY(STAT_VoxelTaskGroupArenaMemory, BlocksSize_RequiresLock);
+	DEC_VOXEL_COUNTER_BY(STAT_VoxelTaskGroupArenaNumAllocations, NumAllocations_RequiresLock);
+}
+
+void* FVoxelTaskGroupArena::Allocate(const int64 Size, const int32 Alignment)
+{
+	checkVoxelSlow(Size > 0);
+	checkVoxelSlow(FMath::IsPowerOfTwo(Alignment) && Alignment <= MaxAlignment);
+
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	NumAllocations_RequiresLock++;
+	INC_VOXEL_COUNTER(STAT_VoxelTaskGroupArenaNumAllocations);
+
+	if (Size > BlockSize / 4)
+	{
+		// Don't waste the end of the current block
+		void* Data = FVoxelMemory::Malloc(Size, MaxAlignment);
+		Blocks_RequiresLock.Add(Data);
+		BlocksSize_RequiresLock += Size;
+		INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelTaskGroupArenaMemory, Size);
+		return Data;
+	}
+
+	int64 Offset = Align(BlockOffset_RequiresLock, Alignment);
+	if (!BlockData_RequiresLock ||
+		Offset + Size > BlockSize)
+	{
+		BlockData_RequiresLock = static_cast<uint8*>(FVoxelMemory::Malloc(BlockSize, MaxAlignment));
+		Blocks_RequiresLock.Add(BlockData_RequiresLock);
+		BlocksSize_RequiresLock += BlockSize;
+		INC_VOXEL_MEMORY_STAT_BY(STAT_VoxelTaskGroupArenaMemory, BlockSize);
+
+		Offset = 0;
+	}
+
+	BlockOffset_RequiresLock = Offset + Size;
+	return BlockData_RequiresLock + Offset;
+}
+
+void* FVoxelTaskGroupArena::AllocateScratch(const int64 Size)
+{
+	{
+		VOXEL_SCOPE_LOCK(CriticalSection);
+
+		if (TVoxelArray<void*>* FreeScratches = SizeToFreeScratches_RequiresLock.Find(Size))
+		{
+			if (FreeScratches->Num() > 0)
+			{
+				return FreeScratches->Pop(false);
+			}
+		}
+	}
+
+	return Allocate(Size, MaxAlignment);
+}
+
+void FVoxelTaskGroupArena::ReleaseScratch(void* Data, const int64 Size)
+{
+	VOXEL_SCOPE_LOCK(CriticalSection);
+	SizeToFreeScratches_RequiresLock.FindOrAdd(Size).Add(Data);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 DEFINE_VOXEL_INSTANCE_COUNTER(FVoxelTaskGroup);
 
 const uint32 GVoxelTaskGroupTLS = FPlatformTLS::AllocTlsSlot();
@@ -356,13 +440,16 @@ void FVoxelTaskGroup::ProcessTask(TVoxelUniquePtr<FVoxelTask> TaskPtr)
 	break;
 	case EVoxelTaskThread::AsyncThread:
 	{
-		AsyncTasks.Enqueue(MoveTemp(TaskPtr));
-
-		if (!AsyncProcessor.Load(std::memory_order_relaxed))
+		if (bIsSynchronous)
 		{
-			VOXEL_SCOPE_COUNTER("Trigger");
-			GVoxelTaskExecutor->Event.Trigger();
+			AsyncTasks.Enqueue(MoveTemp(TaskPtr));
+			break;
 		}
+
+		NumQueuedAsyncTasks.Increment();
+		AsyncTasks.Enqueue(MoveTemp(TaskPtr));
+
+		GVoxelTaskExecutor->EnqueueGroup(*this);
 	}
 	break;
 	}
@@ -512,19 +599,54 @@ void FVoxelTaskGroup::ProcessAsyncTasks()
 	VOXEL_SCOPE_COUNTER_FNAME(GraphStatName);
 	VOXEL_SCOPE_COUNTER_FNAME(CallstackStatName);
 	check(!bIsSynchronous);
-	check(AsyncProcessor.Load());
+	check(NumAsyncProcessors.Load() > 0);
 	check(&Get() == this);
 	const FVoxelQueryScope Scope(nullptr, &Context.Get());
 
+	const auto DequeueTask = [&](TVoxelUniquePtr<FVoxelTask>& OutTask)
+	{
+		VOXEL_SCOPE_LOCK(AsyncTasksCriticalSection);
+
+		if (!AsyncTasks.Dequeue(OutTask))
+		{
+			return false;
+		}
+
+		NumQueuedAsyncTasks.Decrement();
+		return true;
+	};
+
 	TVoxelUniquePtr<FVoxelTask> Task;
 	while (
 		!ShouldExit() &&
-		AsyncTasks.Dequeue(Task))
+		DequeueTask(Task))
 	{
 		Task->Execute();
 	}
 }
 
+bool FVoxelTaskGroup::TryAddAsyncProcessor(const int32 MaxProcessors)
+{
+	int32 Expected = NumAsyncProcessors.Load();
+	while (Expected < MaxProcessors)
+	{
+		if (NumAsyncProcessors.CompareExchangeWeak(Expected, Expected + 1))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FVoxelTaskGroup::RemoveAsyncProcessor()
+{
+	int32 Expected = NumAsyncProcessors.Load();
+	while (!NumAsyncProcessors.CompareExchangeWeak(Expected, Expected - 1))
+	{
+	}
+	checkVoxelSlow(Expected > 0);
+}
+
 FVoxelTaskGroup::FVoxelTaskGroup(
 	const FName Name,
 	const bool bIsSynchronous,
@@ -557,6 +679,8 @@ FVoxelTaskGroupScope::~FVoxelTaskGroupScope()
 	}
 
 	ensure(Group->RuntimeInfo->NumActiveTasks.Decrement() >= 0);
+	// Decrement the count and bump the serial before releasing our ref
+	ensure((Group->ScopeState.Add(MAX_uint32) & MAX_uint32) > 0);
 
 	FPlatformTLS::SetTlsValue(GVoxelTaskGroupTLS, PreviousTLS);
 
@@ -591,6 +715,8 @@ bool FVoxelTaskGroupScope::Initialize(FVoxelTaskGroup& NewGroup)
 	}
 
 	Group = NewGroup.AsShared();
+	// Increment the count and bump the serial after taking our ref
+	Group->ScopeState.Add((int64(1) << 32) + 1);
 
 	PreviousTLS = FPlatformTLS::GetTlsValue(GVoxelTaskGroupTLS);
 	FPlatformTLS::SetTlsValue(GVoxelTaskGroupTLS, &NewGroup);
@@ -7,6 +7,8 @@
 #include "VoxelObjectPinType.h"
 #include "VoxelMaterial.generated.h"
 
+class FVoxelDetailTextureAllocation;
+
 USTRUCT()
 struct VOXELGRAPHCORE_API FVoxelComputedMaterialParameter
 {
@@ -17,6 +19,8 @@ struct VOXELGRAPHCORE_API FVoxelComputedMaterialParameter
 	TVoxelMap<FName, TWeakObjectPtr<UTexture>> TextureParameters;
 	TVoxelMap<FName, TSharedPtr<FVoxelDynamicMaterialParameter>> DynamicParameters;
 	TVoxelArray<TSharedPtr<FVirtualDestructor>> Resources;
+	// Kept alive like Resources, marked as used whenever the mesh is visible
+	TVoxelArray<TSharedPtr<FVoxelDetailTextureAllocation>> DetailTextureAllocations;
 
 	template<typename LambdaType>
 	void ForeachKey(LambdaType&& Lambda) const
@@ -4,6 +4,7 @@
 
 #include "VoxelMinimal.h"
 #include "VoxelPointHandle.h"
+#include "Engine/HitResult.h"
 #include "VoxelPointHandleProvider.generated.h"
 
 UINTERFACE()
@@ -20,4 +21,12 @@ public:
 	virtual bool TryGetPointHandle(
 		int32 ItemIndex,
 		FVoxelPointHandle& OutHandle) const VOXEL_PURE_VIRTUAL({});
+
+	// Override if a single body holds several points, in which case HitResult.Item cannot be used
+	virtual bool TryGetPointHandleFromHit(
+		const FHitResult& HitResult,
+		FVoxelPointHandle& OutHandle) const
+	{
+		return TryGetPointHandle(HitResult.Item, OutHandle);
+	}
 };
\ No newline at end of file
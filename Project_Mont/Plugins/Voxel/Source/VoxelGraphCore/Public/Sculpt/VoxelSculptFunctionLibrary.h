@@ -15,8 +15,35 @@ class VOXELGRAPHCORE_API UVoxelSculptFunctionLibrary : public UBlueprintFunction
 	GENERATED_BODY()
 
 public:
+	// If TargetActor replicates its sculpt, needs to be called on the server
+	// SculptActor then needs to be net addressable, eg placed in the level or replicated
 	UFUNCTION(BlueprintCallable, Category = "Voxel|Sculpt")
 	static void ApplySculpt(
 		AVoxelActor* TargetActor,
 		AVoxelActor* SculptActor);
+
+	// Applies the sculpt without replicating it, returns the voxel bounds that were written
+	// If set, SculptActorToWorld is used instead of the sculpt actor transform, without moving it
+	// If set, Bounds is used instead of the sculpt actor bounds
+	static TOptional<FVoxelIntBox> ApplySculptLocal(
+		AVoxelActor& TargetActor,
+		AVoxelActor& SculptActor,
+		const TOptional<FTransform>& SculptActorToWorld = {},
+		const TOptional<FVoxelIntBox>& Bounds = {});
+
+public:
+	// All the sculpts applied until EndSculptStroke will be undone together
+	UFUNCTION(BlueprintCallable, Category = "Voxel|Sculpt")
+	static void BeginSculptStroke(AVoxelActor* TargetActor);
+
+	UFUNCTION(BlueprintCallable, Category = "Voxel|Sculpt")
+	static void EndSculptStroke(AVoxelActor* TargetActor);
+
+	// Returns false if there was nothing to undo
+	UFUNCTION(BlueprintCallable, Category = "Voxel|Sculpt")
+	static bool UndoSculpt(AVoxelActor* TargetActor);
+
+	// Returns false if there was nothing to redo
+	UFUNCTION(BlueprintCallable, Category = "Voxel|Sculpt")
+	static bool RedoSculpt(AVoxelActor* TargetActor);
 };
\ No newline at end of file
@@ -0,0 +1,166 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "VoxelMinimal.h"
+#include "VoxelFutureValue.h"
+#include "Misc/NetworkGuid.h"
+#include "Sculpt/VoxelSculptStorageData.h"
+#include "VoxelSculptReplication.generated.h"
+
+class AVoxelActor;
+class UVoxelSculptStorage;
+class FVoxelQueryContext;
+struct FVoxelSurface;
+
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelSculptReplicatedBytesPerSecond, "Sculpt Replicated Bytes/s");
+
+// A single ApplySculpt, replicated instead of the sculpt data it writes
+// Every machine runs the sculpt graph with the same inputs in the same order, so only the inputs are sent
+USTRUCT()
+struct VOXELGRAPHCORE_API FVoxelSculptEdit
+{
+	GENERATED_BODY()
+
+	// Incremented by one for each edit, edits are applied in order
+	uint32 SequenceId = 0;
+
+	// Actor with the Edit Sculpt Surface node used as brush: its graph & parameters define the brush shape & strength
+	// Needs to be net addressable, eg placed in the level or replicated
+	TWeakObjectPtr<AVoxelActor> SculptActor;
+	// Received from the server: lets clients resolve SculptActor if the edit arrived before the actor was replicated
+	// Invalid if the server couldn't address SculptActor, in which case the edit can never be applied
+	FNetworkGUID SculptActorNetGUID;
+
+	// Chunk aligned bounds written by the edit, in voxels
+	FVoxelIntBox Bounds;
+
+	// Quantized to what is sent over the network, so that the server applies exactly what clients will
+	void SetSculptActorTransform(const FTransform& Transform);
+	FTransform GetSculptActorTransform() const;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+private:
+	// In mm
+	FInt64Vector Location = FInt64Vector(ForceInit);
+	// Compressed to shorts
+	FIntVector Rotation = FIntVector(ForceInit);
+	// In hundredths
+	FIntVector Scale = FIntVector(100);
+};
+
+template<>
+struct TStructOpsTypeTraits<FVoxelSculptEdit> : TStructOpsTypeTraitsBase2<FVoxelSculptEdit>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+// Sent once to each late joiner: all the sculpt chunks, stored as the difference with the unedited graph output
+// Each chunk is compressed separately, and is mostly zeros outside of the edited areas
+class VOXELGRAPHCORE_API FVoxelSculptSnapshotBuilder : public TSharedFromThis<FVoxelSculptSnapshotBuilder>
+{
+public:
+	using FOnBuilt = TVoxelUniqueFunction<void(const TSharedRef<const TArray<uint8>>& SnapshotData)>;
+	using FOnApplied = TVoxelUniqueFunction<void()>;
+
+	// Game thread only, OnBuilt is called on the game thread
+	// Chunks are gathered right away, their deltas are computed on voxel threads
+	// Only computes the chunks that changed since the last build
+	// Returns false if the sculpt source surface isn't available yet
+	bool BuildAsync(
+		const AVoxelActor& Actor,
+		const FVoxelSculptStorageData& Data,
+		FOnBuilt&& OnBuilt);
+
+	// Game thread only, OnApplied is called on the game thread once the chunks are set
+	// Returns false if the sculpt source surface isn't available yet
+	static bool ApplyAsync(
+		const AVoxelActor& Actor,
+		const TSharedRef<FVoxelSculptStorageData>& Data,
+		const TSharedRef<const TArray<uint8>>& SnapshotData,
+		FOnApplied&& OnApplied);
+
+private:
+	struct FChunkDelta
+	{
+		TWeakPtr<FVoxelSculptStorageData::FChunk> Chunk;
+		TSharedPtr<const TArray64<uint8>> CompressedDelta;
+	};
+	// Game thread only
+	TVoxelMap<FIntVector, FChunkDelta> KeyToChunkDelta;
+
+	struct FSourceSurface
+	{
+		TSharedPtr<FVoxelQueryContext> Context;
+		TSharedPtr<const TVoxelComputeValue<FVoxelSurface>> Compute;
+		float VoxelSize = 0.f;
+	};
+	static TSharedPtr<const FSourceSurface> FindSourceSurface(const AVoxelActor& Actor);
+
+	// Distances of the Set Sculpt Source Surface graph in voxels, OnComputed is called on a voxel thread
+	// Distances is empty if the surface couldn't be computed
+	static void ComputeSourceDistancesAsync(
+		const FSourceSurface& SourceSurface,
+		const FVoxelIntBox& Bounds,
+		TFunction<void(TConstVoxelArrayView<float> Distances)> OnComputed);
+};
+
+// Added to each player controller by the server
+// Late joiners request the sculpt snapshots through it, and the server streams them back in small reliable pieces
+// so that a big sculpt never ends up in a single bunch
+UCLASS()
+class VOXELGRAPHCORE_API UVoxelSculptSnapshotStreamer : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UVoxelSculptSnapshotStreamer();
+
+	//~ Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	//~ End UActorComponent Interface
+
+	// Server only
+	static void AddToPlayerController(APlayerController& PlayerController);
+	// Client only, null until the local player controller is replicated
+	static UVoxelSculptSnapshotStreamer* FindLocal(const UWorld* World);
+
+	// Client only: the snapshot is received through UVoxelSculptStorage::ReceiveSnapshotChunk
+	void RequestSnapshot(UVoxelSculptStorage& Storage);
+	// Server only: sent over the next ticks, throttled by voxel.sculpt.SnapshotBytesPerTick
+	void SendSnapshot(
+		UVoxelSculptStorage& Storage,
+		uint32 SequenceId,
+		const TSharedRef<const TArray<uint8>>& SnapshotData);
+
+private:
+	struct FPendingSnapshot
+	{
+		TWeakObjectPtr<UVoxelSculptStorage> Storage;
+		uint32 SequenceId = 0;
+		TSharedPtr<const TArray<uint8>> Data;
+		int32 NumSent = 0;
+	};
+	TVoxelArray<FPendingSnapshot> PendingSnapshots;
+
+	UFUNCTION(Server, Reliable)
+	void ServerRequestSnapshot(UVoxelSculptStorage* Storage);
+
+	UFUNCTION(Client, Reliable)
+	void ClientReceiveSnapshotChunk(
+		UVoxelSculptStorage* Storage,
+		uint32 SequenceId,
+		int32 TotalSize,
+		const TArray<uint8>& Chunk);
+};
+
+struct VOXELGRAPHCORE_API FVoxelSculptReplicationUtilities
+{
+	// Updates STAT_VoxelSculptReplicatedBytesPerSecond, game thread only
+	static void AddReplicatedBytes(int64 NumBytes);
+};
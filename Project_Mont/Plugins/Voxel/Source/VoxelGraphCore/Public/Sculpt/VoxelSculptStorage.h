@@ -6,27 +6,98 @@
 #include "VoxelFutureValue.h"
 #include "VoxelTransformRef.h"
 #include "VoxelRuntimeParameter.h"
+#include "Sculpt/VoxelSculptReplication.h"
 #include "VoxelSculptStorage.generated.h"
 
+class AVoxelActor;
 struct FVoxelSurface;
 class FVoxelSculptStorageData;
 
+enum class EVoxelSculptSnapshotState : uint8
+{
+	// Server, standalone or snapshot applied
+	None,
+	WaitingForStreamer,
+	Requested,
+	Received,
+	Applying
+};
+
 UCLASS()
 class VOXELGRAPHCORE_API UVoxelSculptStorage : public UActorComponent
 {
 	GENERATED_BODY()
 
 public:
+	UVoxelSculptStorage();
+
 	//~ Begin UObject Interface
 	virtual void Serialize(FArchive& Ar) override;
 	//~ End UObject Interface
 
+	//~ Begin UActorComponent Interface
+	virtual void BeginPlay() override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	//~ End UActorComponent Interface
+
 	void ClearData();
 	TSharedRef<FVoxelSculptStorageData> GetData();
 
 private:
 	FByteBulkData BulkData;
 	TSharedPtr<FVoxelSculptStorageData> Data;
+
+public:
+	// True if the owner has bReplicateSculpt and is networked
+	bool IsReplicatingEdits() const;
+	// Server only: applies the sculpt & sends it to all the clients
+	void ApplyReplicatedEdit(AVoxelActor& SculptActor);
+
+public:
+	// Server only: the snapshot is built asynchronously, then streamed by Streamer
+	void AddSnapshotRequest(UVoxelSculptSnapshotStreamer& Streamer);
+
+	// Client only: no-op if the snapshot was already requested or if the local streamer isn't replicated yet
+	void RequestSnapshot();
+	void ReceiveSnapshotChunk(
+		uint32 SequenceId,
+		int32 TotalSize,
+		TConstArrayView<uint8> Chunk);
+
+private:
+	uint32 LastSequenceId = 0;
+	TVoxelArray<FVoxelSculptEdit> PendingEdits;
+	// Time at which the first pending edit started waiting for its sculpt actor
+	double SculptActorWaitStartTime = 0;
+
+	// Server: requests waiting for a snapshot including their sequence id
+	struct FSnapshotRequest
+	{
+		TWeakObjectPtr<UVoxelSculptSnapshotStreamer> Streamer;
+		uint32 SequenceId = 0;
+	};
+	TVoxelArray<FSnapshotRequest> SnapshotRequests;
+	bool bIsBuildingSnapshot = false;
+	// Last built snapshot, reused by requests until the next edit
+	uint32 SnapshotSequenceId = 0;
+	TSharedPtr<const TArray<uint8>> SnapshotData;
+	const TSharedRef<FVoxelSculptSnapshotBuilder> SnapshotBuilder = MakeVoxelShared<FVoxelSculptSnapshotBuilder>();
+
+	// Client: edits are queued until the snapshot is applied
+	EVoxelSculptSnapshotState SnapshotState = EVoxelSculptSnapshotState::None;
+	uint32 ReceivedSnapshotSequenceId = 0;
+	TArray<uint8> ReceivedSnapshotData;
+
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastEdit(const FVoxelSculptEdit& Edit);
+
+	// Returns false if the edit couldn't be applied yet
+	// Edits whose sculpt actor can never be resolved are logged and skipped
+	bool ApplyEdit(const FVoxelSculptEdit& Edit);
+	void FlushPendingEdits();
+	void ProcessSnapshotRequests();
+	void UpdateTickEnabled();
 };
 
 USTRUCT()
@@ -8,6 +8,8 @@
 
 class FVoxelDependency;
 
+DECLARE_VOXEL_MEMORY_STAT(VOXELGRAPHCORE_API, STAT_VoxelSculptStorageMemory, "Sculpt Storage Memory");
+
 class VOXELGRAPHCORE_API FVoxelSculptStorageData : public TSharedFromThis<FVoxelSculptStorageData>
 {
 public:
@@ -17,7 +19,83 @@ public:
 	static constexpr int32 ChunkCount = FMath::Cube(ChunkSize);
 
 	using FDensity = int16;
-	using FChunk = TVoxelStaticArray<FDensity, ChunkCount>;
+	using FDenseChunk = TVoxelStaticArray<FDensity, ChunkCount>;
+
+	// Chunks fully inside or outside of MaxDistance are stored as a single value,
+	// chunks with few distinct values as a palette, and everything else densely
+	class VOXELGRAPHCORE_API FChunk
+	{
+	public:
+		// Above this, building the palette is too slow and it doesn't save enough memory
+		static constexpr int32 MaxPaletteSize = 16;
+
+		FChunk() = default;
+
+		VOXEL_ALLOCATED_SIZE_TRACKER(STAT_VoxelSculptStorageMemory);
+
+		FORCEINLINE bool IsDense() const
+		{
+			return DenseData.IsValid();
+		}
+		FORCEINLINE bool IsUniform() const
+		{
+			return !IsDense() && PaletteData.IsConstant();
+		}
+
+		FORCEINLINE bool IsLoaded() const
+		{
+			return bIsLoaded.Load();
+		}
+
+		FORCEINLINE FDensity Get(const int32 Index) const
+		{
+			checkVoxelSlow(0 <= Index && Index < ChunkCount);
+			checkVoxelSlow(IsLoaded());
+
+			if (DenseData)
+			{
+				return (*DenseData)[Index];
+			}
+
+			checkVoxelSlow(PaletteData.Num() == ChunkCount);
+			return PaletteData[Index];
+		}
+		FORCEINLINE FDensity operator[](const int32 Index) const
+		{
+			return Get(Index);
+		}
+
+		int64 GetAllocatedSize() const;
+		// Excludes the compressed data, which can be written to concurrently
+		FORCEINLINE int64 GetAllocatedSize_NoCompressedData() const
+		{
+			return PaletteData.GetAllocatedSize() + (DenseData ? sizeof(FDenseChunk) : 0);
+		}
+
+		// Expands the chunk if needed, call Compact once done writing
+		FDenseChunk& GetDenseData();
+		// Picks the smallest representation for the current data
+		void Compact();
+
+		void SetData(const FDenseChunk& Data);
+		void CopyTo(FDenseChunk& Data) const;
+
+		void Serialize(FArchive& Ar);
+
+		// Chunks are loaded lazily from their compressed data on first access
+		void Load();
+		void SetCompressedData(const TSharedRef<const TArray64<uint8>>& NewCompressedData);
+		// Only compresses the chunk if it was written to since the last call
+		TSharedRef<const TArray64<uint8>> GetCompressedData();
+
+	private:
+		TVoxelUniquePtr<FDenseChunk> DenseData;
+		TVoxelPaletteArray<FDensity> PaletteData;
+
+		TVoxelAtomic<bool> bIsLoaded = true;
+		FVoxelFastCriticalSection_NoPadding CompressionCriticalSection;
+		TSharedPtr<const TArray64<uint8>> CompressedData_RequiresLock;
+	};
 
 	FORCEINLINE static FDensity ToDensity(const float Value)
 	{
@@ -40,12 +118,24 @@ public:
 	FORCEINLINE FChunk* FindChunk(const FIntVector& Key)
 	{
 		checkVoxelSlow(CriticalSection.IsLocked_Read_Debug());
-		const TSharedPtr<FChunk>* Chunk = Chunks.Find(Key);
+		const TSharedPtr<FChunk>* ChunkPtr = Chunks.Find(Key);
+		if (!ChunkPtr)
+		{
+			return nullptr;
+		}
+
+		// Null if the chunk creation was undone
+		FChunk* Chunk = ChunkPtr->Get();
 		if (!Chunk)
 		{
 			return nullptr;
 		}
-		return Chunk->Get();
+
+		if (!Chunk->IsLoaded())
+		{
+			Chunk->Load();
+		}
+		return Chunk;
 	}
 	FORCEINLINE const FChunk* FindChunk(const FIntVector& Key) const
 	{
@@ -59,6 +149,26 @@ public:
 		TConstVoxelArrayView<float> Distances);
 
 	void ClearData();
+
+	// Chunks are never written to once added, the returned chunks can be read without the lock
+	TVoxelArray<TPair<FIntVector, TSharedRef<FChunk>>> GetChunks() const;
+	// Replaces all the chunks & clears the history, used by replication
+	void SetChunks(TConstVoxelArrayView<TPair<FIntVector, TSharedRef<FChunk>>> NewChunks);
+
+	// All the writes between BeginStroke and EndStroke are undone together
+	// Writes outside of a stroke are undone one by one
+	void BeginStroke();
+	void EndStroke();
+
+	bool CanUndo() const;
+	bool CanRedo() const;
+	// Only restores & invalidates the chunks touched by the stroke
+	// Undo & Redo fail while a stroke is in progress
+	bool Undo();
+	bool Redo();
+	void ClearHistory();
+
+	// Chunks are compressed independently and only recompressed if they were edited since the last save
 	void Serialize(FArchive& Ar);
 
 private:
@@ -72,4 +182,27 @@ private:
 
 	TSharedRef<FOctree> Octree = MakeVoxelShared<FOctree>();
 	TVoxelAddOnlyMap<FIntVector, TSharedPtr<FChunk>> Chunks;
+
+private:
+	// Chunks are never written to once added, strokes only need to keep the chunks they replaced
+	struct FStroke
+	{
+		struct FChunkHistory
+		{
+			// Null if the chunk didn't exist
+			TSharedPtr<FChunk> Before;
+			TSharedPtr<FChunk> After;
+		};
+		TVoxelMap<FIntVector, FChunkHistory> KeyToChunkHistory;
+
+		int64 GetAllocatedSize() const;
+	};
+
+	TSharedPtr<FStroke> Stroke_RequiresLock;
+	TVoxelArray<TSharedPtr<FStroke>> UndoStack_RequiresLock;
+	TVoxelArray<TSharedPtr<FStroke>> RedoStack_RequiresLock;
+
+	void EndStroke_RequiresLock();
+	void TrimHistory_RequiresLock();
+	FVoxelIntBox ApplyStroke_RequiresLock(const FStroke& Stroke, bool bUndo);
 };
\ No newline at end of file
@@ -39,6 +39,12 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Voxel")
 	bool bCreateRuntimeOnBeginPlay = true;
 
+	// If true, ApplySculpt must be called on the server and is sent to all the clients as a small command
+	// Late joiners receive a compressed snapshot of the sculpt data. Undo/Redo are not supported
+	// The actor is made replicated & always relevant
+	UPROPERTY(EditAnywhere, Category = "Voxel")
+	bool bReplicateSculpt = false;
+
 #if WITH_EDITOR
 	bool bCreateRuntimeOnConstruction_EditorOnly = true;
 #endif
@@ -10,6 +10,10 @@ struct FStreamableHandle;
 class FVoxelWorldChannel;
 class FVoxelChannelManager;
 
+DECLARE_VOXEL_FRAME_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelNumBrushLookups, "Num Brush Lookups");
+DECLARE_VOXEL_FRAME_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelNumBrushesVisited, "Num Brushes Visited");
+DECLARE_VOXEL_FRAME_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelBrushLookupTime, "Brush Lookup Time (us)");
+
 USTRUCT(BlueprintType, DisplayName = "Voxel Channel")
 struct VOXELGRAPHCORE_API FVoxelChannelName
 {
@@ -194,11 +198,22 @@ public:
 
 	VOXEL_COUNT_INSTANCES();
 
+	// Sorted by decreasing priority
+	using FBrushList = TVoxelArray<TSharedRef<const FVoxelBrush>>;
+
 	TSharedPtr<const FVoxelBrush> GetNextBrush(
 		const FVoxelQuery& Query,
 		const FVoxelBox& Bounds,
 		FVoxelBrushPriority Priority) const;
 
+	// All the brushes intersecting Bounds, OutFirstBrushIndex being the first one with a priority below Priority
+	// Cheaper than calling GetNextBrush repeatedly when walking down the brush stack
+	TSharedRef<const FBrushList> GetBrushes(
+		const FVoxelQuery& Query,
+		const FVoxelBox& Bounds,
+		FVoxelBrushPriority Priority,
+		int32& OutFirstBrushIndex) const;
+
 	FVoxelFutureValue Get(const FVoxelQuery& Query) const;
 
 	template<typename T>
@@ -231,6 +246,15 @@ private:
 		const FVoxelBrushPriority Priority;
 		TOptional<FVoxelBox> RuntimeBounds_RequiresLock;
 
+		// Cells this brush is registered in, if any
+		// Set by RemoveBrush: transform changes racing with the removal must not add the brush back
+		bool bRemoved_RequiresLock = false;
+		bool bIsInGrid_RequiresLock = false;
+		bool bIsLarge_RequiresLock = false;
+		FIntVector GridMin_RequiresLock = FIntVector(ForceInit);
+		FIntVector GridMax_RequiresLock = FIntVector(ForceInit);
+		uint64 LastVisitSerial_RequiresLock = 0;
+
 		FRuntimeBrush(
 			const TSharedRef<const FVoxelBrush>& Brush,
 			const FVoxelTransformRef& BrushToRuntime)
@@ -242,6 +266,27 @@ private:
 	};
 	TVoxelMap<FVoxelBrushId, TSharedPtr<FRuntimeBrush>> RuntimeBrushes_RequiresLock;
 
+	// Sparse grid over brush runtime bounds, so that lookups only visit nearby brushes
+	// Brushes spanning too many cells (or infinite ones) are stored in LargeBrushes_RequiresLock
+	const double GridCellSize;
+	TVoxelMap<FIntVector, TVoxelArray<FRuntimeBrush*>> GridCells_RequiresLock;
+	TVoxelArray<FRuntimeBrush*> LargeBrushes_RequiresLock;
+	mutable uint64 VisitSerial_RequiresLock = 0;
+
+	// Reset whenever a brush is added, moved or removed
+	mutable TVoxelMap<FVoxelBox, TSharedPtr<const FBrushList>> BrushListCache_RequiresLock;
+
+	static bool GetGridBounds(
+		const FVoxelBox& Bounds,
+		double CellSize,
+		int64 MaxNumCells,
+		FIntVector& OutMin,
+		FIntVector& OutMax);
+
+	TSharedRef<const FBrushList> GetBrushList_RequiresLock(const FVoxelBox& Bounds) const;
+	void AddToGrid_RequiresLock(FRuntimeBrush& RuntimeBrush);
+	void RemoveFromGrid_RequiresLock(FRuntimeBrush& RuntimeBrush);
+
 	FVoxelRuntimeChannel(
 		const TSharedRef<FVoxelWorldChannel>& WorldChannel,
 		const FVoxelTransformRef& RuntimeLocalToWorld);
@@ -12,10 +12,16 @@ DECLARE_UNIQUE_VOXEL_ID_EXPORT(VOXELGRAPHCORE_API, FVoxelChunkId);
 
 extern VOXELGRAPHCORE_API int32 GVoxelChunkSpawnerMaxChunks;
 extern VOXELGRAPHCORE_API float GVoxelChunkSpawnerCameraRefreshThreshold;
+extern VOXELGRAPHCORE_API float GVoxelChunkSpawnerPredictionPriorityOffset;
+
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelChunkSpawnerPredictedChunks, "Predicted Chunks");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelChunkSpawnerPredictionHits, "Predicted Chunks Ready When Visible");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelChunkSpawnerMissingChunks, "Chunks Missing When Visible");
 
 enum class EVoxelChunkAction
 {
 	Compute,
+	Promote,
 	SetTransitionMask,
 	BeginDestroy,
 	Destroy
@@ -26,6 +32,8 @@ struct FVoxelChunkAction
 	FVoxelChunkId ChunkId;
 
 	uint8 TransitionMask = 0;
+	// Compute only: the chunk isn't visible yet, compute it at a lower priority and don't show it until Promote
+	bool bPredicted = false;
 	TSharedPtr<const TVoxelUniqueFunction<void()>> OnComputeComplete;
 
 	FVoxelChunkAction() = default;
@@ -47,6 +55,7 @@ struct FVoxelChunkActionQueue
 		{
 		default: ensure(false);
 		case EVoxelChunkAction::Compute:
+		case EVoxelChunkAction::Promote:
 		case EVoxelChunkAction::BeginDestroy:
 		{
 			AsyncQueue.Enqueue(Action);
@@ -90,6 +99,24 @@ struct VOXELGRAPHCORE_API FVoxelChunkRef
 		}
 		Queue->Enqueue(Action);
 	}
+	// Computes a chunk the spawner expects to become visible soon
+	// Wrong predictions are cancelled by releasing the chunk ref, nothing was rendered yet
+	void Prefetch() const
+	{
+		FVoxelChunkAction Action(EVoxelChunkAction::Compute, ChunkId);
+		Action.bPredicted = true;
+		Queue->Enqueue(Action);
+	}
+	// Shows a prefetched chunk, bumping its priority if it isn't computed yet
+	void Promote(TVoxelUniqueFunction<void()>&& OnComputeComplete = nullptr) const
+	{
+		FVoxelChunkAction Action(EVoxelChunkAction::Promote, ChunkId);
+		if (OnComputeComplete)
+		{
+			Action.OnComputeComplete = MakeSharedCopy(MoveTemp(OnComputeComplete));
+		}
+		Queue->Enqueue(Action);
+	}
 	void SetTransitionMask(uint8 TransitionMask) const
 	{
 		FVoxelChunkAction Action(EVoxelChunkAction::SetTransitionMask, ChunkId);
@@ -98,6 +125,22 @@ struct VOXELGRAPHCORE_API FVoxelChunkRef
 	}
 };
 
+// Smoothed velocity of an invoker or a view, used to prefetch the chunks it is moving towards
+struct VOXELGRAPHCORE_API FVoxelChunkSpawnerVelocity
+{
+	FVector Position = FVector(ForceInit);
+	FVector Velocity = FVector(ForceInit);
+	double Time = 0.;
+
+	// Teleports reset the velocity, see voxel.chunkspawner.PredictionMaxSpeed
+	void Update(const FVector& NewPosition, double NewTime);
+
+	FORCEINLINE FVector Predict(const float PredictionTime) const
+	{
+		return Position + Velocity * PredictionTime;
+	}
+};
+
 USTRUCT()
 struct VOXELGRAPHCORE_API FVoxelChunkSpawner
 	: public FVoxelVirtualStruct
@@ -8,6 +8,9 @@ class FVoxelDependency;
 class FVoxelDependencyTracker;
 
 DECLARE_VOXEL_MEMORY_STAT(VOXELGRAPHCORE_API, STAT_VoxelDependencies, "Dependencies");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelDependencyInvalidations, "Dependency Invalidations");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelDependencyTrackersTested, "Dependency Trackers Tested");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelDependencyTrackersInvalidated, "Dependency Trackers Invalidated");
 
 class VOXELGRAPHCORE_API FVoxelDependencyInvalidationScope
 {
@@ -40,10 +43,7 @@ public:
 
 	VOXEL_ALLOCATED_SIZE_TRACKER(STAT_VoxelDependencies);
 
-	int64 GetAllocatedSize() const
-	{
-		return TrackerRefs_RequiresLock.GetAllocatedSize();
-	}
+	int64 GetAllocatedSize() const;
 
 	struct FInvalidationParameters
 	{
@@ -64,9 +64,26 @@ private:
 
 		bool bHasTag = false;
 		uint64 Tag = 0;
+
+		// Position in the spatial index
+		int32 Level = -1;
+		FIntVector Cell = FIntVector(ForceInit);
+		int32 IndexInCell = -1;
 	};
 	TVoxelChunkedSparseArray<FTrackerRef> TrackerRefs_RequiresLock;
 
+	// Loose grid of trackers: a tracker is stored at the level where its bounds are smaller than a cell,
+	// in the cell containing its min corner. Trackers without bounds are stored in UnboundedTrackers_RequiresLock
+	static constexpr int32 NumLevels = 32;
+	static constexpr double BaseCellSize = 256.;
+
+	TVoxelArray<int32> UnboundedTrackers_RequiresLock;
+	TVoxelStaticArray<TVoxelIntVectorMap<TVoxelArray<int32>>, NumLevels> LevelToCells_RequiresLock;
+
+	int32 AddTrackerRef_RequiresLock(const FTrackerRef& TrackerRef);
+	void RemoveTrackerRef_RequiresLock(int32 Index);
+	TVoxelArray<int32>& GetCell_RequiresLock(const FTrackerRef& TrackerRef);
+
 	FVoxelDependency(
 		const FName ClassName,
 		const FName InstanceName);
@@ -92,6 +109,18 @@ public:
 	{
 		return bIsInvalidated.Load();
 	}
+
+	// Set when something was computed from placeholder or coarser data that is still streaming in
+	// The tracker is invalidated once the data is in, until then results shouldn't be persisted
+	FORCEINLINE bool IsApproximate() const
+	{
+		return bIsApproximate.Load();
+	}
+	FORCEINLINE void MarkApproximate()
+	{
+		bIsApproximate.Store(true);
+	}
+
 	void AddDependency(
 		const TSharedRef<FVoxelDependency>& Dependency,
 		const TOptional<FVoxelBox>& Bounds = {},
@@ -116,6 +145,7 @@ private:
 
 	FVoxelFastCriticalSection CriticalSection;
 	TVoxelAtomic<bool> bIsInvalidated;
+	TVoxelAtomic<bool> bIsApproximate;
 	TVoxelUniqueFunction<void()> OnInvalidated;
 	TVoxelChunkedArray<FDependencyRef> DependencyRefs;
 	TVoxelArray<FSharedVoidPtr> ObjectsToKeepAlive;
@@ -212,6 +212,8 @@ struct FVoxelNormalDetailTextureRefPinType : public FVoxelObjectPinType
 ///////////////////////////////////////////////////////////////////////////////
 
 DECLARE_VOXEL_MEMORY_STAT(VOXELGRAPHCORE_API, STAT_VoxelDetailTextureMemory, "Voxel Detail Texture Memory (GPU)");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelDetailTextureEvictions, "Detail Texture Evictions");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHCORE_API, STAT_VoxelDetailTextureRelocations, "Detail Texture Relocations");
 
 struct FVoxelDetailTextureAllocationRange
 {
@@ -253,6 +255,12 @@ public:
 
 	TSharedRef<FVoxelDetailTextureAllocation> Allocate_AnyThread(int32 Num);
 	void Update_GameThread();
+	// If allocations were refused because of the budget, evicts the least recently rendered allocations
+	// and asks the refused chunks to allocate again
+	// Then shrinks the atlas when it's mostly empty by asking the chunks in the upper half to reallocate
+	void Compact_GameThread();
+
+	int64 GetMemorySize(int32 SizeInBlocks) const;
 
 private:
 	TArray<UTexture2D*> Textures_GameThread;
@@ -264,7 +272,19 @@ private:
 	FVoxelFastCriticalSection CriticalSection;
 
 	int32 SizeInBlocks_RequiresLock = 0;
+	// Free ranges are only handed out below this. Lower than SizeInBlocks_RequiresLock while compacting
+	int32 UsableSizeInBlocks_RequiresLock = 0;
+	int32 NumAllocatedBlocks_RequiresLock = 0;
+	bool bLoggedBudgetWarning_RequiresLock = false;
 	TVoxelArray<FVoxelDetailTextureAllocationRange> FreeRanges_RequiresLock;
+	TVoxelSet<FVoxelDetailTextureAllocation*> Allocations_RequiresLock;
+
+	void Resize_RequiresLock(int32 NewSizeInBlocks);
+	bool CanGrow_RequiresLock() const;
+	int32 AddFreeRange_RequiresLock(const FVoxelDetailTextureAllocationRange& Range);
+	void RebuildFreeRanges_RequiresLock();
+	void EvictForRefusedAllocations_RequiresLock();
+	void Evict_RequiresLock(FVoxelDetailTextureAllocation& Allocation);
 
 	FORCEINLINE void CheckRange(const FVoxelDetailTextureAllocationRange& Range) const
 	{
@@ -294,15 +314,39 @@ public:
 
 	TSharedRef<FVoxelDetailTextureDynamicMaterialParameter> GetTexture() const;
 
+	// True if the atlas was full and couldn't grow without going over voxel.DetailTextureBudget
+	// The allocation has no blocks, and the chunk is recomputed once off-screen allocations are evicted
+	FORCEINLINE bool IsOutOfSpace() const
+	{
+		return bIsOutOfSpace;
+	}
+
+	// Called whenever a mesh using this allocation is visible, the least recently used allocations are evicted first
+	FORCEINLINE void MarkUsed_AnyThread() const
+	{
+		LastUsedFrame.Store(GFrameCounterRenderThread);
+	}
+
 private:
 	const TWeakPtr<FVoxelDetailTextureAllocator> WeakAllocator;
+	// Invalidated when this allocation is evicted, needs to be relocated or can be retried after being out of space
+	const TSharedRef<FVoxelDependency> Dependency;
+	mutable TVoxelAtomic<uint64> LastUsedFrame;
+	// Set by Allocate_AnyThread before the allocation is returned, never changed afterwards
+	bool bIsOutOfSpace = false;
 	TVoxelArray<FVoxelDetailTextureAllocationRange> Ranges;
 
+	// Our ranges were given back to the allocator and our chunk invalidated
+	bool bIsEvicted_RequiresLock = false;
+	bool bRelocationRequested_RequiresLock = false;
+	bool bRetryRequested_RequiresLock = false;
+
 	FVoxelDetailTextureAllocation(FVoxelDetailTextureAllocator& Allocator, int32 Num);
 
 	friend class FVoxelDetailTextureUpload;
 	friend class FVoxelDetailTextureManager;
 	friend class FVoxelDetailTextureAllocator;
+	friend class FVoxelDetailTexturePool;
 };
 
 struct FVoxelDetailTextureCoordinate
@@ -340,9 +384,6 @@ private:
 
 	TFunction<void()> OnUploadComplete;
 
-	void BeginUpload_GameThread();
-	void Upload_RenderThread(const FTextureResource& Resource);
-
 	friend class FVoxelDetailTextureManager;
 };
 
@@ -369,6 +410,7 @@ public:
 
 	void UpdateTextureSize_GameThread();
 	void UpdatePixelFormat_GameThread();
+	void Compact_GameThread();
 	int32 GetTextureSize_AnyThread(int32 LOD, const FVoxelQuery& Query);
 
 private:
@@ -401,6 +443,33 @@ private:
 	TMap<UVoxelDetailTexture*, TSharedPtr<FVoxelDetailTexturePool>> TextureToPool;
 	TQueue<TSharedPtr<FVoxelDetailTextureUpload>, EQueueMode::Mpsc> PendingUploads;
 	TQueue<TWeakPtr<FVoxelDetailTextureAllocator>, EQueueMode::Mpsc> AllocatorsToUpdate;
+	TQueue<TWeakPtr<FVoxelDependency>, EQueueMode::Mpsc> DependenciesToInvalidate;
+
+	// Sum of the texture memory of all the allocators, checked against voxel.DetailTextureBudget
+	FThreadSafeCounter64 AllocatedMemory;
+
+	struct FUploadCopy
+	{
+		int32 UploadIndex = 0;
+		// Offset in blocks in the upload data
+		int32 SourceOffset = 0;
+		FIntPoint StagingPosition = FIntPoint(ForceInit);
+		FVoxelDetailTextureAllocationRange Range{};
+	};
+	struct FUploadBatch
+	{
+		const FTextureResource* Resource = nullptr;
+		int32 TextureSize = 0;
+		int32 BytesPerPixel = 0;
+		EPixelFormat PixelFormat = {};
+		FIntPoint StagingSizeInBlocks = FIntPoint(ForceInit);
+		int32 StagingCursorX = 0;
+		TVoxelArray<TSharedPtr<FVoxelDetailTextureUpload>> Uploads;
+		TVoxelArray<FUploadCopy> Copies;
+	};
+
+	void FlushUploads_GameThread();
+	static void Upload_RenderThread(FRHICommandListImmediate& RHICmdList, const FUploadBatch& Batch);
 
 	friend FVoxelDetailTextureUpload;
 	friend FVoxelDetailTextureAllocator;
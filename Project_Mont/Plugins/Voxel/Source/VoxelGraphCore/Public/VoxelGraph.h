@@ -147,6 +147,10 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Config")
 	bool bEnableThumbnail = false;
 
+	// If true, chains of ISPC nodes will be run as a single task, without allocating buffers for intermediate results
+	UPROPERTY(EditAnywhere, Category = "Config", AdvancedDisplay)
+	bool bFuseISPCNodes = false;
+
 	UPROPERTY(EditAnywhere, Category = "Config")
 	FString Tooltip;
 
@@ -36,6 +36,18 @@ public:
 	static void RemoveUnusedNodes(FGraph& Graph);
 	static void CheckForLoops(FGraph& Graph);
 
+public:
+	// Runs the passes below until none of them changes the graph, then logs how many nodes each pass removed
+	// Requires a root node, see voxel.graph.Optimize
+	static void Optimize(FGraph& Graph, const FString& DebugName);
+
+	// Runs ISPC nodes with only constant inputs and replaces their outputs by default values
+	static bool FoldConstants(FGraph& Graph);
+	// Bypasses nodes whose output is always one of their inputs, eg Select with a constant index
+	static bool PruneConstantBranches(FGraph& Graph);
+	// Merges pure nodes of the same type with the same inputs
+	static bool RemoveDuplicateNodes(FGraph& Graph);
+
 private:
 	static bool ReplaceTemplatesImpl(FGraph& Graph);
 	static void InitializeTemplatesPassthroughNodes(FGraph& Graph, FNode& Node);
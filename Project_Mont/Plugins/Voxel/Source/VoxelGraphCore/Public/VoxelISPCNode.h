@@ -35,6 +35,20 @@ public:
 	virtual FVoxelComputeValue CompileCompute(FName PinName) const override;
 	//~ End FVoxelNode Interface
 
+public:
+	// True if this node has a single buffer output that can be computed in another node task
+	bool CanBeFused() const;
+	// NodeToFuse will be computed in our task, one buffer chunk at a time, without allocating its output buffer
+	// NodeToFuse output must only be used by InputPinName
+	void FuseInput(FName InputPinName, const FVoxelISPCNode& NodeToFuse);
+	// Call once all inputs are fused, only on nodes that are not fused themselves
+	void CompileFusedKernel();
+	// Runs the node on uniform inputs, without a query or a node runtime. Used to fold constants at compile time
+	// Inputs & outputs are in pin order. Returns false if the node has no ISPC function
+	bool ComputeConstants(
+		TConstVoxelArrayView<FVoxelRuntimePinValue> InputValues,
+		TVoxelArray<FVoxelRuntimePinValue>& OutOutputValues) const;
+
 private:
 	struct FCachedPin
 	{
@@ -46,4 +60,47 @@ private:
 
 	FVoxelNodeISPCPtr CachedPtr = nullptr;
 	TVoxelArray<FCachedPin> CachedPins;
+
+	struct FKernel
+	{
+		struct FInput
+		{
+			const FVoxelISPCNode* Node = nullptr;
+			FName PinName;
+			FVoxelPinType PinType;
+		};
+		enum class EBufferType : uint8
+		{
+			Input,
+			Scratch,
+			Output
+		};
+		struct FBufferRef
+		{
+			EBufferType Type = {};
+			int32 Index = 0;
+		};
+		struct FStep
+		{
+			FVoxelNodeISPCPtr Ptr = nullptr;
+			// One per pin
+			TVoxelArray<FBufferRef> Buffers;
+		};
+
+		TVoxelArray<FInput> Inputs;
+		// Executed in order, last step is this node
+		TVoxelArray<FStep> Steps;
+		// Byte offset of each terminal buffer of each scratch buffer, for a single buffer chunk
+		TVoxelArray<TVoxelArray<int32>> ScratchOffsets;
+		int32 ScratchSize = 0;
+		int32 MaxNumTerminalBuffers = 0;
+	};
+	TVoxelMap<FName, const FVoxelISPCNode*> FusedInputs;
+	TSharedPtr<const FKernel> Kernel;
+
+	static void AddKernelStep(
+		FKernel& Kernel,
+		const FVoxelISPCNode& Node,
+		bool bIsRoot,
+		int32& OutScratchIndex);
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "VoxelMinimal.h"
 #include "VoxelTransformRef.h"
+#include "VoxelChunkSpawner.h"
 #include "VoxelInvoker.generated.h"
 
 class UVoxelInvokerComponent;
@@ -15,16 +16,23 @@ public:
 	const int32 ChunkSize;
 	const int32 Offset;
 	const FVoxelTransformRef LocalToWorld;
+	// If positive, invokers are extrapolated from their velocity to where they will be in PredictionTime seconds
+	// The path in-between is covered too, using up to MaxPredictionSamples invokers
+	const float PredictionTime;
+
+	static constexpr int32 MaxPredictionSamples = 4;
 
 	FVoxelInvokerView(
 		const FName Channel,
 		const int32 ChunkSize,
 		const int32 Offset,
-		const FVoxelTransformRef& LocalToWorld)
+		const FVoxelTransformRef& LocalToWorld,
+		const float PredictionTime = 0.f)
 		: Channel(Channel)
 		, ChunkSize(ChunkSize)
 		, Offset(Offset)
 		, LocalToWorld(LocalToWorld)
+		, PredictionTime(PredictionTime)
 	{
 		ensure(ChunkSize > 0);
 	}
@@ -48,19 +56,90 @@ public:
 		const UWorld* World,
 		const TVoxelSet<UVoxelInvokerComponent*>& InvokerComponents);
 
+	struct FBenchmarkResult
+	{
+		double Time = 0.;
+		int64 NumChunks = 0;
+	};
+	// Moves NumInvokers invokers around for NumTicks ticks and logs the chunk throughput
+	// Invokers are placed using Seed, so results are comparable across runs
+	static FBenchmarkResult Benchmark(
+		int32 NumInvokers,
+		float Radius,
+		int32 NumTicks,
+		int32 Seed = 0);
+
 private:
 	bool bTaskInProgress = false;
 	FVoxelFastCriticalSection CriticalSection;
-	TVoxelAddOnlySet<FIntVector> Chunks_RequiresLock;
+	// Number of invokers overlapping each chunk
+	TVoxelIntVectorMap<int32> ChunkToNumInvokers_RequiresLock;
 	FOnChangedMulticast OnAddChunkMulticast_RequiresLock;
 	FOnChangedMulticast OnRemoveChunkMulticast_RequiresLock;
 
+	// Used to match invokers across ticks
+	struct FInvokerKey
+	{
+		// Invoker component, null for the camera
+		const void* Source = nullptr;
+		// Index along the predicted path
+		int32 Sample = 0;
+
+		FORCEINLINE bool operator==(const FInvokerKey& Other) const
+		{
+			return
+				Source == Other.Source &&
+				Sample == Other.Sample;
+		}
+		FORCEINLINE friend uint32 GetTypeHash(const FInvokerKey& Key)
+		{
+			return FVoxelUtilities::MurmurHashMulti(
+				GetTypeHash(Key.Source),
+				GetTypeHash(Key.Sample));
+		}
+	};
 	struct FInvoker
 	{
+		FInvokerKey Key;
 		FVector Center = FVector(ForceInit);
 		float Radius = 0.f;
 	};
-	void Tick_Async(TVoxelArray<FInvoker> Invokers);
+	struct FChunkedInvoker
+	{
+		FVector Center = FVector(ForceInit);
+		double RadiusInChunks = 0.;
+
+		FORCEINLINE bool operator==(const FChunkedInvoker& Other) const
+		{
+			return
+				Center == Other.Center &&
+				RadiusInChunks == Other.RadiusInChunks;
+		}
+
+		FIntVector GetMin() const;
+		FIntVector GetMax() const;
+		// Returns false if no chunk in this column is in range
+		bool GetColumn(int32 X, int32 Y, int32& OutMinZ, int32& OutMaxZ) const;
+	};
+	// Only accessed by Tick_Async, which never runs concurrently with itself
+	TVoxelMap<FInvokerKey, FChunkedInvoker> KeyToChunkedInvoker;
+	// Only accessed by Tick
+	TVoxelMap<const void*, FVoxelChunkSpawnerVelocity> SourceToVelocity_GameThread;
+
+	// Replaces each invoker by samples along its predicted path
+	void PredictInvokers(TVoxelArray<FInvoker>& Invokers);
+
+	TVoxelAddOnlySet<FIntVector> GetChunks_RequiresLock() const;
+
+	// Only visits chunks that are in Old or in New but not in both
+	template<typename LambdaType>
+	static void DiffInvoker(
+		const FChunkedInvoker* Old,
+		const FChunkedInvoker* New,
+		LambdaType&& Lambda);
+
+	// Returns the number of chunks added or removed
+	int64 Tick_Async(const TVoxelArray<FInvoker>& Invokers);
 };
 
 class VOXELGRAPHCORE_API FVoxelInvokerManager : public IVoxelWorldSubsystem
@@ -74,7 +153,8 @@ public:
 		FName Channel,
 		int32 ChunkSize,
 		int32 Offset,
-		const FVoxelTransformRef& LocalToWorld);
+		const FVoxelTransformRef& LocalToWorld,
+		float PredictionTime = 0.f);
 
 	//~ Begin IVoxelWorldSubsystem Interface
 	virtual void Tick() override;
@@ -91,6 +171,7 @@ private:
 		int32 ChunkSize = 0;
 		int32 Offset = 0;
 		FVoxelTransformRef LocalToWorld;
+		float PredictionTime = 0.f;
 
 		FORCEINLINE bool operator==(const FViewKey& Other) const
 		{
@@ -98,7 +179,8 @@ private:
 				Channel == Other.Channel &&
 				ChunkSize == Other.ChunkSize &&
 				Offset == Other.Offset &&
-				LocalToWorld == Other.LocalToWorld;
+				LocalToWorld == Other.LocalToWorld &&
+				PredictionTime == Other.PredictionTime;
 		}
 		FORCEINLINE friend uint32 GetTypeHash(const FViewKey & Key)
 		{
@@ -106,7 +188,8 @@ private:
 				GetTypeHash(Key.Channel) ^
 				GetTypeHash(Key.ChunkSize) ^
 				GetTypeHash(Key.Offset) ^
-				GetTypeHash(Key.LocalToWorld);
+				GetTypeHash(Key.LocalToWorld) ^
+				GetTypeHash(Key.PredictionTime);
 		}
 	};
 	FVoxelFastCriticalSection CriticalSection;
@@ -538,6 +538,16 @@ public:
 	virtual uint32 GetNodeHash() const;
 	virtual bool IsNodeIdentical(const FVoxelNode& Other) const;
 
+	// Used by the compiler to remove unreachable branches
+	// ConstantInputs are the default values of the input pins that are not linked
+	// Returns the input pin that OutputPinName will always be equal to, if any
+	virtual FName GetConstantPassthroughPin(
+		FName OutputPinName,
+		const TVoxelMap<FName, FVoxelPinValue>& ConstantInputs) const
+	{
+		return {};
+	}
+
 public:
 	virtual void PreSerialize() override;
 	virtual void PostSerialize() override;
@@ -0,0 +1,95 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "VoxelMinimal.h"
+#include "VoxelGraphNodeRef.h"
+
+class FVoxelNodeProfiler;
+
+extern VOXELGRAPHCORE_API bool GVoxelEnableNodeProfiler;
+
+// Per node & per graph timings, available in all builds unlike the editor node stats
+// See voxel.profiler.Start/Stop/Dump/Compare
+struct VOXELGRAPHCORE_API FVoxelNodeProfilerReport
+{
+	struct FEntry
+	{
+		FString Graph;
+		// Empty for graph totals
+		FString Node;
+		int64 NumCalls = 0;
+		int64 NumElements = 0;
+		int64 NumBytes = 0;
+		double Time = 0.;
+
+		FORCEINLINE bool IsGraphTotal() const
+		{
+			return Node.IsEmpty();
+		}
+		// Time per element if elements are known, time per call otherwise
+		double GetNormalizedTime() const;
+	};
+
+	// Wall time the profiler was recording for
+	double Duration = 0.;
+	// Sorted by time, slowest first
+	TArray<FEntry> Entries;
+
+	void Log(int32 MaxEntries) const;
+
+	// Format is picked from the extension, .json or .csv
+	bool Save(const FString& Path) const;
+	static TOptional<FVoxelNodeProfilerReport> Load(const FString& Path);
+
+	// Logs all the entries whose normalized time increased by more than Threshold (0.1 = 10%)
+	// Entries taking less than MinTime seconds in both reports are ignored
+	// Returns the number of regressions
+	static int32 Compare(
+		const FVoxelNodeProfilerReport& Old,
+		const FVoxelNodeProfilerReport& New,
+		float Threshold,
+		double MinTime);
+};
+
+extern VOXELGRAPHCORE_API FVoxelNodeProfiler* GVoxelNodeProfiler;
+
+class VOXELGRAPHCORE_API FVoxelNodeProfiler : public FVoxelSingleton
+{
+public:
+	// Thread safe
+	void Record(
+		const FVoxelGraphNodeRef& NodeRef,
+		double Duration,
+		int64 NumElements,
+		int64 NumBytes);
+
+	void Reset();
+	FVoxelNodeProfilerReport MakeReport();
+
+	//~ Begin FVoxelSingleton Interface
+	virtual void Tick() override;
+	//~ End FVoxelSingleton Interface
+
+private:
+	struct FQueuedStat
+	{
+		FVoxelGraphNodeRef NodeRef;
+		double Duration = 0.;
+		int64 NumElements = 0;
+		int64 NumBytes = 0;
+	};
+	TQueue<FQueuedStat, EQueueMode::Mpsc> Queue;
+
+	struct FStats
+	{
+		int64 NumCalls = 0;
+		int64 NumElements = 0;
+		int64 NumBytes = 0;
+		double Time = 0.;
+	};
+	TVoxelMap<FVoxelGraphNodeRef, FStats> NodeToStats;
+	double StartTime = FPlatformTime::Seconds();
+
+	void Flush();
+};
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "VoxelMinimal.h"
+#include "VoxelNodeProfiler.h"
 
 struct IVoxelNodeInterface;
 
@@ -21,13 +22,13 @@ struct IVoxelNodeStatProvider
 extern VOXELGRAPHCORE_API TArray<IVoxelNodeStatProvider*> GVoxelNodeStatProviders;
 #endif
 
+// Records stats for the editor node stats and for the runtime node profiler, see voxel.profiler.Start
 class VOXELGRAPHCORE_API FVoxelNodeStatScope
 {
 public:
 	FORCEINLINE FVoxelNodeStatScope(const IVoxelNodeInterface& InNode, const int64 InCount)
 	{
-#if WITH_EDITOR
-		if (!GVoxelEnableNodeStats)
+		if (!ShouldRecordStats())
 		{
 			return;
 		}
@@ -35,39 +36,44 @@ public:
 		Node = &InNode;
 		Count = InCount;
 		StartTime = FPlatformTime::Seconds();
-#endif
 	}
 	FORCEINLINE ~FVoxelNodeStatScope()
 	{
-#if WITH_EDITOR
 		if (IsEnabled())
 		{
 			RecordStats(FPlatformTime::Seconds() - StartTime);
 		}
-#endif
 	}
 
 	FORCEINLINE bool IsEnabled() const
 	{
-#if WITH_EDITOR
 		return Node != nullptr;
-#else
-		return false;
-#endif
 	}
 	FORCEINLINE void SetCount(const int32 NewCount)
 	{
-#if WITH_EDITOR
 		Count = NewCount;
+	}
+	FORCEINLINE void SetNumBytes(const int64 NewNumBytes)
+	{
+		NumBytes = NewNumBytes;
+	}
+
+	FORCEINLINE static bool ShouldRecordStats()
+	{
+#if WITH_EDITOR
+		if (GVoxelEnableNodeStats)
+		{
+			return true;
+		}
 #endif
+		return GVoxelEnableNodeProfiler;
 	}
 
 private:
-#if WITH_EDITOR
 	const IVoxelNodeInterface* Node = nullptr;
 	int64 Count = 0;
+	int64 NumBytes = 0;
 	double StartTime = 0;
 
-	void RecordStats(const double Duration) const;
-#endif
+	void RecordStats(double Duration) const;
 };
\ No newline at end of file
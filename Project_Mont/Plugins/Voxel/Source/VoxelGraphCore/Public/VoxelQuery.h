@@ -188,6 +188,10 @@ public:
 	void Tick();
 	void AddReferencedObjects(FReferenceCollector& Collector);
 
+	// Same runtime seen from another transform, used to evaluate a graph without moving its actor
+	// Subsystems are still owned by this runtime info. Call Destroy once done
+	TSharedRef<FVoxelRuntimeInfo> MakeWithLocalToWorld(const FVoxelTransformRef& NewLocalToWorld) const;
+
 private:
 	explicit FVoxelRuntimeInfo(const FVoxelRuntimeInfoBase& RuntimeInfoBase);
 
@@ -331,6 +335,9 @@ public:
 		return Path.NodeRefs.Num();
 	}
 
+	// Same graph & parameters evaluated with another runtime info, see FVoxelRuntimeInfo::MakeWithLocalToWorld
+	TSharedRef<FVoxelQueryContext> MakeWithRuntimeInfo(const TSharedRef<const FVoxelRuntimeInfo>& NewRuntimeInfo) const;
+
 	TSharedRef<FVoxelQueryContext> EnterScope(const FVoxelGraphNodeRef& Node);
 	TSharedRef<FVoxelQueryContext> GetChildContext(const FVoxelChildQueryContextKey& Key);
 	TSharedRef<FVoxelExecNodeRuntimeWrapper> FindOrAddExecNodeRuntimeWrapper(const TSharedRef<FVoxelExecNode>& Node);
@@ -5,33 +5,49 @@
 #include "VoxelMinimal.h"
 #include "VoxelNode.h"
 
+// Lock-free: entries are stored inline in open addressing tables
+// Tables are never resized in place, a new twice as big table is chained when one is full
+// so that entry references stay valid for the lifetime of the cache
 class VOXELGRAPHCORE_API FVoxelQueryCache
 {
 public:
 	struct FEntry
 	{
-		FVoxelFastCriticalSection CriticalSection;
+		FVoxelFastCriticalSection_NoPadding CriticalSection;
 		FVoxelFutureValue Value;
 	};
 
-	FVoxelQueryCache()
-	{
-		Entries.Reserve(128);
-	}
+	FVoxelQueryCache();
+	~FVoxelQueryCache();
+	UE_NONCOPYABLE(FVoxelQueryCache);
+
+	FEntry& FindOrAddEntry(FVoxelPinRuntimeId PinId);
+
+private:
+	// A key is only looked up in NumProbes consecutive slots of each table
+	static constexpr int32 NumProbes = 16;
+	static constexpr int32 FirstTableSize = 128;
 
-	FEntry& FindOrAddEntry(const FVoxelPinRuntimeId PinId)
+	struct FSlot
 	{
-		VOXEL_SCOPE_LOCK(CriticalSection);
+		// 0 if empty, never reset once set
+		TVoxelAtomic<uint64> PinId;
+		FEntry Entry;
+	};
+	struct FTable
+	{
+		const int32 Size;
+		TVoxelAtomic<FTable*> Next = nullptr;
+		TUniquePtr<FSlot[]> Slots;
 
-		TSharedPtr<FEntry>& Entry = Entries.FindOrAdd(PinId);
-		if (!Entry)
+		explicit FTable(const int32 Size)
+			: Size(Size)
+			, Slots(MakeUnique<FSlot[]>(Size))
 		{
-			Entry = MakeVoxelShared<FEntry>();
+			checkVoxelSlow(FMath::IsPowerOfTwo(Size));
 		}
-		return *Entry;
-	}
+	};
+	FTable FirstTable;
 
-private:
-	FVoxelFastCriticalSection CriticalSection;
-	TVoxelAddOnlyMap<FVoxelPinRuntimeId, TSharedPtr<FEntry>> Entries;
-};
\ No newline at end of file
+	FEntry* FindOrAddEntry(FTable& Table, uint64 PinId, uint64 Hash);
+};
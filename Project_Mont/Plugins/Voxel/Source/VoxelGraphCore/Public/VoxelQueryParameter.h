@@ -97,6 +97,15 @@ struct VOXELGRAPHCORE_API FVoxelMinExactDistanceQueryParameter : public FVoxelQu
 	float MinExactDistance = 0.f;
 };
 
+// Set when the result is stored permanently, eg baked into sculpt data
+// Streamed data must then be loaded synchronously at full resolution instead of being approximated
+USTRUCT()
+struct VOXELGRAPHCORE_API FVoxelPersistentQueryParameter : public FVoxelQueryParameter
+{
+	GENERATED_BODY()
+	GENERATED_VOXEL_QUERY_PARAMETER_BODY()
+};
+
 USTRUCT()
 struct VOXELGRAPHCORE_API FVoxelQueryChannelBoundsQueryParameter : public FVoxelQueryParameter
 {
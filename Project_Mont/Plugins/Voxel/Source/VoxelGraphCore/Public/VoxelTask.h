@@ -29,13 +29,17 @@ public:
 	{
 		return FVoxelTaskPriority();
 	}
+	// DynamicOffset is added to Offset and can be changed while the tasks are queued
 	FORCEINLINE static FVoxelTaskPriority MakeBounds(
 		const FVoxelBox& Bounds,
 		const double Offset,
 		const FObjectKey World,
-		const FVoxelTransformRef& LocalToWorld)
+		const FVoxelTransformRef& LocalToWorld,
+		const TSharedPtr<const TVoxelAtomic<double>>& DynamicOffset = nullptr)
 	{
-		return FVoxelTaskPriority(true, Bounds, Offset, GetPosition(World, LocalToWorld));
+		FVoxelTaskPriority Priority(true, Bounds, Offset, GetPosition(World, LocalToWorld));
+		Priority.DynamicOffset = DynamicOffset;
+		return Priority;
 	}
 
 	FORCEINLINE double GetPriority() const
@@ -46,9 +50,15 @@ public:
 		}
 		checkVoxelSlow(Position.IsValid());
 
+		double FinalOffset = Offset;
+		if (DynamicOffset)
+		{
+			FinalOffset += DynamicOffset->Load();
+		}
+
 		const double DistanceSquared = Bounds.ComputeSquaredDistanceFromBoxToPoint(*Position.Get());
 		// Keep the sign of Offset
-		return DistanceSquared + Offset * FMath::Abs(Offset);
+		return DistanceSquared + FinalOffset * FMath::Abs(FinalOffset);
 	}
 
 private:
@@ -56,6 +66,7 @@ private:
 	FVoxelBox Bounds;
 	double Offset = 0;
 	TSharedPtr<const FVector> Position;
+	TSharedPtr<const TVoxelAtomic<double>> DynamicOffset;
 
 	FORCEINLINE FVoxelTaskPriority(
 		const bool bHasBounds,
@@ -32,6 +32,10 @@ public:
 	}
 	void LogAllTasks();
 	void AddGroup(const TSharedRef<FVoxelTaskGroup>& Group);
+	// Called when Group has new async tasks to process
+	void EnqueueGroup(FVoxelTaskGroup& Group);
+
+	static int32 GetTargetNumThreads();
 
 public:
 	//~ Begin FVoxelSingleton Interface
@@ -139,10 +143,53 @@ private:
 		FThreadSafeCounter NumGroups;
 	};
 
+	// Groups with pending async tasks, bucketed by priority
+	// The owning thread pops from the back of its buckets, other threads steal from the front
+	// Buckets are computed on push, and fixed up on pop & every voxel.threading.PriorityDuration by Rebucket
+	class FWorkQueue
+	{
+	public:
+		static constexpr int32 NumBuckets = 16;
+
+		FORCEINLINE int32 Num() const
+		{
+			return NumGroups.Load(std::memory_order_relaxed);
+		}
+		// NumBuckets if empty
+		FORCEINLINE int32 GetTopBucket() const
+		{
+			return TopBucket.Load(std::memory_order_relaxed);
+		}
+
+		void Push(int32 Bucket, const TWeakPtr<FVoxelTaskGroup>& Group);
+		TWeakPtr<FVoxelTaskGroup> Pop(bool bSteal, int32& OutBucket);
+		// Recomputes the bucket of every group with the latest camera position
+		void Rebucket();
+		void Reset();
+
+		static int32 GetBucket(const FVoxelTaskPriority& Priority);
+
+	private:
+		struct FBucket
+		{
+			int32 Head = 0;
+			TVoxelArray<TWeakPtr<FVoxelTaskGroup>> Groups;
+		};
+
+		FVoxelFastCriticalSection CriticalSection;
+		TVoxelAtomic<int32> NumGroups = 0;
+		TVoxelAtomic<int32> TopBucket = NumBuckets;
+		TVoxelStaticArray<FBucket, NumBuckets> Buckets;
+
+		void UpdateTopBucket_RequiresLock();
+	};
+
 	class FThread : public FRunnable
 	{
 	public:
-		FThread();
+		const int32 ThreadIndex;
+
+		explicit FThread(int32 ThreadIndex);
 		virtual ~FThread() override;
 
 		//~ Begin FRunnable Interface
@@ -154,6 +201,8 @@ private:
 		FRunnableThread* Thread = nullptr;
 	};
 
+	static constexpr int32 MaxThreads = 128;
+
 	TVoxelAtomic<bool> bIsExiting = false;
 	double LastNoTasksTime = 0;
 	bool bWasProcessingTaskLastFrame = false;
@@ -163,7 +212,12 @@ private:
 
 	FTaskGroupArray Groups;
 
+	TVoxelStaticArray<FWorkQueue, MaxThreads> WorkQueues;
+	TVoxelAtomic<int32> NumActiveWorkQueues = 1;
+	TVoxelAtomic<double> LastRebucketTime = 0.;
+	FThreadSafeCounter NextWorkQueue;
+
 	TQueue<TWeakPtr<FVoxelTaskGroup>, EQueueMode::Mpsc> GameGroupsQueue;
 
-	TSharedPtr<FVoxelTaskGroup> GetGroupToProcess(const FThread* Thread);
+	TSharedPtr<FVoxelTaskGroup> GetGroupToProcess(const FThread& Thread);
 };
\ No newline at end of file
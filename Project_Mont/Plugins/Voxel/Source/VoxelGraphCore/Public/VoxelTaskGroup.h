@@ -8,6 +8,46 @@
 
 extern VOXELGRAPHCORE_API const uint32 GVoxelTaskGroupTLS;
 
+DECLARE_VOXEL_MEMORY_STAT(VOXELGRAPHCORE_API, STAT_VoxelTaskGroupArenaMemory, "Task Group Arena Memory");
+DECLARE_VOXEL_COUNTER_WITH_CATEGORY(VOXELGRAPHCORE_API, STATGROUP_VoxelMemory, STAT_VoxelTaskGroupArenaNumAllocations, "Task Group Arena Num Allocations");
+
+// Bump allocator for memory that never escapes the tasks of a single group
+// Nothing is freed before the group is destroyed, at which point all the blocks are freed at once
+class VOXELGRAPHCORE_API FVoxelTaskGroupArena
+{
+public:
+	static constexpr int64 BlockSize = 256 * 1024;
+	static constexpr int32 MaxAlignment = 64;
+
+	FVoxelTaskGroupArena() = default;
+	~FVoxelTaskGroupArena();
+	UE_NONCOPYABLE(FVoxelTaskGroupArena);
+
+	void* Allocate(int64 Size, int32 Alignment);
+
+	// Scratch memory is recycled: a released scratch will be returned by the next AllocateScratch of the same size
+	// Use this for temporaries allocated in a loop, eg for every buffer chunk
+	void* AllocateScratch(int64 Size);
+	void ReleaseScratch(void* Data, int64 Size);
+
+	template<typename T>
+	TVoxelArrayView<T> Allocate(const int32 Num)
+	{
+		checkStatic(std::is_trivially_destructible_v<T>);
+		return TVoxelArrayView<T>(static_cast<T*>(Allocate(Num * sizeof(T), alignof(T))), Num);
+	}
+
+private:
+	FVoxelFastCriticalSection CriticalSection;
+	TVoxelArray<void*> Blocks_RequiresLock;
+	int64 BlocksSize_RequiresLock = 0;
+	uint8* BlockData_RequiresLock = nullptr;
+	int64 BlockOffset_RequiresLock = 0;
+	int64 NumAllocations_RequiresLock = 0;
+	TVoxelMap<int64, TVoxelArray<void*>> SizeToFreeScratches_RequiresLock;
+};
+
+
 class VOXELGRAPHCORE_API FVoxelTaskGroup : public TSharedFromThis<FVoxelTaskGroup>
 {
 public:
@@ -20,6 +60,8 @@ public:
 	const TSharedRef<FVoxelTaskReferencer> Referencer;
 	const TSharedRef<const FVoxelRuntimeInfo> RuntimeInfo;
 	const TSharedRef<const FVoxelQueryContext> Context;
+	// Released when the group is destroyed
+	FVoxelTaskGroupArena Arena;
 
 	VOXEL_COUNT_INSTANCES();
 
@@ -117,11 +159,21 @@ public:
 	void LogTasks() const;
 
 public:
-	TVoxelAtomic<const void*> AsyncProcessor = nullptr;
+	// Number of voxel threads currently processing this group's async tasks
+	TVoxelAtomic<int32> NumAsyncProcessors = 0;
+	// True if this group is in one of the executor work queues
+	TVoxelAtomic<bool> bIsQueued = false;
+	// Low 32 bits: number of FVoxelTaskGroupScope currently holding a ref to this group
+	// High 32 bits: bumped on every scope change, so that ShouldExit can detect concurrent changes
+	FThreadSafeCounter64 ScopeState;
 
 	FORCEINLINE bool HasGameTasks() const { return !GameTasks.IsEmpty(); }
 	FORCEINLINE bool HasRenderTasks() const { return !RenderTasks.IsEmpty(); }
 	FORCEINLINE bool HasAsyncTasks() const { return !AsyncTasks.IsEmpty(); }
+	FORCEINLINE int32 NumAsyncTasks() const { return NumQueuedAsyncTasks.GetValue(); }
+
+	bool TryAddAsyncProcessor(int32 MaxProcessors);
+	void RemoveAsyncProcessor();
 
 	void ProcessGameTasks();
 	void ProcessRenderTasks(FRDGBuilder& GraphBuilder);
@@ -138,7 +190,18 @@ public:
 		{
 			return false;
 		}
-		return IsSharedFromThisUnique(this);
+
+		const int64 State = ScopeState.GetValue();
+		const int32 ReferenceCount = GetSharedFromThisReferenceCount(this);
+		if (ScopeState.GetValue() != State)
+		{
+			// A scope was entered or exited while reading the reference count, check again on the next task
+			return false;
+		}
+
+		// Every thread processing this group holds a ref through its scope, with several async processors
+		// the group is never unique: exit once the owner released it and only the scopes are left
+		return ReferenceCount <= int32(State & MAX_uint32);
 	}
 	FORCEINLINE static FVoxelTaskGroup& Get()
 	{
@@ -157,6 +220,10 @@ private:
 	TQueue<TVoxelUniquePtr<FVoxelTask>, EQueueMode::Mpsc> RenderTasks;
 	TQueue<TVoxelUniquePtr<FVoxelTask>, EQueueMode::Mpsc> AsyncTasks;
 
+	// AsyncTasks is single consumer, serialize dequeues when several threads process this group
+	FVoxelFastCriticalSection_NoPadding AsyncTasksCriticalSection;
+	FThreadSafeCounter NumQueuedAsyncTasks;
+
 	mutable FVoxelFastCriticalSection PendingTasksCriticalSection;
 	TVoxelSparseArray<TVoxelUniquePtr<FVoxelTask>, FVoxelPendingTaskId> PendingTasks_RequiresLock;
 
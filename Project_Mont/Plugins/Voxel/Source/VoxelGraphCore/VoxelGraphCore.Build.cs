@@ -15,6 +15,14 @@ public class VoxelGraphCore : ModuleRules_Voxel
 			}
 		);
 
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Json",
+				"NetCore",
+			}
+		);
+
 		if (Target.bBuildEditor)
 		{
 			PublicDependencyModuleNames.AddRange(
@@ -0,0 +1,541 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#include "VoxelBenchmarkCommandlet.h"
+#include "VoxelGraph.h"
+#include "VoxelInvoker.h"
+#include "VoxelTaskGroup.h"
+#include "VoxelDependency.h"
+#include "VoxelGraphExecutor.h"
+#include "VoxelParameterValues.h"
+#include "VoxelFunctionCallNode.h"
+#include "VoxelPositionQueryParameter.h"
+#include "Buffer/VoxelFloatBuffers.h"
+#include "MarchingCube/VoxelMarchingCubeProcessor.h"
+#include "Collision/VoxelCollisionCooker.h"
+#include "Collision/VoxelTriangleMeshCollider.h"
+#include "HAL/Event.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+UVoxelBenchmarkCommandlet::UVoxelBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	ShowErrorCount = true;
+}
+
+int32 UVoxelBenchmarkCommandlet::Main(const FString& Params)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FSettings Settings;
+	FParse::Value(*Params, TEXT("Seed="), Settings.Seed);
+	FParse::Value(*Params, TEXT("NumChunks="), Settings.NumChunks);
+	FParse::Value(*Params, TEXT("ChunkSize="), Settings.ChunkSize);
+	FParse::Value(*Params, TEXT("VoxelSize="), Settings.VoxelSize);
+	FParse::Value(*Params, TEXT("NumRuns="), Settings.NumRuns);
+	FParse::Value(*Params, TEXT("Output="), Settings.OutputName);
+
+	Settings.NumChunks = FMath::Max(Settings.NumChunks, 1);
+	Settings.ChunkSize = FMath::Clamp(Settings.ChunkSize, 4, 128);
+	Settings.VoxelSize = FMath::Max(Settings.VoxelSize, 1.f);
+	Settings.NumRuns = FMath::Max(Settings.NumRuns, 1);
+
+	FString GraphPaths;
+	FParse::Value(*Params, TEXT("Graphs="), GraphPaths, false);
+
+	TArray<FString> GraphPathArray;
+	GraphPaths.ParseIntoArray(GraphPathArray, TEXT(","));
+
+	TArray<FResult> Results;
+	int32 NumErrors = 0;
+
+	for (const FString& GraphPath : GraphPathArray)
+	{
+		UVoxelGraphInterface* Graph = LoadObject<UVoxelGraphInterface>(nullptr, *GraphPath.TrimStartAndEnd());
+		if (!Graph)
+		{
+			LOG_VOXEL(Error, "Failed to load graph %s", *GraphPath);
+			NumErrors++;
+			continue;
+		}
+
+		const int32 NumResults = Results.Num();
+		BenchmarkGraph(*Graph, Settings, Results);
+
+		if (Results.Num() == NumResults)
+		{
+			NumErrors++;
+		}
+	}
+
+	{
+		int32 NumInvokers = 8;
+		float InvokerRadius = 5000.f;
+		int32 NumInvokerTicks = 100;
+		FParse::Value(*Params, TEXT("NumInvokers="), NumInvokers);
+		FParse::Value(*Params, TEXT("InvokerRadius="), InvokerRadius);
+		FParse::Value(*Params, TEXT("NumInvokerTicks="), NumInvokerTicks);
+
+		FResult Result;
+		Result.Benchmark = "InvokerUpdates";
+		Result.Unit = "Chunks";
+		Result.Time = MAX_dbl;
+
+		for (int32 Run = 0; Run < Settings.NumRuns; Run++)
+		{
+			const FVoxelInvokerView::FBenchmarkResult InvokerResult = FVoxelInvokerView::Benchmark(
+				FMath::Max(NumInvokers, 1),
+				FMath::Max(InvokerRadius, 0.f),
+				FMath::Max(NumInvokerTicks, 1),
+				Settings.Seed);
+
+			Result.NumElements = InvokerResult.NumChunks;
+			Result.Time = FMath::Min(Result.Time, InvokerResult.Time);
+		}
+
+		Results.Add(Result);
+	}
+
+	for (const FResult& Result : Results)
+	{
+		LOG_VOXEL(Display, "%s %s: %lld %s in %s, %s %s/s",
+			Result.Graph.IsEmpty() ? TEXT("[Global]") : *Result.Graph,
+			*Result.Benchmark,
+			Result.NumElements,
+			*Result.Unit,
+			*FVoxelUtilities::ConvertToTimeText(Result.Time, 3).ToString(),
+			*FVoxelUtilities::ConvertToNumberText(Result.GetThroughput()).ToString(),
+			*Result.Unit);
+	}
+
+	FString ReportPath;
+	if (!FParse::Value(*Params, TEXT("Report="), ReportPath))
+	{
+		ReportPath = FPaths::ProfilingDir() / "Voxel" / "Benchmark-" + FDateTime::Now().ToString() + ".json";
+	}
+
+	if (!SaveReport(ReportPath, Settings.Seed, Results))
+	{
+		LOG_VOXEL(Error, "Failed to save benchmark report to %s", *ReportPath);
+		return 1;
+	}
+	LOG_VOXEL(Display, "Benchmark report saved to %s", *FPaths::ConvertRelativePathToFull(ReportPath));
+
+	FString BaselinePath;
+	if (FParse::Value(*Params, TEXT("Baseline="), BaselinePath))
+	{
+		const TOptional<TArray<FResult>> Baseline = LoadReport(BaselinePath);
+		if (!Baseline)
+		{
+			return 1;
+		}
+
+		float Threshold = 0.1f;
+		FParse::Value(*Params, TEXT("Threshold="), Threshold);
+
+		const int32 NumRegressions = Compare(Baseline.GetValue(), Results, FMath::Max(Threshold, 0.f));
+		if (NumRegressions > 0)
+		{
+			LOG_VOXEL(Error, "%d benchmark regressions against %s", NumRegressions, *BaselinePath);
+			return 1;
+		}
+		LOG_VOXEL(Display, "No benchmark regressions against %s", *BaselinePath);
+	}
+
+	return NumErrors > 0 ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool UVoxelBenchmarkCommandlet::SaveReport(
+	const FString& Path,
+	const int32 Seed,
+	const TArray<FResult>& Results)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	TArray<TSharedPtr<FJsonValue>> JsonResults;
+	for (const FResult& Result : Results)
+	{
+		const TSharedRef<FJsonObject> JsonResult = MakeShared<FJsonObject>();
+		JsonResult->SetStringField("Graph", Result.Graph);
+		JsonResult->SetStringField("Benchmark", Result.Benchmark);
+		JsonResult->SetStringField("Unit", Result.Unit);
+		JsonResult->SetNumberField("NumElements", Result.NumElements);
+		JsonResult->SetNumberField("Time", Result.Time);
+		JsonResult->SetNumberField("Throughput", Result.GetThroughput());
+		JsonResults.Add(MakeShared<FJsonValueObject>(JsonResult));
+	}
+
+	const TSharedRef<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+	JsonObject->SetNumberField("Seed", Seed);
+	JsonObject->SetStringField("Platform", FPlatformProperties::IniPlatformName());
+	JsonObject->SetStringField("CPU", FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	JsonObject->SetNumberField("NumCores", FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	JsonObject->SetArrayField("Results", JsonResults);
+
+	FString Text;
+	if (!FJsonSerializer::Serialize(JsonObject, TJsonWriterFactory<>::Create(&Text)))
+	{
+		return false;
+	}
+
+	return FFileHelper::SaveStringToFile(Text, *Path);
+}
+
+TOptional<TArray<UVoxelBenchmarkCommandlet::FResult>> UVoxelBenchmarkCommandlet::LoadReport(const FString& Path)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *Path))
+	{
+		LOG_VOXEL(Error, "Failed to read %s", *Path);
+		return {};
+	}
+
+	TSharedPtr<FJsonObject> JsonObject;
+	if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), JsonObject) ||
+		!JsonObject)
+	{
+		LOG_VOXEL(Error, "Failed to parse %s", *Path);
+		return {};
+	}
+
+	TArray<FResult> Results;
+	for (const TSharedPtr<FJsonValue>& JsonValue : JsonObject->GetArrayField("Results"))
+	{
+		const TSharedPtr<FJsonObject> JsonResult = JsonValue->AsObject();
+		if (!JsonResult)
+		{
+			continue;
+		}
+
+		FResult& Result = Results.Emplace_GetRef();
+		Result.Graph = JsonResult->GetStringField("Graph");
+		Result.Benchmark = JsonResult->GetStringField("Benchmark");
+		Result.Unit = JsonResult->GetStringField("Unit");
+		Result.NumElements = JsonResult->GetNumberField("NumElements");
+		Result.Time = JsonResult->GetNumberField("Time");
+	}
+	return Results;
+}
+
+int32 UVoxelBenchmarkCommandlet::Compare(
+	const TArray<FResult>& Old,
+	const TArray<FResult>& New,
+	const float Threshold)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	TVoxelMap<TPair<FString, FString>, const FResult*> OldResults;
+	OldResults.Reserve(Old.Num());
+
+	for (const FResult& Result : Old)
+	{
+		OldResults.Add({ Result.Graph, Result.Benchmark }, &Result);
+	}
+
+	int32 NumRegressions = 0;
+	for (const FResult& NewResult : New)
+	{
+		const FResult* const* OldResultPtr = OldResults.Find({ NewResult.Graph, NewResult.Benchmark });
+		if (!OldResultPtr)
+		{
+			LOG_VOXEL(Warning, "%s %s: not in baseline", *NewResult.Graph, *NewResult.Benchmark);
+			continue;
+		}
+		const FResult& OldResult = **OldResultPtr;
+
+		if (OldResult.NumElements != NewResult.NumElements)
+		{
+			// Graph or settings changed, the throughput is still comparable but worth knowing
+			LOG_VOXEL(Warning, "%s %s: %lld %s in baseline, %lld now",
+				*NewResult.Graph,
+				*NewResult.Benchmark,
+				OldResult.NumElements,
+				*OldResult.Unit,
+				NewResult.NumElements);
+		}
+
+		const double OldThroughput = OldResult.GetThroughput();
+		const double NewThroughput = NewResult.GetThroughput();
+		if (OldThroughput <= 0. ||
+			NewThroughput >= OldThroughput * (1. - Threshold))
+		{
+			continue;
+		}
+
+		NumRegressions++;
+
+		LOG_VOXEL(Error, "%s %s: %s -> %s %s/s (-%.1f%%)",
+			NewResult.Graph.IsEmpty() ? TEXT("[Global]") : *NewResult.Graph,
+			*NewResult.Benchmark,
+			*FVoxelUtilities::ConvertToNumberText(OldThroughput).ToString(),
+			*FVoxelUtilities::ConvertToNumberText(NewThroughput).ToString(),
+			*NewResult.Unit,
+			100. * (1. - NewThroughput / OldThroughput));
+	}
+
+	return NumRegressions;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelBenchmarkCommandlet::BenchmarkGraph(
+	UVoxelGraphInterface& Graph,
+	const FSettings& Settings,
+	TArray<FResult>& OutResults)
+{
+	VOXEL_SCOPE_COUNTER_FORMAT("UVoxelBenchmarkCommandlet::BenchmarkGraph %s", *Graph.GetPathName());
+	check(IsInGameThread());
+
+	const UVoxelGraph* RootGraph = Graph.GetGraph();
+	if (!RootGraph)
+	{
+		LOG_VOXEL(Error, "%s: no graph", *Graph.GetPathName());
+		return;
+	}
+
+	const FVoxelGraphParameter* OutputParameter = nullptr;
+	for (const FVoxelGraphParameter& Parameter : RootGraph->Parameters)
+	{
+		if (Parameter.ParameterType != EVoxelGraphParameterType::Output ||
+			!Parameter.Type.Is<FVoxelFloatBuffer>())
+		{
+			continue;
+		}
+		if (!Settings.OutputName.IsEmpty() &&
+			Parameter.Name != *Settings.OutputName)
+		{
+			continue;
+		}
+
+		OutputParameter = &Parameter;
+		break;
+	}
+
+	if (!OutputParameter)
+	{
+		LOG_VOXEL(Error, "%s: no float buffer output %s", *Graph.GetPathName(), *Settings.OutputName);
+		return;
+	}
+
+	const FVoxelGraphPinRef PinRef
+	{
+		FVoxelGraphNodeRef
+		{
+			RootGraph,
+			// See FVoxelRuntimeNode::GetNodeId
+			FName("Output." + OutputParameter->Name.ToString())
+		},
+		VOXEL_PIN_NAME(FVoxelNode_FunctionCallOutput, ValuePin)
+	};
+
+	const TSharedRef<const FVoxelComputeValue> Compute = GVoxelGraphExecutorManager->MakeCompute_GameThread(OutputParameter->Type, PinRef);
+
+	// No world: the benchmark only depends on the graph & its default parameters
+	const TSharedRef<FVoxelRuntimeInfo> RuntimeInfo =
+		FVoxelRuntimeInfoBase::MakePreview()
+		.EnableParallelTasks()
+		.MakeRuntimeInfo();
+
+	ON_SCOPE_EXIT
+	{
+		RuntimeInfo->Destroy();
+	};
+
+	const TSharedRef<FVoxelQueryContext> QueryContext = FVoxelQueryContext::Make(
+		RuntimeInfo,
+		FVoxelParameterValues::Create(&Graph));
+
+	const int32 ChunkSize = Settings.ChunkSize;
+	const int32 DataSize = ChunkSize + 1;
+	const float VoxelSize = Settings.VoxelSize;
+	const float ChunkWorldSize = ChunkSize * VoxelSize;
+
+	// Most graphs are terrains: keep chunks close to Z = 0 so that a good part of them has a surface
+	TArray<FVector3f> ChunkStarts;
+	{
+		FRandomStream Stream(Settings.Seed);
+		for (int32 Index = 0; Index < Settings.NumChunks; Index++)
+		{
+			ChunkStarts.Add(ChunkWorldSize * FVector3f(
+				Stream.RandRange(-64, 63),
+				Stream.RandRange(-64, 63),
+				Stream.RandRange(-2, 1)));
+		}
+	}
+
+	FResult EvaluationResult;
+	EvaluationResult.Graph = Graph.GetPathName();
+	EvaluationResult.Benchmark = "GraphEvaluation";
+	EvaluationResult.Unit = "Voxels";
+	EvaluationResult.NumElements = int64(Settings.NumChunks) * DataSize * DataSize * DataSize;
+	EvaluationResult.Time = MAX_dbl;
+
+	TArray<FVoxelFloatBuffer> ChunkDistances;
+
+	for (int32 Run = 0; Run < Settings.NumRuns; Run++)
+	{
+		// Shared in case we stop waiting before all the callbacks ran
+		struct FEvaluation
+		{
+			TArray<FVoxelFloatBuffer> ChunkDistances;
+			FThreadSafeCounter NumPending;
+			FEventRef Event;
+		};
+		const TSharedRef<FEvaluation> Evaluation = MakeVoxelShared<FEvaluation>();
+		Evaluation->ChunkDistances.SetNum(ChunkStarts.Num());
+		Evaluation->NumPending.Set(ChunkStarts.Num());
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		// Start all the chunks at once so that they are spread over the voxel threads
+		for (int32 Index = 0; Index < ChunkStarts.Num(); Index++)
+		{
+			FVoxelTaskGroup::StartAsyncTask<FVoxelFloatBuffer>(
+				STATIC_FNAME("VoxelBenchmark"),
+				QueryContext,
+				[QueryContext, Compute, ChunkStart = ChunkStarts[Index], VoxelSize, DataSize]() -> TVoxelFutureValue<FVoxelFloatBuffer>
+				{
+					const TSharedRef<FVoxelQueryParameters> Parameters = MakeVoxelShared<FVoxelQueryParameters>();
+					Parameters->Add<FVoxelLODQueryParameter>().LOD = 0;
+					Parameters->Add<FVoxelGradientStepQueryParameter>().Step = VoxelSize;
+					Parameters->Add<FVoxelPositionQueryParameter>().InitializeGrid(ChunkStart, VoxelSize, FIntVector(DataSize));
+
+					const FVoxelQuery Query = FVoxelQuery::Make(
+						QueryContext,
+						Parameters,
+						FVoxelDependencyTracker::Create("VoxelBenchmark"));
+
+					return TVoxelFutureValue<FVoxelFloatBuffer>((*Compute)(Query));
+				},
+				[Evaluation, Index](const FVoxelFloatBuffer& Distances)
+				{
+					// Each index is only written once, no need to lock
+					Evaluation->ChunkDistances[Index] = Distances;
+
+					if (Evaluation->NumPending.Decrement() == 0)
+					{
+						Evaluation->Event->Trigger();
+					}
+				});
+		}
+
+		if (!Evaluation->Event->Wait(FTimespan::FromMinutes(10)))
+		{
+			LOG_VOXEL(Error, "%s: timed out evaluating graph, %d chunks left", *Graph.GetPathName(), Evaluation->NumPending.GetValue());
+			return;
+		}
+
+		EvaluationResult.Time = FMath::Min(EvaluationResult.Time, FPlatformTime::Seconds() - StartTime);
+
+		ChunkDistances = MoveTemp(Evaluation->ChunkDistances);
+	}
+
+	OutResults.Add(EvaluationResult);
+
+	FResult MeshingResult;
+	MeshingResult.Graph = Graph.GetPathName();
+	MeshingResult.Benchmark = "Meshing";
+	MeshingResult.Unit = "Cells";
+	MeshingResult.Time = MAX_dbl;
+
+	TArray<TSharedPtr<FVoxelMarchingCubeSurface>> Surfaces;
+
+	for (int32 Run = 0; Run < Settings.NumRuns; Run++)
+	{
+		Surfaces.Reset();
+		MeshingResult.NumElements = 0;
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		for (int32 Index = 0; Index < ChunkDistances.Num(); Index++)
+		{
+			const FVoxelFloatBuffer& Distances = ChunkDistances[Index];
+			if (Distances.IsConstant() ||
+				!ensure(Distances.Num() == DataSize * DataSize * DataSize))
+			{
+				// Same as FVoxelNode_GenerateMarchingCubeSurface, constant chunks are skipped
+				continue;
+			}
+
+			const TSharedRef<FVoxelMarchingCubeSurface> Surface = MakeVoxelShared<FVoxelMarchingCubeSurface>();
+			Surface->ChunkSize = ChunkSize;
+			Surface->ScaledVoxelSize = VoxelSize;
+			Surface->ChunkBounds = FVoxelBox(FVector(ChunkStarts[Index]), FVector(ChunkStarts[Index] + ChunkWorldSize));
+
+			FVoxelMarchingCubeProcessor Processor(
+				ChunkSize,
+				DataSize,
+				ConstCast(Distances.GetStorage()),
+				*Surface);
+			Processor.Generate(false);
+
+			MeshingResult.NumElements += int64(ChunkSize) * ChunkSize * ChunkSize;
+			Surfaces.Add(Surface);
+		}
+
+		MeshingResult.Time = FMath::Min(MeshingResult.Time, FPlatformTime::Seconds() - StartTime);
+	}
+
+	OutResults.Add(MeshingResult);
+
+	FResult CollisionResult;
+	CollisionResult.Graph = Graph.GetPathName();
+	CollisionResult.Benchmark = "CollisionCooking";
+	CollisionResult.Unit = "Triangles";
+	CollisionResult.Time = MAX_dbl;
+
+	TArray<TVoxelArray<FVector3f>> SurfacePositions;
+	for (const TSharedPtr<FVoxelMarchingCubeSurface>& Surface : Surfaces)
+	{
+		TVoxelArray<FVector3f>& Positions = SurfacePositions.Emplace_GetRef();
+		FVoxelUtilities::SetNumFast(Positions, Surface->Vertices.Num());
+
+		for (int32 Index = 0; Index < Positions.Num(); Index++)
+		{
+			Positions[Index] = Surface->Vertices[Index] * Surface->ScaledVoxelSize;
+		}
+	}
+
+	for (int32 Run = 0; Run < Settings.NumRuns; Run++)
+	{
+		CollisionResult.NumElements = 0;
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		for (int32 Index = 0; Index < Surfaces.Num(); Index++)
+		{
+			const FVoxelMarchingCubeSurface& Surface = *Surfaces[Index];
+			if (Surface.Indices.Num() == 0)
+			{
+				continue;
+			}
+
+			const TSharedPtr<FVoxelTriangleMeshCollider> Collider = FVoxelCollisionCooker::CookTriangleMesh(
+				Surface.Indices,
+				SurfacePositions[Index],
+				{});
+
+			if (Collider)
+			{
+				CollisionResult.NumElements += Surface.Indices.Num() / 3;
+			}
+		}
+
+		CollisionResult.Time = FMath::Min(CollisionResult.Time, FPlatformTime::Seconds() - StartTime);
+	}
+
+	OutResults.Add(CollisionResult);
+}
@@ -0,0 +1,76 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "VoxelMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VoxelBenchmarkCommandlet.generated.h"
+
+class UVoxelGraphInterface;
+
+// Headless benchmark, runs without a window or a GPU:
+// UnrealEditor-Cmd Project.uproject -run=VoxelBenchmark -nullrhi
+//     -Graphs=/Game/A.A,/Game/B.B    Reference graphs, each needs a float buffer output (first one is used unless -Output=Name)
+//     -Report=Path.json              Defaults to ProfilingDir/Voxel/Benchmark-date.json
+//     -Baseline=Path.json            Compares against a previous report, returns non-zero on regressions
+//     -Threshold=0.1                 Max allowed throughput drop vs the baseline
+//     -Seed=0 -NumChunks=16 -ChunkSize=32 -VoxelSize=100 -NumRuns=3
+// Chunks are evaluated concurrently on the voxel threads, like they are at runtime
+//     -NumInvokers=8 -InvokerRadius=5000 -NumInvokerTicks=100
+UCLASS()
+class UVoxelBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVoxelBenchmarkCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+public:
+	struct FResult
+	{
+		// Graph path, empty for graph-independent benchmarks
+		FString Graph;
+		// GraphEvaluation, Meshing, CollisionCooking or InvokerUpdates
+		FString Benchmark;
+		// Voxels, Cells, Triangles or Chunks
+		FString Unit;
+		int64 NumElements = 0;
+		// Best time across all runs
+		double Time = 0.;
+
+		double GetThroughput() const
+		{
+			return NumElements / FMath::Max(Time, UE_SMALL_NUMBER);
+		}
+	};
+
+	static bool SaveReport(const FString& Path, int32 Seed, const TArray<FResult>& Results);
+	static TOptional<TArray<FResult>> LoadReport(const FString& Path);
+
+	// Logs all the benchmarks whose throughput dropped by more than Threshold
+	// Returns the number of regressions
+	static int32 Compare(
+		const TArray<FResult>& Old,
+		const TArray<FResult>& New,
+		float Threshold);
+
+private:
+	struct FSettings
+	{
+		int32 Seed = 0;
+		int32 NumChunks = 16;
+		int32 ChunkSize = 32;
+		float VoxelSize = 100.f;
+		int32 NumRuns = 3;
+		FString OutputName;
+	};
+
+	static void BenchmarkGraph(
+		UVoxelGraphInterface& Graph,
+		const FSettings& Settings,
+		TArray<FResult>& OutResults);
+};
@@ -23,6 +23,7 @@ public class VoxelGraphEditor : ModuleRules_Voxel
                 "SharedSettingsWidgets",
                 "InteractiveToolsFramework",
                 "EditorInteractiveToolsFramework",
+                "Json",
 
                 // For SItemSelector
                 "NiagaraEditor",
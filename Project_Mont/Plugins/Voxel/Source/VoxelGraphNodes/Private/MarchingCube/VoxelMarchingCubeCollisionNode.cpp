@@ -2,9 +2,11 @@
 
 #include "MarchingCube/VoxelMarchingCubeCollisionNode.h"
 #include "MarchingCube/VoxelMarchingCubeNodes.h"
+#include "MarchingCube/VoxelMarchingCubeDiskCache.h"
 #include "VoxelInvoker.h"
 #include "VoxelRuntime.h"
 #include "Collision/VoxelCollisionComponent.h"
+#include "Collision/VoxelTriangleMeshCollider.h"
 #include "Navigation/VoxelNavigationComponent.h"
 
 VOXEL_CONSOLE_VARIABLE(
@@ -16,22 +18,110 @@ VOXEL_CONSOLE_VARIABLE(
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-FVoxelNodeAliases::TValue<FVoxelCollider> FVoxelMarchingCubeCollisionExecNode::CreateCollider(
+TVoxelUniquePtr<FVoxelExecNodeRuntime> FVoxelMarchingCubeCollisionExecNode::CreateExecRuntime(const TSharedRef<const FVoxelExecNode>& SharedThis) const
+{
+	return MakeVoxelUnique<FVoxelMarchingCubeCollisionExecNodeRuntime>(SharedThis);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelMarchingCubeCollisionExecNodeRuntime::Create()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!IsGameWorld() &&
+		!GVoxelCollisionEnableInEditor)
+	{
+		return;
+	}
+
+	const bool bComputeCollision = GetConstantPin(Node.ComputeCollisionPin);
+	const bool bComputeNavmesh = GetConstantPin(Node.ComputeNavmeshPin);
+
+	if (!bComputeCollision &&
+		!bComputeNavmesh)
+	{
+		return;
+	}
+
+	FVoxelMarchingCubeCollisionChunks::FSettings Settings;
+	Settings.InvokerChannel = GetConstantPin(Node.InvokerChannelPin);
+	Settings.VoxelSize = GetConstantPin(Node.VoxelSizePin);
+	Settings.ChunkSize = GetConstantPin(Node.ChunkSizePin);
+	Settings.PriorityOffset = GetConstantPin(Node.PriorityOffsetPin);
+	Settings.bComputeCollision = bComputeCollision;
+	Settings.BodyInstance = GetConstantPin(Node.BodyInstancePin);
+
+	if (bComputeNavmesh)
+	{
+		Settings.NavmeshSettings.Emplace();
+		Settings.NavmeshSettings->MaxSlope = GetConstantPin(Node.NavmeshMaxSlopePin);
+		Settings.NavmeshSettings->AgentHeight = GetConstantPin(Node.NavmeshAgentHeightPin);
+		Settings.NavmeshSettings->WeldSize = GetConstantPin(Node.NavmeshSimplificationPin) * Settings.VoxelSize;
+	}
+
+	Chunks = MakeVoxelShared<FVoxelMarchingCubeCollisionChunks>(
+		Node,
+		FVoxelMarchingCubeCollisionChunks::FPins
+		{
+			Node.SurfacePin,
+			Node.PhysicalMaterialPin,
+			Node.DistanceChecksTolerancePin,
+			Node.BodyInstancePin
+		},
+		Settings);
+	Chunks->Create(*this);
+}
+
+void FVoxelMarchingCubeCollisionExecNodeRuntime::Destroy()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!Chunks)
+	{
+		return;
+	}
+
+	Chunks->Destroy(GetRuntime().Get());
+	Chunks.Reset();
+}
+
+void FVoxelMarchingCubeCollisionExecNodeRuntime::Tick(FVoxelRuntime& Runtime)
+{
+	VOXEL_FUNCTION_COUNTER();
+	ensure(!IsDestroyed());
+
+	if (Chunks)
+	{
+		Chunks->Tick(Runtime);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelNodeAliases::TValue<FVoxelMarchingCubeCollisionChunk> FVoxelMarchingCubeCollisionChunks::CreateChunk(
 	const FVoxelQuery& InQuery,
-	const float VoxelSize,
-	const int32 ChunkSize,
 	const FVoxelBox& Bounds) const
 {
 	checkVoxelSlow(FVoxelTaskReferencer::Get().IsReferenced(this));
-	const FVoxelQuery Query = InQuery.EnterScope(*this);
+	const FVoxelQuery Query = InQuery.EnterScope(Node);
+
+	if (Query.GetInfo(EVoxelQueryInfo::Query).FindParameter<FVoxelRuntimeParameter_DisableCollision>())
+	{
+		return FVoxelMarchingCubeCollisionChunk();
+	}
 
 	const TSharedRef<FVoxelQueryParameters> SurfaceParameters = Query.CloneParameters();
 	SurfaceParameters->Add<FVoxelQueryChannelBoundsQueryParameter>().Bounds = Bounds;
-	const TValue<FVoxelSurface> FutureSurface = GetNodeRuntime().Get(SurfacePin, Query.MakeNewQuery(SurfaceParameters));
+	const TValue<FVoxelSurface> FutureSurface = GetNodeRuntime().Get(Pins.Surface, Query.MakeNewQuery(SurfaceParameters));
 
-	return VOXEL_CALL_NODE(FVoxelNode_CreateMarchingCubeCollider, ColliderPin, Query)
+	const TValue<FVoxelCollider> Collider = VOXEL_CALL_NODE(FVoxelNode_CreateMarchingCubeCollider, ColliderPin, Query)
 	{
-		VOXEL_CALL_NODE_BIND(SurfacePin, VoxelSize, ChunkSize, Bounds, FutureSurface)
+		VOXEL_CALL_NODE_BIND(SurfacePin, Bounds, FutureSurface)
 		{
 			return VOXEL_CALL_NODE(FVoxelNode_GenerateMarchingCubeSurface, SurfacePin, Query)
 			{
@@ -42,18 +132,19 @@ FVoxelNodeAliases::TValue<FVoxelCollider> FVoxelMarchingCubeCollisionExecNode::C
 						return FutureSurface->GetDistance(Query);
 					};
 				};
-				VOXEL_CALL_NODE_BIND(VoxelSizePin, VoxelSize)
+				VOXEL_CALL_NODE_BIND(VoxelSizePin)
 				{
-					return VoxelSize;
+					return Settings.VoxelSize;
 				};
-				VOXEL_CALL_NODE_BIND(ChunkSizePin, ChunkSize)
+				VOXEL_CALL_NODE_BIND(ChunkSizePin)
 				{
-					return ChunkSize;
+					return Settings.ChunkSize;
 				};
 				VOXEL_CALL_NODE_BIND(BoundsPin, Bounds)
 				{
 					return Bounds;
 				};
+				// All chunks are LOD 0, no transitions needed
 				VOXEL_CALL_NODE_BIND(EnableTransitionsPin)
 				{
 					return false;
@@ -68,60 +159,72 @@ FVoxelNodeAliases::TValue<FVoxelCollider> FVoxelMarchingCubeCollisionExecNode::C
 				};
 				VOXEL_CALL_NODE_BIND(DistanceChecksTolerancePin)
 				{
-					return GetNodeRuntime().Get(DistanceChecksTolerancePin, Query);
+					return GetNodeRuntime().Get(Pins.DistanceChecksTolerance, Query);
 				};
 			};
 		};
 
 		VOXEL_CALL_NODE_BIND(PhysicalMaterialPin)
 		{
-			return GetNodeRuntime().Get(PhysicalMaterialPin, Query);
+			return GetNodeRuntime().Get(Pins.PhysicalMaterial, Query);
 		};
 	};
-}
 
-TVoxelUniquePtr<FVoxelExecNodeRuntime> FVoxelMarchingCubeCollisionExecNode::CreateExecRuntime(const TSharedRef<const FVoxelExecNode>& SharedThis) const
-{
-	return MakeVoxelUnique<FVoxelMarchingCubeCollisionExecNodeRuntime>(SharedThis);
+	const TValue<FBodyInstance> BodyInstance =
+		Settings.BodyInstance
+		? TValue<FBodyInstance>(Settings.BodyInstance.ToSharedRef())
+		: GetNodeRuntime().Get(Pins.BodyInstance, Query);
+
+	return
+		MakeVoxelTask(STATIC_FNAME("MarchingCubeCollisionChunks - CreateChunk"))
+		.Dependencies(Collider, BodyInstance)
+		.Execute<FVoxelMarchingCubeCollisionChunk>([=, NavmeshSettings = Settings.NavmeshSettings]
+		{
+			const TSharedRef<FVoxelMarchingCubeCollisionChunk> Chunk = MakeVoxelShared<FVoxelMarchingCubeCollisionChunk>();
+			if (Collider.Get_CheckCompleted().GetStruct() == FVoxelCollider::StaticStruct())
+			{
+				return Chunk;
+			}
+
+			Chunk->Collider = Collider.GetShared_CheckCompleted();
+			Chunk->BodyInstance = BodyInstance.GetShared_CheckCompleted();
+
+			if (NavmeshSettings)
+			{
+				if (const FVoxelTriangleMeshCollider* TriangleMeshCollider = Chunk->Collider->As<FVoxelTriangleMeshCollider>())
+				{
+					// Build the navmesh here instead of on the game thread when the collider is registered
+					Chunk->Collider = TriangleMeshCollider->CopyWithNavmesh(Bounds, NavmeshSettings.GetValue());
+				}
+			}
+			return Chunk;
+		});
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelMarchingCubeCollisionExecNodeRuntime::Create()
+void FVoxelMarchingCubeCollisionChunks::Create(const FVoxelExecNodeRuntime& Owner)
 {
 	VOXEL_FUNCTION_COUNTER();
 
-	if (!IsGameWorld() &&
-		!GVoxelCollisionEnableInEditor)
-	{
-		return;
-	}
-
-	BodyInstance = GetConstantPin(Node.BodyInstancePin);
-	bComputeCollision = GetConstantPin(Node.ComputeCollisionPin);
-	bComputeNavmesh = GetConstantPin(Node.ComputeNavmeshPin);
-
-	if (!bComputeCollision &&
-		!bComputeNavmesh)
-	{
-		return;
-	}
+	const int32 FullChunkSize = FMath::CeilToInt(Settings.ChunkSize * Settings.VoxelSize);
 
-	const FName InvokerChannel = GetConstantPin(Node.InvokerChannelPin);
-	const float VoxelSize = GetConstantPin(Node.VoxelSizePin);
-	const int32 ChunkSize = GetConstantPin(Node.ChunkSizePin);
-	const int32 FullChunkSize = FMath::CeilToInt(ChunkSize * VoxelSize);
-
-	InvokerView = FVoxelInvokerManager::Get(GetWorld())->MakeView(
-		InvokerChannel,
+	InvokerView = FVoxelInvokerManager::Get(Owner.GetWorld())->MakeView(
+		Settings.InvokerChannel,
 		FullChunkSize,
 		0,
-		GetLocalToWorld());
+		Owner.GetLocalToWorld());
 
 	InvokerView->Bind(
-		MakeWeakPtrDelegate(this, [=](const TVoxelAddOnlySet<FIntVector>& ChunksToAdd)
+		MakeWeakPtrDelegate(this, [
+			this,
+			FullChunkSize,
+			NodeRef = Owner.NodeRef,
+			Context = Owner.GetContext(),
+			World = Owner.GetWorld(),
+			LocalToWorld = Owner.GetLocalToWorld()](const TVoxelAddOnlySet<FIntVector>& ChunksToAdd)
 		{
 			VOXEL_SCOPE_COUNTER("OnAddChunk");
 			VOXEL_SCOPE_LOCK(CriticalSection);
@@ -136,29 +239,30 @@ void FVoxelMarchingCubeCollisionExecNodeRuntime::Create()
 
 				const FVoxelBox Bounds = FVoxelBox(FVector(ChunkKey) * FullChunkSize, FVector(ChunkKey + 1) * FullChunkSize);
 
-				TVoxelDynamicValueFactory<FVoxelCollider> Factory(STATIC_FNAME("Marching Cube Collision"), [
-					&Node = Node,
-					VoxelSize,
-					ChunkSize,
-					Bounds](const FVoxelQuery& Query)
+				TVoxelDynamicValueFactory<FVoxelMarchingCubeCollisionChunk> Factory(STATIC_FNAME("Marching Cube Collision"), [this, Bounds](const FVoxelQuery& Query)
 				{
-					return Node.CreateCollider(Query, VoxelSize, ChunkSize, Bounds);
+					return CreateChunk(Query, Bounds);
 				});
 
 				const TSharedRef<FVoxelQueryParameters> Parameters = MakeVoxelShared<FVoxelQueryParameters>();
 				Parameters->Add<FVoxelLODQueryParameter>().LOD = 0;
-				Chunk->Collider_RequiresLock = Factory
+				if (Settings.DiskCache)
+				{
+					Parameters->Add<FVoxelMarchingCubeDiskCacheQueryParameter>().DiskCache = Settings.DiskCache;
+				}
+				Chunk->Value_RequiresLock = Factory
 					.AddRef(NodeRef)
+					.AddRef(AsShared())
 					.Priority(FVoxelTaskPriority::MakeBounds(
 						Bounds,
-						GetConstantPin(Node.PriorityOffsetPin),
-						GetWorld(),
-						GetLocalToWorld()))
-					.Compute(GetContext(), Parameters);
+						Settings.PriorityOffset,
+						World,
+						LocalToWorld))
+					.Compute(Context, Parameters);
 
-				Chunk->Collider_RequiresLock.OnChanged(MakeWeakPtrLambda(this, [this, WeakChunk = MakeWeakPtr(Chunk)](const TSharedRef<const FVoxelCollider>& Collider)
+				Chunk->Value_RequiresLock.OnChanged(MakeWeakPtrLambda(this, [this, WeakChunk = MakeWeakPtr(Chunk)](const TSharedRef<const FVoxelMarchingCubeCollisionChunk>& Value)
 				{
-					QueuedColliders.Enqueue({ WeakChunk, Collider });
+					QueuedChunks.Enqueue({ WeakChunk, Value });
 				}));
 			}
 		}),
@@ -175,64 +279,48 @@ void FVoxelMarchingCubeCollisionExecNodeRuntime::Create()
 					return;
 				}
 
-				Chunk->Collider_RequiresLock = {};
+				Chunk->Value_RequiresLock = {};
 				ChunksToDestroy.Enqueue(Chunk);
 			}
 		}));
 }
 
-void FVoxelMarchingCubeCollisionExecNodeRuntime::Destroy()
+void FVoxelMarchingCubeCollisionChunks::Destroy(FVoxelRuntime* Runtime)
 {
 	VOXEL_FUNCTION_COUNTER();
 
 	InvokerView = {};
 
-	ProcessChunksToDestroy();
+	ProcessChunksToDestroy(Runtime);
 	{
 		VOXEL_SCOPE_LOCK(CriticalSection);
 
-		const TSharedPtr<FVoxelRuntime> Runtime = GetRuntime();
 		for (const auto& It : Chunks_RequiresLock)
 		{
-			FChunk& Chunk = *It.Value;
-			Chunk.Collider_RequiresLock = {};
-
-			if (Runtime)
-			{
-				Runtime->DestroyComponent(Chunk.CollisionComponent_GameThread);
-				Runtime->DestroyComponent(Chunk.NavigationComponent_GameThread);
-			}
-			else
-			{
-				Chunk.CollisionComponent_GameThread.Reset();
-				Chunk.NavigationComponent_GameThread.Reset();
-			}
+			It.Value->Value_RequiresLock = {};
+			ChunksToDestroy.Enqueue(It.Value);
 		}
 		Chunks_RequiresLock.Empty();
 	}
-	ProcessChunksToDestroy();
+	ProcessChunksToDestroy(Runtime);
 }
 
-void FVoxelMarchingCubeCollisionExecNodeRuntime::Tick(FVoxelRuntime& Runtime)
+void FVoxelMarchingCubeCollisionChunks::Tick(FVoxelRuntime& Runtime)
 {
 	VOXEL_FUNCTION_COUNTER();
-	ensure(!IsDestroyed());
 
-	ProcessChunksToDestroy();
-	ProcessQueuedColliders(Runtime);
+	ProcessChunksToDestroy(&Runtime);
+	ProcessQueuedChunks(Runtime);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelMarchingCubeCollisionExecNodeRuntime::ProcessChunksToDestroy()
+void FVoxelMarchingCubeCollisionChunks::ProcessChunksToDestroy(FVoxelRuntime* Runtime)
 {
 	VOXEL_FUNCTION_COUNTER();
 
-	const TSharedPtr<FVoxelRuntime> Runtime = GetRuntime();
-	ensure(Runtime || IsDestroyed());
-
 	TSharedPtr<FChunk> Chunk;
 	while (ChunksToDestroy.Dequeue(Chunk))
 	{
@@ -240,7 +328,7 @@ void FVoxelMarchingCubeCollisionExecNodeRuntime::ProcessChunksToDestroy()
 		{
 			continue;
 		}
-		ensure(!Chunk->Collider_RequiresLock.IsValid());
+		ensure(!Chunk->Value_RequiresLock.IsValid());
 
 		if (Runtime)
 		{
@@ -255,31 +343,34 @@ void FVoxelMarchingCubeCollisionExecNodeRuntime::ProcessChunksToDestroy()
 	}
 }
 
-void FVoxelMarchingCubeCollisionExecNodeRuntime::ProcessQueuedColliders(FVoxelRuntime& Runtime)
+void FVoxelMarchingCubeCollisionChunks::ProcessQueuedChunks(FVoxelRuntime& Runtime)
 {
 	VOXEL_FUNCTION_COUNTER();
 	check(IsInGameThread());
-	ensure(!IsDestroyed());
 
-	FQueuedCollider QueuedCollider;
-	while (QueuedColliders.Dequeue(QueuedCollider))
+	const FVoxelCollisionRegisterBudget Budget;
+
+	FQueuedChunk QueuedChunk;
+	while (
+		Budget.HasTimeLeft() &&
+		QueuedChunks.Dequeue(QueuedChunk))
 	{
-		const TSharedPtr<FChunk> Chunk = QueuedCollider.Chunk.Pin();
+		const TSharedPtr<FChunk> Chunk = QueuedChunk.Chunk.Pin();
 		if (!Chunk)
 		{
 			continue;
 		}
 
-		const TSharedRef<const FVoxelCollider> Collider = QueuedCollider.Collider.ToSharedRef();
-		if (Collider->GetStruct() == StaticStructFast<FVoxelCollider>())
+		const TSharedPtr<const FVoxelCollider> Collider = QueuedChunk.Value->Collider;
+		if (!Collider)
 		{
 			Runtime.DestroyComponent(Chunk->CollisionComponent_GameThread);
 			Runtime.DestroyComponent(Chunk->NavigationComponent_GameThread);
 			continue;
 		}
-		ensure(bComputeCollision || bComputeNavmesh);
 
-		if (bComputeCollision)
+		if (Settings.bComputeCollision &&
+			QueuedChunk.Value->BodyInstance->GetCollisionEnabled(false) != ECollisionEnabled::NoCollision)
 		{
 			UVoxelCollisionComponent* Component = Chunk->CollisionComponent_GameThread.Get();
 			if (!Component)
@@ -291,12 +382,16 @@ void FVoxelMarchingCubeCollisionExecNodeRuntime::ProcessQueuedColliders(FVoxelRu
 			if (ensure(Component))
 			{
 				Component->SetRelativeLocation(Collider->GetOffset());
-				Component->SetBodyInstance(*BodyInstance);
+				Component->SetBodyInstance(*QueuedChunk.Value->BodyInstance);
 				Component->SetCollider(Collider);
 			}
 		}
+		else
+		{
+			Runtime.DestroyComponent(Chunk->CollisionComponent_GameThread);
+		}
 
-		if (bComputeNavmesh)
+		if (Settings.NavmeshSettings)
 		{
 			UVoxelNavigationComponent* Component = Chunk->NavigationComponent_GameThread.Get();
 			if (!Component)
@@ -312,4 +407,4 @@ void FVoxelMarchingCubeCollisionExecNodeRuntime::ProcessQueuedColliders(FVoxelRu
 			}
 		}
 	}
-}
\ No newline at end of file
+}
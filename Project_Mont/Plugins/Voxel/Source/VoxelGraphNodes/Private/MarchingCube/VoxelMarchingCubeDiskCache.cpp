@@ -0,0 +1,464 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#include "MarchingCube/VoxelMarchingCubeDiskCache.h"
+#include "MarchingCube/VoxelMarchingCubeNodes.h"
+#include "VoxelQuery.h"
+#include "VoxelDependency.h"
+#include "VoxelDiskCache.h"
+#include "VoxelMacroLibrary.h"
+#include "VoxelGraphExecutor.h"
+#include "VoxelGraphInterface.h"
+#include "VoxelFunctionLibrary.h"
+#include "VoxelParameterContainer.h"
+#include "Sculpt/VoxelSculptStorage.h"
+#include "Sculpt/VoxelSculptStorageData.h"
+#include "Hash/CityHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ArchiveUObject.h"
+
+DEFINE_VOXEL_COUNTER(STAT_VoxelMarchingCubeDiskCacheHits);
+DEFINE_VOXEL_COUNTER(STAT_VoxelMarchingCubeDiskCacheMisses);
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHNODES_API, float, GVoxelMarchingCubeDiskCacheSize, 1024.f,
+	"voxel.marchingcube.DiskCacheSize",
+	"Max size in MB of Saved/Voxel/SurfaceCache, least recently used chunks are deleted first");
+
+VOXEL_CONSOLE_COMMAND(
+	ClearMarchingCubeDiskCache,
+	"voxel.marchingcube.ClearDiskCache",
+	"Deletes all the marching cube surfaces saved to disk")
+{
+	FVoxelMarchingCubeDiskCache::ClearAll();
+}
+
+// Hashes the serialized content of graphs, function & macro libraries, parameter containers and their subobjects
+// Other objects (meshes, heightmaps...) are hashed by path and by the hash of their package when it was last saved,
+// so that reimporting them invalidates the surfaces
+class FVoxelMarchingCubeGraphHasher : public FArchiveUObject
+{
+public:
+	uint64 Hash = 0;
+	// Set if a referenced package has unsaved changes: its saved hash doesn't match what the graph will read
+	bool bReferencesDirtyPackage = false;
+
+	FVoxelMarchingCubeGraphHasher()
+	{
+		SetIsSaving(true);
+		SetIsPersistent(true);
+	}
+
+	void HashObject(UObject& Object)
+	{
+		VOXEL_FUNCTION_COUNTER();
+
+		VisitedObjects.Add(&Object);
+		ObjectsToHash.Add(&Object);
+
+		while (ObjectsToHash.Num() > 0)
+		{
+			ObjectsToHash.Pop(false)->Serialize(*this);
+		}
+	}
+
+	using FArchiveUObject::operator<<;
+
+	//~ Begin FArchive Interface
+	virtual void Serialize(void* Data, const int64 Num) override
+	{
+		Hash = CityHash64WithSeed(static_cast<const char*>(Data), uint32(Num), Hash);
+	}
+	virtual FArchive& operator<<(FName& Name) override
+	{
+		FString String = Name.ToString();
+		return *this << String;
+	}
+	virtual FArchive& operator<<(UObject*& Object) override
+	{
+		FString Path = Object ? Object->GetPathName() : FString();
+		*this << Path;
+
+		if (!Object ||
+			VisitedObjects.Contains(Object))
+		{
+			return *this;
+		}
+		VisitedObjects.Add(Object);
+
+		if (ShouldHashContent(*Object))
+		{
+			ObjectsToHash.Add(Object);
+		}
+		else
+		{
+			HashPackage(*Object);
+		}
+		return *this;
+	}
+	virtual FString GetArchiveName() const override
+	{
+		return "FVoxelMarchingCubeGraphHasher";
+	}
+	//~ End FArchive Interface
+
+private:
+	TVoxelSet<UObject*> VisitedObjects;
+	TVoxelArray<UObject*> ObjectsToHash;
+	TVoxelSet<UPackage*> VisitedPackages;
+
+	void HashPackage(const UObject& Object)
+	{
+		UPackage* Package = Object.GetPackage();
+		if (!Package ||
+			Package == GetTransientPackage() ||
+			VisitedPackages.Contains(Package))
+		{
+			return;
+		}
+		VisitedPackages.Add(Package);
+
+		if (Package->IsDirty())
+		{
+			bReferencesDirtyPackage = true;
+		}
+
+#if WITH_EDITORONLY_DATA
+		// Updated whenever the package is saved, eg after a reimport
+		FIoHash SavedHash = Package->GetSavedHash();
+		Serialize(&SavedHash, sizeof(SavedHash));
+#endif
+	}
+
+	static bool ShouldHashContent(const UObject& Object)
+	{
+		for (const UObject* Outer = &Object; Outer; Outer = Outer->GetOuter())
+		{
+			if (Outer->IsA<UVoxelGraphInterface>() ||
+				Outer->IsA<UVoxelFunctionLibrary>() ||
+				Outer->IsA<UVoxelMacroLibrary>() ||
+				Outer->IsA<UVoxelParameterContainer>())
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+FVoxelDiskCache GVoxelMarchingCubeDiskCacheFiles("SurfaceCache", GVoxelMarchingCubeDiskCacheSize);
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+namespace Voxel::MarchingCube
+{
+	// Bump whenever the file layout or the meshing changes
+	constexpr uint32 DiskCacheMagic = 0x564F4D43;
+	constexpr uint32 DiskCacheVersion = 1;
+
+	template<typename T>
+	uint64 HashValue(const T& Value, const uint64 Hash)
+	{
+		return CityHash64WithSeed(reinterpret_cast<const char*>(&Value), uint32(sizeof(T)), Hash);
+	}
+
+	template<typename T>
+	void SerializeArray(FArchive& Ar, TVoxelArray<T>& Array)
+	{
+		checkStatic(TIsTriviallyDestructible<T>::Value);
+
+		int32 Num = Array.Num();
+		Ar << Num;
+
+		if (Ar.IsLoading())
+		{
+			if (Num < 0 ||
+				Num * int64(sizeof(T)) > Ar.TotalSize() - Ar.Tell())
+			{
+				Ar.SetError();
+				return;
+			}
+			FVoxelUtilities::SetNumFast(Array, Num);
+		}
+
+		Ar.Serialize(Array.GetData(), Num * sizeof(T));
+	}
+
+	void SerializeSurface(FArchive& Ar, FVoxelMarchingCubeSurface& Surface)
+	{
+		Ar << Surface.LOD;
+		Ar << Surface.ChunkSize;
+		Ar << Surface.ScaledVoxelSize;
+		Ar << Surface.ChunkBounds.Min;
+		Ar << Surface.ChunkBounds.Max;
+		Ar << Surface.NumEdgeVertices;
+
+		SerializeArray(Ar, Surface.Cells);
+		SerializeArray(Ar, Surface.Indices);
+		SerializeArray(Ar, Surface.Vertices);
+		SerializeArray(Ar, Surface.CellIndices);
+
+		for (int32 Direction = 0; Direction < 6; Direction++)
+		{
+			SerializeArray(Ar, Surface.TransitionIndices[Direction]);
+			SerializeArray(Ar, Surface.TransitionVertices[Direction]);
+			SerializeArray(Ar, Surface.TransitionCellIndices[Direction]);
+		}
+	}
+
+	TSharedPtr<FVoxelMarchingCubeSurface> LoadSurface(const uint64 ChunkKey, const TOptional<TArray<uint8>>& Data)
+	{
+		VOXEL_FUNCTION_COUNTER();
+		VOXEL_ALLOW_MALLOC_SCOPE();
+
+		if (!Data)
+		{
+			return nullptr;
+		}
+
+		FMemoryReader Reader(Data.GetValue());
+
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		uint64 Key = 0;
+		uint64 PayloadHash = 0;
+		Reader << Magic;
+		Reader << Version;
+		Reader << Key;
+		Reader << PayloadHash;
+
+		if (Reader.IsError() ||
+			Magic != DiskCacheMagic ||
+			Version != DiskCacheVersion ||
+			Key != ChunkKey ||
+			PayloadHash != CityHash64(reinterpret_cast<const char*>(Data->GetData() + Reader.Tell()), uint32(Data->Num() - Reader.Tell())))
+		{
+			return nullptr;
+		}
+
+		const TSharedRef<FVoxelMarchingCubeSurface> Surface = MakeVoxelShared<FVoxelMarchingCubeSurface>();
+		SerializeSurface(Reader, *Surface);
+
+		if (Reader.IsError() ||
+			!Reader.AtEnd())
+		{
+			ensureVoxelSlow(false);
+			return nullptr;
+		}
+
+		return Surface;
+	}
+
+	// Sculpt data isn't part of the key
+	bool IsSculpted(const FVoxelQuery& Query, const FVoxelBox& Bounds)
+	{
+		const TSharedPtr<const FVoxelRuntimeParameter_SculptStorage> RuntimeParameter = Query.GetInfo(EVoxelQueryInfo::Local).FindParameter<FVoxelRuntimeParameter_SculptStorage>();
+		if (!RuntimeParameter ||
+			!RuntimeParameter->Data)
+		{
+			return false;
+		}
+
+		FVoxelTransformRef SurfaceToWorld;
+		float VoxelSize;
+		{
+			VOXEL_SCOPE_LOCK(RuntimeParameter->CriticalSection);
+
+			SurfaceToWorld = RuntimeParameter->SurfaceToWorldOverride.IsSet()
+				? RuntimeParameter->SurfaceToWorldOverride.GetValue()
+				: Query.GetLocalToWorld();
+
+			VoxelSize = RuntimeParameter->VoxelSize;
+		}
+
+		FVoxelSculptStorageData& Data = *RuntimeParameter->Data;
+		FVoxelScopeLock_Read Lock(Data.CriticalSection);
+
+		if (VoxelSize <= 0.f)
+		{
+			// Sculpt source not set yet
+			return Data.HasChunks(FVoxelBox::Infinite);
+		}
+
+		// Same as FVoxelNode_GetSculptSurface_Distance
+		const FVoxelTransformRef SurfaceToQueryRef =
+			SurfaceToWorld *
+			Query.GetInfo(EVoxelQueryInfo::Query).GetWorldToLocal();
+
+		const FTransform3f SurfaceToQuery = FTransform3f(FTransform(FScaleMatrix(VoxelSize) * SurfaceToQueryRef.Get(Query)));
+		return Data.HasChunks(Bounds.TransformBy(SurfaceToQuery.ToInverseMatrixWithScale()));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+TSharedPtr<FVoxelMarchingCubeDiskCache> FVoxelMarchingCubeDiskCache::Create(const FVoxelRuntimeInfo& RuntimeInfo)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(IsInGameThread());
+
+	UObject* Instance = RuntimeInfo.GetInstance().Get();
+	if (!ensure(Instance))
+	{
+		return nullptr;
+	}
+
+	UVoxelParameterContainer* ParameterContainer = nullptr;
+	ForEachObjectWithOuter(Instance, [&](UObject* Object)
+	{
+		if (!ParameterContainer)
+		{
+			ParameterContainer = Cast<UVoxelParameterContainer>(Object);
+		}
+	}, false);
+
+	if (!ParameterContainer)
+	{
+		return nullptr;
+	}
+
+	// The parameter container references the graph, which is hashed recursively
+	FVoxelMarchingCubeGraphHasher Hasher;
+	Hasher.Hash = Voxel::MarchingCube::DiskCacheVersion;
+#if !WITH_EDITORONLY_DATA
+	// Package saved hashes are editor only, cooked assets only change with a new build
+	FString BuildVersion = FApp::GetBuildVersion();
+	Hasher << BuildVersion;
+#endif
+	Hasher.HashObject(*ParameterContainer);
+
+	if (Hasher.bReferencesDirtyPackage)
+	{
+		// Will be cached once the referenced assets are saved & the runtime recreated
+		return nullptr;
+	}
+
+	// 0 is used for invalidated runtimes
+	const TSharedRef<FVoxelMarchingCubeDiskCache> DiskCache = MakeVoxelShared<FVoxelMarchingCubeDiskCache>(FMath::Max<uint64>(Hasher.Hash, 1));
+
+	ParameterContainer->AddOnChanged(MakeWeakPtrDelegate(DiskCache, [&This = *DiskCache]
+	{
+		This.RuntimeHash.Store(0);
+	}));
+	GVoxelGraphExecutorManager->OnGraphChanged.Add(MakeWeakPtrDelegate(DiskCache, [&This = *DiskCache](const UVoxelGraphInterface&)
+	{
+		This.RuntimeHash.Store(0);
+	}));
+
+	return DiskCache;
+}
+
+uint64 FVoxelMarchingCubeDiskCache::GetChunkKey(
+	const FVoxelQuery& Query,
+	const int32 LOD,
+	const int32 ChunkSize,
+	const float ScaledVoxelSize,
+	const FVoxelBox& Bounds,
+	const bool bEnableTransitions,
+	const bool bPerfectTransitions) const
+{
+	VOXEL_FUNCTION_COUNTER();
+	using namespace Voxel::MarchingCube;
+
+	uint64 Key = RuntimeHash.Load();
+	if (Key == 0 ||
+		IsSculpted(Query, Bounds))
+	{
+		return 0;
+	}
+
+	// Graphs can sample world positions, and moving the actor will invalidate the chunk
+	const FMatrix QueryToWorld = Query.GetQueryToWorld().Get(Query);
+
+	Key = HashValue(LOD, Key);
+	Key = HashValue(ChunkSize, Key);
+	Key = HashValue(ScaledVoxelSize, Key);
+	Key = HashValue(Bounds.Min, Key);
+	Key = HashValue(Bounds.Max, Key);
+	Key = HashValue(bEnableTransitions, Key);
+	Key = HashValue(bPerfectTransitions, Key);
+	Key = HashValue(QueryToWorld, Key);
+	return FMath::Max<uint64>(Key, 1);
+}
+
+FVoxelDummyFutureValue FVoxelMarchingCubeDiskCache::LoadAsync(
+	const uint64 ChunkKey,
+	const TSharedRef<TSharedPtr<FVoxelMarchingCubeSurface>>& OutSurface) const
+{
+	VOXEL_FUNCTION_COUNTER();
+	ensure(ChunkKey != 0);
+
+	const FVoxelDummyFutureValue Dummy = FVoxelFutureValue::MakeDummy();
+
+	GVoxelMarchingCubeDiskCacheFiles.LoadAsync(ChunkKey, [ChunkKey, OutSurface, Dummy](const TOptional<TArray<uint8>> Data)
+	{
+		*OutSurface = Voxel::MarchingCube::LoadSurface(ChunkKey, Data);
+
+		if (*OutSurface)
+		{
+			INC_VOXEL_COUNTER(STAT_VoxelMarchingCubeDiskCacheHits);
+		}
+		else
+		{
+			INC_VOXEL_COUNTER(STAT_VoxelMarchingCubeDiskCacheMisses);
+		}
+
+		Dummy.MarkDummyAsCompleted();
+	});
+
+	return Dummy;
+}
+
+void FVoxelMarchingCubeDiskCache::Save(
+	const FVoxelQuery& Query,
+	const uint64 ChunkKey,
+	const FVoxelMarchingCubeSurface& Surface) const
+{
+	VOXEL_FUNCTION_COUNTER();
+	VOXEL_ALLOW_MALLOC_SCOPE();
+	using namespace Voxel::MarchingCube;
+	ensure(ChunkKey != 0);
+
+	// The chunk will be recomputed, and might have read outdated or approximate values
+	// Approximate chunks would otherwise be loaded back as is in the next session, with nothing left to invalidate them
+	if (RuntimeHash.Load() == 0 ||
+		Query.GetDependencyTracker().IsInvalidated() ||
+		Query.GetDependencyTracker().IsApproximate())
+	{
+		return;
+	}
+
+	TArray<uint8> Payload;
+	{
+		FMemoryWriter Writer(Payload);
+		SerializeSurface(Writer, ConstCast(Surface));
+	}
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint32 Magic = DiskCacheMagic;
+	uint32 Version = DiskCacheVersion;
+	uint64 Key = ChunkKey;
+	uint64 PayloadHash = CityHash64(reinterpret_cast<const char*>(Payload.GetData()), uint32(Payload.Num()));
+	Writer << Magic;
+	Writer << Version;
+	Writer << Key;
+	Writer << PayloadHash;
+	Writer.Serialize(Payload.GetData(), Payload.Num());
+
+	GVoxelMarchingCubeDiskCacheFiles.SaveAsync(ChunkKey, MoveTemp(Data));
+}
+
+void FVoxelMarchingCubeDiskCache::ClearAll()
+{
+	GVoxelMarchingCubeDiskCacheFiles.Clear();
+}
@@ -3,6 +3,7 @@
 #include "MarchingCube/VoxelMarchingCubeExecNode.h"
 #include "MarchingCube/VoxelMarchingCubeNodes.h"
 #include "MarchingCube/VoxelMarchingCubeMesh.h"
+#include "MarchingCube/VoxelMarchingCubeDiskCache.h"
 #include "VoxelRuntime.h"
 #include "VoxelSettings.h"
 #include "VoxelDebugNode.h"
@@ -10,6 +11,7 @@
 #include "VoxelDetailTextureNodes.h"
 #include "VoxelScreenSizeChunkSpawner.h"
 #include "Rendering/VoxelMeshComponent.h"
+#include "Collision/VoxelCollisionCooker.h"
 
 FVoxelNodeAliases::TValue<FVoxelMarchingCubeExecNodeMesh> FVoxelMarchingCubeExecNode::CreateMesh(
 	const FVoxelQuery& InQuery,
@@ -414,7 +416,39 @@ FVoxelNodeAliases::TValue<FVoxelMarchingCubeExecNodeMesh> FVoxelMarchingCubeExec
 			{
 				VOXEL_CALL_NODE_BIND(SurfacePin, MarchingCubeSurface)
 				{
-					return MarchingCubeSurface;
+					const TValue<int32> SimplifiedCollisionLOD = GetNodeRuntime().Get(SimplifiedCollisionLODPin, Query);
+
+					return VOXEL_ON_COMPLETE(MarchingCubeSurface, SimplifiedCollisionLOD)
+					{
+						if (SimplifiedCollisionLOD < 0 ||
+							MarchingCubeSurface->LOD < SimplifiedCollisionLOD)
+						{
+							return MarchingCubeSurface;
+						}
+
+						// Only the fields used by the collider node are set
+						const TSharedRef<FVoxelMarchingCubeSurface> SimplifiedSurface = MakeVoxelShared<FVoxelMarchingCubeSurface>();
+						SimplifiedSurface->LOD = MarchingCubeSurface->LOD;
+						SimplifiedSurface->ChunkSize = MarchingCubeSurface->ChunkSize;
+						SimplifiedSurface->ScaledVoxelSize = MarchingCubeSurface->ScaledVoxelSize;
+						SimplifiedSurface->ChunkBounds = MarchingCubeSurface->ChunkBounds;
+
+						// Vertices are in LOD voxels, so the grid scales with the LOD
+						FVoxelCollisionCooker::SimplifyTriangleMesh(
+							MarchingCubeSurface->Indices,
+							MarchingCubeSurface->Vertices,
+							2.f,
+							SimplifiedSurface->Indices,
+							SimplifiedSurface->Vertices);
+
+						if (SimplifiedSurface->Indices.Num() == 0)
+						{
+							// Everything collapsed, keep the full collider rather than none
+							return MarchingCubeSurface;
+						}
+
+						return SimplifiedSurface;
+					};
 				};
 
 				VOXEL_CALL_NODE_BIND(PhysicalMaterialPin)
@@ -446,8 +480,8 @@ TVoxelUniquePtr<FVoxelExecNodeRuntime> FVoxelMarchingCubeExecNode::CreateExecRun
 {
 	if (!FApp::CanEverRender())
 	{
-		// Never create on server
-		return nullptr;
+		// Never render on server, but optionally compute collision
+		return MakeVoxelUnique<FVoxelMarchingCubeServerExecNodeRuntime>(SharedThis);
 	}
 
 	return MakeVoxelUnique<FVoxelMarchingCubeExecNodeRuntime>(SharedThis);
@@ -470,6 +504,11 @@ void FVoxelMarchingCubeExecNodeRuntime::Create()
 	ChunkSpawner = GetConstantPin(Node.ChunkSpawnerPin)->MakeSharedCopy();
 	VoxelSize = GetConstantPin(Node.VoxelSizePin);
 
+	if (GetConstantPin(Node.DiskCachePin))
+	{
+		DiskCache = FVoxelMarchingCubeDiskCache::Create(*GetRuntimeInfo());
+	}
+
 	if (ChunkSpawner->GetStruct() == StaticStructFast<FVoxelChunkSpawner>())
 	{
 		const TSharedRef<FVoxelScreenSizeChunkSpawner> ScreenSizeChunkSpawner = MakeVoxelShared<FVoxelScreenSizeChunkSpawner>();
@@ -566,6 +605,46 @@ void FVoxelMarchingCubeExecNodeRuntime::FChunkInfo::FlushOnComplete()
 	});
 }
 
+void FVoxelMarchingCubeExecNodeRuntime::ComputeMesh(FChunkInfo& ChunkInfo)
+{
+	checkVoxelSlow(ChunkInfos_CriticalSection.IsLocked());
+
+	TVoxelDynamicValueFactory<FVoxelMarchingCubeExecNodeMesh> Factory(STATIC_FNAME("Marching Cube Mesh"), [
+		&Node = Node,
+		VoxelSize = VoxelSize,
+		ChunkSize = ChunkInfo.ChunkSize,
+		Bounds = ChunkInfo.Bounds](const FVoxelQuery& Query)
+	{
+		checkVoxelSlow(FVoxelTaskReferencer::Get().IsReferenced(&Node));
+		return Node.CreateMesh(Query, VoxelSize, ChunkSize, Bounds);
+	});
+
+	const TSharedRef<FVoxelQueryParameters> Parameters = MakeVoxelShared<FVoxelQueryParameters>();
+	Parameters->Add<FVoxelLODQueryParameter>().LOD = ChunkInfo.LOD;
+	if (DiskCache)
+	{
+		Parameters->Add<FVoxelMarchingCubeDiskCacheQueryParameter>().DiskCache = DiskCache;
+	}
+
+	ChunkInfo.PredictionPriorityOffset->Store(ChunkInfo.bPredicted ? GVoxelChunkSpawnerPredictionPriorityOffset : 0.);
+
+	ensure(!ChunkInfo.Mesh.IsValid());
+	ChunkInfo.Mesh = Factory
+		.AddRef(NodeRef)
+		.Priority(FVoxelTaskPriority::MakeBounds(
+			ChunkInfo.Bounds,
+			GetConstantPin(Node.PriorityOffsetPin),
+			GetWorld(),
+			GetLocalToWorld(),
+			ChunkInfo.PredictionPriorityOffset))
+		.Compute(GetContext(), Parameters);
+
+	ChunkInfo.Mesh.OnChanged([QueuedMeshes = QueuedMeshes, ChunkId = ChunkInfo.ChunkId](const TSharedRef<const FVoxelMarchingCubeExecNodeMesh>& NewMesh)
+	{
+		QueuedMeshes->Enqueue(FQueuedMesh{ ChunkId, NewMesh });
+	});
+}
+
 void FVoxelMarchingCubeExecNodeRuntime::ProcessMeshes(FVoxelRuntime& Runtime)
 {
 	VOXEL_FUNCTION_COUNTER();
@@ -596,6 +675,19 @@ void FVoxelMarchingCubeExecNodeRuntime::ProcessMeshes(FVoxelRuntime& Runtime)
 			continue;
 		}
 
+		if (ChunkInfo->bPredicted)
+		{
+			// Not visible yet, will be shown when promoted
+			ChunkInfo->PredictedMesh = QueuedMesh.Mesh;
+			continue;
+		}
+
+		if (ChunkInfo->bMissingWhenVisible)
+		{
+			INC_VOXEL_COUNTER(STAT_VoxelChunkSpawnerMissingChunks);
+			ChunkInfo->bMissingWhenVisible = false;
+		}
+
 		const TSharedPtr<const FVoxelMesh> Mesh = QueuedMesh.Mesh->Mesh;
 		const TSharedPtr<const FVoxelCollider> Collider = QueuedMesh.Mesh->Collider;
 
@@ -691,38 +783,46 @@ void FVoxelMarchingCubeExecNodeRuntime::ProcessAction(FVoxelRuntime* Runtime, co
 	{
 		VOXEL_SCOPE_COUNTER("Compute");
 
-		TVoxelDynamicValueFactory<FVoxelMarchingCubeExecNodeMesh> Factory(STATIC_FNAME("Marching Cube Mesh"), [
-			&Node = Node,
-			VoxelSize = VoxelSize,
-			ChunkSize = ChunkInfo->ChunkSize,
-			Bounds = ChunkInfo->Bounds](const FVoxelQuery& Query)
+		ChunkInfo->bPredicted = Action.bPredicted;
+		ChunkInfo->bMissingWhenVisible = !Action.bPredicted;
+		if (Action.bPredicted)
 		{
-			checkVoxelSlow(FVoxelTaskReferencer::Get().IsReferenced(&Node));
-			return Node.CreateMesh(Query, VoxelSize, ChunkSize, Bounds);
-		});
-
-		const TSharedRef<FVoxelQueryParameters> Parameters = MakeVoxelShared<FVoxelQueryParameters>();
-		Parameters->Add<FVoxelLODQueryParameter>().LOD = ChunkInfo->LOD;
+			INC_VOXEL_COUNTER(STAT_VoxelChunkSpawnerPredictedChunks);
+		}
 
-		ensure(!ChunkInfo->Mesh.IsValid());
-		ChunkInfo->Mesh = Factory
-			.AddRef(NodeRef)
-			.Priority(FVoxelTaskPriority::MakeBounds(
-				ChunkInfo->Bounds,
-				GetConstantPin(Node.PriorityOffsetPin),
-				GetWorld(),
-				GetLocalToWorld()))
-			.Compute(GetContext(), Parameters);
+		ComputeMesh(*ChunkInfo);
 
-		ChunkInfo->Mesh.OnChanged([QueuedMeshes = QueuedMeshes, ChunkId = ChunkInfo->ChunkId](const TSharedRef<const FVoxelMarchingCubeExecNodeMesh>& NewMesh)
+		if (Action.OnComputeComplete)
 		{
-			QueuedMeshes->Enqueue(FQueuedMesh{ ChunkId, NewMesh });
-		});
+			ChunkInfo->OnCompleteArray.Add(Action.OnComputeComplete);
+		}
+	}
+	break;
+	case EVoxelChunkAction::Promote:
+	{
+		VOXEL_SCOPE_COUNTER("Promote");
 
 		if (Action.OnComputeComplete)
 		{
 			ChunkInfo->OnCompleteArray.Add(Action.OnComputeComplete);
 		}
+
+		if (!ChunkInfo->bPredicted)
+		{
+			break;
+		}
+		ChunkInfo->bPredicted = false;
+
+		if (ChunkInfo->PredictedMesh)
+		{
+			INC_VOXEL_COUNTER(STAT_VoxelChunkSpawnerPredictionHits);
+			QueuedMeshes->Enqueue(FQueuedMesh{ ChunkInfo->ChunkId, MoveTemp(ChunkInfo->PredictedMesh) });
+			break;
+		}
+
+		// Computed meshes are already in QueuedMeshes, otherwise bump the tasks to the priority of a visible chunk whether they started or not
+		ChunkInfo->bMissingWhenVisible = !ChunkInfo->Mesh.IsComputed();
+		ChunkInfo->PredictionPriorityOffset->Store(0.);
 	}
 	break;
 	case EVoxelChunkAction::SetTransitionMask:
@@ -767,4 +867,80 @@ void FVoxelMarchingCubeExecNodeRuntime::ProcessAction(FVoxelRuntime* Runtime, co
 	}
 	break;
 	}
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void FVoxelMarchingCubeServerExecNodeRuntime::Create()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const bool bComputeCollision = GetConstantPin(Node.ServerCollisionPin);
+	const bool bComputeNavmesh = GetConstantPin(Node.ServerNavmeshPin);
+
+	if (!bComputeCollision &&
+		!bComputeNavmesh)
+	{
+		return;
+	}
+
+	// Invoker components are registered for every connected player's pawn, so this covers all of them
+	FVoxelMarchingCubeCollisionChunks::FSettings Settings;
+	Settings.InvokerChannel = GetConstantPin(Node.ServerInvokerChannelPin);
+	Settings.VoxelSize = GetConstantPin(Node.VoxelSizePin);
+	Settings.ChunkSize = FMath::Max(GetConstantPin(Node.ServerChunkSizePin), 4);
+	Settings.PriorityOffset = GetConstantPin(Node.PriorityOffsetPin);
+	Settings.bComputeCollision = bComputeCollision;
+
+	if (bComputeNavmesh)
+	{
+		Settings.NavmeshSettings.Emplace();
+		Settings.NavmeshSettings->MaxSlope = GetConstantPin(Node.ServerNavmeshMaxSlopePin);
+		Settings.NavmeshSettings->AgentHeight = GetConstantPin(Node.ServerNavmeshAgentHeightPin);
+		Settings.NavmeshSettings->WeldSize = GetConstantPin(Node.ServerNavmeshSimplificationPin) * Settings.VoxelSize;
+	}
+
+	if (GetConstantPin(Node.DiskCachePin))
+	{
+		Settings.DiskCache = FVoxelMarchingCubeDiskCache::Create(*GetRuntimeInfo());
+	}
+
+	// BodyInstance is a virtual pin here, it's queried for each chunk
+	Chunks = MakeVoxelShared<FVoxelMarchingCubeCollisionChunks>(
+		Node,
+		FVoxelMarchingCubeCollisionChunks::FPins
+		{
+			Node.SurfacePin,
+			Node.PhysicalMaterialPin,
+			Node.DistanceChecksTolerancePin,
+			Node.BodyInstancePin
+		},
+		Settings);
+	Chunks->Create(*this);
+}
+
+void FVoxelMarchingCubeServerExecNodeRuntime::Destroy()
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (!Chunks)
+	{
+		return;
+	}
+
+	Chunks->Destroy(GetRuntime().Get());
+	Chunks.Reset();
+}
+
+void FVoxelMarchingCubeServerExecNodeRuntime::Tick(FVoxelRuntime& Runtime)
+{
+	VOXEL_FUNCTION_COUNTER();
+	ensure(!IsDestroyed());
+
+	if (Chunks)
+	{
+		Chunks->Tick(Runtime);
+	}
+}
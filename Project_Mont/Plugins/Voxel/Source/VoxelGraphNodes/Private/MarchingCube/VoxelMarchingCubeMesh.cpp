@@ -2,6 +2,7 @@
 
 #include "MarchingCube/VoxelMarchingCubeMesh.h"
 #include "Rendering/VoxelShaderHooks.h"
+#include "MeshOptimizer.h"
 
 #include "Engine/Engine.h"
 #include "Engine/Texture2D.h"
@@ -17,6 +18,11 @@
 
 DEFINE_VOXEL_INSTANCE_COUNTER(FVoxelMarchingCubeVertexFactoryBase);
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHNODES_API, bool, GVoxelMarchingCubeQuantizeVertices, false,
+	"voxel.marchingcube.QuantizeVertices",
+	"If true, marching cube positions will be uploaded as 16 bit chunk-local coordinates, vertex normals as 16 bit octahedrons and indices as 16 bit when possible");
+
 DEFINE_VOXEL_SHADER_HOOK(
 	VoxelMarchingCubeVertexFactory,
 	MaterialVertexParameters,
@@ -55,6 +61,9 @@ void FVoxelMarchingCubeVertexFactoryShaderParameters::Bind(const FShaderParamete
 {
 #define BIND(Name) Name.Bind(ParameterMap, TEXT(#Name))
 	BIND(VoxelSize);
+	BIND(PositionScale);
+	BIND(bQuantizedPositions);
+	BIND(bOctahedronNormals);
 	BIND(NumCells);
 	BIND(CellTextureCoordinates);
 	BIND(TextureSampler);
@@ -88,6 +97,9 @@ void FVoxelMarchingCubeVertexFactoryShaderParameters::GetElementShaderBindings(
 	const FVoxelMarchingCubeVertexFactoryBase& VoxelVertexFactory = static_cast<const FVoxelMarchingCubeVertexFactoryBase&>(*VertexFactory);
 
 	ShaderBindings.Add(VoxelSize, VoxelVertexFactory.VoxelSize);
+	ShaderBindings.Add(PositionScale, VoxelVertexFactory.PositionScale);
+	ShaderBindings.Add(bQuantizedPositions, VoxelVertexFactory.bQuantizedPositions ? 1u : 0u);
+	ShaderBindings.Add(bOctahedronNormals, VoxelVertexFactory.bOctahedronNormals ? 1u : 0u);
 	ShaderBindings.Add(NumCells, VoxelVertexFactory.NumCells);
 
 	ShaderBindings.Add(
@@ -238,6 +250,156 @@ IMPLEMENT_VERTEX_FACTORY_TYPE(FVoxelMarchingCubeVertexFactory_WithVertexNormals,
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+void FVoxelMarchingCubeMesh::Optimize()
+{
+	VOXEL_FUNCTION_COUNTER_NUM(Indices.Num(), 1024);
+
+	const int32 NumTriangles = Indices.Num() / 3;
+	if (NumTriangles == 0 ||
+		!ensure(CellIndices.Num() == NumTriangles))
+	{
+		return;
+	}
+
+	TVoxelArray<int32> NewIndices;
+	FVoxelUtilities::SetNumFast(NewIndices, Indices.Num());
+
+	meshopt_optimizeVertexCache(
+		ReinterpretCastPtr<uint32>(NewIndices.GetData()),
+		ReinterpretCastPtr<uint32>(Indices.GetData()),
+		Indices.Num(),
+		Vertices.Num());
+
+	// Triangles are emitted as-is, find them back to reorder cell indices
+	{
+		VOXEL_SCOPE_COUNTER("Remap cell indices");
+
+		TVoxelAddOnlyMap<FIntVector, int32> TriangleToIndex;
+		TriangleToIndex.Reserve(NumTriangles);
+
+		// Duplicated triangles are chained
+		TVoxelArray<int32> NextTriangle;
+		FVoxelUtilities::SetNumFast(NextTriangle, NumTriangles);
+
+		for (int32 TriangleIndex = 0; TriangleIndex < NumTriangles; TriangleIndex++)
+		{
+			const FIntVector Triangle(
+				Indices[3 * TriangleIndex + 0],
+				Indices[3 * TriangleIndex + 1],
+				Indices[3 * TriangleIndex + 2]);
+
+			if (int32* FirstTriangle = TriangleToIndex.Find(Triangle))
+			{
+				NextTriangle[TriangleIndex] = *FirstTriangle;
+				*FirstTriangle = TriangleIndex;
+			}
+			else
+			{
+				NextTriangle[TriangleIndex] = -1;
+				TriangleToIndex.Add_CheckNew(Triangle, TriangleIndex);
+			}
+		}
+
+		TVoxelArray<int32> NewCellIndices;
+		FVoxelUtilities::SetNumFast(NewCellIndices, NumTriangles);
+
+		for (int32 TriangleIndex = 0; TriangleIndex < NumTriangles; TriangleIndex++)
+		{
+			const FIntVector Triangle(
+				NewIndices[3 * TriangleIndex + 0],
+				NewIndices[3 * TriangleIndex + 1],
+				NewIndices[3 * TriangleIndex + 2]);
+
+			int32& OldTriangleIndex = TriangleToIndex.FindChecked(Triangle);
+			check(OldTriangleIndex != -1);
+
+			NewCellIndices[TriangleIndex] = CellIndices[OldTriangleIndex];
+			OldTriangleIndex = NextTriangle[OldTriangleIndex];
+		}
+
+		CellIndices = MoveTemp(NewCellIndices);
+	}
+
+	Indices = MoveTemp(NewIndices);
+
+	// Order vertices by first use, keeping edge vertices first as they are the only ones translated & with normals at higher LODs
+	TVoxelArray<int32> OldToNewVertex;
+	FVoxelUtilities::SetNumFast(OldToNewVertex, Vertices.Num());
+	FVoxelUtilities::Memset(OldToNewVertex, 0xFF);
+
+	int32 NumNewEdgeVertices = 0;
+	int32 NumNewOtherVertices = NumEdgeVertices;
+
+	const auto AddVertex = [&](const int32 OldIndex)
+	{
+		int32& NewIndex = OldToNewVertex[OldIndex];
+		if (NewIndex != -1)
+		{
+			return;
+		}
+
+		NewIndex = OldIndex < NumEdgeVertices ? NumNewEdgeVertices++ : NumNewOtherVertices++;
+	};
+
+	for (const int32 Index : Indices)
+	{
+		AddVertex(Index);
+	}
+	// Vertices only used by transitions
+	for (int32 Index = 0; Index < Vertices.Num(); Index++)
+	{
+		AddVertex(Index);
+	}
+	check(NumNewEdgeVertices == NumEdgeVertices);
+	check(NumNewOtherVertices == Vertices.Num());
+
+	const auto RemapArray = [&](TVoxelArray<FVector3f>& Array)
+	{
+		TVoxelArray<FVector3f> NewArray;
+		FVoxelUtilities::SetNumFast(NewArray, Array.Num());
+
+		for (int32 Index = 0; Index < Array.Num(); Index++)
+		{
+			NewArray[OldToNewVertex[Index]] = Array[Index];
+		}
+
+		Array = MoveTemp(NewArray);
+	};
+
+	RemapArray(Vertices);
+
+	// Either all vertices or only edge vertices have normals
+	ensure(VertexNormals.Num() == 0 || VertexNormals.Num() == NumEdgeVertices || VertexNormals.Num() == Vertices.Num());
+	RemapArray(VertexNormals);
+
+	for (int32& Index : Indices)
+	{
+		Index = OldToNewVertex[Index];
+	}
+
+	for (TVoxelArray<FTransitionIndex>& Array : TransitionIndices)
+	{
+		for (FTransitionIndex& TransitionIndex : Array)
+		{
+			if (!TransitionIndex.bIsRelative)
+			{
+				TransitionIndex.Index = OldToNewVertex[TransitionIndex.Index];
+			}
+		}
+	}
+	for (TVoxelArray<FTransitionVertex>& Array : TransitionVertices)
+	{
+		for (FTransitionVertex& TransitionVertex : Array)
+		{
+			TransitionVertex.SourceVertex = OldToNewVertex[TransitionVertex.SourceVertex];
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 void FVoxelMarchingCubeMesh::SetTransitionMask_GameThread(uint8 NewTransitionMask)
 {
 	VOXEL_ENQUEUE_RENDER_COMMAND(SetTransitionMask_RenderThread)(MakeWeakPtrLambda(this, [this, NewTransitionMask](FRHICommandList& RHICmdList)
@@ -540,18 +702,40 @@ void FVoxelMarchingCubeMesh::SetTransitionMask_RenderThread(FRHICommandList& RHI
 	VertexNormalsBuffer.Reset();
 	PrimitivesDataBuffer.Reset();
 
+	const bool bQuantize = GVoxelMarchingCubeQuantizeVertices;
+
 	{
 		VOXEL_SCOPE_COUNTER("Indices");
 
 		IndicesBuffer = MakeVoxelShared<FIndexBuffer>();
 
-		FVoxelResourceArrayRef ResourceArray(NewIndices);
-		FRHIResourceCreateInfo CreateInfo(TEXT("Indices"), &ResourceArray);
-		IndicesBuffer->IndexBufferRHI = UE_503_SWITCH(RHICreateIndexBuffer, RHICmdList.CreateIndexBuffer)(
-			sizeof(int32),
-			NewIndices.Num() * sizeof(int32),
-			BUF_Static,
-			CreateInfo);
+		if (bQuantize &&
+			NewVertices.Num() <= MAX_uint16 + 1)
+		{
+			TVoxelArray<uint16> NewIndices16;
+			FVoxelUtilities::SetNumFast(NewIndices16, NewIndices.Num());
+			for (int32 Index = 0; Index < NewIndices.Num(); Index++)
+			{
+				NewIndices16[Index] = NewIndices[Index];
+			}
+			FVoxelResourceArrayRef ResourceArray(NewIndices16);
+			FRHIResourceCreateInfo CreateInfo(TEXT("Indices"), &ResourceArray);
+			IndicesBuffer->IndexBufferRHI = UE_503_SWITCH(RHICreateIndexBuffer, RHICmdList.CreateIndexBuffer)(
+				sizeof(uint16),
+				NewIndices16.Num() * sizeof(uint16),
+				BUF_Static,
+				CreateInfo);
+		}
+		else
+		{
+			FVoxelResourceArrayRef ResourceArray(NewIndices);
+			FRHIResourceCreateInfo CreateInfo(TEXT("Indices"), &ResourceArray);
+			IndicesBuffer->IndexBufferRHI = UE_503_SWITCH(RHICreateIndexBuffer, RHICmdList.CreateIndexBuffer)(
+				sizeof(int32),
+				NewIndices.Num() * sizeof(int32),
+				BUF_Static,
+				CreateInfo);
+		}
 		IndicesBuffer->InitResource(UE_503_ONLY(RHICmdList));
 	}
 
@@ -560,15 +744,60 @@ void FVoxelMarchingCubeMesh::SetTransitionMask_RenderThread(FRHICommandList& RHI
 
 		VerticesBuffer = MakeVoxelShared<FVertexBuffer>();
 
-		FVoxelResourceArrayRef ResourceArray(NewVertices);
-		FRHIResourceCreateInfo CreateInfo(TEXT("Vertices"), &ResourceArray);
-		VerticesBuffer->VertexBufferRHI = UE_503_SWITCH(RHICreateVertexBuffer, RHICmdList.CreateVertexBuffer)(
-			NewVertices.Num() * sizeof(FVector3f),
-			BUF_Static,
-			CreateInfo);
-		VerticesBuffer->InitResource(UE_503_ONLY(RHICmdList));
-
-		VertexFactory->PositionComponent = FVertexStreamComponent(VerticesBuffer.Get(), 0, sizeof(FVector3f), VET_Float3);
+		if (bQuantize)
+		{
+			// Positions are chunk-local, in [0, ChunkSize]
+			// Use a power of two fixed point scale so that integer positions are exact: the detail textures rely on frac(VoxelPosition)
+			const int32 ScaleLog2 = FMath::FloorLog2(MAX_uint16 / ChunkSize);
+			const float Scale = 1 << ScaleLog2;
+
+			bool bOutOfRange = false;
+			TVoxelArray<uint64> QuantizedVertices;
+			FVoxelUtilities::SetNumFast(QuantizedVertices, NewVertices.Num());
+			for (int32 Index = 0; Index < NewVertices.Num(); Index++)
+			{
+				const FVector3f& Vertex = NewVertices[Index];
+				const int32 X = FMath::RoundToInt(Vertex.X * Scale);
+				const int32 Y = FMath::RoundToInt(Vertex.Y * Scale);
+				const int32 Z = FMath::RoundToInt(Vertex.Z * Scale);
+
+				bOutOfRange |=
+					X < 0 || X > MAX_uint16 ||
+					Y < 0 || Y > MAX_uint16 ||
+					Z < 0 || Z > MAX_uint16;
+
+				QuantizedVertices[Index] =
+					(uint64(FMath::Clamp(X, 0, MAX_uint16)) << 0) |
+					(uint64(FMath::Clamp(Y, 0, MAX_uint16)) << 16) |
+					(uint64(FMath::Clamp(Z, 0, MAX_uint16)) << 32);
+			}
+			ensureMsgf(!bOutOfRange, TEXT("Marching cube vertex outside of [0, %d], quantized mesh will be distorted"), ChunkSize);
+			FVoxelResourceArrayRef ResourceArray(QuantizedVertices);
+			FRHIResourceCreateInfo CreateInfo(TEXT("Vertices"), &ResourceArray);
+			VerticesBuffer->VertexBufferRHI = UE_503_SWITCH(RHICreateVertexBuffer, RHICmdList.CreateVertexBuffer)(
+				QuantizedVertices.Num() * sizeof(uint64),
+				BUF_Static,
+				CreateInfo);
+			VerticesBuffer->InitResource(UE_503_ONLY(RHICmdList));
+
+			VertexFactory->PositionComponent = FVertexStreamComponent(VerticesBuffer.Get(), 0, sizeof(uint64), VET_UShort4N);
+			VertexFactory->PositionScale = 1.f / Scale;
+			VertexFactory->bQuantizedPositions = true;
+		}
+		else
+		{
+			FVoxelResourceArrayRef ResourceArray(NewVertices);
+			FRHIResourceCreateInfo CreateInfo(TEXT("Vertices"), &ResourceArray);
+			VerticesBuffer->VertexBufferRHI = UE_503_SWITCH(RHICreateVertexBuffer, RHICmdList.CreateVertexBuffer)(
+				NewVertices.Num() * sizeof(FVector3f),
+				BUF_Static,
+				CreateInfo);
+			VerticesBuffer->InitResource(UE_503_ONLY(RHICmdList));
+
+			VertexFactory->PositionComponent = FVertexStreamComponent(VerticesBuffer.Get(), 0, sizeof(FVector3f), VET_Float3);
+			VertexFactory->PositionScale = 1.f;
+			VertexFactory->bQuantizedPositions = false;
+		}
 	}
 
 	{
@@ -596,17 +825,47 @@ void FVoxelMarchingCubeMesh::SetTransitionMask_RenderThread(FRHICommandList& RHI
 
 		VertexNormalsBuffer = MakeVoxelShared<FVertexBuffer>();
 
-		FVoxelResourceArrayRef ResourceArray(NewVertexNormals);
-		FRHIResourceCreateInfo CreateInfo(TEXT("VertexNormals"), &ResourceArray);
-		VertexNormalsBuffer->VertexBufferRHI = UE_503_SWITCH(RHICreateVertexBuffer, RHICmdList.CreateVertexBuffer)(
-			NewVertexNormals.Num() * sizeof(FVector3f),
-			BUF_Static,
-			CreateInfo);
-		VertexNormalsBuffer->InitResource(UE_503_ONLY(RHICmdList));
-
-		VertexFactory->VertexNormalComponent = FVertexStreamComponent(VertexNormalsBuffer.Get(), 0, sizeof(FVector3f), VET_Float3);
+		if (bQuantize)
+		{
+			TVoxelArray<uint32> Octahedrons;
+			FVoxelUtilities::SetNumFast(Octahedrons, NewVertexNormals.Num());
+			for (int32 Index = 0; Index < NewVertexNormals.Num(); Index++)
+			{
+				const FVector3f Normal = NewVertexNormals[Index].GetSafeNormal(UE_SMALL_NUMBER, FVector3f::UpVector);
+				const FVector2f Octahedron = FVoxelUtilities::UnitVectorToOctahedron(Normal);
+				const uint32 X = FMath::Clamp<int32>(FMath::RoundToInt(Octahedron.X * MAX_uint16), 0, MAX_uint16);
+				const uint32 Y = FMath::Clamp<int32>(FMath::RoundToInt(Octahedron.Y * MAX_uint16), 0, MAX_uint16);
+				Octahedrons[Index] = X | (Y << 16);
+			}
+			FVoxelResourceArrayRef ResourceArray(Octahedrons);
+			FRHIResourceCreateInfo CreateInfo(TEXT("VertexNormals"), &ResourceArray);
+			VertexNormalsBuffer->VertexBufferRHI = UE_503_SWITCH(RHICreateVertexBuffer, RHICmdList.CreateVertexBuffer)(
+				Octahedrons.Num() * sizeof(uint32),
+				BUF_Static,
+				CreateInfo);
+			VertexNormalsBuffer->InitResource(UE_503_ONLY(RHICmdList));
+
+			VertexFactory->VertexNormalComponent = FVertexStreamComponent(VertexNormalsBuffer.Get(), 0, sizeof(uint32), VET_UShort2N);
+			VertexFactory->bOctahedronNormals = true;
+		}
+		else
+		{
+			FVoxelResourceArrayRef ResourceArray(NewVertexNormals);
+			FRHIResourceCreateInfo CreateInfo(TEXT("VertexNormals"), &ResourceArray);
+			VertexNormalsBuffer->VertexBufferRHI = UE_503_SWITCH(RHICreateVertexBuffer, RHICmdList.CreateVertexBuffer)(
+				NewVertexNormals.Num() * sizeof(FVector3f),
+				BUF_Static,
+				CreateInfo);
+			VertexNormalsBuffer->InitResource(UE_503_ONLY(RHICmdList));
+
+			VertexFactory->VertexNormalComponent = FVertexStreamComponent(VertexNormalsBuffer.Get(), 0, sizeof(FVector3f), VET_Float3);
+			VertexFactory->bOctahedronNormals = false;
+		}
 	}
 
+	// Buffers are recreated when the transition mask changes
+	UpdateGpuStats();
+
 	if (VertexFactory->IsInitialized())
 	{
 		VOXEL_INLINE_COUNTER("VertexFactory ReleaseResource", VertexFactory->ReleaseResource());
@@ -648,6 +907,10 @@ int64 FVoxelMarchingCubeMesh::GetGpuAllocatedSize() const
 	{
 		AllocatedSize += VertexNormalsBuffer->VertexBufferRHI->GetSize();
 	}
+	if (PrimitivesDataBuffer && PrimitivesDataBuffer->VertexBufferRHI)
+	{
+		AllocatedSize += PrimitivesDataBuffer->VertexBufferRHI->GetSize();
+	}
 	return AllocatedSize;
 }
 
@@ -917,4 +1180,17 @@ bool FVoxelMarchingCubeMesh::Draw_RenderThread(const FPrimitiveSceneProxy& Proxy
 #endif
 
 	return true;
+}
+
+void FVoxelMarchingCubeMesh::OnVisible_AnyThread() const
+{
+	if (!ComputedMaterial)
+	{
+		return;
+	}
+
+	for (const TSharedPtr<FVoxelDetailTextureAllocation>& Allocation : ComputedMaterial->Parameters.DetailTextureAllocations)
+	{
+		Allocation->MarkUsed_AnyThread();
+	}
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "MarchingCube/VoxelMarchingCubeNodes.h"
 #include "MarchingCube/VoxelMarchingCubeMesh.h"
 #include "MarchingCube/VoxelMarchingCubeProcessor.h"
+#include "MarchingCube/VoxelMarchingCubeDiskCache.h"
 #include "VoxelGradientNodes.h"
 #include "VoxelDetailTextureNodes.h"
 #include "VoxelDistanceFieldWrapper.h"
@@ -36,6 +37,11 @@ VOXEL_CONSOLE_VARIABLE(
 	"Add padding to perfectly overlap chunks distance fields. "
 	"This might cause invalid entries into Lumen's surface cache and glitches in Lumen at chunk borders.");
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELGRAPHNODES_API, bool, GVoxelMarchingCubeOptimizeMeshes, true,
+	"voxel.marchingcube.OptimizeMeshes",
+	"If true, marching cube mesh triangles & vertices will be reordered for the GPU vertex cache");
+
 DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_GenerateMarchingCubeSurface, Surface)
 {
 	FindVoxelQueryParameter(FVoxelLODQueryParameter, LODQueryParameter);
@@ -101,7 +107,7 @@ DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_GenerateMarchingCubeSurface, Surface)
 				});
 		};
 
-		return VOXEL_ON_COMPLETE(Bounds, LOD, ChunkSize, EnableTransitions, PerfectTransitions, DataSize, ScaledVoxelSize, ShouldSkip)
+		return VOXEL_ON_COMPLETE(Bounds, LOD, ChunkSize, EnableTransitions, PerfectTransitions, DataSize, ScaledVoxelSize, EnableDistanceChecks, ShouldSkip)
 		{
 			if (ShouldSkip)
 			{
@@ -117,100 +123,155 @@ DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_GenerateMarchingCubeSurface, Surface)
 				FVoxelGameUtilities::DrawBox({}, Bounds, Query.GetQueryToWorld().Get_NoDependency(), FColor::Red);
 			}
 
-			const TSharedRef<FVoxelQueryParameters> Parameters = Query.CloneParameters();
-			Parameters->Add<FVoxelGradientStepQueryParameter>().Step = ScaledVoxelSize;
-			Parameters->Add<FVoxelPositionQueryParameter>().InitializeGrid(FVector3f(Bounds.Min), ScaledVoxelSize, FIntVector(DataSize));
-
-			const TValue<FVoxelFloatBuffer> Distances = Get(DistancePin, Query.MakeNewQuery(Parameters));
-
-			return VOXEL_ON_COMPLETE(Bounds, LOD, ChunkSize, EnableTransitions, PerfectTransitions, DataSize, ScaledVoxelSize, Distances)
+			// The distance checks above registered the same dependencies as the full query would,
+			// so the chunk is still invalidated when loaded from disk
+			const TSharedPtr<const FVoxelMarchingCubeDiskCache> DiskCache = INLINE_LAMBDA -> TSharedPtr<const FVoxelMarchingCubeDiskCache>
 			{
-				if (Distances.IsConstant() ||
-					!ensure(Distances.Num() == DataSize * DataSize * DataSize))
-				{
-					return {};
-				}
-
-				const TSharedRef<FVoxelMarchingCubeSurface> Surface = MakeVoxelShared<FVoxelMarchingCubeSurface>();
-				Surface->LOD = LOD;
-				Surface->ChunkSize = ChunkSize;
-				Surface->ScaledVoxelSize = ScaledVoxelSize;
-				Surface->ChunkBounds = Bounds;
-
-				const TSharedRef<FVoxelMarchingCubeProcessor> Processor = MakeVoxelShared<FVoxelMarchingCubeProcessor>(
-					ChunkSize,
-					DataSize,
-					ConstCast(Distances.GetStorage()),
-					*Surface);
-				Processor->bPerfectTransitions = PerfectTransitions;
-				Processor->Generate(EnableTransitions);
-
-				if (Surface->Cells.Num() == 0)
+				const FVoxelMarchingCubeDiskCacheQueryParameter* DiskCacheQueryParameter = Query.GetParameters().Find<FVoxelMarchingCubeDiskCacheQueryParameter>();
+				if (!DiskCacheQueryParameter ||
+					!EnableDistanceChecks)
 				{
-					return {};
+					return nullptr;
 				}
-				ensure(Surface->Indices.Num() > 0);
+				return DiskCacheQueryParameter->DiskCache;
+			};
 
-				if (!PerfectTransitions)
+			const uint64 DiskCacheKey = DiskCache ? DiskCache->GetChunkKey(Query, LOD, ChunkSize, ScaledVoxelSize, Bounds, EnableTransitions, PerfectTransitions) : 0;
+			// Read the file on the IO thread pool, and only query the distances if the chunk isn't cached
+			const TSharedRef<TSharedPtr<FVoxelMarchingCubeSurface>> CachedSurface = MakeVoxelShared<TSharedPtr<FVoxelMarchingCubeSurface>>();
+			const FVoxelDummyFutureValue Loaded = INLINE_LAMBDA
+			{
+				if (DiskCacheKey != 0)
 				{
-					return Surface;
+					return DiskCache->LoadAsync(DiskCacheKey, CachedSurface);
 				}
 
-				using FTransitionVertexToQuery = FVoxelMarchingCubeProcessor::FTransitionVertexToQuery;
-
-				FVoxelFloatBufferStorage QueryX;
-				FVoxelFloatBufferStorage QueryY;
-				FVoxelFloatBufferStorage QueryZ;
+				const FVoxelDummyFutureValue Dummy = FVoxelFutureValue::MakeDummy();
+				Dummy.MarkDummyAsCompleted();
+				return Dummy;
+			};
 
-				for (const TVoxelArray<FTransitionVertexToQuery>& Array : Processor->TransitionVerticesToQuery)
+			return VOXEL_ON_COMPLETE(Bounds, LOD, ChunkSize, EnableTransitions, PerfectTransitions, DataSize, ScaledVoxelSize, DiskCache, DiskCacheKey, CachedSurface, Loaded)
+			{
+				if (*CachedSurface)
 				{
-					for (const FTransitionVertexToQuery& VertexToQuery : Array)
+					if ((*CachedSurface)->Cells.Num() == 0)
 					{
-						QueryX.Add(float(Bounds.Min.X) + VertexToQuery.PositionA.X * ScaledVoxelSize);
-						QueryY.Add(float(Bounds.Min.Y) + VertexToQuery.PositionA.Y * ScaledVoxelSize);
-						QueryZ.Add(float(Bounds.Min.Z) + VertexToQuery.PositionA.Z * ScaledVoxelSize);
-
-						QueryX.Add(float(Bounds.Min.X) + VertexToQuery.PositionB.X * ScaledVoxelSize);
-						QueryY.Add(float(Bounds.Min.Y) + VertexToQuery.PositionB.Y * ScaledVoxelSize);
-						QueryZ.Add(float(Bounds.Min.Z) + VertexToQuery.PositionB.Z * ScaledVoxelSize);
+						return {};
 					}
+					return CachedSurface->ToSharedRef();
 				}
 
-				if (QueryX.Num() == 0 ||
-					QueryY.Num() == 0 ||
-					QueryZ.Num() == 0)
+				const TValue<FVoxelMarchingCubeSurface> Surface = INLINE_LAMBDA -> TValue<FVoxelMarchingCubeSurface>
 				{
-					ensure(QueryX.Num() == 0);
-					ensure(QueryY.Num() == 0);
-					ensure(QueryZ.Num() == 0);
-					return Surface;
-				}
-
-				const TSharedRef<FVoxelQueryParameters> TransitionParameters = Query.CloneParameters();
-				TransitionParameters->Add<FVoxelLODQueryParameter>().LOD = LOD + 1;
-				TransitionParameters->Add<FVoxelGradientStepQueryParameter>().Step = ScaledVoxelSize * 2;
-				TransitionParameters->Add<FVoxelPositionQueryParameter>().Initialize(FVoxelVectorBuffer::Make(QueryX, QueryY, QueryZ));
+					const TSharedRef<FVoxelQueryParameters> Parameters = Query.CloneParameters();
+					Parameters->Add<FVoxelGradientStepQueryParameter>().Step = ScaledVoxelSize;
+					Parameters->Add<FVoxelPositionQueryParameter>().InitializeGrid(FVector3f(Bounds.Min), ScaledVoxelSize, FIntVector(DataSize));
 
-				const TValue<FVoxelFloatBuffer> TransitionDistances = Get(DistancePin, Query.MakeNewQuery(TransitionParameters));
+					const TValue<FVoxelFloatBuffer> Distances = Get(DistancePin, Query.MakeNewQuery(Parameters));
 
-				return VOXEL_ON_COMPLETE(Surface, Processor, TransitionDistances)
-				{
-					int32 Index = 0;
-					for (int32 Direction = 0; Direction < 6; Direction++)
+					return VOXEL_ON_COMPLETE(Bounds, LOD, ChunkSize, EnableTransitions, PerfectTransitions, DataSize, ScaledVoxelSize, Distances)
 					{
-						for (const FTransitionVertexToQuery& VertexToQuery : Processor->TransitionVerticesToQuery[Direction])
+						if (Distances.IsConstant() ||
+							!ensure(Distances.Num() == DataSize * DataSize * DataSize))
+						{
+							return {};
+						}
+
+						const TSharedRef<FVoxelMarchingCubeSurface> Surface = MakeVoxelShared<FVoxelMarchingCubeSurface>();
+						Surface->LOD = LOD;
+						Surface->ChunkSize = ChunkSize;
+						Surface->ScaledVoxelSize = ScaledVoxelSize;
+						Surface->ChunkBounds = Bounds;
+
+						const TSharedRef<FVoxelMarchingCubeProcessor> Processor = MakeVoxelShared<FVoxelMarchingCubeProcessor>(
+							ChunkSize,
+							DataSize,
+							ConstCast(Distances.GetStorage()),
+							*Surface);
+						Processor->bPerfectTransitions = PerfectTransitions;
+						Processor->Generate(EnableTransitions);
+
+						if (Surface->Cells.Num() == 0)
 						{
-							const float ValueA = TransitionDistances[Index++];
-							const float ValueB = TransitionDistances[Index++];
+							return {};
+						}
+						ensure(Surface->Indices.Num() > 0);
+
+						if (!PerfectTransitions)
+						{
+							return Surface;
+						}
+
+						using FTransitionVertexToQuery = FVoxelMarchingCubeProcessor::FTransitionVertexToQuery;
+
+						FVoxelFloatBufferStorage QueryX;
+						FVoxelFloatBufferStorage QueryY;
+						FVoxelFloatBufferStorage QueryZ;
 
-							const float Alpha = ValueA / (ValueA - ValueB);
-							const FVector3f Position = FMath::Lerp(FVector3f(VertexToQuery.PositionA), FVector3f(VertexToQuery.PositionB), Alpha);
+						for (const TVoxelArray<FTransitionVertexToQuery>& Array : Processor->TransitionVerticesToQuery)
+						{
+							for (const FTransitionVertexToQuery& VertexToQuery : Array)
+							{
+								QueryX.Add(float(Bounds.Min.X) + VertexToQuery.PositionA.X * ScaledVoxelSize);
+								QueryY.Add(float(Bounds.Min.Y) + VertexToQuery.PositionA.Y * ScaledVoxelSize);
+								QueryZ.Add(float(Bounds.Min.Z) + VertexToQuery.PositionA.Z * ScaledVoxelSize);
+
+								QueryX.Add(float(Bounds.Min.X) + VertexToQuery.PositionB.X * ScaledVoxelSize);
+								QueryY.Add(float(Bounds.Min.Y) + VertexToQuery.PositionB.Y * ScaledVoxelSize);
+								QueryZ.Add(float(Bounds.Min.Z) + VertexToQuery.PositionB.Z * ScaledVoxelSize);
+							}
+						}
 
-							Surface->TransitionVertices[Direction][VertexToQuery.Index].Position = Position;
+						if (QueryX.Num() == 0 ||
+							QueryY.Num() == 0 ||
+							QueryZ.Num() == 0)
+						{
+							ensure(QueryX.Num() == 0);
+							ensure(QueryY.Num() == 0);
+							ensure(QueryZ.Num() == 0);
+							return Surface;
 						}
-					}
-					ensure(TransitionDistances.IsConstant() || TransitionDistances.Num() == Index);
 
+						const TSharedRef<FVoxelQueryParameters> TransitionParameters = Query.CloneParameters();
+						TransitionParameters->Add<FVoxelLODQueryParameter>().LOD = LOD + 1;
+						TransitionParameters->Add<FVoxelGradientStepQueryParameter>().Step = ScaledVoxelSize * 2;
+						TransitionParameters->Add<FVoxelPositionQueryParameter>().Initialize(FVoxelVectorBuffer::Make(QueryX, QueryY, QueryZ));
+
+						const TValue<FVoxelFloatBuffer> TransitionDistances = Get(DistancePin, Query.MakeNewQuery(TransitionParameters));
+
+						return VOXEL_ON_COMPLETE(Surface, Processor, TransitionDistances)
+						{
+							int32 Index = 0;
+							for (int32 Direction = 0; Direction < 6; Direction++)
+							{
+								for (const FTransitionVertexToQuery& VertexToQuery : Processor->TransitionVerticesToQuery[Direction])
+								{
+									const float ValueA = TransitionDistances[Index++];
+									const float ValueB = TransitionDistances[Index++];
+
+									const float Alpha = ValueA / (ValueA - ValueB);
+									const FVector3f Position = FMath::Lerp(FVector3f(VertexToQuery.PositionA), FVector3f(VertexToQuery.PositionB), Alpha);
+
+									Surface->TransitionVertices[Direction][VertexToQuery.Index].Position = Position;
+								}
+							}
+							ensure(TransitionDistances.IsConstant() || TransitionDistances.Num() == Index);
+
+							return Surface;
+						};
+					};
+				};
+
+				if (DiskCacheKey == 0)
+				{
+					return Surface;
+				}
+
+				return VOXEL_ON_COMPLETE(DiskCache, DiskCacheKey, Surface)
+				{
+					// Empty chunks are saved too, they have no cells
+					DiskCache->Save(Query, DiskCacheKey, *Surface);
 					return Surface;
 				};
 			};
@@ -475,6 +536,12 @@ DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_CreateMarchingCubeMesh, Mesh)
 					}
 				}
 
+				if (GVoxelMarchingCubeOptimizeMeshes)
+				{
+					// Surface is left untouched, its triangles are still sorted by cell for detail textures
+					Mesh->Optimize();
+				}
+
 				if (GenerateDistanceField)
 				{
 					{
@@ -306,58 +306,66 @@ TVoxelFutureValue<FVoxelComputedMaterialParameter> FVoxelDetailTextureParameter:
 		{
 			const TSharedRef<FVoxelDetailTextureAllocation> Allocation = Pool->Allocate_AnyThread(TextureSize, Helper->NumCells(), Query);
 
-			TVoxelArray<TSharedRef<FVoxelDetailTextureUpload>> Uploads;
-			for (int32 TextureIndex = 0; TextureIndex < Allocation->NumTextures; TextureIndex++)
+			TVoxelArray<FVoxelDetailTextureCoordinate> CellCoordinates0;
+			TVoxelArray<FVoxelDummyFutureValue> UploadDummies;
+			if (Allocation->IsOutOfSpace())
 			{
-				Uploads.Add(MakeVoxelShared<FVoxelDetailTextureUpload>(*Allocation, TextureIndex));
+				// Over budget: sample the first block until off-screen allocations are evicted and this chunk is recomputed
+				CellCoordinates0.SetNumZeroed(Helper->NumCells());
 			}
-
-			TVoxelArray<FVoxelDetailTextureCoordinate> CellCoordinates0;
-			for (int32 TextureIndex = 0; TextureIndex < Allocation->NumTextures; TextureIndex++)
+			else
 			{
-				TVoxelArray<FVoxelDetailTextureCoordinate> CellCoordinates;
-				CellCoordinates.Reserve(Helper->NumCells());
-
-				int32 Index = 0;
-
-				FVoxelDetailTextureCoordinate Coordinate;
-				TVoxelArrayView<uint8> Data;
-				int32 Pitch = 0;
-				while (Uploads[TextureIndex]->GetUploadInfo(Coordinate, Data, Pitch))
+				TVoxelArray<TSharedRef<FVoxelDetailTextureUpload>> Uploads;
+				for (int32 TextureIndex = 0; TextureIndex < Allocation->NumTextures; TextureIndex++)
 				{
-					ComputeCell(
-						Index,
-						Pitch,
-						TextureSize,
-						Allocation->PixelFormat,
-						TextureIndex,
-						*Buffer,
-						Data);
-
-					CellCoordinates.Add(Coordinate);
-					Index += TextureSize * TextureSize;
+					Uploads.Add(MakeVoxelShared<FVoxelDetailTextureUpload>(*Allocation, TextureIndex));
 				}
-				ensure(Buffer->IsConstant() || Buffer->Num() == Index);
-				ensure(CellCoordinates.Num() == Helper->NumCells());
 
-				if (TextureIndex == 0)
+				for (int32 TextureIndex = 0; TextureIndex < Allocation->NumTextures; TextureIndex++)
 				{
-					CellCoordinates0 = MoveTemp(CellCoordinates);
+					TVoxelArray<FVoxelDetailTextureCoordinate> CellCoordinates;
+					CellCoordinates.Reserve(Helper->NumCells());
+
+					int32 Index = 0;
+
+					FVoxelDetailTextureCoordinate Coordinate;
+					TVoxelArrayView<uint8> Data;
+					int32 Pitch = 0;
+					while (Uploads[TextureIndex]->GetUploadInfo(Coordinate, Data, Pitch))
+					{
+						ComputeCell(
+							Index,
+							Pitch,
+							TextureSize,
+							Allocation->PixelFormat,
+							TextureIndex,
+							*Buffer,
+							Data);
+
+						CellCoordinates.Add(Coordinate);
+						Index += TextureSize * TextureSize;
+					}
+					ensure(Buffer->IsConstant() || Buffer->Num() == Index);
+					ensure(CellCoordinates.Num() == Helper->NumCells());
+
+					if (TextureIndex == 0)
+					{
+						CellCoordinates0 = MoveTemp(CellCoordinates);
+					}
+					else
+					{
+						checkVoxelSlow(ReinterpretCastVoxelArray<uint32>(CellCoordinates0) == ReinterpretCastVoxelArray<uint32>(CellCoordinates));
+					}
 				}
-				else
+
+				for (const TSharedRef<FVoxelDetailTextureUpload>& Upload : Uploads)
 				{
-					checkVoxelSlow(ReinterpretCastVoxelArray<uint32>(CellCoordinates0) == ReinterpretCastVoxelArray<uint32>(CellCoordinates));
+					UploadDummies.Add(Upload->Upload());
 				}
 			}
 
 			const int32 CellCoordinatesTextureIndex = Helper->AddCellCoordinates(MoveTemp(CellCoordinates0));
 
-			TVoxelArray<FVoxelDummyFutureValue> UploadDummies;
-			for (const TSharedRef<FVoxelDetailTextureUpload>& Upload : Uploads)
-			{
-				UploadDummies.Add(Upload->Upload());
-			}
-
 			return VOXEL_ON_COMPLETE(TextureSize, Allocation, CellCoordinatesTextureIndex, UploadDummies)
 			{
 				FVoxelComputedMaterialParameter MaterialParameters;
@@ -372,7 +380,7 @@ TVoxelFutureValue<FVoxelComputedMaterialParameter> FVoxelDetailTextureParameter:
 					MaterialParameters.DynamicParameters.Add(NameOverride.GetValue(), Allocation->GetTexture());
 				}
 
-				MaterialParameters.Resources.Add(Allocation);
+				MaterialParameters.DetailTextureAllocations.Add(Allocation);
 				return MaterialParameters;
 			};
 		};
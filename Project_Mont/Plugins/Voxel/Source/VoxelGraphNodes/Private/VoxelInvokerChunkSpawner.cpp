@@ -19,7 +19,7 @@ void FVoxelInvokerChunkSpawner::Tick(FVoxelRuntime& Runtime)
 
 	VOXEL_SCOPE_LOCK(CriticalSection);
 
-	ChunkRefs_RequiresLock.Empty();
+	Chunks_RequiresLock.Empty();
 
 	InvokerView_GameThread = FVoxelInvokerManager::Get(Runtime.GetWorld())->MakeView(
 		InvokerChannel,
@@ -30,33 +30,123 @@ void FVoxelInvokerChunkSpawner::Tick(FVoxelRuntime& Runtime)
 	InvokerViewBindRef_GameThread = MakeSharedVoid();
 
 	InvokerView_GameThread->Bind_Async(
-		MakeWeakPtrDelegate(InvokerViewBindRef_GameThread, MakeWeakPtrLambda(this, [=](const TVoxelAddOnlySet<FIntVector>& ChunksToAdd)
+		MakeWeakPtrDelegate(InvokerViewBindRef_GameThread, MakeWeakPtrLambda(this, [this, FullChunkSize](const TVoxelAddOnlySet<FIntVector>& ChunksToAdd)
 		{
-			VOXEL_SCOPE_COUNTER("OnAddChunk");
-			VOXEL_SCOPE_LOCK(CriticalSection);
+			AddChunks(ChunksToAdd, FullChunkSize, false);
+		})),
+		MakeWeakPtrDelegate(InvokerViewBindRef_GameThread, MakeWeakPtrLambda(this, [this](const TVoxelAddOnlySet<FIntVector>& ChunksToRemove)
+		{
+			RemoveChunks(ChunksToRemove, false);
+		})));
 
-			for (const FIntVector& Chunk : ChunksToAdd)
-			{
-				const TSharedRef<FVoxelChunkRef> ChunkRef = CreateChunk(
-					LOD,
-					ChunkSize,
-					FVoxelBox(FVector(Chunk) * FullChunkSize, FVector(Chunk + 1) * FullChunkSize));
-				ChunkRef->Compute();
-
-				ensure(!ChunkRefs_RequiresLock.Contains(Chunk));
-				ChunkRefs_RequiresLock.Add(Chunk) = ChunkRef;
-			}
+	if (PredictionTime <= 0.f)
+	{
+		PredictedInvokerView_GameThread = {};
+		return;
+	}
+
+	PredictedInvokerView_GameThread = FVoxelInvokerManager::Get(Runtime.GetWorld())->MakeView(
+		InvokerChannel,
+		FullChunkSize,
+		0,
+		Runtime.GetLocalToWorld(),
+		PredictionTime);
+
+	PredictedInvokerView_GameThread->Bind_Async(
+		MakeWeakPtrDelegate(InvokerViewBindRef_GameThread, MakeWeakPtrLambda(this, [this, FullChunkSize](const TVoxelAddOnlySet<FIntVector>& ChunksToAdd)
+		{
+			AddChunks(ChunksToAdd, FullChunkSize, true);
 		})),
 		MakeWeakPtrDelegate(InvokerViewBindRef_GameThread, MakeWeakPtrLambda(this, [this](const TVoxelAddOnlySet<FIntVector>& ChunksToRemove)
 		{
-			VOXEL_SCOPE_COUNTER("OnRemoveChunk");
-			VOXEL_SCOPE_LOCK(CriticalSection);
+			RemoveChunks(ChunksToRemove, true);
+		})));
+}
+
+void FVoxelInvokerChunkSpawner::AddChunks(
+	const TVoxelAddOnlySet<FIntVector>& ChunksToAdd,
+	const int32 FullChunkSize,
+	const bool bPredicted)
+{
+	VOXEL_FUNCTION_COUNTER();
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	for (const FIntVector& ChunkKey : ChunksToAdd)
+	{
+		FChunk& Chunk = Chunks_RequiresLock.FindOrAdd(ChunkKey);
+
+		if (bPredicted)
+		{
+			ensure(!Chunk.bIsPredicted);
+			Chunk.bIsPredicted = true;
+		}
+		else
+		{
+			ensure(!Chunk.bIsVisible);
+			Chunk.bIsVisible = true;
+		}
 
-			for (const FIntVector& Chunk : ChunksToRemove)
+		if (Chunk.ChunkRef)
+		{
+			if (!bPredicted)
 			{
-				ensure(ChunkRefs_RequiresLock.Remove(Chunk));
+				// Prefetched earlier, the prediction was right
+				Chunk.ChunkRef->Promote();
 			}
-		})));
+			continue;
+		}
+
+		Chunk.ChunkRef = CreateChunk(
+			LOD,
+			ChunkSize,
+			FVoxelBox(FVector(ChunkKey) * FullChunkSize, FVector(ChunkKey + 1) * FullChunkSize));
+
+		if (bPredicted)
+		{
+			Chunk.ChunkRef->Prefetch();
+		}
+		else
+		{
+			Chunk.ChunkRef->Compute();
+		}
+	}
+}
+
+void FVoxelInvokerChunkSpawner::RemoveChunks(
+	const TVoxelAddOnlySet<FIntVector>& ChunksToRemove,
+	const bool bPredicted)
+{
+	VOXEL_FUNCTION_COUNTER();
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	for (const FIntVector& ChunkKey : ChunksToRemove)
+	{
+		FChunk* Chunk = Chunks_RequiresLock.Find(ChunkKey);
+		if (!ensure(Chunk))
+		{
+			continue;
+		}
+
+		if (bPredicted)
+		{
+			ensure(Chunk->bIsPredicted);
+			Chunk->bIsPredicted = false;
+		}
+		else
+		{
+			ensure(Chunk->bIsVisible);
+			Chunk->bIsVisible = false;
+		}
+
+		if (Chunk->bIsVisible ||
+			Chunk->bIsPredicted)
+		{
+			continue;
+		}
+
+		// Releasing the chunk ref cancels its task if it's still queued
+		Chunks_RequiresLock.Remove(ChunkKey);
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -69,8 +159,9 @@ DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_MakeInvokerChunkSpawner, Spawner)
 	const TValue<float> WorldSize = Get(WorldSizePin, Query);
 	const TValue<int32> ChunkSize = Get(ChunkSizePin, Query);
 	const TValue<FName> InvokerChannel = Get(InvokerChannelPin, Query);
+	const TValue<float> PredictionTime = Get(PredictionTimePin, Query);
 
-	return VOXEL_ON_COMPLETE(LOD, WorldSize, ChunkSize, InvokerChannel)
+	return VOXEL_ON_COMPLETE(LOD, WorldSize, ChunkSize, InvokerChannel, PredictionTime)
 	{
 		const TSharedRef<FVoxelInvokerChunkSpawner> Spawner = MakeVoxelShared<FVoxelInvokerChunkSpawner>();
 		Spawner->NodeRef = GetNodeRef();
@@ -78,6 +169,7 @@ DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_MakeInvokerChunkSpawner, Spawner)
 		Spawner->WorldSize = WorldSize;
 		Spawner->ChunkSize = FMath::Clamp(FMath::CeilToInt(ChunkSize / 2.f) * 2, 4, 128);
 		Spawner->InvokerChannel = InvokerChannel;
+		Spawner->PredictionTime = FMath::Max(PredictionTime, 0.f);
 		return Spawner;
 	};
 }
\ No newline at end of file
@@ -42,27 +42,73 @@ void FVoxelScreenSizeChunkSpawner::Tick(FVoxelRuntime& Runtime)
 
 	ON_SCOPE_EXIT
 	{
-		if (bUpdateQueued && LastViewOrigin.IsSet())
+		if (bUpdateQueued && LastViews.Num() > 0)
 		{
-			UpdateTree(LastViewOrigin.GetValue());
+			UpdateTree(LastViews, LastPredictedViews);
 		}
 	};
 
-	FVector ViewOrigin = FVector::ZeroVector;
-	if (!FVoxelGameUtilities::GetCameraView(Runtime.GetWorld_GameThread(), ViewOrigin))
+	TArray<FVoxelViewOrigin> Views;
+	if (!FVoxelGameUtilities::GetViewOrigins(Runtime.GetWorld_GameThread(), Views))
 	{
 		return;
 	}
 
-	ViewOrigin = Runtime.GetLocalToWorld().Get_NoDependency().InverseTransformPosition(ViewOrigin);
+	const FMatrix WorldToLocal = Runtime.GetLocalToWorld().Get_NoDependency().Inverse();
+	for (FVoxelViewOrigin& View : Views)
+	{
+		View.Position = WorldToLocal.TransformPosition(View.Position);
+	}
+
+	TArray<FVoxelViewOrigin> PredictedViews;
+	if (PredictionTime > 0.f)
+	{
+		// Players joining or leaving reorder the views, match them by player controller
+		TVoxelMap<FObjectKey, FVoxelChunkSpawnerVelocity> NewPlayerControllerToVelocity;
+		NewPlayerControllerToVelocity.Reserve(Views.Num());
+
+		const double Time = FPlatformTime::Seconds();
+		for (const FVoxelViewOrigin& View : Views)
+		{
+			FVoxelChunkSpawnerVelocity Velocity = PlayerControllerToVelocity.FindRef(View.PlayerController);
+			Velocity.Update(View.Position, Time);
+			NewPlayerControllerToVelocity.Add(View.PlayerController, Velocity);
+
+			FVoxelViewOrigin PredictedView = View;
+			PredictedView.Position = Velocity.Predict(PredictionTime);
+			PredictedViews.Add(PredictedView);
+		}
+
+		PlayerControllerToVelocity = MoveTemp(NewPlayerControllerToVelocity);
+	}
+
+	const auto HaveViewsChanged = [](const TArray<FVoxelViewOrigin>& NewViews, const TArray<FVoxelViewOrigin>& OldViews)
+	{
+		if (NewViews.Num() != OldViews.Num())
+		{
+			return true;
+		}
 
-	if (LastViewOrigin.IsSet() &&
-		FVector::Distance(ViewOrigin, LastViewOrigin.GetValue()) < GVoxelChunkSpawnerCameraRefreshThreshold)
+		for (int32 Index = 0; Index < NewViews.Num(); Index++)
+		{
+			if (NewViews[Index].Weight != OldViews[Index].Weight ||
+				FVector::Distance(NewViews[Index].Position, OldViews[Index].Position) >= GVoxelChunkSpawnerCameraRefreshThreshold)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	};
+
+	if (!HaveViewsChanged(Views, LastViews) &&
+		!HaveViewsChanged(PredictedViews, LastPredictedViews))
 	{
 		return;
 	}
 
-	LastViewOrigin = ViewOrigin;
+	LastViews = MoveTemp(Views);
+	LastPredictedViews = MoveTemp(PredictedViews);
 	bUpdateQueued = true;
 }
 
@@ -75,7 +121,9 @@ void FVoxelScreenSizeChunkSpawner::Refresh()
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
-void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
+void FVoxelScreenSizeChunkSpawner::UpdateTree(
+	const TArray<FVoxelViewOrigin>& Views,
+	const TArray<FVoxelViewOrigin>& PredictedViews)
 {
 	VOXEL_FUNCTION_COUNTER();
 
@@ -95,24 +143,20 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 	ensure(!bTaskInProgress);
 	bTaskInProgress = true;
 
-	AsyncVoxelTask(MakeWeakPtrLambda(this, [this, ViewOrigin, OctreeDepth, OldTree = Octree]
+	AsyncVoxelTask(MakeWeakPtrLambda(this, [this, Views, PredictedViews, OctreeDepth]
 	{
-		const TSharedRef<FOctree> NewTree = MakeVoxelShared<FOctree>(
-			OctreeDepth,
-			ViewOrigin,
-			*this);
-
-		if (OldTree)
+		// WorldSize & ChunkSize never change, a new spawner is created instead
+		if (!Octree)
 		{
-			VOXEL_SCOPE_COUNTER("CopyFrom");
-			NewTree->CopyFrom(*OldTree);
+			Octree = MakeVoxelShared<FOctree>(OctreeDepth, *this);
 		}
 
 		TMap<FChunkId, FChunkInfo> ChunkInfos;
 		TSet<FChunkId> ChunksToAdd;
 		TSet<FChunkId> ChunksToRemove;
 		TSet<FChunkId> ChunksToUpdate;
-		NewTree->Update(LastChunkScreenSize.GetValue(), ChunkInfos, ChunksToAdd, ChunksToRemove, ChunksToUpdate);
+		TMap<FChunkId, TArray<FChunkId>> ChunkToPreviousChunks;
+		Octree->Update(LastChunkScreenSize.GetValue(), Views, ChunkInfos, ChunksToAdd, ChunksToRemove, ChunksToUpdate, ChunkToPreviousChunks);
 
 		{
 			VOXEL_SCOPE_COUNTER("Sort");
@@ -124,6 +168,32 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 			});
 		}
 
+		TMap<FChunkId, FChunkInfo> PredictedChunkInfos;
+		TSet<FChunkId> PredictedChunksToAdd;
+		TSet<FChunkId> PredictedChunksToRemove;
+		if (PredictedViews.Num() > 0)
+		{
+			VOXEL_SCOPE_COUNTER("Update prediction");
+
+			if (!PredictedOctree)
+			{
+				PredictedOctree = MakeVoxelShared<FOctree>(OctreeDepth, *this);
+				PredictedOctree->bIsPrediction = true;
+			}
+
+			// Predicted chunks are never rendered, their replacement chains don't matter
+			TSet<FChunkId> PredictedChunksToUpdate;
+			TMap<FChunkId, TArray<FChunkId>> PredictedChunkToPreviousChunks;
+			PredictedOctree->Update(
+				LastChunkScreenSize.GetValue(),
+				PredictedViews,
+				PredictedChunkInfos,
+				PredictedChunksToAdd,
+				PredictedChunksToRemove,
+				PredictedChunksToUpdate,
+				PredictedChunkToPreviousChunks);
+		}
+
 		VOXEL_SCOPE_LOCK(CriticalSection);
 
 		for (const FChunkId ChunkId : ChunksToUpdate)
@@ -174,32 +244,38 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 			const TSharedPtr<FChunk> Chunk = Chunks_RequiresLock.Add(ChunkId, MakeVoxelShared<FChunk>());
 			ensureVoxelSlow(ChunkInfo.ChunkBounds.Size().GetAbsMax() > 1);
 
-			Chunk->ChunkRef = CreateChunk(ChunkInfo.LOD, ChunkSize, ChunkInfo.ChunkBounds);
+			// Reuse the chunk if it was prefetched
+			TSharedPtr<FVoxelChunkRef> PredictedChunkRef;
+			const bool bWasPredicted = PredictedChunks_RequiresLock.RemoveAndCopyValue(ChunkInfo.NodeBounds, PredictedChunkRef);
+			if (bWasPredicted)
+			{
+				Chunk->ChunkRef = PredictedChunkRef;
+			}
+			else
+			{
+				Chunk->ChunkRef = CreateChunk(ChunkInfo.LOD, ChunkSize, ChunkInfo.ChunkBounds);
+			}
 
 			const TSharedRef<FPreviousChunks> PreviousChunks = MakeVoxelShared<FPreviousChunks>();
-			if (OldTree)
+			if (const TArray<FChunkId>* PreviousChunkIds = ChunkToPreviousChunks.Find(ChunkId))
 			{
-				OldTree->TraverseBounds(ChunkInfos[ChunkId].NodeBounds, [&](const FOctree::FNodeRef TreeNodeRef)
+				for (const FChunkId PreviousChunkId : *PreviousChunkIds)
 				{
-					const FNode& Node = OldTree->GetNode(TreeNodeRef);
-					if (!Node.bIsRendered ||
-						!ChunksToRemove.Contains(Node.ChunkId))
+					if (!ensure(ChunksToRemove.Contains(PreviousChunkId)))
 					{
-						return;
+						continue;
 					}
 
-					checkVoxelSlow(!OldTree->HasAnyChildren(TreeNodeRef));
-
-					const TSharedPtr<FChunk> OldChunk = Chunks_RequiresLock.FindRef(Node.ChunkId);
+					const TSharedPtr<FChunk> OldChunk = Chunks_RequiresLock.FindRef(PreviousChunkId);
 					if (!ensure(OldChunk))
 					{
-						return;
+						continue;
 					}
 
 					ensure(!OldChunk->ChunkRef);
 					ensure(OldChunk->PreviousChunks);
 					PreviousChunks->Children.Add(OldChunk->PreviousChunks);
-				});
+				}
 			}
 
 			if (PreviousChunks->Children.Num() > 0)
@@ -208,7 +284,8 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 			}
 
 			Chunk->ChunkRef->SetTransitionMask(ChunkInfo.TransitionMask);
-			Chunk->ChunkRef->Compute(MakeWeakPtrLambda(this, [this, ChunkId]
+
+			TVoxelUniqueFunction<void()> OnComputeComplete = MakeWeakPtrLambda(this, [this, ChunkId]
 			{
 				VOXEL_SCOPE_LOCK(CriticalSection);
 				if (!Chunks_RequiresLock.Contains(ChunkId))
@@ -217,7 +294,42 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 				}
 
 				Chunks_RequiresLock[ChunkId]->PreviousChunks.Reset();
-			}));
+			});
+
+			if (bWasPredicted)
+			{
+				Chunk->ChunkRef->Promote(MoveTemp(OnComputeComplete));
+			}
+			else
+			{
+				Chunk->ChunkRef->Compute(MoveTemp(OnComputeComplete));
+			}
+		}
+
+		for (const FChunkId ChunkId : PredictedChunksToRemove)
+		{
+			// Wrong prediction: releasing the chunk ref cancels its task if it's still queued
+			// No-op if the chunk was reused above
+			PredictedChunks_RequiresLock.Remove(PredictedChunkInfos[ChunkId].NodeBounds);
+		}
+
+		for (const FChunkId ChunkId : PredictedChunksToAdd)
+		{
+			const FChunkInfo& ChunkInfo = PredictedChunkInfos[ChunkId];
+			if (Octree->IsRendered(ChunkInfo.NodeBounds))
+			{
+				// Already visible
+				continue;
+			}
+
+			if (!ensure(!PredictedChunks_RequiresLock.Contains(ChunkInfo.NodeBounds)))
+			{
+				continue;
+			}
+
+			const TSharedRef<FVoxelChunkRef> ChunkRef = CreateChunk(ChunkInfo.LOD, ChunkSize, ChunkInfo.ChunkBounds);
+			ChunkRef->Prefetch();
+			PredictedChunks_RequiresLock.Add(ChunkInfo.NodeBounds, ChunkRef);
 		}
 
 		for (const FChunkId ChunkId : ChunksToRemove)
@@ -231,6 +343,8 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 			ensure(!Chunk->ChunkRef);
 		}
 
+		const int32 NumNodes = Octree->NumNodes();
+
 		FVoxelUtilities::RunOnGameThread(MakeWeakPtrLambda(this, [=]
 		{
 			VOXEL_FUNCTION_COUNTER();
@@ -239,12 +353,10 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 			ensure(bTaskInProgress);
 			bTaskInProgress = false;
 
-			if (NewTree->NumNodes() >= GVoxelChunkSpawnerMaxChunks)
+			if (NumNodes >= GVoxelChunkSpawnerMaxChunks)
 			{
 				VOXEL_MESSAGE(Error, "{0}: voxel.chunkspawner.MaxChunks reached", GraphNodeRef);
 			}
-
-			Octree = NewTree;
 		}));
 	}));
 }
@@ -255,10 +367,12 @@ void FVoxelScreenSizeChunkSpawner::UpdateTree(const FVector& ViewOrigin)
 
 void FVoxelScreenSizeChunkSpawner::FOctree::Update(
 	const float ChunkScreenSize,
+	const TArray<FVoxelViewOrigin>& Views,
 	TMap<FChunkId, FChunkInfo>& ChunkInfos,
 	TSet<FChunkId>& ChunksToAdd,
 	TSet<FChunkId>& ChunksToRemove,
-	TSet<FChunkId>& ChunksToUpdate)
+	TSet<FChunkId>& ChunksToUpdate,
+	TMap<FChunkId, TArray<FChunkId>>& ChunkToPreviousChunks)
 {
 	VOXEL_FUNCTION_COUNTER();
 
@@ -321,29 +435,79 @@ void FVoxelScreenSizeChunkSpawner::FOctree::Update(
 		if (NodeRef.GetHeight() > 0)
 		{
 			const FVoxelBox ChunkBounds = GetChunkBounds(NodeRef);
+			const double ChunkWorldSize = ChunkBounds.Size().GetMax();
+
+			// Finest LOD required by any view
+			bool bShouldSubdivide = NodeRef.GetHeight() > Object.MaxLOD;
+			for (const FVoxelViewOrigin& View : Views)
+			{
+				if (bShouldSubdivide)
+				{
+					break;
+				}
+
+				const double Distance = ChunkBounds.DistanceFromBoxToPoint(View.Position);
+				// Don't take the projection/FOV into account, as it leads to
+				// unwanted/unstable results on different screen ratio or when zooming
+				const double ScreenSize = View.Weight * ChunkWorldSize / FMath::Max(1., Distance);
 
-			const double Distance = ChunkBounds.DistanceFromBoxToPoint(ViewOrigin);
-			// Don't take the projection/FOV into account, as it leads to
-			// unwanted/unstable results on different screen ratio or when zooming
-			const double ScreenSize = ChunkBounds.Size().GetMax() / FMath::Max(1., Distance);
+				bShouldSubdivide = ScreenSize > ChunkScreenSize;
+			}
 
-			if (ScreenSize > ChunkScreenSize ||
-				NodeRef.GetHeight() > Object.MaxLOD)
+			if (bShouldSubdivide)
 			{
 				if (!HasAnyChildren(NodeRef))
 				{
 					CreateAllChildren(NodeRef);
 				}
+
+				FNode& Node = GetNode(NodeRef);
+
+				// The new children replace this node, or whatever this node was itself replacing
+				// if it was created in this update and is subdivided further right away
+				TArray<FChunkId> PreviousChunks;
+				if (Node.bIsRendered)
+				{
+					PreviousChunks.Add(Node.ChunkId);
+				}
+				else
+				{
+					ChunkToPreviousChunks.RemoveAndCopyValue(Node.ChunkId, PreviousChunks);
+				}
+
 				HideNode(NodeRef);
 
+				if (PreviousChunks.Num() > 0)
+				{
+					TraverseChildren(NodeRef, [&](const FNodeRef ChildRef)
+					{
+						ChunkToPreviousChunks.Add(GetNode(ChildRef).ChunkId, PreviousChunks);
+						return false;
+					});
+				}
+
 				return true;
 			}
 		}
 
 		if (HasAnyChildren(NodeRef))
 		{
-			TraverseChildren(NodeRef, HideNode);
+			TArray<FChunkId> PreviousChunks;
+			TraverseChildren(NodeRef, [&](const FNodeRef ChildRef)
+			{
+				const FNode& Child = GetNode(ChildRef);
+				if (Child.bIsRendered)
+				{
+					PreviousChunks.Add(Child.ChunkId);
+				}
+				HideNode(ChildRef);
+			});
 			DestroyAllChildren(NodeRef);
+
+			if (PreviousChunks.Num() > 0)
+			{
+				ChunkToPreviousChunks.Add(GetNode(NodeRef).ChunkId, MoveTemp(PreviousChunks));
+			}
 		}
 
 		ShowNode(NodeRef);
@@ -351,7 +515,8 @@ void FVoxelScreenSizeChunkSpawner::FOctree::Update(
 		return false;
 	});
 
-	if (!Object.bEnableTransitions)
+	if (!Object.bEnableTransitions ||
+		bIsPrediction)
 	{
 		return;
 	}
@@ -441,6 +606,29 @@ FORCEINLINE bool FVoxelScreenSizeChunkSpawner::FOctree::AdjacentNodeHasHigherHei
 	return Result.GetHeight() > NodeRef.GetHeight();
 }
 
+bool FVoxelScreenSizeChunkSpawner::FOctree::IsRendered(const FVoxelIntBox& NodeBounds) const
+{
+	const FVector PositionToQuery = NodeBounds.ToVoxelBox().GetCenter();
+
+	if (!Root().GetBounds().ContainsFloat(PositionToQuery))
+	{
+		return false;
+	}
+
+	FNodeRef Result = Root();
+
+	while (!(Result.GetBounds() == NodeBounds))
+	{
+		if (Result.GetHeight() == 0 ||
+			!TryGetChild(Result, PositionToQuery, Result))
+		{
+			return false;
+		}
+	}
+
+	return GetNode(Result).bIsRendered;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -451,8 +639,9 @@ DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_MakeScreenSizeChunkSpawner, Spawner)
 	const TValue<int32> ChunkSize = Get(ChunkSizePin, Query);
 	const TValue<int32> MaxLOD = Get(MaxLODPin, Query);
 	const TValue<bool> EnableTransitions = Get(EnableTransitionsPin, Query);
+	const TValue<float> PredictionTime = Get(PredictionTimePin, Query);
 
-	return VOXEL_ON_COMPLETE(WorldSize, ChunkSize, MaxLOD, EnableTransitions)
+	return VOXEL_ON_COMPLETE(WorldSize, ChunkSize, MaxLOD, EnableTransitions, PredictionTime)
 	{
 		const TSharedRef<FVoxelScreenSizeChunkSpawner> Spawner = MakeVoxelShared<FVoxelScreenSizeChunkSpawner>();
 		Spawner->GraphNodeRef = GetNodeRef();
@@ -460,6 +649,7 @@ DEFINE_VOXEL_NODE_COMPUTE(FVoxelNode_MakeScreenSizeChunkSpawner, Spawner)
 		Spawner->ChunkSize = FMath::Clamp(FMath::CeilToInt(ChunkSize / 2.f) * 2, 4, 128);
 		Spawner->MaxLOD = MaxLOD;
 		Spawner->bEnableTransitions = EnableTransitions;
+		Spawner->PredictionTime = FMath::Max(PredictionTime, 0.f);
 		Spawner->ChunkScreenSizeValueFactory = MakeDynamicValueFactory(ChunkScreenSizePin);
 		Spawner->QueryContext = Query.GetSharedContext();
 		Spawner->QueryParameters = Query.GetSharedParameters();
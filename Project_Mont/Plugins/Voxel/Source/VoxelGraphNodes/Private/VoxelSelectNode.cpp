@@ -211,6 +211,43 @@ void FVoxelNode_Select::PostSerialize()
 	Super::PostSerialize();
 }
 
+FName FVoxelNode_Select::GetConstantPassthroughPin(
+	const FName OutputPinName,
+	const TVoxelMap<FName, FVoxelPinValue>& ConstantInputs) const
+{
+	const FVoxelPinValue* IndexValue = ConstantInputs.Find(IndexPin);
+	if (!IndexValue)
+	{
+		return {};
+	}
+
+	int32 Index;
+	if (IndexValue->Is<bool>())
+	{
+		Index = IndexValue->Get<bool>() ? 1 : 0;
+	}
+	else if (IndexValue->Is<uint8>())
+	{
+		Index = IndexValue->Get<uint8>();
+	}
+	else if (IndexValue->Is<int32>())
+	{
+		Index = IndexValue->Get<int32>();
+	}
+	else
+	{
+		return {};
+	}
+
+	if (!ValuePins.IsValidIndex(Index))
+	{
+		// Let the runtime return the default value
+		return {};
+	}
+
+	return ValuePins[Index];
+}
+
 void FVoxelNode_Select::FixupValuePins()
 {
 	for (const FVoxelPinRef& Pin : ValuePins)
@@ -7,12 +7,119 @@
 #include "VoxelExecNode.h"
 #include "VoxelFastOctree.h"
 #include "VoxelPhysicalMaterial.h"
+#include "Navigation/VoxelNavmesh.h"
 #include "VoxelMarchingCubeCollisionNode.generated.h"
 
 struct FVoxelCollider;
 class FVoxelInvokerView;
 class UVoxelCollisionComponent;
 class UVoxelNavigationComponent;
+class FVoxelMarchingCubeDiskCache;
+
+USTRUCT()
+struct VOXELGRAPHNODES_API FVoxelMarchingCubeCollisionChunk
+{
+	GENERATED_BODY()
+
+	// Null if empty
+	TSharedPtr<const FVoxelCollider> Collider;
+	TSharedPtr<const FBodyInstance> BodyInstance;
+};
+
+// Computes collision & navmesh in chunks around the invokers of a channel
+// Used by FVoxelMarchingCubeCollisionExecNode, and by FVoxelMarchingCubeExecNode on dedicated servers
+class VOXELGRAPHNODES_API FVoxelMarchingCubeCollisionChunks
+	: public FVirtualDestructor
+	, public FVoxelNodeAliases
+	, public TSharedFromThis<FVoxelMarchingCubeCollisionChunks>
+{
+public:
+	// Pins of the owning node
+	struct FPins
+	{
+		TVoxelPinRef<FVoxelSurface> Surface;
+		TVoxelPinRef<FVoxelPhysicalMaterialBuffer> PhysicalMaterial;
+		TVoxelPinRef<float> DistanceChecksTolerance;
+		// Only queried if FSettings::BodyInstance is null
+		TVoxelPinRef<FBodyInstance> BodyInstance;
+	};
+	struct FSettings
+	{
+		FName InvokerChannel;
+		float VoxelSize = 0.f;
+		int32 ChunkSize = 0;
+		double PriorityOffset = 0.;
+		bool bComputeCollision = false;
+		// If set the navmesh is built in the task pool too, see FVoxelTriangleMeshCollider::PrecomputedNavmesh
+		TOptional<FVoxelNavmeshSettings> NavmeshSettings;
+		TSharedPtr<const FBodyInstance> BodyInstance;
+		TSharedPtr<const FVoxelMarchingCubeDiskCache> DiskCache;
+	};
+
+	// Node must outlive this
+	const FVoxelNode& Node;
+	const FPins Pins;
+	const FSettings Settings;
+
+	FVoxelMarchingCubeCollisionChunks(
+		const FVoxelNode& Node,
+		const FPins& Pins,
+		const FSettings& Settings)
+		: Node(Node)
+		, Pins(Pins)
+		, Settings(Settings)
+	{
+	}
+
+	FORCEINLINE const FVoxelGraphNodeRef& GetNodeRef() const
+	{
+		return Node.GetNodeRef();
+	}
+	FORCEINLINE const FVoxelNodeRuntime& GetNodeRuntime() const
+	{
+		return Node.GetNodeRuntime();
+	}
+
+	void Create(const FVoxelExecNodeRuntime& Owner);
+	void Destroy(FVoxelRuntime* Runtime);
+	void Tick(FVoxelRuntime& Runtime);
+
+	TValue<FVoxelMarchingCubeCollisionChunk> CreateChunk(
+		const FVoxelQuery& InQuery,
+		const FVoxelBox& Bounds) const;
+
+private:
+	struct FChunk
+	{
+		FChunk() = default;
+		~FChunk()
+		{
+			ensure(!Value_RequiresLock.IsValid());
+			ensure(!CollisionComponent_GameThread.IsValid());
+			ensure(!NavigationComponent_GameThread.IsValid());
+		}
+
+		TVoxelDynamicValue<FVoxelMarchingCubeCollisionChunk> Value_RequiresLock;
+		TWeakObjectPtr<UVoxelCollisionComponent> CollisionComponent_GameThread;
+		TWeakObjectPtr<UVoxelNavigationComponent> NavigationComponent_GameThread;
+	};
+
+	TSharedPtr<FVoxelInvokerView> InvokerView;
+
+	FVoxelFastCriticalSection CriticalSection;
+	TVoxelIntVectorMap<TSharedPtr<FChunk>> Chunks_RequiresLock;
+
+	struct FQueuedChunk
+	{
+		TWeakPtr<FChunk> Chunk;
+		TSharedPtr<const FVoxelMarchingCubeCollisionChunk> Value;
+	};
+	TQueue<FQueuedChunk, EQueueMode::Mpsc> QueuedChunks;
+	TQueue<TSharedPtr<FChunk>, EQueueMode::Mpsc> ChunksToDestroy;
+
+	void ProcessChunksToDestroy(FVoxelRuntime* Runtime);
+	void ProcessQueuedChunks(FVoxelRuntime& Runtime);
+};
 
 USTRUCT(DisplayName = "Generate Marching Cube Collision & Navmesh")
 struct VOXELGRAPHNODES_API FVoxelMarchingCubeCollisionExecNode : public FVoxelExecNode
@@ -30,15 +137,17 @@ struct VOXELGRAPHNODES_API FVoxelMarchingCubeCollisionExecNode : public FVoxelEx
 	VOXEL_INPUT_PIN(FVoxelPhysicalMaterialBuffer, PhysicalMaterial, nullptr, VirtualPin, AdvancedDisplay);
 	VOXEL_INPUT_PIN(float, DistanceChecksTolerance, 1.f, VirtualPin, AdvancedDisplay);
 	VOXEL_INPUT_PIN(int32, ChunkSize, 32, ConstantPin, AdvancedDisplay);
+	// Triangles steeper than this are not walkable, in degrees. Should match your nav agents max slope
+	VOXEL_INPUT_PIN(float, NavmeshMaxSlope, 44.f, ConstantPin, AdvancedDisplay);
+	// Walls & cave ceilings higher than this above every walkable surface can't block agents and are not sent to the nav system
+	// Should be at least your tallest nav agent height
+	VOXEL_INPUT_PIN(float, NavmeshAgentHeight, 200.f, ConstantPin, AdvancedDisplay);
+	// Navmesh vertices closer than this are welded together, in voxels. 0 to disable
+	VOXEL_INPUT_PIN(float, NavmeshSimplification, 0.5f, ConstantPin, AdvancedDisplay);
 	// Priority offset, added to the task distance from camera
 	// Closest tasks are computed first, so set this to a very low value (eg, -1000000) if you want it to be computed first
 	VOXEL_INPUT_PIN(double, PriorityOffset, -2000000, ConstantPin, AdvancedDisplay);
 
-	TValue<FVoxelCollider> CreateCollider(
-		const FVoxelQuery& InQuery,
-		float VoxelSize,
-		int32 ChunkSize,
-		const FVoxelBox& Bounds) const;
 	virtual TVoxelUniquePtr<FVoxelExecNodeRuntime> CreateExecRuntime(const TSharedRef<const FVoxelExecNode>& SharedThis) const override;
 };
 
@@ -54,38 +163,5 @@ public:
 	//~ End FVoxelExecNodeRuntime Interface
 
 private:
-	struct FChunk
-	{
-		FChunk() = default;
-		~FChunk()
-		{
-			ensure(!Collider_RequiresLock.IsValid());
-			ensure(!CollisionComponent_GameThread.IsValid());
-			ensure(!NavigationComponent_GameThread.IsValid());
-		}
-
-		TVoxelDynamicValue<FVoxelCollider> Collider_RequiresLock;
-		TWeakObjectPtr<UVoxelCollisionComponent> CollisionComponent_GameThread;
-		TWeakObjectPtr<UVoxelNavigationComponent> NavigationComponent_GameThread;
-	};
-
-public:
-	TSharedPtr<const FBodyInstance> BodyInstance;
-	bool bComputeCollision = false;
-	bool bComputeNavmesh = false;
-	TSharedPtr<FVoxelInvokerView> InvokerView;
-
-	FVoxelFastCriticalSection CriticalSection;
-	TVoxelIntVectorMap<TSharedPtr<FChunk>> Chunks_RequiresLock;
-
-	struct FQueuedCollider
-	{
-		TWeakPtr<FChunk> Chunk;
-		TSharedPtr<const FVoxelCollider> Collider;
-	};
-	TQueue<FQueuedCollider, EQueueMode::Mpsc> QueuedColliders;
-	TQueue<TSharedPtr<FChunk>, EQueueMode::Mpsc> ChunksToDestroy;
-
-	void ProcessChunksToDestroy();
-	void ProcessQueuedColliders(FVoxelRuntime& Runtime);
+	TSharedPtr<FVoxelMarchingCubeCollisionChunks> Chunks;
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+// Copyright Voxel Plugin, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "VoxelMinimal.h"
+#include "VoxelFutureValue.h"
+#include "VoxelQueryParameter.h"
+#include "VoxelMarchingCubeDiskCache.generated.h"
+
+class FVoxelQuery;
+class FVoxelRuntimeInfo;
+struct FVoxelMarchingCubeSurface;
+
+DECLARE_VOXEL_COUNTER(VOXELGRAPHNODES_API, STAT_VoxelMarchingCubeDiskCacheHits, "Marching Cube Disk Cache Hits");
+DECLARE_VOXEL_COUNTER(VOXELGRAPHNODES_API, STAT_VoxelMarchingCubeDiskCacheMisses, "Marching Cube Disk Cache Misses");
+
+extern VOXELGRAPHNODES_API float GVoxelMarchingCubeDiskCacheSize;
+
+// Generated surfaces of a single runtime, saved to Saved/Voxel/SurfaceCache and reused across sessions
+// Chunks are keyed by the graph, its parameters, the assets they reference, the runtime transform and the chunk LOD & bounds
+class VOXELGRAPHNODES_API FVoxelMarchingCubeDiskCache : public TSharedFromThis<FVoxelMarchingCubeDiskCache>
+{
+public:
+	// Game thread only
+	// Hashes the content of the graph, the graphs it references and the parameter overrides of the runtime instance
+	// Null if an asset referenced by the graph has unsaved changes
+	static TSharedPtr<FVoxelMarchingCubeDiskCache> Create(const FVoxelRuntimeInfo& RuntimeInfo);
+
+	explicit FVoxelMarchingCubeDiskCache(const uint64 RuntimeHash)
+		: RuntimeHash(RuntimeHash)
+	{
+	}
+
+	// 0 if the chunk must not be cached: runtime invalidated or chunk sculpted
+	uint64 GetChunkKey(
+		const FVoxelQuery& Query,
+		int32 LOD,
+		int32 ChunkSize,
+		float ScaledVoxelSize,
+		const FVoxelBox& Bounds,
+		bool bEnableTransitions,
+		bool bPerfectTransitions) const;
+
+	// The file is read on the IO thread pool, the returned future completes once OutSurface is set
+	// OutSurface is null if not cached. Empty chunks are cached too and have no cells
+	FVoxelDummyFutureValue LoadAsync(
+		uint64 ChunkKey,
+		const TSharedRef<TSharedPtr<FVoxelMarchingCubeSurface>>& OutSurface) const;
+	// Skipped if anything the chunk depends on changed while it was computed, or if it used approximate data
+	// Serialized right away, the file is written on the IO thread pool
+	void Save(
+		const FVoxelQuery& Query,
+		uint64 ChunkKey,
+		const FVoxelMarchingCubeSurface& Surface) const;
+
+	static void ClearAll();
+
+private:
+	// Reset to 0 when the graph or its parameters change: in-flight chunks might have read either value,
+	// so nothing is loaded or saved anymore until the runtime is recreated
+	TVoxelAtomic<uint64> RuntimeHash;
+};
+
+USTRUCT()
+struct VOXELGRAPHNODES_API FVoxelMarchingCubeDiskCacheQueryParameter : public FVoxelQueryParameter
+{
+	GENERATED_BODY()
+	GENERATED_VOXEL_QUERY_PARAMETER_BODY()
+
+	TSharedPtr<const FVoxelMarchingCubeDiskCache> DiskCache;
+};
@@ -12,10 +12,12 @@
 #include "Rendering/VoxelMeshSettings.h"
 #include "Collision/VoxelCollider.h"
 #include "Collision/VoxelCollisionComponent.h"
+#include "MarchingCube/VoxelMarchingCubeCollisionNode.h"
 #include "VoxelMarchingCubeExecNode.generated.h"
 
 struct FVoxelMesh;
 class UVoxelMeshComponent;
+class FVoxelMarchingCubeDiskCache;
 
 USTRUCT()
 struct VOXELGRAPHNODES_API FVoxelMarchingCubeExecNodeMesh
@@ -28,7 +30,7 @@ struct VOXELGRAPHNODES_API FVoxelMarchingCubeExecNodeMesh
 	TSharedPtr<const FBodyInstance> BodyInstance;
 };
 
-// This node is entirely disabled on dedicated servers
+// On dedicated servers, nothing is rendered: if ServerCollision is true, only collision (and optionally navmesh) is computed around invokers
 USTRUCT(DisplayName = "Generate Marching Cube Surface")
 struct VOXELGRAPHNODES_API FVoxelMarchingCubeExecNode : public FVoxelExecNode
 {
@@ -50,6 +52,10 @@ struct VOXELGRAPHNODES_API FVoxelMarchingCubeExecNode : public FVoxelExecNode
 	// https://docs.voxelplugin.com/basics/navmesh-and-collision
 	VOXEL_INPUT_PIN(FBodyInstance, BodyInstance, nullptr, VirtualPin);
 	VOXEL_INPUT_PIN(FVoxelPhysicalMaterialBuffer, PhysicalMaterial, nullptr, VirtualPin);
+	// Chunks at this LOD or above will use a coarser collider, with vertices welded on a 2x2x2 voxels grid
+	// Useful when distant chunks only need rough physics (eg, projectiles, ragdolls)
+	// -1 to disable
+	VOXEL_INPUT_PIN(int32, SimplifiedCollisionLOD, -1, VirtualPin, AdvancedDisplay);
 
 	// Mesh settings, used to tune mesh component settings like CastShadow, ReceiveDecals...
 	VOXEL_INPUT_PIN(FVoxelMeshSettings, MeshSettings, nullptr, VirtualPin, AdvancedDisplay);
@@ -68,6 +74,25 @@ struct VOXELGRAPHNODES_API FVoxelMarchingCubeExecNode : public FVoxelExecNode
 	// Priority offset, added to the task distance from camera
 	// Closest tasks are computed first, so set this to a very low value (eg, -1000000) if you want it to be computed first
 	VOXEL_INPUT_PIN(double, PriorityOffset, 0, ConstantPin, AdvancedDisplay);
+	// If true, generated surfaces are saved to Saved/Voxel/SurfaceCache and loaded back on the next run instead of querying the graph
+	// Chunks are keyed by the graph, its parameters, the actor transform and the chunk LOD & bounds. Sculpted chunks are never cached
+	// Channel brushes from other actors are not part of the key: only enable this on graphs that don't read channels edited at runtime
+	// Requires EnableDistanceChecks. See voxel.marchingcube.DiskCacheSize & voxel.marchingcube.ClearDiskCache
+	VOXEL_INPUT_PIN(bool, DiskCache, false, ConstantPin, AdvancedDisplay);
+
+	// If true, dedicated servers will compute collision around the invokers of ServerInvokerChannel
+	// No render mesh, detail textures or materials will be computed
+	VOXEL_INPUT_PIN(bool, ServerCollision, false, ConstantPin, AdvancedDisplay);
+	// If true, dedicated servers will also compute navmesh around invokers
+	VOXEL_INPUT_PIN(bool, ServerNavmesh, false, ConstantPin, AdvancedDisplay);
+	// See the NavmeshMaxSlope, NavmeshAgentHeight & NavmeshSimplification pins of the collision node
+	VOXEL_INPUT_PIN(float, ServerNavmeshMaxSlope, 44.f, ConstantPin, AdvancedDisplay);
+	VOXEL_INPUT_PIN(float, ServerNavmeshAgentHeight, 200.f, ConstantPin, AdvancedDisplay);
+	VOXEL_INPUT_PIN(float, ServerNavmeshSimplification, 0.5f, ConstantPin, AdvancedDisplay);
+	// Invoker channel used to spawn server chunks. Add this channel to your player pawns' invoker components
+	VOXEL_INPUT_PIN(FName, ServerInvokerChannel, "Default", ConstantPin, AdvancedDisplay);
+	// Size of server chunks, in voxels
+	VOXEL_INPUT_PIN(int32, ServerChunkSize, 32, ConstantPin, AdvancedDisplay);
 
 	TValue<FVoxelMarchingCubeExecNodeMesh> CreateMesh(
 		const FVoxelQuery& InQuery,
@@ -92,6 +117,7 @@ private:
 	const TSharedRef<FVoxelChunkActionQueue> ChunkActionQueue = MakeVoxelShared<FVoxelChunkActionQueue>();
 
 	TSharedPtr<FVoxelChunkSpawner> ChunkSpawner;
+	TSharedPtr<const FVoxelMarchingCubeDiskCache> DiskCache;
 	float VoxelSize = 0.f;
 
 	struct FChunkInfo
@@ -120,6 +146,13 @@ private:
 
 		TVoxelDynamicValue<FVoxelMarchingCubeExecNodeMesh> Mesh;
 		uint8 TransitionMask = 0;
+		// Prefetched by the chunk spawner: the mesh is kept in PredictedMesh until the chunk is promoted
+		bool bPredicted = false;
+		TSharedPtr<const FVoxelMarchingCubeExecNodeMesh> PredictedMesh;
+		// Set to voxel.chunkspawner.PredictionPriorityOffset while predicted, reset on promotion to bump the queued tasks
+		const TSharedRef<TVoxelAtomic<double>> PredictionPriorityOffset = MakeVoxelShared<TVoxelAtomic<double>>(0.);
+		// Visible but without any mesh to show yet, counted in STAT_VoxelChunkSpawnerMissingChunks once displayed
+		bool bMissingWhenVisible = false;
 		TWeakObjectPtr<UVoxelMeshComponent> MeshComponent;
 		TWeakObjectPtr<UVoxelCollisionComponent> CollisionComponent;
 		TVoxelArray<TSharedPtr<const TVoxelUniqueFunction<void()>>> OnCompleteArray;
@@ -140,7 +173,23 @@ private:
 
 	FGraphEventRef ProcessActionsGraphEvent;
 
+	void ComputeMesh(FChunkInfo& ChunkInfo);
 	void ProcessMeshes(FVoxelRuntime& Runtime);
 	void ProcessActions(FVoxelRuntime* Runtime, bool bIsInGameThread);
 	void ProcessAction(FVoxelRuntime* Runtime, const FVoxelChunkAction& Action);
-};
\ No newline at end of file
+};
+
+class VOXELGRAPHNODES_API FVoxelMarchingCubeServerExecNodeRuntime : public TVoxelExecNodeRuntime<FVoxelMarchingCubeExecNode>
+{
+public:
+	using Super::Super;
+
+	//~ Begin FVoxelExecNodeRuntime Interface
+	virtual void Create() override;
+	virtual void Destroy() override;
+	virtual void Tick(FVoxelRuntime& Runtime) override;
+	//~ End FVoxelExecNodeRuntime Interface
+
+private:
+	TSharedPtr<FVoxelMarchingCubeCollisionChunks> Chunks;
+};
@@ -26,6 +26,9 @@ public:
 		FVertexInputStreamArray& VertexStreams) const;
 
 	LAYOUT_FIELD(FShaderParameter, VoxelSize);
+	LAYOUT_FIELD(FShaderParameter, PositionScale);
+	LAYOUT_FIELD(FShaderParameter, bQuantizedPositions);
+	LAYOUT_FIELD(FShaderParameter, bOctahedronNormals);
 	LAYOUT_FIELD(FShaderParameter, NumCells);
 	LAYOUT_FIELD(FShaderResourceParameter, CellTextureCoordinates);
 	LAYOUT_FIELD(FShaderResourceParameter, TextureSampler);
@@ -48,6 +51,10 @@ class VOXELGRAPHNODES_API FVoxelMarchingCubeVertexFactoryBase : public FVertexFa
 {
 public:
 	float VoxelSize = 0;
+	// Size of one fixed point step when quantized, always a power of two
+	float PositionScale = 1.f;
+	bool bQuantizedPositions = false;
+	bool bOctahedronNormals = false;
 	int32 NumCells = 0;
 	FShaderResourceViewRHIRef CellTextureCoordinates;
 
@@ -152,6 +159,10 @@ struct VOXELGRAPHNODES_API FVoxelMarchingCubeMesh : public FVoxelMesh
 	TSharedPtr<FCardRepresentationData> CardRepresentationData;
 	TSharedPtr<FDistanceFieldVolumeData> DistanceFieldVolumeData;
 
+	// Reorder triangles & vertices for the GPU vertex cache & vertex fetch
+	// Edge vertices are kept first, cell indices & transitions are remapped
+	void Optimize();
+
 	void SetTransitionMask_GameThread(uint8 NewTransitionMask);
 	void SetTransitionMask_RenderThread(FRHICommandList& RHICmdList, uint8 NewTransitionMask);
 
@@ -166,6 +177,7 @@ struct VOXELGRAPHNODES_API FVoxelMarchingCubeMesh : public FVoxelMesh
 	virtual void Destroy_RenderThread() override;
 
 	virtual bool Draw_RenderThread(const FPrimitiveSceneProxy& Proxy, FMeshBatch& MeshBatch) const override;
+	virtual void OnVisible_AnyThread() const override;
 
 	virtual const FCardRepresentationData* GetCardRepresentationData() const override
 	{
@@ -22,6 +22,8 @@ public:
 	float WorldSize = 0.f;
 	int32 ChunkSize = 0;
 	FName InvokerChannel;
+	// 0 to disable prediction
+	float PredictionTime = 0.f;
 
 	//~ Begin FVoxelChunkSpawnerImpl Interface
 	virtual void Tick(FVoxelRuntime& Runtime) override;
@@ -29,10 +31,23 @@ public:
 
 private:
 	TSharedPtr<FVoxelInvokerView> InvokerView_GameThread;
+	TSharedPtr<FVoxelInvokerView> PredictedInvokerView_GameThread;
 	FSharedVoidPtr InvokerViewBindRef_GameThread;
 
+	struct FChunk
+	{
+		TSharedPtr<FVoxelChunkRef> ChunkRef;
+		// In range of an invoker
+		bool bIsVisible = false;
+		// In range of an invoker predicted position
+		bool bIsPredicted = false;
+	};
+
 	FVoxelFastCriticalSection CriticalSection;
-	TVoxelIntVectorMap<TSharedPtr<FVoxelChunkRef>> ChunkRefs_RequiresLock;
+	TVoxelIntVectorMap<FChunk> Chunks_RequiresLock;
+
+	void AddChunks(const TVoxelAddOnlySet<FIntVector>& ChunksToAdd, int32 FullChunkSize, bool bPredicted);
+	void RemoveChunks(const TVoxelAddOnlySet<FIntVector>& ChunksToRemove, bool bPredicted);
 };
 
 USTRUCT(Category = "Chunk Spawner")
@@ -45,6 +60,9 @@ struct VOXELGRAPHNODES_API FVoxelNode_MakeInvokerChunkSpawner : public FVoxelNod
 	VOXEL_INPUT_PIN(float, WorldSize, 1.e6f);
 	VOXEL_INPUT_PIN(int32, ChunkSize, 32);
 	VOXEL_INPUT_PIN(FName, InvokerChannel, "Default");
+	// If positive, chunks are prefetched where invokers will be in PredictionTime seconds, based on their velocity
+	// Prefetched chunks are computed at a lower priority than chunks in range, see voxel.chunkspawner.PredictionPriorityOffset
+	VOXEL_INPUT_PIN(float, PredictionTime, 0.f, AdvancedDisplay);
 
 	VOXEL_OUTPUT_PIN(FVoxelChunkSpawner, Spawner);
 };
\ No newline at end of file
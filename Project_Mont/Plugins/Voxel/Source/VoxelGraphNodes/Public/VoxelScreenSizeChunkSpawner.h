@@ -22,6 +22,8 @@ public:
 	int32 ChunkSize = 32;
 	int32 MaxLOD = 20;
 	bool bEnableTransitions = true;
+	// 0 to disable prediction
+	float PredictionTime = 0.f;
 	TVoxelDynamicValueFactory<float> ChunkScreenSizeValueFactory;
 	TSharedPtr<FVoxelQueryContext> QueryContext;
 	TSharedPtr<const FVoxelQueryParameters> QueryParameters;
@@ -54,18 +56,19 @@ private:
 		FVoxelIntBox NodeBounds;
 	};
 
+	// Kept across updates and only modified by the update task, so that
+	// an update only touches the nodes whose LOD changed
 	class FOctree : public TVoxelFastOctree<FNode>
 	{
 	public:
-		const FVector ViewOrigin;
 		const FVoxelScreenSizeChunkSpawner& Object;
+		// Predicted octrees are never rendered, no need for transitions
+		bool bIsPrediction = false;
 
 		FOctree(
 			const int32 Depth,
-			const FVector& ViewOrigin,
 			const FVoxelScreenSizeChunkSpawner& Object)
 			: TVoxelFastOctree<FNode>(Depth)
-			, ViewOrigin(ViewOrigin)
 			, Object(Object)
 		{
 		}
@@ -75,21 +78,33 @@ private:
 			return NodeRef.GetBounds().ToVoxelBox().Scale(Object.GetVoxelSize() * Object.ChunkSize);
 		}
 
+		// Nodes are refined to the finest LOD required by any view
+		// ChunkToPreviousChunks maps added chunks to the removed chunks they replace
 		void Update(
 			float ChunkScreenSize,
+			const TArray<FVoxelViewOrigin>& Views,
 			TMap<FChunkId, FChunkInfo>& ChunkInfos,
 			TSet<FChunkId>& ChunksToAdd,
 			TSet<FChunkId>& ChunksToRemove,
-			TSet<FChunkId>& ChunksToUpdate);
+			TSet<FChunkId>& ChunksToUpdate,
+			TMap<FChunkId, TArray<FChunkId>>& ChunkToPreviousChunks);
 
 		bool AdjacentNodeHasHigherHeight(FNodeRef NodeRef, int32 Direction) const;
+		bool IsRendered(const FVoxelIntBox& NodeBounds) const;
 	};
 
 private:
-	TSharedPtr<const FOctree> Octree;
+	// Only accessed by the update task
+	TSharedPtr<FOctree> Octree;
 	bool bTaskInProgress = false;
 	bool bUpdateQueued = false;
-	TOptional<FVector> LastViewOrigin;
+	// Same refinement, but using the views extrapolated from their velocity
+	// Its chunks are prefetched and handed over to Octree if it renders a node with the same bounds
+	TSharedPtr<FOctree> PredictedOctree;
+	// In local space
+	TArray<FVoxelViewOrigin> LastViews;
+	TArray<FVoxelViewOrigin> LastPredictedViews;
+	TVoxelMap<FObjectKey, FVoxelChunkSpawnerVelocity> PlayerControllerToVelocity;
 
 	struct FPreviousChunks
 	{
@@ -110,8 +125,12 @@ private:
 
 	FVoxelFastCriticalSection CriticalSection;
 	TVoxelMap<FChunkId, TSharedPtr<FChunk>> Chunks_RequiresLock;
+	// Prefetched chunks that aren't rendered yet, by node bounds
+	TVoxelMap<FVoxelIntBox, TSharedPtr<FVoxelChunkRef>> PredictedChunks_RequiresLock;
 
-	void UpdateTree(const FVector& ViewOrigin);
+	void UpdateTree(
+		const TArray<FVoxelViewOrigin>& Views,
+		const TArray<FVoxelViewOrigin>& PredictedViews);
 };
 
 USTRUCT(Category = "Chunk Spawner")
@@ -131,6 +150,9 @@ struct VOXELGRAPHNODES_API FVoxelNode_MakeScreenSizeChunkSpawner : public FVoxel
 	VOXEL_INPUT_PIN(int32, MaxLOD, 20, AdvancedDisplay);
 	// Add transition meshes in-between LODs to hide holes
 	VOXEL_INPUT_PIN(bool, EnableTransitions, true, AdvancedDisplay);
+	// If positive, chunks are prefetched where the views will be in PredictionTime seconds, based on their velocity
+	// Prefetched chunks are computed at a lower priority than visible ones and are only rendered once the views reach them
+	VOXEL_INPUT_PIN(float, PredictionTime, 0.f, AdvancedDisplay);
 
 	VOXEL_OUTPUT_PIN(FVoxelChunkSpawner, Spawner);
 };
\ No newline at end of file
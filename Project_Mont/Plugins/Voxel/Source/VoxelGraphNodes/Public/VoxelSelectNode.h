@@ -28,6 +28,9 @@ public:
 
 	virtual void PreSerialize() override;
 	virtual void PostSerialize() override;
+	virtual FName GetConstantPassthroughPin(
+		FName OutputPinName,
+		const TVoxelMap<FName, FVoxelPinValue>& ConstantInputs) const override;
 	//~ End FVoxelNode Interface
 
 public:
@@ -1,9 +1,27 @@
 // Copyright Voxel Plugin, Inc. All Rights Reserved.
 
 #include "VoxelHeightmap.h"
+#include "Compression/OodleDataCompression.h"
+#include "Serialization/CustomVersion.h"
 
 DEFINE_VOXEL_FACTORY(UVoxelHeightmap);
 DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelHeightmapMemory);
+DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelHeightmapTileMemory);
+DEFINE_VOXEL_COUNTER(STAT_VoxelHeightmapTileLoads);
+
+VOXEL_CONSOLE_VARIABLE(
+	VOXELLANDMASS_API, float, GVoxelHeightmapTileCacheSize, 256.f,
+	"voxel.heightmap.TileCacheSize",
+	"Max memory in MB used by the decompressed tiles of each heightmap. Tiles not sampled for the longest time are discarded first");
+
+using FVoxelHeightmapCustomVersion = DECLARE_VOXEL_VERSION
+(
+	FirstVersion,
+	AddTiles
+);
+
+constexpr FVoxelGuid GVoxelHeightmapCustomVersionGUID = MAKE_VOXEL_GUID("8E3B1C5A2F6D4B7E9A0C4D1F6B2E7A93");
+FCustomVersionRegistration GRegisterVoxelHeightmapCustomVersionGUID(GVoxelHeightmapCustomVersionGUID, FVoxelHeightmapCustomVersion::LatestVersion, TEXT("VoxelHeightmapVer"));
 
 void FVoxelHeightmap::Serialize(FArchive& Ar)
 {
@@ -12,12 +30,18 @@ void FVoxelHeightmap::Serialize(FArchive& Ar)
 	using FVersion = DECLARE_VOXEL_VERSION
 	(
 		FirstVersion,
-		AddMinMax
+		AddMinMax,
+		AddTiles
 	);
 
 	int32 Version = FVersion::LatestVersion;
 	Ar << Version;
 
+	if (Ar.IsLoading())
+	{
+		ResetTiles();
+	}
+
 	Ar << SizeX;
 	Ar << SizeY;
 
@@ -27,8 +51,25 @@ void FVoxelHeightmap::Serialize(FArchive& Ar)
 		Ar << MaxHeight;
 	}
 
+	if (Version >= FVersion::AddTiles)
+	{
+		Ar << NumMips;
+		Ar << NumTilesX;
+		Ar << NumTilesY;
+		TileOffsets.BulkSerialize(Ar);
+	}
+
 	Heights.BulkSerialize(Ar);
-	ensure(SizeX * SizeY == Heights.Num());
+
+	if (IsTiled())
+	{
+		ensure(Heights.Num() == 0);
+		ensure(TileOffsets.Num() == NumTilesX * NumTilesY * NumMips + 1);
+	}
+	else
+	{
+		ensure(SizeX * SizeY == Heights.Num());
+	}
 
 	if (Version < FVersion::AddMinMax)
 	{
@@ -45,6 +86,210 @@ void FVoxelHeightmap::Serialize(FArchive& Ar)
 	UpdateStats();
 }
 
+void FVoxelHeightmap::SerializeTiles(FArchive& Ar, UObject* Owner)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	if (Ar.IsSaving() &&
+		CompressedTiles.Num() > 0)
+	{
+		// If CompressedTiles is empty the tiles were streamed from disk, and TileBulkData still points to them
+		TileBulkData.Lock(LOCK_READ_WRITE);
+		void* Data = TileBulkData.Realloc(CompressedTiles.Num());
+		FMemory::Memcpy(Data, CompressedTiles.GetData(), CompressedTiles.Num());
+		TileBulkData.Unlock();
+	}
+
+	// Never inline the tiles so that they can be streamed
+	TileBulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+	TileBulkData.Serialize(Ar, Owner);
+
+	if (!Ar.IsLoading())
+	{
+		return;
+	}
+
+	if (!IsTiled())
+	{
+		TileBulkData.RemoveBulkData();
+		return;
+	}
+
+	if (!ensure(TileBulkData.GetBulkDataSize() == TileOffsets.Last()))
+	{
+		ResetTiles();
+		Heights.Reset();
+		SizeX = 0;
+		SizeY = 0;
+		return;
+	}
+
+	if (!TileBulkData.CanLoadFromDisk())
+	{
+		VOXEL_SCOPE_COUNTER("Load tiles");
+
+		// Cannot stream, keep the compressed tiles in memory
+		FVoxelUtilities::SetNumFast(CompressedTiles, TileBulkData.GetBulkDataSize());
+
+		void* Data = CompressedTiles.GetData();
+		TileBulkData.GetCopy(&Data, true);
+		TileBulkData.RemoveBulkData();
+	}
+
+	UpdateStats();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+TSharedPtr<const FVoxelHeightmap::FTile> FVoxelHeightmap::FindTile(const int32 TileX, const int32 TileY, const int32 Mip) const
+{
+	checkVoxelSlow(IsTiled());
+	const int32 Key = GetTileMipKey(TileX, TileY, Mip);
+
+	if (const TSharedPtr<const FTile> Tile = FindLoadedTile(Key))
+	{
+		return Tile;
+	}
+
+	if (CompressedTiles.Num() == 0)
+	{
+		// Needs to be streamed
+		return nullptr;
+	}
+
+	// Don't hold the lock while decompressing, other threads might be sampling already loaded tiles
+	const int64 Offset = TileOffsets[Key];
+	const TSharedRef<const FTile> Tile = DecompressTile(
+		Mip,
+		CompressedTiles.GetData() + Offset,
+		int32(TileOffsets[Key + 1] - Offset));
+
+	return AddLoadedTile(Key, Tile);
+}
+
+void FVoxelHeightmap::LoadTileAsync(const int32 TileX, const int32 TileY, const int32 Mip, FOnTileLoaded&& OnLoaded) const
+{
+	if (const TSharedPtr<const FTile> Tile = FindTile(TileX, TileY, Mip))
+	{
+		OnLoaded(Tile.ToSharedRef());
+		return;
+	}
+
+	VOXEL_FUNCTION_COUNTER();
+
+	const int32 Key = GetTileMipKey(TileX, TileY, Mip);
+
+	TSharedPtr<const FTile> LoadedTile;
+	{
+		VOXEL_SCOPE_LOCK(CriticalSection);
+
+		if (const FLoadedTile* ExistingTile = LoadedTiles_RequiresLock.Find(Key))
+		{
+			// Streamed in since FindTile
+			LoadedTile = ExistingTile->Tile;
+		}
+		else
+		{
+			TVoxelArray<FOnTileLoaded>& Callbacks = PendingLoads_RequiresLock.FindOrAdd(Key);
+			Callbacks.Add(MoveTemp(OnLoaded));
+
+			if (Callbacks.Num() > 1)
+			{
+				// Already being streamed
+				return;
+			}
+		}
+	}
+
+	if (LoadedTile)
+	{
+		OnLoaded(LoadedTile.ToSharedRef());
+		return;
+	}
+
+	const int64 Offset = TileOffsets[Key];
+	const int32 CompressedSize = int32(TileOffsets[Key + 1] - Offset);
+
+	const TSharedRef<TVoxelArray<uint8>> StreamedData = MakeVoxelShared<TVoxelArray<uint8>>();
+	FVoxelUtilities::SetNumFast(*StreamedData, CompressedSize);
+
+	FBulkDataIORequestCallBack Callback = [This = AsShared(), Key, Mip, StreamedData](const bool bWasCancelled, IBulkDataIORequest* Request)
+	{
+		// Requests can't be deleted from their own callback, and we don't want to decompress on the IO thread
+		AsyncVoxelTask([=]
+		{
+			Request->WaitCompletion();
+			delete Request;
+
+			const TSharedRef<FTile> Tile = This->DecompressTile(
+				Mip,
+				ensure(!bWasCancelled) ? StreamedData->GetData() : nullptr,
+				StreamedData->Num());
+
+			This->OnTileStreamed(Key, This->AddLoadedTile(Key, Tile));
+		});
+	};
+
+	IBulkDataIORequest* Request = TileBulkData.CreateStreamingRequest(
+		Offset,
+		CompressedSize,
+		AIOP_Normal,
+		&Callback,
+		StreamedData->GetData());
+
+	if (!ensure(Request))
+	{
+		OnTileStreamed(Key, DecompressTile(Mip, nullptr, 0));
+	}
+}
+
+TSharedRef<const FVoxelHeightmap::FTile> FVoxelHeightmap::LoadTile(const int32 TileX, const int32 TileY, const int32 Mip) const
+{
+	if (const TSharedPtr<const FTile> Tile = FindTile(TileX, TileY, Mip))
+	{
+		return Tile.ToSharedRef();
+	}
+
+	VOXEL_FUNCTION_COUNTER();
+
+	const int32 Key = GetTileMipKey(TileX, TileY, Mip);
+	const int64 Offset = TileOffsets[Key];
+	const int32 CompressedSize = int32(TileOffsets[Key + 1] - Offset);
+
+	TVoxelArray<uint8> StreamedData;
+	FVoxelUtilities::SetNumFast(StreamedData, CompressedSize);
+
+	bool bWasCancelled = false;
+	FBulkDataIORequestCallBack Callback = [&bWasCancelled](const bool bInWasCancelled, IBulkDataIORequest*)
+	{
+		bWasCancelled = bInWasCancelled;
+	};
+
+	IBulkDataIORequest* Request = TileBulkData.CreateStreamingRequest(
+		Offset,
+		CompressedSize,
+		AIOP_High,
+		&Callback,
+		StreamedData.GetData());
+
+	if (!ensure(Request))
+	{
+		return DecompressTile(Mip, nullptr, 0);
+	}
+
+	Request->WaitCompletion();
+	delete Request;
+
+	const TSharedRef<FTile> Tile = DecompressTile(
+		Mip,
+		ensure(!bWasCancelled) ? StreamedData.GetData() : nullptr,
+		StreamedData.Num());
+
+	return AddLoadedTile(Key, Tile);
+}
+
 void FVoxelHeightmap::Initialize(
 	int32 NewSizeX,
 	int32 NewSizeY,
@@ -53,6 +298,8 @@ void FVoxelHeightmap::Initialize(
 	VOXEL_FUNCTION_COUNTER();
 	check(NewSizeX * NewSizeY == NewHeights.Num());
 
+	ResetTiles();
+
 	SizeX = NewSizeX;
 	SizeY = NewSizeY;
 	Heights = MoveTemp(NewHeights);
@@ -65,6 +312,321 @@ void FVoxelHeightmap::Initialize(
 		MinHeight = FMath::Min(MinHeight, Height);
 		MaxHeight = FMath::Max(MinHeight, Height);
 	}
+
+	UpdateStats();
+}
+
+void FVoxelHeightmap::BuildTiles()
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(!IsTiled());
+	check(SizeX * SizeY == Heights.Num());
+
+	ResetTiles();
+
+	NumMips = FMath::Clamp(FMath::FloorLog2(FMath::Min(SizeX, SizeY)), 1, MaxMips);
+	NumTilesX = FVoxelUtilities::DivideCeil_Positive(SizeX, TileSize);
+	NumTilesY = FVoxelUtilities::DivideCeil_Positive(SizeY, TileSize);
+
+	TVoxelArray<TVoxelArray<uint16>> Mips;
+	Mips.Add(MoveTemp(Heights));
+
+	for (int32 Mip = 1; Mip < NumMips; Mip++)
+	{
+		VOXEL_SCOPE_COUNTER("Build mip");
+
+		const FIntPoint ParentSize = GetMipSize(Mip - 1);
+		const FIntPoint MipSize = GetMipSize(Mip);
+		const TVoxelArray<uint16>& ParentHeights = Mips[Mip - 1];
+
+		TVoxelArray<uint16> MipHeights;
+		FVoxelUtilities::SetNumFast(MipHeights, MipSize.X * MipSize.Y);
+
+		ParallelFor(MipSize.Y, [&](const int32 Y)
+		{
+			const int32 Y0 = 2 * Y;
+			const int32 Y1 = FMath::Min(2 * Y + 1, ParentSize.Y - 1);
+
+			for (int32 X = 0; X < MipSize.X; X++)
+			{
+				const int32 X0 = 2 * X;
+				const int32 X1 = FMath::Min(2 * X + 1, ParentSize.X - 1);
+
+				const int32 Sum =
+					ParentHeights[X0 + ParentSize.X * Y0] +
+					ParentHeights[X1 + ParentSize.X * Y0] +
+					ParentHeights[X0 + ParentSize.X * Y1] +
+					ParentHeights[X1 + ParentSize.X * Y1];
+
+				MipHeights[X + MipSize.X * Y] = (Sum + 2) / 4;
+			}
+		});
+
+		Mips.Add(MoveTemp(MipHeights));
+	}
+
+	const int32 NumTileMips = NumTilesX * NumTilesY * NumMips;
+
+	TVoxelArray<TVoxelArray<uint8>> CompressedTileMips;
+	CompressedTileMips.SetNum(NumTileMips);
+
+	ParallelFor(NumTileMips, [&](const int32 Key)
+	{
+		VOXEL_SCOPE_COUNTER("Compress tile");
+
+		const int32 Mip = Key % NumMips;
+		const int32 TileX = (Key / NumMips) % NumTilesX;
+		const int32 TileY = (Key / NumMips) / NumTilesX;
+		checkVoxelSlow(Key == GetTileMipKey(TileX, TileY, Mip));
+
+		const FIntPoint MipSize = GetMipSize(Mip);
+		const TVoxelArray<uint16>& MipHeights = Mips[Mip];
+		const int32 MipTileSize = TileSize >> Mip;
+		const int32 Stride = MipTileSize + 1;
+
+		TVoxelArray<uint16> TileHeights;
+		FVoxelUtilities::SetNumFast(TileHeights, Stride * Stride);
+
+		for (int32 Y = 0; Y < Stride; Y++)
+		{
+			const int32 SourceY = FMath::Min(TileY * MipTileSize + Y, MipSize.Y - 1);
+
+			for (int32 X = 0; X < Stride; X++)
+			{
+				const int32 SourceX = FMath::Min(TileX * MipTileSize + X, MipSize.X - 1);
+				TileHeights[X + Stride * Y] = MipHeights[SourceX + MipSize.X * SourceY];
+			}
+		}
+
+		// Delta encode from the left neighbor (or from the row above for the first column), terrain is smooth so this compresses much better
+		// Iterate backwards so that predictions use the original values
+		for (int32 Y = Stride - 1; Y >= 0; Y--)
+		{
+			for (int32 X = Stride - 1; X >= 0; X--)
+			{
+				const uint16 Prediction =
+					X > 0
+					? TileHeights[(X - 1) + Stride * Y]
+					: Y > 0
+					? TileHeights[Stride * (Y - 1)]
+					: 0;
+
+				TileHeights[X + Stride * Y] -= Prediction;
+			}
+		}
+
+		const int64 UncompressedSize = TileHeights.Num() * sizeof(uint16);
+
+		TVoxelArray<uint8>& CompressedData = CompressedTileMips[Key];
+		FVoxelUtilities::SetNumFast(CompressedData, int32(FOodleDataCompression::CompressedBufferSizeNeeded(UncompressedSize)));
+
+		const int64 CompressedSize = FOodleDataCompression::Compress(
+			CompressedData.GetData(),
+			CompressedData.Num(),
+			TileHeights.GetData(),
+			UncompressedSize,
+			FOodleDataCompression::ECompressor::Kraken,
+			FOodleDataCompression::ECompressionLevel::Normal);
+		check(CompressedSize > 0);
+
+		CompressedData.SetNum(int32(CompressedSize), false);
+	});
+
+	FVoxelUtilities::SetNumFast(TileOffsets, NumTileMips + 1);
+
+	int64 Offset = 0;
+	for (int32 Key = 0; Key < NumTileMips; Key++)
+	{
+		TileOffsets[Key] = Offset;
+		Offset += CompressedTileMips[Key].Num();
+	}
+	TileOffsets[NumTileMips] = Offset;
+
+	FVoxelUtilities::SetNumFast(CompressedTiles, Offset);
+
+	for (int32 Key = 0; Key < NumTileMips; Key++)
+	{
+		FMemory::Memcpy(
+			CompressedTiles.GetData() + TileOffsets[Key],
+			CompressedTileMips[Key].GetData(),
+			CompressedTileMips[Key].Num());
+	}
+
+	UpdateStats();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+TSharedPtr<const FVoxelHeightmap::FTile> FVoxelHeightmap::FindLoadedTile(const int32 Key) const
+{
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	FLoadedTile* LoadedTile = LoadedTiles_RequiresLock.Find(Key);
+	if (!LoadedTile)
+	{
+		return nullptr;
+	}
+
+	LoadedTile->LastAccessFrame = GFrameCounter;
+	return LoadedTile->Tile;
+}
+
+TSharedRef<const FVoxelHeightmap::FTile> FVoxelHeightmap::AddLoadedTile(const int32 Key, const TSharedRef<const FTile>& Tile) const
+{
+	VOXEL_SCOPE_LOCK(CriticalSection);
+
+	FLoadedTile& LoadedTile = LoadedTiles_RequiresLock.FindOrAdd(Key);
+	LoadedTile.LastAccessFrame = GFrameCounter;
+
+	if (LoadedTile.Tile)
+	{
+		// Loaded by another thread in the meantime
+		return LoadedTile.Tile.ToSharedRef();
+	}
+
+	LoadedTile.Tile = Tile;
+
+	if (IsLowestMipKey(Key))
+	{
+		// Kept forever so that samplers always have a fallback without waiting on IO
+		return Tile;
+	}
+
+	LoadedTilesSize_RequiresLock += Tile->GetAllocatedSize();
+
+	Trim_RequiresLock();
+
+	return Tile;
+}
+
+void FVoxelHeightmap::OnTileStreamed(const int32 Key, const TSharedRef<const FTile>& Tile) const
+{
+	TVoxelArray<FOnTileLoaded> Callbacks;
+	{
+		VOXEL_SCOPE_LOCK(CriticalSection);
+
+		// Might have been reset in the meantime
+		if (TVoxelArray<FOnTileLoaded>* PendingCallbacks = PendingLoads_RequiresLock.Find(Key))
+		{
+			Callbacks = MoveTemp(*PendingCallbacks);
+			PendingLoads_RequiresLock.Remove(Key);
+		}
+	}
+
+	for (FOnTileLoaded& Callback : Callbacks)
+	{
+		Callback(Tile);
+	}
+}
+
+TSharedRef<FVoxelHeightmap::FTile> FVoxelHeightmap::DecompressTile(const int32 Mip, const uint8* CompressedData, const int32 CompressedSize) const
+{
+	VOXEL_FUNCTION_COUNTER();
+	INC_VOXEL_COUNTER(STAT_VoxelHeightmapTileLoads);
+
+	const int32 Stride = (TileSize >> Mip) + 1;
+
+	const TSharedRef<FTile> Tile = MakeVoxelShared<FTile>();
+	FVoxelUtilities::SetNumFast(Tile->Heights, Stride * Stride);
+
+	// CompressedData is null if streaming failed
+	if (!CompressedData ||
+		!ensure(FOodleDataCompression::Decompress(
+			Tile->Heights.GetData(),
+			Tile->Heights.Num() * sizeof(uint16),
+			CompressedData,
+			CompressedSize)))
+	{
+		FVoxelUtilities::Memzero(Tile->Heights);
+		Tile->UpdateStats();
+		return Tile;
+	}
+
+	for (int32 Y = 0; Y < Stride; Y++)
+	{
+		for (int32 X = 0; X < Stride; X++)
+		{
+			const uint16 Prediction =
+				X > 0
+				? Tile->Heights[(X - 1) + Stride * Y]
+				: Y > 0
+				? Tile->Heights[Stride * (Y - 1)]
+				: 0;
+
+			Tile->Heights[X + Stride * Y] += Prediction;
+		}
+	}
+
+	Tile->UpdateStats();
+	return Tile;
+}
+
+void FVoxelHeightmap::Trim_RequiresLock() const
+{
+	checkVoxelSlow(CriticalSection.IsLocked());
+
+	const int64 MaxSize = FMath::Max<int64>(GVoxelHeightmapTileCacheSize * 1024 * 1024, 0);
+	if (LoadedTilesSize_RequiresLock <= MaxSize)
+	{
+		return;
+	}
+
+	VOXEL_FUNCTION_COUNTER();
+
+	struct FTileToTrim
+	{
+		uint64 LastAccessFrame = 0;
+		int32 Key = 0;
+	};
+	TVoxelArray<FTileToTrim> TilesToTrim;
+	TilesToTrim.Reserve(LoadedTiles_RequiresLock.Num());
+
+	for (const auto& It : LoadedTiles_RequiresLock)
+	{
+		if (IsLowestMipKey(It.Key))
+		{
+			continue;
+		}
+
+		TilesToTrim.Add(FTileToTrim{ It.Value.LastAccessFrame, It.Key });
+	}
+
+	TilesToTrim.Sort([](const FTileToTrim& A, const FTileToTrim& B)
+	{
+		return A.LastAccessFrame < B.LastAccessFrame;
+	});
+
+	// Trim a bit more than needed so that we don't sort on every load once the cache is full
+	const int64 TargetSize = MaxSize * 3 / 4;
+
+	for (const FTileToTrim& TileToTrim : TilesToTrim)
+	{
+		if (LoadedTilesSize_RequiresLock <= TargetSize ||
+			TileToTrim.LastAccessFrame >= GFrameCounter)
+		{
+			// Never trim tiles used this frame, they are likely still being sampled
+			break;
+		}
+
+		const FLoadedTile LoadedTile = LoadedTiles_RequiresLock.FindAndRemoveChecked(TileToTrim.Key);
+		LoadedTilesSize_RequiresLock -= LoadedTile.Tile->GetAllocatedSize();
+	}
+}
+
+void FVoxelHeightmap::ResetTiles()
+{
+	NumMips = 0;
+	NumTilesX = 0;
+	NumTilesY = 0;
+	TileOffsets.Empty();
+	CompressedTiles.Empty();
+	TileBulkData.RemoveBulkData();
+
+	VOXEL_SCOPE_LOCK(CriticalSection);
+	LoadedTiles_RequiresLock.Empty();
+	LoadedTilesSize_RequiresLock = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -77,6 +639,8 @@ void UVoxelHeightmap::Serialize(FArchive& Ar)
 
 	Super::Serialize(Ar);
 
+	Ar.UsingCustomVersion(GVoxelHeightmapCustomVersionGUID);
+
 	if (!Heightmap)
 	{
 		Heightmap = MakeVoxelShared<FVoxelHeightmap>();
@@ -103,6 +667,22 @@ void UVoxelHeightmap::Serialize(FArchive& Ar)
 
 	FVoxelObjectUtilities::SerializeBulkData(this, BulkData, Ar, *Heightmap);
 
+	if (Ar.CustomVer(GVoxelHeightmapCustomVersionGUID) >= FVoxelHeightmapCustomVersion::AddTiles)
+	{
+		if (FVoxelObjectUtilities::ShouldSerializeBulkData(Ar))
+		{
+			Heightmap->SerializeTiles(Ar, this);
+		}
+	}
+	else if (
+		Ar.IsLoading() &&
+		!Heightmap->IsTiled() &&
+		Heightmap->GetHeights().Num() > 0)
+	{
+		// Heightmaps saved before tiles were added
+		Heightmap->BuildTiles();
+	}
+
 	if (!bIsCooked)
 	{
 		FVoxelObjectUtilities::SerializeBulkData(this, SourceBulkData, Ar, *SourceHeightmap);
@@ -138,7 +718,12 @@ void UVoxelHeightmap::UpdateHeightmap()
 
 	if (!Config.bEnableCutoff)
 	{
-		Heightmap = MakeSharedCopy(*SourceHeightmap);
+		Heightmap = MakeVoxelShared<FVoxelHeightmap>();
+		Heightmap->Initialize(
+			SourceHeightmap->GetSizeX(),
+			SourceHeightmap->GetSizeY(),
+			TVoxelArray<uint16>(SourceHeightmap->GetHeights()));
+		Heightmap->BuildTiles();
 		return;
 	}
 
@@ -216,6 +801,7 @@ void UVoxelHeightmap::UpdateHeightmap()
 
 	Heightmap = MakeVoxelShared<FVoxelHeightmap>();
 	Heightmap->Initialize(SizeX, SizeY, MoveTemp(NormalizedHeights));
+	Heightmap->BuildTiles();
 
 	MarkPackageDirty();
 
@@ -1,6 +1,7 @@
 // Copyright Voxel Plugin, Inc. All Rights Reserved.
 
 #include "VoxelHeightmapFunctionLibrary.h"
+#include "VoxelDependency.h"
 #include "VoxelPositionQueryParameter.h"
 #include "VoxelHeightmapFunctionLibraryImpl.ispc.generated.h"
 
@@ -14,10 +15,147 @@ FVoxelFloatBuffer UVoxelHeightmapFunctionLibrary::SampleHeightmap(
 		return 0.f;
 	}
 	const FVoxelHeightmapConfig& Config = Heightmap.Config;
+	const FVoxelHeightmap& Data = *Heightmap.Data;
+
+	if (!Data.IsTiled())
+	{
+		VOXEL_MESSAGE(Error, "{0}: Heightmap {1} is empty", this, Heightmap.Asset);
+		return 0.f;
+	}
 
 	const float ScaleZ = Config.ScaleZ * Config.InternalScaleZ / MAX_uint16;
 	const float OffsetZ = Config.ScaleZ * Config.InternalOffsetZ;
 
+	const int32 TargetMip = GetMip(Data, Config.ScaleXY);
+	const FIntPoint NumTiles = Data.GetNumTiles();
+
+	int32 Mip = -1;
+	int32 MipTileSize = 0;
+	FIntPoint TileRangeX;
+	FIntPoint TileRangeY;
+	FIntPoint TileRangeSize;
+	TVoxelArray<TSharedPtr<const FVoxelHeightmap::FTile>> Tiles;
+	TVoxelArray<const uint16*> TilePointers;
+	{
+		VOXEL_SCOPE_COUNTER("Load tiles");
+
+		// Persisted results can't be refined later: wait for the target mip
+		const bool bIsPersistent = GetQuery().GetParameters().Find<FVoxelPersistentQueryParameter>() != nullptr;
+
+		// Tiles streamed from disk are loaded asynchronously: sample the finest mip that is fully loaded in the meantime,
+		// and invalidate the query once the tiles of the target mip are in
+		for (int32 CandidateMip = TargetMip; CandidateMip < Data.GetNumMips(); CandidateMip++)
+		{
+			const FIntPoint MipSize = Data.GetMipSize(CandidateMip);
+			const int32 CandidateMipTileSize = FVoxelHeightmap::TileSize >> CandidateMip;
+
+			// Only load the tiles touched by the query
+			const auto GetTileRange = [&](const FVoxelFloatBuffer& Positions, const int32 Size, const int32 MipSizeAxis, const int32 NumTilesAxis)
+			{
+				const FFloatInterval MinMax = Positions.GetStorage().GetMinMaxSafe();
+
+				const auto GetTexel = [&](const float Position)
+				{
+					const float Texel = (Position / Config.ScaleXY + Size / 2.f + 0.5f) / (1 << CandidateMip) - 0.5f;
+					return FMath::Clamp(FMath::FloorToInt(Texel), 0, MipSizeAxis - 2);
+				};
+
+				// Pad by one texel in case the ISPC rounding differs slightly
+				return FIntPoint(
+					FMath::Clamp((GetTexel(MinMax.Min) - 1) / CandidateMipTileSize, 0, NumTilesAxis - 1),
+					FMath::Clamp((GetTexel(MinMax.Max) + 1) / CandidateMipTileSize, 0, NumTilesAxis - 1));
+			};
+
+			TileRangeX = GetTileRange(Position.X, Data.GetSizeX(), MipSize.X, NumTiles.X);
+			TileRangeY = GetTileRange(Position.Y, Data.GetSizeY(), MipSize.Y, NumTiles.Y);
+			TileRangeSize = FIntPoint(TileRangeX.Y - TileRangeX.X + 1, TileRangeY.Y - TileRangeY.X + 1);
+
+			Tiles.Reset();
+			Tiles.SetNum(TileRangeSize.X * TileRangeSize.Y);
+
+			ParallelFor(Tiles.Num(), [&](const int32 Index)
+			{
+				Tiles[Index] = Data.FindTile(
+					TileRangeX.X + Index % TileRangeSize.X,
+					TileRangeY.X + Index / TileRangeSize.X,
+					CandidateMip);
+			});
+
+			TVoxelArray<FIntPoint> MissingTiles;
+			for (int32 Index = 0; Index < Tiles.Num(); Index++)
+			{
+				if (!Tiles[Index])
+				{
+					MissingTiles.Add(FIntPoint(
+						TileRangeX.X + Index % TileRangeSize.X,
+						TileRangeY.X + Index / TileRangeSize.X));
+				}
+			}
+
+			if (MissingTiles.Num() == 0)
+			{
+				Mip = CandidateMip;
+				MipTileSize = CandidateMipTileSize;
+				break;
+			}
+
+			if (bIsPersistent ||
+				CandidateMip == Data.GetNumMips() - 1)
+			{
+				// Lowest mip tiles are tiny and never trimmed, block on them rather than sampling placeholder heights
+				VOXEL_SCOPE_COUNTER("LoadTile");
+
+				ParallelFor(MissingTiles, [&](const FIntPoint& Tile)
+				{
+					Tiles[(Tile.X - TileRangeX.X) + TileRangeSize.X * (Tile.Y - TileRangeY.X)] = Data.LoadTile(Tile.X, Tile.Y, CandidateMip);
+				});
+
+				Mip = CandidateMip;
+				MipTileSize = CandidateMipTileSize;
+				break;
+			}
+
+			if (CandidateMip != TargetMip)
+			{
+				continue;
+			}
+
+			const TSharedRef<FVoxelDependency> Dependency = FVoxelDependency::Create(
+				STATIC_FNAME("Heightmap"),
+				STATIC_FNAME("SampleHeightmap"));
+
+			// Add the dependency before requesting the tiles, they might finish loading right away
+			GetQuery().GetDependencyTracker().AddDependency(Dependency);
+
+			const TSharedRef<FThreadSafeCounter> NumPending = MakeVoxelShared<FThreadSafeCounter>(MissingTiles.Num());
+			for (const FIntPoint& Tile : MissingTiles)
+			{
+				Data.LoadTileAsync(Tile.X, Tile.Y, CandidateMip, [Dependency, NumPending](const TSharedRef<const FVoxelHeightmap::FTile>&)
+				{
+					// The tile is now cached, the next query will find it
+					if (NumPending->Decrement() == 0)
+					{
+						Dependency->Invalidate();
+					}
+				});
+			}
+		}
+
+		check(Mip != -1);
+
+		if (Mip != TargetMip)
+		{
+			// Don't persist anything computed from this, eg in the surface disk cache
+			GetQuery().GetDependencyTracker().MarkApproximate();
+		}
+
+		FVoxelUtilities::SetNumFast(TilePointers, Tiles.Num());
+		for (int32 Index = 0; Index < Tiles.Num(); Index++)
+		{
+			TilePointers[Index] = Tiles[Index]->Heights.GetData();
+		}
+	}
+
 	FVoxelFloatBufferStorage Result;
 	Result.Allocate(Position.Num());
 
@@ -31,9 +169,14 @@ FVoxelFloatBuffer UVoxelHeightmapFunctionLibrary::SampleHeightmap(
 			Config.ScaleXY,
 			ScaleZ,
 			OffsetZ,
-			Heightmap.Data->GetSizeX(),
-			Heightmap.Data->GetSizeY(),
-			Heightmap.Data->GetHeights().GetData(),
+			Data.GetSizeX(),
+			Data.GetSizeY(),
+			Mip,
+			MipTileSize,
+			TileRangeX.X,
+			TileRangeY.X,
+			TileRangeSize.X,
+			TilePointers.GetData(),
 			Iterator.Num(),
 			Result.GetData(Iterator));
 	});
@@ -74,7 +217,7 @@ FVoxelSurface UVoxelHeightmapFunctionLibrary::MakeCubemapPlanetSurface(
 	return Surface;
 }
 
-FVoxelFloatBuffer UVoxelHeightmapFunctionLibrary::MakeCubemapPlanetSurface_Distance(
+TVoxelFutureValue<FVoxelFloatBuffer> UVoxelHeightmapFunctionLibrary::MakeCubemapPlanetSurface_Distance(
 	const FVoxelHeightmapRef& PosX,
 	const FVoxelHeightmapRef& NegX,
 	const FVoxelHeightmapRef& PosY,
@@ -124,22 +267,36 @@ FVoxelFloatBuffer UVoxelHeightmapFunctionLibrary::MakeCubemapPlanetSurface_Dista
 
 	const FVoxelVectorBuffer Positions = PositionQueryParameter->GetPositions();
 
-	FVoxelFloatBufferStorage Distance;
-	Distance.Allocate(Positions.Num());
-
-	const TVoxelStaticArray<const uint16*, 6> Heightmaps
+	const TVoxelStaticArray<TSharedPtr<const FVoxelHeightmap>, 6> Heightmaps
 	{
-		PosX.Data->GetHeights().GetData(),
-		NegX.Data->GetHeights().GetData(),
-		PosY.Data->GetHeights().GetData(),
-		NegY.Data->GetHeights().GetData(),
-		PosZ.Data->GetHeights().GetData(),
-		NegZ.Data->GetHeights().GetData(),
+		PosX.Data,
+		NegX.Data,
+		PosY.Data,
+		NegY.Data,
+		PosZ.Data,
+		NegZ.Data,
 	};
 
+	for (const TSharedPtr<const FVoxelHeightmap>& Heightmap : Heightmaps)
+	{
+		if (!Heightmap->IsTiled())
+		{
+			VOXEL_MESSAGE(Error, "{0}: Heightmaps are empty", this);
+			return {};
+		}
+	}
+
+	// All faces have the same size, and so the same number of mips
+	const int32 Mip = GetMip(*Heightmaps[0], 2 * PlanetRadius / Size.GetMax());
+	const int32 MipTileSize = FVoxelHeightmap::TileSize >> Mip;
+	const FIntPoint NumTiles = Heightmaps[0]->GetNumTiles();
+
+	TVoxelArray<int32> TileSlots;
+	FVoxelUtilities::SetNumFast(TileSlots, Positions.Num());
+
 	ForeachVoxelBufferChunk(Positions.Num(), [&](const FVoxelBufferIterator& Iterator)
 	{
-		ispc::VoxelHeightmapFunctionLibrary_GetDistanceToCubemapPlanet(
+		ispc::VoxelHeightmapFunctionLibrary_GetCubemapPlanetTiles(
 			Positions.X.GetData(Iterator),
 			Positions.X.IsConstant(),
 			Positions.Y.GetData(Iterator),
@@ -147,16 +304,100 @@ FVoxelFloatBuffer UVoxelHeightmapFunctionLibrary::MakeCubemapPlanetSurface_Dista
 			Positions.Z.GetData(Iterator),
 			Positions.Z.IsConstant(),
 			GetISPCValue(PlanetCenter),
-			PlanetRadius,
-			MaxHeight,
 			Size.X,
 			Size.Y,
-			Heightmaps.GetData(),
+			Mip,
+			MipTileSize,
+			NumTiles.X,
 			Iterator.Num(),
-			Distance.GetData(Iterator));
+			TileSlots.GetData() + Iterator.GetIndex());
 	});
 
-	return FVoxelFloatBuffer::Make(Distance);
+	// Replace tile keys by their index in the tile table
+	TVoxelArray<int32> TileKeys;
+	{
+		VOXEL_SCOPE_COUNTER("Find tiles");
+
+		TVoxelMap<int32, int32> TileKeyToSlot;
+		for (int32& TileSlot : TileSlots)
+		{
+			const int32 TileKey = TileSlot;
+			if (const int32* Slot = TileKeyToSlot.Find(TileKey))
+			{
+				TileSlot = *Slot;
+				continue;
+			}
+
+			TileSlot = TileKeys.Add(TileKey);
+			TileKeyToSlot.Add_CheckNew(TileKey, TileSlot);
+		}
+	}
+
+	// Tiles streamed from disk complete their dummy future once loaded, the distance task waits on all of them
+	const TSharedRef<TVoxelArray<TSharedPtr<const FVoxelHeightmap::FTile>>> Tiles = MakeVoxelShared<TVoxelArray<TSharedPtr<const FVoxelHeightmap::FTile>>>();
+	Tiles->SetNum(TileKeys.Num());
+
+	TVoxelArray<FVoxelFutureValue> TileFutures;
+	{
+		VOXEL_SCOPE_COUNTER("Load tiles");
+
+		for (int32 Index = 0; Index < TileKeys.Num(); Index++)
+		{
+			const int32 Face = TileKeys[Index] % 6;
+			const int32 TileIndex = TileKeys[Index] / 6;
+
+			const FVoxelDummyFutureValue Dummy = FVoxelFutureValue::MakeDummy();
+			TileFutures.Add(Dummy);
+
+			Heightmaps[Face]->LoadTileAsync(TileIndex % NumTiles.X, TileIndex / NumTiles.X, Mip, [Tiles, Index, Dummy](const TSharedRef<const FVoxelHeightmap::FTile>& Tile)
+			{
+				// Each index is only written once, no need to lock
+				(*Tiles)[Index] = Tile;
+				Dummy.MarkDummyAsCompleted();
+			});
+		}
+	}
+
+	return
+		MakeVoxelTask()
+		.Dependencies(TileFutures)
+		.Execute<FVoxelFloatBuffer>([=, TileSlots = MoveTemp(TileSlots)]
+		{
+			TVoxelArray<const uint16*> TilePointers;
+			FVoxelUtilities::SetNumFast(TilePointers, Tiles->Num());
+
+			for (int32 Index = 0; Index < Tiles->Num(); Index++)
+			{
+				TilePointers[Index] = (*Tiles)[Index]->Heights.GetData();
+			}
+
+			FVoxelFloatBufferStorage Distance;
+			Distance.Allocate(Positions.Num());
+
+			ForeachVoxelBufferChunk(Positions.Num(), [&](const FVoxelBufferIterator& Iterator)
+			{
+				ispc::VoxelHeightmapFunctionLibrary_GetDistanceToCubemapPlanet(
+					Positions.X.GetData(Iterator),
+					Positions.X.IsConstant(),
+					Positions.Y.GetData(Iterator),
+					Positions.Y.IsConstant(),
+					Positions.Z.GetData(Iterator),
+					Positions.Z.IsConstant(),
+					GetISPCValue(PlanetCenter),
+					PlanetRadius,
+					MaxHeight,
+					Size.X,
+					Size.Y,
+					Mip,
+					MipTileSize,
+					TileSlots.GetData() + Iterator.GetIndex(),
+					TilePointers.GetData(),
+					Iterator.Num(),
+					Distance.GetData(Iterator));
+			});
+
+			return FVoxelFloatBuffer::Make(Distance);
+		});
 }
 
 FVoxelBox UVoxelHeightmapFunctionLibrary::GetHeightmapBounds(const FVoxelHeightmapRef& Heightmap) const
@@ -183,4 +424,21 @@ FVoxelBox UVoxelHeightmapFunctionLibrary::GetHeightmapBounds(const FVoxelHeightm
 	Bounds.Max.Y = Size.Y;
 	Bounds.Max.Z = MaxHeight;
 	return Bounds;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+int32 UVoxelHeightmapFunctionLibrary::GetMip(const FVoxelHeightmap& Heightmap, const float TexelSize) const
+{
+	// Chunks set the gradient step to the distance between their samples
+	// Coarse LODs can then sample coarse mips without ever loading full resolution tiles
+	const FVoxelGradientStepQueryParameter* GradientStepQueryParameter = GetQuery().GetParameters().Find<FVoxelGradientStepQueryParameter>();
+	if (!GradientStepQueryParameter)
+	{
+		return 0;
+	}
+
+	return Heightmap.GetMip(GradientStepQueryParameter->Step / TexelSize);
 }
\ No newline at end of file
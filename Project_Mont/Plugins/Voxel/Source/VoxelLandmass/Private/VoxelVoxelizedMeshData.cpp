@@ -6,12 +6,20 @@
 #include "VoxelDistanceFieldUtilities_Old.h"
 #include "Engine/StaticMesh.h"
 
+VOXEL_CONSOLE_VARIABLE(
+	VOXELLANDMASS_API, int32, GVoxelVoxelizedMeshMaxImportMemory, 8192,
+	"voxel.landmass.VoxelizedMeshMaxImportMemory",
+	"Max memory in MB used by the dense grid when voxelizing a mesh. Increase the voxel size of meshes hitting this limit");
+
 DEFINE_VOXEL_MEMORY_STAT(STAT_VoxelVoxelizedMeshData);
 
 int64 FVoxelVoxelizedMeshData::GetAllocatedSize() const
 {
 	int64 AllocatedSize = sizeof(*this);
-	AllocatedSize += DistanceField.GetAllocatedSize();
+	AllocatedSize += BrickIndices.GetAllocatedSize();
+	AllocatedSize += CoarseDistances.GetAllocatedSize();
+	AllocatedSize += BrickDistances.GetAllocatedSize();
+	AllocatedSize += BrickNormals.GetAllocatedSize();
 	return AllocatedSize;
 }
 
@@ -29,7 +37,9 @@ void FVoxelVoxelizedMeshData::Serialize(FArchive& Ar)
 		RemoveSerializedRangeChunkSize,
 		AddMaxSmoothness,
 		AddNormals,
-		SwitchToFVoxelBox
+		SwitchToFVoxelBox,
+		SwitchToSparseBricks,
+		AddCoarseDistances
 	);
 
 	int32 Version = FVersion::LatestVersion;
@@ -57,12 +67,52 @@ void FVoxelVoxelizedMeshData::Serialize(FArchive& Ar)
 
 	Ar << Origin;
 	Ar << Size;
-	DistanceField.BulkSerialize(Ar);
-	Normals.BulkSerialize(Ar);
+
+	if (Version < FVersion::SwitchToSparseBricks)
+	{
+		TVoxelArray<float> DistanceField;
+		TVoxelArray<FVoxelOctahedron> Normals;
+		DistanceField.BulkSerialize(Ar);
+		Normals.BulkSerialize(Ar);
+
+		if (!BuildBricks(DistanceField, Normals))
+		{
+			Size = FIntVector::ZeroValue;
+			NumBricks = FIntVector::ZeroValue;
+			BrickIndices.Empty();
+			CoarseDistances.Empty();
+			BrickDistances.Empty();
+			BrickNormals.Empty();
+		}
+	}
+	else if (Version < FVersion::AddCoarseDistances)
+	{
+		TVoxelArray<float> BrickConstants;
+
+		Ar << NumBricks;
+		BrickIndices.BulkSerialize(Ar);
+		BrickConstants.BulkSerialize(Ar);
+		BrickDistances.BulkSerialize(Ar);
+		BrickNormals.BulkSerialize(Ar);
+
+		BuildCoarseDistances(BrickConstants);
+	}
+	else
+	{
+		Ar << NumBricks;
+		BrickIndices.BulkSerialize(Ar);
+		CoarseDistances.BulkSerialize(Ar);
+		BrickDistances.BulkSerialize(Ar);
+		BrickNormals.BulkSerialize(Ar);
+	}
 
 	UpdateStats();
 }
 
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
 TSharedPtr<FVoxelVoxelizedMeshData> FVoxelVoxelizedMeshData::VoxelizeMesh(
 	const UStaticMesh& Mesh,
 	float VoxelSize,
@@ -85,9 +135,21 @@ TSharedPtr<FVoxelVoxelizedMeshData> FVoxelVoxelizedMeshData::VoxelizeMesh(
 	const FIntVector Size = FVoxelUtilities::CeilToInt(MeshBoundsWithSmoothness.GetSize());
 	const FVector3f Origin = MeshBoundsWithSmoothness.Min;
 
-	if (int64(Size.X) * int64(Size.Y) * int64(Size.Z) * sizeof(float) >= MAX_int32 / 2)
+	// Voxelization still goes through a dense grid, only the final data is sparse
+	// Per voxel: distance, surface position, voxel normal, octahedron normal & jump flood scratch
+	constexpr int64 ImportBytesPerVoxel = 40;
+	const int64 NumVoxels = int64(Size.X) * int64(Size.Y) * int64(Size.Z);
+	if (NumVoxels >= MAX_int32)
+	{
+		VOXEL_MESSAGE(Error, "{0}: Voxelized mesh would have more than 2B voxels", Mesh);
+		return nullptr;
+	}
+	if (NumVoxels * ImportBytesPerVoxel > int64(GVoxelVoxelizedMeshMaxImportMemory) * 1024 * 1024)
 	{
-		VOXEL_MESSAGE(Error, "{0}: Voxelized mesh would have more than 1GB of data", Mesh);
+		VOXEL_MESSAGE(Error, "{0}: Voxelizing would use {1}MB, more than voxel.landmass.VoxelizedMeshMaxImportMemory ({2}MB). Increase the voxel size",
+			Mesh,
+			NumVoxels * ImportBytesPerVoxel / 1024 / 1024,
+			GVoxelVoxelizedMeshMaxImportMemory);
 		return nullptr;
 	}
 	if (Size.X * Size.Y * Size.Z == 0)
@@ -114,54 +176,67 @@ TSharedPtr<FVoxelVoxelizedMeshData> FVoxelVoxelizedMeshData::VoxelizeMesh(
 
 	// Propagate distances
 	FVoxelDistanceFieldUtilities::JumpFlood(Size, SurfacePositions, true);
-	FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(Size, SurfacePositions, Distances);
+	FVoxelDistanceFieldUtilities::GetDistancesFromSurfacePositions(Size, SurfacePositions, Distances, true);
 
 	// Propagate normals
-	for (int32 Index = 0; Index < VoxelNormals.Num(); Index++)
+	// Only voxels with a zero normal are written to, and only voxels with a non-zero normal are read from
+	TVoxelArray<FVoxelOctahedron> Normals;
+	FVoxelUtilities::SetNumFast(Normals, VoxelNormals.Num());
+
+	ParallelFor(Size.Z, [&](const int32 Z)
 	{
-		if (!VoxelNormals[Index].IsZero())
+		VOXEL_SCOPE_COUNTER("Propagate normals");
+
+		const int32 StartIndex = FVoxelUtilities::Get3DIndex<int32>(Size, 0, 0, Z);
+		const int32 EndIndex = StartIndex + Size.X * Size.Y;
+
+		for (int32 Index = StartIndex; Index < EndIndex; Index++)
 		{
-			continue;
-		}
+			if (!VoxelNormals[Index].IsZero())
+			{
+				Normals[Index] = FVoxelOctahedron(VoxelNormals[Index]);
+				continue;
+			}
 
-		const FVector3f SurfacePosition = SurfacePositions[Index];
-
-		const FVector3f Alpha = SurfacePosition - FVector3f(FVoxelUtilities::FloorToInt(SurfacePosition));
-
-		const FIntVector Min = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(SurfacePosition), FIntVector::ZeroValue, Size - 1);
-		const FIntVector Max = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(SurfacePosition), FIntVector::ZeroValue, Size - 1);
-
-		const FVector3f Normal000 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Min.Y, Min.Z)];
-		const FVector3f Normal001 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Min.Y, Min.Z)];
-		const FVector3f Normal010 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Max.Y, Min.Z)];
-		const FVector3f Normal011 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Max.Y, Min.Z)];
-		const FVector3f Normal100 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Min.Y, Max.Z)];
-		const FVector3f Normal101 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Min.Y, Max.Z)];
-		const FVector3f Normal110 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Max.Y, Max.Z)];
-		const FVector3f Normal111 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Max.Y, Max.Z)];
-
-		ensure(!Normal000.IsZero());
-		ensure(!Normal001.IsZero());
-		ensure(!Normal010.IsZero());
-		ensure(!Normal011.IsZero());
-		ensure(!Normal100.IsZero());
-		ensure(!Normal101.IsZero());
-		ensure(!Normal110.IsZero());
-		ensure(!Normal111.IsZero());
-
-		VoxelNormals[Index] = FVoxelUtilities::TrilinearInterpolation(
-			Normal000,
-			Normal001,
-			Normal010,
-			Normal011,
-			Normal100,
-			Normal101,
-			Normal110,
-			Normal111,
-			Alpha.X,
-			Alpha.Y,
-			Alpha.Z).GetSafeNormal();
-	}
+			const FVector3f SurfacePosition = SurfacePositions[Index];
+
+			const FVector3f Alpha = SurfacePosition - FVector3f(FVoxelUtilities::FloorToInt(SurfacePosition));
+
+			const FIntVector Min = FVoxelUtilities::Clamp(FVoxelUtilities::FloorToInt(SurfacePosition), FIntVector::ZeroValue, Size - 1);
+			const FIntVector Max = FVoxelUtilities::Clamp(FVoxelUtilities::CeilToInt(SurfacePosition), FIntVector::ZeroValue, Size - 1);
+
+			const FVector3f Normal000 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Min.Y, Min.Z)];
+			const FVector3f Normal001 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Min.Y, Min.Z)];
+			const FVector3f Normal010 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Max.Y, Min.Z)];
+			const FVector3f Normal011 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Max.Y, Min.Z)];
+			const FVector3f Normal100 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Min.Y, Max.Z)];
+			const FVector3f Normal101 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Min.Y, Max.Z)];
+			const FVector3f Normal110 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Min.X, Max.Y, Max.Z)];
+			const FVector3f Normal111 = VoxelNormals[FVoxelUtilities::Get3DIndex<int32>(Size, Max.X, Max.Y, Max.Z)];
+
+			ensure(!Normal000.IsZero());
+			ensure(!Normal001.IsZero());
+			ensure(!Normal010.IsZero());
+			ensure(!Normal011.IsZero());
+			ensure(!Normal100.IsZero());
+			ensure(!Normal101.IsZero());
+			ensure(!Normal110.IsZero());
+			ensure(!Normal111.IsZero());
+
+			Normals[Index] = FVoxelOctahedron(FVoxelUtilities::TrilinearInterpolation(
+				Normal000,
+				Normal001,
+				Normal010,
+				Normal011,
+				Normal100,
+				Normal101,
+				Normal110,
+				Normal111,
+				Alpha.X,
+				Alpha.Y,
+				Alpha.Z).GetSafeNormal());
+		}
+	});
 
 	const TSharedRef<FVoxelVoxelizedMeshData> VoxelizedMeshData = MakeVoxelShared<FVoxelVoxelizedMeshData>();
 	VoxelizedMeshData->MeshBounds = FVoxelBox(MeshBounds);
@@ -171,11 +246,178 @@ TSharedPtr<FVoxelVoxelizedMeshData> FVoxelVoxelizedMeshData::VoxelizeMesh(
 
 	VoxelizedMeshData->Origin = Origin;
 	VoxelizedMeshData->Size = Size;
-	VoxelizedMeshData->DistanceField = MoveTemp(Distances);
-	VoxelizedMeshData->Normals = TVoxelArray<FVoxelOctahedron>(VoxelNormals);
+
+	if (!VoxelizedMeshData->BuildBricks(Distances, Normals))
+	{
+		VOXEL_MESSAGE(Error, "{0}: Voxelized mesh would have too many bricks near its surface", Mesh);
+		return nullptr;
+	}
+
 	VoxelizedMeshData->UpdateStats();
 
-	LOG_VOXEL(Log, "%s voxelized, %d leaks", *Mesh.GetPathName(), NumLeaks);
+	LOG_VOXEL(Log, "%s voxelized, %d leaks, %d/%d bricks stored",
+		*Mesh.GetPathName(),
+		NumLeaks,
+		VoxelizedMeshData->BrickDistances.Num() / NumVoxelsPerBrick,
+		VoxelizedMeshData->BrickIndices.Num());
 
 	return VoxelizedMeshData;
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool FVoxelVoxelizedMeshData::BuildBricks(
+	const TConstVoxelArrayView<float> Distances,
+	const TConstVoxelArrayView<FVoxelOctahedron> Normals)
+{
+	VOXEL_FUNCTION_COUNTER();
+	check(Distances.Num() == Size.X * Size.Y * Size.Z);
+	check(Normals.Num() == Size.X * Size.Y * Size.Z);
+
+	NumBricks = FVoxelUtilities::DivideCeil(FVoxelUtilities::ComponentMax(Size - 1, FIntVector(1)), BrickSize);
+
+	const int32 NumBricksTotal = NumBricks.X * NumBricks.Y * NumBricks.Z;
+	FVoxelUtilities::SetNumFast(BrickIndices, NumBricksTotal);
+
+	const auto GetIndex = [&](const FIntVector& BrickPosition, const int32 X, const int32 Y, const int32 Z)
+	{
+		// The last layer of the last bricks can be outside of the data
+		const FIntVector Position = FVoxelUtilities::ComponentMin(BrickPosition * BrickSize + FIntVector(X, Y, Z), Size - 1);
+		return FVoxelUtilities::Get3DIndex<int32>(Size, Position);
+	};
+
+	ParallelFor(NumBricksTotal, [&](const int32 BrickIndex)
+	{
+		const FIntVector BrickPosition = FVoxelUtilities::Break3DIndex(NumBricks, BrickIndex);
+
+		float ClosestDistance = MAX_flt;
+		for (int32 Z = 0; Z < BrickSizeWithApron; Z++)
+		{
+			for (int32 Y = 0; Y < BrickSizeWithApron; Y++)
+			{
+				for (int32 X = 0; X < BrickSizeWithApron; X++)
+				{
+					const float Distance = Distances[GetIndex(BrickPosition, X, Y, Z)];
+					if (FMath::Abs(Distance) < FMath::Abs(ClosestDistance))
+					{
+						ClosestDistance = Distance;
+					}
+				}
+			}
+		}
+
+		BrickIndices[BrickIndex] = FMath::Abs(ClosestDistance) < DenseBandWidth ? 0 : -1;
+	});
+
+	// Far from the surface the sign never changes within a brick, so interpolating the corners never creates a surface
+	{
+		const FIntVector NumCorners = NumBricks + 1;
+		FVoxelUtilities::SetNumFast(CoarseDistances, NumCorners.X * NumCorners.Y * NumCorners.Z);
+
+		ParallelFor(CoarseDistances.Num(), [&](const int32 CornerIndex)
+		{
+			const FIntVector Corner = FVoxelUtilities::Break3DIndex(NumCorners, CornerIndex);
+			const FIntVector Position = FVoxelUtilities::ComponentMin(Corner * BrickSize, Size - 1);
+			CoarseDistances[CornerIndex] = Distances[FVoxelUtilities::Get3DIndex<int32>(Size, Position)];
+		});
+	}
+
+	int32 NumDenseBricks = 0;
+	for (int32& BrickIndex : BrickIndices)
+	{
+		if (BrickIndex != -1)
+		{
+			BrickIndex = NumDenseBricks++;
+		}
+	}
+
+	if (int64(NumDenseBricks) * NumVoxelsPerBrick >= MAX_int32)
+	{
+		return false;
+	}
+
+	FVoxelUtilities::SetNumFast(BrickDistances, NumDenseBricks * NumVoxelsPerBrick);
+	FVoxelUtilities::SetNumFast(BrickNormals, NumDenseBricks * NumVoxelsPerBrick);
+
+	ParallelFor(NumBricksTotal, [&](const int32 BrickIndex)
+	{
+		const int32 DenseBrickIndex = BrickIndices[BrickIndex];
+		if (DenseBrickIndex == -1)
+		{
+			return;
+		}
+
+		const FIntVector BrickPosition = FVoxelUtilities::Break3DIndex(NumBricks, BrickIndex);
+
+		int32 WriteIndex = DenseBrickIndex * NumVoxelsPerBrick;
+		for (int32 Z = 0; Z < BrickSizeWithApron; Z++)
+		{
+			for (int32 Y = 0; Y < BrickSizeWithApron; Y++)
+			{
+				for (int32 X = 0; X < BrickSizeWithApron; X++)
+				{
+					const int32 ReadIndex = GetIndex(BrickPosition, X, Y, Z);
+					BrickDistances[WriteIndex] = Distances[ReadIndex];
+					BrickNormals[WriteIndex] = Normals[ReadIndex];
+					WriteIndex++;
+				}
+			}
+		}
+	});
+
+	return true;
+}
+
+void FVoxelVoxelizedMeshData::BuildCoarseDistances(const TConstVoxelArrayView<float> BrickConstants)
+{
+	VOXEL_FUNCTION_COUNTER();
+
+	const FIntVector NumCorners = NumBricks + 1;
+	FVoxelUtilities::SetNumFast(CoarseDistances, NumCorners.X * NumCorners.Y * NumCorners.Z);
+
+	if (!ensure(BrickConstants.Num() == BrickIndices.Num()) ||
+		!ensure(BrickIndices.Num() == NumBricks.X * NumBricks.Y * NumBricks.Z))
+	{
+		FVoxelUtilities::Memzero(CoarseDistances);
+		return;
+	}
+
+	ParallelFor(CoarseDistances.Num(), [&](const int32 CornerIndex)
+	{
+		const FIntVector Corner = FVoxelUtilities::Break3DIndex(NumCorners, CornerIndex);
+
+		// Use the exact distance if a dense brick touches this corner, else the closest constant of the neighboring bricks
+		float Distance = MAX_flt;
+		for (int32 Neighbor = 0; Neighbor < 8; Neighbor++)
+		{
+			const FIntVector BrickPosition = Corner - FIntVector(
+				bool(Neighbor & 1),
+				bool(Neighbor & 2),
+				bool(Neighbor & 4));
+
+			if (BrickPosition.X < 0 || BrickPosition.X >= NumBricks.X ||
+				BrickPosition.Y < 0 || BrickPosition.Y >= NumBricks.Y ||
+				BrickPosition.Z < 0 || BrickPosition.Z >= NumBricks.Z)
+			{
+				continue;
+			}
+
+			const int32 BrickIndex = FVoxelUtilities::Get3DIndex<int32>(NumBricks, BrickPosition);
+			const int32 DenseBrickIndex = BrickIndices[BrickIndex];
+			if (DenseBrickIndex != -1)
+			{
+				const FIntVector LocalPosition = (Corner - BrickPosition) * BrickSize;
+				Distance = BrickDistances[DenseBrickIndex * NumVoxelsPerBrick + FVoxelUtilities::Get3DIndex<int32>(BrickSizeWithApron, LocalPosition)];
+				break;
+			}
+
+			if (FMath::Abs(BrickConstants[BrickIndex]) < FMath::Abs(Distance))
+			{
+				Distance = BrickConstants[BrickIndex];
+			}
+		}
+		CoarseDistances[CornerIndex] = Distance;
+	});
+}
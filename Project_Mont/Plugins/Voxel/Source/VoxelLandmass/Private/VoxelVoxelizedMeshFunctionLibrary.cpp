@@ -49,9 +49,15 @@ FVoxelFloatBuffer UVoxelVoxelizedMeshFunctionLibrary::CreateVoxelizedMeshSurface
 	FindVoxelQueryParameter_Function(FVoxelPositionQueryParameter, PositionQueryParameter);
 
 	const FVoxelVectorBuffer Positions = PositionQueryParameter->GetPositions();
-	const FIntVector Size = MeshData->Size;
-	check(MeshData->DistanceField.Num() == Size.X * Size.Y * Size.Z);
-	check(MeshData->Normals.Num() == Size.X * Size.Y * Size.Z);
+	const FIntVector NumBricks = MeshData->NumBricks;
+	check(MeshData->BrickIndices.Num() == NumBricks.X * NumBricks.Y * NumBricks.Z);
+	check(MeshData->CoarseDistances.Num() == (NumBricks.X + 1) * (NumBricks.Y + 1) * (NumBricks.Z + 1));
+	check(MeshData->BrickDistances.Num() == MeshData->BrickNormals.Num());
+
+	if (MeshData->BrickIndices.Num() == 0)
+	{
+		return {};
+	}
 
 	FVoxelFloatBufferStorage Distance;
 	Distance.Allocate(Positions.Num());
@@ -66,9 +72,13 @@ FVoxelFloatBuffer UVoxelVoxelizedMeshFunctionLibrary::CreateVoxelizedMeshSurface
 			Positions.Y.IsConstant(),
 			Positions.Z.IsConstant(),
 			Iterator.Num(),
-			GetISPCValue(Size),
-			MeshData->DistanceField.GetData(),
-			MeshData->Normals.GetData(),
+			GetISPCValue(MeshData->Size),
+			GetISPCValue(NumBricks),
+			FVoxelVoxelizedMeshData::BrickSize,
+			MeshData->BrickIndices.GetData(),
+			MeshData->CoarseDistances.GetData(),
+			MeshData->BrickDistances.GetData(),
+			MeshData->BrickNormals.GetData(),
 			GetISPCValue(MeshData->Origin),
 			MeshData->VoxelSize,
 			bHermiteInterpolation,
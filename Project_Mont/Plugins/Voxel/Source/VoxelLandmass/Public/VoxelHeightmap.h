@@ -6,17 +6,45 @@
 #include "VoxelHeightmap.generated.h"
 
 DECLARE_VOXEL_MEMORY_STAT(VOXELLANDMASS_API, STAT_VoxelHeightmapMemory, "Voxel Heightmap Memory");
+DECLARE_VOXEL_MEMORY_STAT(VOXELLANDMASS_API, STAT_VoxelHeightmapTileMemory, "Voxel Heightmap Tile Memory");
+DECLARE_VOXEL_COUNTER(VOXELLANDMASS_API, STAT_VoxelHeightmapTileLoads, "Heightmap Tile Loads");
 
-class VOXELLANDMASS_API FVoxelHeightmap
+// Heightmaps are either dense (source heightmaps, used for editing) or tiled (runtime heightmaps)
+// Tiled heightmaps store TileSize^2 tiles, each with its own mip chain
+// Each tile mip is delta encoded & compressed separately, and is only decompressed when a query samples it
+// On cooked/saved assets the compressed tiles stay on disk & are streamed in from the bulk data
+class VOXELLANDMASS_API FVoxelHeightmap : public TSharedFromThis<FVoxelHeightmap>
 {
 public:
+	static constexpr int32 TileSize = 256;
+	static constexpr int32 MaxMips = 8;
+
+	struct VOXELLANDMASS_API FTile
+	{
+		// (TileSize >> Mip) + 1 texels per side: tiles store one extra row & column so that bilinear sampling never needs a neighbor tile
+		TVoxelArray<uint16> Heights;
+
+		VOXEL_ALLOCATED_SIZE_TRACKER(STAT_VoxelHeightmapTileMemory);
+
+		int64 GetAllocatedSize() const
+		{
+			return Heights.GetAllocatedSize();
+		}
+	};
+
 	FVoxelHeightmap() = default;
+	UE_NONCOPYABLE(FVoxelHeightmap);
 
 	int64 GetAllocatedSize() const
 	{
-		return Heights.GetAllocatedSize();
+		return
+			Heights.GetAllocatedSize() +
+			TileOffsets.GetAllocatedSize() +
+			CompressedTiles.GetAllocatedSize();
 	}
 	void Serialize(FArchive& Ar);
+	// Compressed tile data, stored in its own bulk data so that it can be streamed
+	void SerializeTiles(FArchive& Ar, UObject* Owner);
 
 	VOXEL_ALLOCATED_SIZE_TRACKER(STAT_VoxelHeightmapMemory);
 
@@ -55,8 +83,10 @@ public:
 		return X + SizeX * Y;
 	}
 
+	// Only valid on dense heightmaps
 	FORCEINLINE const TVoxelArray<uint16>& GetHeights() const
 	{
+		checkVoxelSlow(!IsTiled());
 		return Heights;
 	}
 	FORCEINLINE float GetHeight(int32 X, int32 Y) const
@@ -69,17 +99,105 @@ public:
 	}
 
 public:
+	FORCEINLINE bool IsTiled() const
+	{
+		return NumMips > 0;
+	}
+	FORCEINLINE int32 GetNumMips() const
+	{
+		return NumMips;
+	}
+	FORCEINLINE FIntPoint GetNumTiles() const
+	{
+		return FIntPoint(NumTilesX, NumTilesY);
+	}
+	FORCEINLINE FIntPoint GetMipSize(const int32 Mip) const
+	{
+		return FVoxelUtilities::DivideCeil(FIntPoint(SizeX, SizeY), 1 << Mip);
+	}
+	// Mip to use when samples are TexelsPerSample texels apart
+	FORCEINLINE int32 GetMip(const float TexelsPerSample) const
+	{
+		checkVoxelSlow(IsTiled());
+
+		if (!(TexelsPerSample >= 2.f))
+		{
+			return 0;
+		}
+		return FMath::Min<int32>(FMath::FloorLog2(uint32(FMath::Min(TexelsPerSample, 1.e9f))), NumMips - 1);
+	}
+
+	// Thread safe, will decompress the tile if its compressed data is in memory
+	// Returns null if the tile needs to be streamed from disk, use LoadTileAsync then
+	// Tiles are cached until voxel.heightmap.TileCacheSize is exceeded
+	// Tiles of the lowest mip are tiny and are never trimmed once loaded
+	TSharedPtr<const FTile> FindTile(int32 TileX, int32 TileY, int32 Mip) const;
+
+	using FOnTileLoaded = TVoxelUniqueFunction<void(const TSharedRef<const FTile>& Tile)>;
+	// Thread safe, never blocks on IO
+	// OnLoaded is called right away if the tile is available, otherwise from a voxel task once the tile is streamed in
+	// Concurrent loads of the same tile share a single streaming request
+	void LoadTileAsync(int32 TileX, int32 TileY, int32 Mip, FOnTileLoaded&& OnLoaded) const;
+	// Thread safe, blocks on IO if the tile needs to be streamed
+	// Only use this for lowest mip tiles or for results that can't be approximated
+	TSharedRef<const FTile> LoadTile(int32 TileX, int32 TileY, int32 Mip) const;
+
+public:
+	// Creates a dense heightmap
 	void Initialize(
 		int32 NewSizeX,
 		int32 NewSizeY,
 		TVoxelArray<uint16>&& NewHeights);
 
+	// Converts a dense heightmap to a tiled one, freeing the dense heights
+	void BuildTiles();
+
 private:
 	int32 SizeX = 0;
 	int32 SizeY = 0;
 	uint16 MinHeight = 0;
 	uint16 MaxHeight = 0;
 	TVoxelArray<uint16> Heights;
+
+	int32 NumMips = 0;
+	int32 NumTilesX = 0;
+	int32 NumTilesY = 0;
+	// Offsets of the compressed tile mips, indexed by Mip + NumMips * TileIndex, with one extra end offset
+	TVoxelArray<int64> TileOffsets;
+	// Set if the tiles were built or loaded in memory, otherwise they are streamed from TileBulkData
+	TVoxelArray64<uint8> CompressedTiles;
+	FByteBulkData TileBulkData;
+
+	struct FLoadedTile
+	{
+		TSharedPtr<const FTile> Tile;
+		uint64 LastAccessFrame = 0;
+	};
+	mutable FVoxelFastCriticalSection CriticalSection;
+	mutable TVoxelMap<int32, FLoadedTile> LoadedTiles_RequiresLock;
+	// Doesn't include the lowest mip tiles, which are never trimmed
+	mutable int64 LoadedTilesSize_RequiresLock = 0;
+	// Callbacks of the tiles currently being streamed
+	mutable TVoxelMap<int32, TVoxelArray<FOnTileLoaded>> PendingLoads_RequiresLock;
+
+	FORCEINLINE int32 GetTileMipKey(const int32 TileX, const int32 TileY, const int32 Mip) const
+	{
+		checkVoxelSlow(0 <= TileX && TileX < NumTilesX);
+		checkVoxelSlow(0 <= TileY && TileY < NumTilesY);
+		checkVoxelSlow(0 <= Mip && Mip < NumMips);
+		return Mip + NumMips * (TileX + NumTilesX * TileY);
+	}
+	FORCEINLINE bool IsLowestMipKey(const int32 Key) const
+	{
+		return Key % NumMips == NumMips - 1;
+	}
+
+	TSharedPtr<const FTile> FindLoadedTile(int32 Key) const;
+	TSharedRef<const FTile> AddLoadedTile(int32 Key, const TSharedRef<const FTile>& Tile) const;
+	TSharedRef<FTile> DecompressTile(int32 Mip, const uint8* CompressedData, int32 CompressedSize) const;
+	void OnTileStreamed(int32 Key, const TSharedRef<const FTile>& Tile) const;
+	void Trim_RequiresLock() const;
+	void ResetTiles();
 };
 
 USTRUCT()
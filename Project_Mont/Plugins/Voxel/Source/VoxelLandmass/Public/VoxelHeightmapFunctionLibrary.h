@@ -70,7 +70,7 @@ public:
 		float PlanetRadius = 100000.f,
 		float MaxHeight = 10000.f) const;
 
-	FVoxelFloatBuffer MakeCubemapPlanetSurface_Distance(
+	TVoxelFutureValue<FVoxelFloatBuffer> MakeCubemapPlanetSurface_Distance(
 		const FVoxelHeightmapRef& PosX,
 		const FVoxelHeightmapRef& NegX,
 		const FVoxelHeightmapRef& PosY,
@@ -83,4 +83,8 @@ public:
 
 	UFUNCTION(Category = "Heightmap")
 	FVoxelBox GetHeightmapBounds(const FVoxelHeightmapRef& Heightmap) const;
+
+private:
+	// TexelSize: size of a full resolution texel in world units
+	int32 GetMip(const FVoxelHeightmap& Heightmap, float TexelSize) const;
 };
\ No newline at end of file
@@ -17,10 +17,24 @@ public:
 	float MaxSmoothness = 0;
 	FVoxelMeshVoxelizerSettings VoxelizerSettings;
 
+	// Cells are grouped in bricks of BrickSize^3
+	// Bricks store one extra layer of voxels so that a cell never needs to sample a neighboring brick
+	static constexpr int32 BrickSize = 8;
+	static constexpr int32 BrickSizeWithApron = BrickSize + 1;
+	static constexpr int32 NumVoxelsPerBrick = BrickSizeWithApron * BrickSizeWithApron * BrickSizeWithApron;
+	// Bricks with a voxel closer than this to the surface are stored densely
+	static constexpr float DenseBandWidth = 4.f;
+
 	FVector3f Origin = FVector3f::ZeroVector;
 	FIntVector Size = FIntVector::ZeroValue;
-	TVoxelArray<float> DistanceField;
-	TVoxelArray<FVoxelOctahedron> Normals;
+	FIntVector NumBricks = FIntVector::ZeroValue;
+	// Index of the brick in BrickDistances/BrickNormals, -1 if the brick is far from the surface
+	TVoxelArray<int32> BrickIndices;
+	// Distances at the brick corners, (NumBricks + 1)^3
+	// Bricks far from the surface trilinearly interpolate these
+	TVoxelArray<float> CoarseDistances;
+	TVoxelArray<float> BrickDistances;
+	TVoxelArray<FVoxelOctahedron> BrickNormals;
 
 	FVoxelVoxelizedMeshData() = default;
 
@@ -34,4 +48,11 @@ public:
 		float VoxelSize,
 		float MaxSmoothness,
 		const FVoxelMeshVoxelizerSettings& VoxelizerSettings);
+
+private:
+	bool BuildBricks(
+		TConstVoxelArrayView<float> Distances,
+		TConstVoxelArrayView<FVoxelOctahedron> Normals);
+	// Used to upgrade data that stored a single distance per far brick
+	void BuildCoarseDistances(TConstVoxelArrayView<float> BrickConstants);
 };
\ No newline at end of file
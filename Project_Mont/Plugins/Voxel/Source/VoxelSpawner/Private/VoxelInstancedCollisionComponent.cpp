@@ -1,11 +1,13 @@
 // Copyright Voxel Plugin, Inc. All Rights Reserved.
 
 #include "VoxelInstancedCollisionComponent.h"
+#include "VoxelAABBTree.h"
 #include "Point/VoxelPointOverrideManager.h"
 #include "SceneManagement.h"
 #include "Engine/StaticMesh.h"
 #include "PrimitiveSceneProxy.h"
 #include "PhysicsEngine/BodySetup.h"
+#include "Chaos/Convex.h"
 
 VOXEL_CONSOLE_VARIABLE(
 	VOXELSPAWNER_API, bool, GVoxelFoliageShowInstancesCollisions, true,
@@ -51,17 +53,24 @@ UBodySetup* UVoxelInstancedCollisionComponent::GetBodySetup()
 		return nullptr;
 	}
 
-	const UStaticMesh* StaticMesh = Data->Mesh.StaticMesh.Get();
-	if (!StaticMesh)
+	if (Data->bAggregate)
 	{
-		return nullptr;
+		return AggregateBodySetup;
 	}
 
-	return StaticMesh->GetBodySetup();
+	return GetMeshBodySetup();
 }
 
 bool UVoxelInstancedCollisionComponent::ShouldCreatePhysicsState() const
 {
+	if (Data &&
+		Data->bAggregate)
+	{
+		return
+			AggregateBodySetup &&
+			AggregateBodySetup->AggGeom.GetElementCount() > 0;
+	}
+
 	return true;
 }
 
@@ -86,6 +95,11 @@ void UVoxelInstancedCollisionComponent::OnComponentDestroyed(const bool bDestroy
 	ReturnToPool();
 
 	Super::OnComponentDestroyed(bDestroyingHierarchy);
+
+	if (AggregateBodySetup)
+	{
+		AggregateBodySetup->ClearPhysicsMeshes();
+	}
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -151,6 +165,25 @@ public:
 
 			const FVector ViewOrigin = Views[ViewIndex]->ViewMatrices.GetViewOrigin();
 
+			if (Data->bAggregate)
+			{
+				if (!BodySetup)
+				{
+					continue;
+				}
+
+				BodySetup->AggGeom.GetAggGeom(
+					FTransform(GetLocalToWorld()),
+					FColor(157, 149, 223, 255),
+					MaterialProxy,
+					false,
+					true,
+					DrawsVelocity(),
+					ViewIndex,
+					Collector);
+				continue;
+			}
+
 			VOXEL_SCOPE_LOCK(DataImpl.CriticalSection);
 			for (int32 Index = 0; Index < DataImpl.AllBodyInstances_RequiresLock.Num(); Index++)
 			{
@@ -237,12 +270,27 @@ FPrimitiveSceneProxy* UVoxelInstancedCollisionComponent::CreateSceneProxy()
 
 void UVoxelInstancedCollisionComponent::OnCreatePhysicsState()
 {
+	if (Data &&
+		Data->bAggregate)
+	{
+		// Single compound body at component location
+		Super::OnCreatePhysicsState();
+		return;
+	}
+
 	// We want to avoid PrimitiveComponent base body instance at component location
 	USceneComponent::OnCreatePhysicsState();
 }
 
 void UVoxelInstancedCollisionComponent::OnDestroyPhysicsState()
 {
+	if (BodyInstance.IsValidBodyInstance())
+	{
+		// Created by aggregate collision
+		Super::OnDestroyPhysicsState();
+		return;
+	}
+
 #if UE_ENABLE_DEBUG_DRAWING
 	SendRenderDebugPhysics();
 #endif
@@ -279,6 +327,91 @@ bool UVoxelInstancedCollisionComponent::TryGetPointHandle(
 	return true;
 }
 
+bool UVoxelInstancedCollisionComponent::TryGetPointHandleFromHit(
+	const FHitResult& HitResult,
+	FVoxelPointHandle& OutHandle) const
+{
+	if (!ensure(Data) ||
+		!ensure(OverrideChunk))
+	{
+		return false;
+	}
+
+	if (!Data->bAggregate)
+	{
+		return TryGetPointHandle(HitResult.Item, OutHandle);
+	}
+
+	VOXEL_FUNCTION_COUNTER();
+
+	const FVector LocalImpactPoint = GetComponentTransform().InverseTransformPosition(HitResult.ImpactPoint);
+
+	VOXEL_SCOPE_LOCK(Data->CriticalSection);
+	const FVoxelInstancedCollisionDataImpl& DataImpl = Data->GetDataImpl_RequiresLock();
+
+	if (!DataImpl.AggregateShapeTree ||
+		!ensure(AggregateBodySetup))
+	{
+		return false;
+	}
+	const FKAggregateGeom& AggGeom = AggregateBodySetup->AggGeom;
+
+	// All the instances are in the same body: the impact point lies on the surface of the shape that was hit
+	// Only the shapes whose bounds contain the impact are checked
+	int32 BestIndex = -1;
+	double BestDistance = MAX_dbl;
+	DataImpl.AggregateShapeTree->Overlap(FVoxelBox(LocalImpactPoint).Extend(1.), [&](const int32 ShapeIndex)
+	{
+		const FVoxelInstancedCollisionDataImpl::FAggregateShape& Shape = DataImpl.AggregateShapes[ShapeIndex];
+
+		double Distance = MAX_dbl;
+		switch (Shape.Type)
+		{
+		default: ensure(false); break;
+		case EAggCollisionShape::Sphere:
+		{
+			Distance = AggGeom.SphereElems[Shape.ElementIndex].GetShortestDistanceToPoint(LocalImpactPoint, FTransform::Identity);
+		}
+		break;
+		case EAggCollisionShape::Box:
+		{
+			Distance = AggGeom.BoxElems[Shape.ElementIndex].GetShortestDistanceToPoint(LocalImpactPoint, FTransform::Identity);
+		}
+		break;
+		case EAggCollisionShape::Sphyl:
+		{
+			Distance = AggGeom.SphylElems[Shape.ElementIndex].GetShortestDistanceToPoint(LocalImpactPoint, FTransform::Identity);
+		}
+		break;
+		case EAggCollisionShape::Convex:
+		{
+			Distance = AggGeom.ConvexElems[Shape.ElementIndex].GetShortestDistanceToPoint(LocalImpactPoint, FTransform::Identity);
+		}
+		break;
+		}
+
+		if (Distance < BestDistance)
+		{
+			BestIndex = Shape.Index;
+			BestDistance = Distance;
+		}
+
+		// Keep visiting
+		return false;
+	});
+
+	if (BestIndex == -1 ||
+		// Will happen if the data was updated in-between us doing the trace & TryGetPointHandleFromHit being called
+		!DataImpl.PointIds[BestIndex].IsValid())
+	{
+		return false;
+	}
+
+	OutHandle.ChunkRef = Data->ChunkRef;
+	OutHandle.PointId = DataImpl.PointIds[BestIndex];
+	return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -324,7 +457,7 @@ void UVoxelInstancedCollisionComponent::SetData(const TSharedRef<FVoxelInstanced
 		}));
 	}
 
-	if (const UBodySetup* BodySetup = GetBodySetup())
+	if (const UBodySetup* BodySetup = GetMeshBodySetup())
 	{
 		if (!BodyInstance.GetOverrideWalkableSlopeOnInstance())
 		{
@@ -371,10 +504,23 @@ void UVoxelInstancedCollisionComponent::ReturnToPool()
 		DataImpl = {};
 	}
 
+	const bool bAggregate = Data->bAggregate;
+
 	Data = {};
 	OverrideChunk = {};
 	OverrideChunkDelegatePtr = {};
 
+	if (bAggregate)
+	{
+		if (AggregateBodySetup)
+		{
+			AggregateBodySetup->AggGeom.EmptyElements();
+			AggregateBodySetup->ClearPhysicsMeshes();
+		}
+		ScaledConvexElems.Empty();
+		RecreatePhysicsState();
+	}
+
 	MarkRenderStateDirty();
 }
 
@@ -388,6 +534,32 @@ void UVoxelInstancedCollisionComponent::Update()
 		return;
 	}
 
+	if (Data->bAggregate)
+	{
+		{
+			VOXEL_SCOPE_LOCK(Data->CriticalSection);
+			FVoxelInstancedCollisionDataImpl& DataImpl = Data->GetDataImpl_RequiresLock();
+			NumInstances = DataImpl.PointIdToIndex.Num();
+
+			if (DataImpl.InstanceBodiesToUpdate.Num() == 0 &&
+				!DataImpl.bAggregateDirty)
+			{
+				return;
+			}
+
+			UpdateAggregate_RequiresLock(DataImpl);
+
+			DataImpl.InstanceBodiesToUpdate.Reset();
+			DataImpl.bAggregateDirty = false;
+		}
+
+		// Only this chunk body is rebuilt
+		// Not locked as CalcBounds will lock
+		RecreatePhysicsState();
+		MarkRenderStateDirty();
+		return;
+	}
+
 	VOXEL_SCOPE_LOCK(Data->CriticalSection);
 	FVoxelInstancedCollisionDataImpl& DataImpl = Data->GetDataImpl_RequiresLock();
 	ensure(DataImpl.PointIds.Num() == DataImpl.Transforms.Num());
@@ -497,4 +669,181 @@ TSharedRef<FBodyInstance> UVoxelInstancedCollisionComponent::MakeBodyInstance(co
 	Body->bSimulatePhysics = false;
 	Body->InstanceBodyIndex = Index;
 	return Body;
-}
\ No newline at end of file
+}
+
+UBodySetup* UVoxelInstancedCollisionComponent::GetMeshBodySetup() const
+{
+	if (!Data)
+	{
+		return nullptr;
+	}
+
+	const UStaticMesh* StaticMesh = Data->Mesh.StaticMesh.Get();
+	if (!StaticMesh)
+	{
+		return nullptr;
+	}
+
+	return StaticMesh->GetBodySetup();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void UVoxelInstancedCollisionComponent::UpdateAggregate_RequiresLock(FVoxelInstancedCollisionDataImpl& DataImpl)
+{
+	VOXEL_SCOPE_COUNTER_FORMAT("UpdateAggregate Num=%d", DataImpl.PointIdToIndex.Num());
+	checkVoxelSlow(Data->CriticalSection.IsLocked());
+
+	const UBodySetup* MeshBodySetup = GetMeshBodySetup();
+	if (!ensure(MeshBodySetup))
+	{
+		return;
+	}
+
+	if (AggregateBodySetup)
+	{
+		AggregateBodySetup->ClearPhysicsMeshes();
+	}
+	else
+	{
+		AggregateBodySetup = NewObject<UBodySetup>(this);
+		AggregateBodySetup->bGenerateMirroredCollision = false;
+		AggregateBodySetup->CollisionTraceFlag = CTF_UseSimpleAsComplex;
+	}
+
+	AggregateBodySetup->PhysMaterial = MeshBodySetup->PhysMaterial;
+	AggregateBodySetup->WalkableSlopeOverride = MeshBodySetup->WalkableSlopeOverride;
+
+	const FKAggregateGeom& MeshGeom = MeshBodySetup->AggGeom;
+	FKAggregateGeom& AggGeom = AggregateBodySetup->AggGeom;
+	AggGeom.EmptyElements();
+
+	const FTransform ComponentTransform = GetComponentTransform();
+
+	DataImpl.AggregateShapes.Reset();
+	DataImpl.AggregateShapeTree.Reset();
+
+	TVoxelArray<FVoxelAABBTree::FElement> ShapeElements;
+	const auto AddShape = [&](const EAggCollisionShape::Type Type, const int32 ElementIndex, const int32 Index, const FBox& Bounds)
+	{
+		ShapeElements.Add(FVoxelAABBTree::FElement{ FVoxelBox(Bounds), DataImpl.AggregateShapes.Num() });
+		DataImpl.AggregateShapes.Add(FVoxelInstancedCollisionDataImpl::FAggregateShape{ Type, ElementIndex, Index });
+	};
+
+	// Only keep the scaled convexes still in use
+	TVoxelMap<TPair<int32, FVector3f>, FKConvexElem> OldScaledConvexElems = MoveTemp(ScaledConvexElems);
+	ScaledConvexElems.Reset();
+
+	const auto GetScaledConvexElem = [&](const int32 ConvexIndex, const FVector& Scale) -> const FKConvexElem&
+	{
+		const TPair<int32, FVector3f> Key{ ConvexIndex, FVector3f(Scale) };
+		if (const FKConvexElem* ScaledElem = ScaledConvexElems.Find(Key))
+		{
+			return *ScaledElem;
+		}
+		if (FKConvexElem* OldScaledElem = OldScaledConvexElems.Find(Key))
+		{
+			return ScaledConvexElems.Add_CheckNew(Key, MoveTemp(*OldScaledElem));
+		}
+
+		VOXEL_SCOPE_COUNTER("Scale convex");
+
+		const FKConvexElem& Elem = MeshGeom.ConvexElems[ConvexIndex];
+		const auto& ChaosConvex = Elem.GetChaosConvexMesh();
+
+		// Bake the element transform & the instance scale in the vertices
+		TArray<Chaos::FConvex::FVec3Type> Vertices;
+		if (ensure(ChaosConvex))
+		{
+			Vertices.Reserve(ChaosConvex->GetVertices().Num());
+			for (const Chaos::FConvex::FVec3Type& Vertex : ChaosConvex->GetVertices())
+			{
+				Vertices.Add(Chaos::FConvex::FVec3Type(Elem.GetTransform().TransformPosition(FVector(Vertex)) * Scale));
+			}
+		}
+
+		FKConvexElem ScaledElem = Elem;
+		ScaledElem.SetTransform(FTransform::Identity);
+		ScaledElem.VertexData.Reset(Vertices.Num());
+		for (const Chaos::FConvex::FVec3Type& Vertex : Vertices)
+		{
+			ScaledElem.VertexData.Add(FVector(Vertex));
+		}
+		ScaledElem.UpdateElemBox();
+
+		const Chaos::FReal Margin = ChaosConvex ? ChaosConvex->GetMargin() * Scale.GetAbsMin() : 0.f;
+#if VOXEL_ENGINE_VERSION >= 504
+		ScaledElem.SetChaosConvexMesh(Chaos::FConvexPtr(new Chaos::FConvex(Vertices, Margin)));
+#else
+		ScaledElem.SetChaosConvexMesh(MakeShared<Chaos::FConvex, ESPMode::ThreadSafe>(Vertices, Margin));
+#endif
+		ScaledElem.ComputeChaosConvexIndices();
+
+		return ScaledConvexElems.Add_CheckNew(Key, MoveTemp(ScaledElem));
+	};
+
+	VOXEL_SCOPE_LOCK(OverrideChunk->CriticalSection);
+
+	for (int32 Index = 0; Index < DataImpl.PointIds.Num(); Index++)
+	{
+		const FVoxelPointId PointId = DataImpl.PointIds[Index];
+		if (!PointId.IsValid() ||
+			OverrideChunk->PointIdsToHide_RequiresLock.Contains(PointId))
+		{
+			continue;
+		}
+
+		const FTransform Transform = FTransform(DataImpl.Transforms[Index]).GetRelativeTransform(ComponentTransform);
+		const FVector Scale = Transform.GetScale3D();
+		if (Scale.IsNearlyZero())
+		{
+			continue;
+		}
+
+		const FTransform RelativeTransform(Transform.GetRotation(), Transform.GetTranslation());
+
+		for (const FKSphereElem& Elem : MeshGeom.SphereElems)
+		{
+			const FKSphereElem& NewElem = AggGeom.SphereElems.Add_GetRef(Elem.GetFinalScaled(Scale, RelativeTransform));
+			AddShape(EAggCollisionShape::Sphere, AggGeom.SphereElems.Num() - 1, Index, NewElem.CalcAABB(FTransform::Identity, 1.f));
+		}
+		for (const FKBoxElem& Elem : MeshGeom.BoxElems)
+		{
+			const FKBoxElem& NewElem = AggGeom.BoxElems.Add_GetRef(Elem.GetFinalScaled(Scale, RelativeTransform));
+			AddShape(EAggCollisionShape::Box, AggGeom.BoxElems.Num() - 1, Index, NewElem.CalcAABB(FTransform::Identity, 1.f));
+		}
+		for (const FKSphylElem& Elem : MeshGeom.SphylElems)
+		{
+			const FKSphylElem& NewElem = AggGeom.SphylElems.Add_GetRef(Elem.GetFinalScaled(Scale, RelativeTransform));
+			AddShape(EAggCollisionShape::Sphyl, AggGeom.SphylElems.Num() - 1, Index, NewElem.CalcAABB(FTransform::Identity, 1.f));
+		}
+		for (int32 ConvexIndex = 0; ConvexIndex < MeshGeom.ConvexElems.Num(); ConvexIndex++)
+		{
+			FKConvexElem* NewElem;
+			if (Scale.Equals(FVector::OneVector))
+			{
+				// Chaos convex is shared with the static mesh, only the transform differs
+				const FKConvexElem& Elem = MeshGeom.ConvexElems[ConvexIndex];
+				NewElem = &AggGeom.ConvexElems.Add_GetRef(Elem);
+				NewElem->SetTransform(Elem.GetTransform() * RelativeTransform);
+			}
+			else
+			{
+				// Chaos convex is shared with the instances of the same scale
+				NewElem = &AggGeom.ConvexElems.Add_GetRef(GetScaledConvexElem(ConvexIndex, Scale));
+				NewElem->SetTransform(RelativeTransform);
+			}
+			AddShape(EAggCollisionShape::Convex, AggGeom.ConvexElems.Num() - 1, Index, NewElem->CalcAABB(FTransform::Identity, FVector::OneVector));
+		}
+	}
+
+	if (ShapeElements.Num() > 0)
+	{
+		DataImpl.AggregateShapeTree = MakeVoxelShared<FVoxelAABBTree>();
+		DataImpl.AggregateShapeTree->Initialize(MoveTemp(ShapeElements));
+	}
+
+	AggregateBodySetup->bCreatedPhysicsMeshes = true;
+}
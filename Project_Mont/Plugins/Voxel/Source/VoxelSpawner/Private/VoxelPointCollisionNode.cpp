@@ -18,6 +18,7 @@ void FVoxelPointCollisionExecNodeRuntime::Create()
 
 	const TSharedRef<const FVoxelChunkedPointSet> ChunkedPoints = GetConstantPin(Node.ChunkedPointsPin);
 	const TSharedRef<const FBodyInstance> BodyInstance = GetConstantPin(Node.BodyInstancePin);
+	const bool bAggregateCollision = GetConstantPin(Node.AggregateCollisionPin);
 
 	if (!ChunkedPoints->IsValid())
 	{
@@ -68,6 +69,7 @@ void FVoxelPointCollisionExecNodeRuntime::Create()
 					FVoxelBox(SmallChunkMin, SmallChunkMin + SmallChunkSize),
 					GetRuntimeInfo(),
 					BodyInstance,
+					bAggregateCollision,
 					LargeChunk.ToSharedRef());
 
 				Chunk->Initialize();
@@ -12,12 +12,14 @@ FVoxelPointCollisionSmallChunk::FVoxelPointCollisionSmallChunk(
 	const FVoxelBox& Bounds,
 	const TSharedRef<const FVoxelRuntimeInfo>& RuntimeInfo,
 	const TSharedRef<const FBodyInstance>& BodyInstance,
+	const bool bAggregateCollision,
 	const TSharedRef<FVoxelPointCollisionLargeChunk>& LargeChunk)
 	: NodeRef(NodeRef)
 	, ChunkRef(ChunkRef)
 	, Bounds(Bounds)
 	, RuntimeInfo(RuntimeInfo)
 	, BodyInstance(BodyInstance)
+	, bAggregateCollision(bAggregateCollision)
 	, LargeChunk(LargeChunk)
 {
 }
@@ -107,7 +109,11 @@ void FVoxelPointCollisionSmallChunk::UpdatePoints(const FMeshToPoints& MeshToPoi
 
 				Data.PointIds[Index] = {};
 				Data.Transforms[Index] = {};
-				Data.InstanceBodiesToDelete.Add(MoveTemp(Data.InstanceBodies[Index]));
+				if (Data.InstanceBodies[Index])
+				{
+					Data.InstanceBodiesToDelete.Add(MoveTemp(Data.InstanceBodies[Index]));
+				}
+				Data.bAggregateDirty = It.Value.Data->bAggregate;
 
 				Data.FreeIndices.Add(Index);
 
@@ -127,7 +133,7 @@ void FVoxelPointCollisionSmallChunk::UpdatePoints(const FMeshToPoints& MeshToPoi
 			FComponent& Component = MeshToComponent_RequiresLock.FindOrAdd(Mesh);
 			if (!Component.Data)
 			{
-				Component.Data = MakeVoxelShared<FVoxelInstancedCollisionData>(Mesh, ChunkRef);
+				Component.Data = MakeVoxelShared<FVoxelInstancedCollisionData>(Mesh, ChunkRef, bAggregateCollision);
 				Component.Data->CriticalSection.Lock();
 				LockedDatas.Add(Component.Data);
 			}
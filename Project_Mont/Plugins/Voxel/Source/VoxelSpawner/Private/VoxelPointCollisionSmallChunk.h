@@ -22,6 +22,7 @@ public:
 	const FVoxelBox Bounds;
 	const TSharedRef<const FVoxelRuntimeInfo> RuntimeInfo;
 	const TSharedRef<const FBodyInstance> BodyInstance;
+	const bool bAggregateCollision;
 	const TSharedRef<FVoxelPointCollisionLargeChunk> LargeChunk;
 
 	VOXEL_COUNT_INSTANCES();
@@ -32,6 +33,7 @@ public:
 		const FVoxelBox& Bounds,
 		const TSharedRef<const FVoxelRuntimeInfo>& RuntimeInfo,
 		const TSharedRef<const FBodyInstance>& BodyInstance,
+		bool bAggregateCollision,
 		const TSharedRef<FVoxelPointCollisionLargeChunk>& LargeChunk);
 
 	FORCEINLINE const FVoxelRuntimeInfo& GetRuntimeInfoRef() const
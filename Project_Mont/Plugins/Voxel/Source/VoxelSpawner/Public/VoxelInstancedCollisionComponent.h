@@ -5,8 +5,10 @@
 #include "VoxelMinimal.h"
 #include "Buffer/VoxelStaticMeshBuffer.h"
 #include "Point/VoxelPointHandleProvider.h"
+#include "PhysicsEngine/ConvexElem.h"
 #include "VoxelInstancedCollisionComponent.generated.h"
 
+class FVoxelAABBTree;
 class FVoxelPointOverrideChunk;
 
 DECLARE_VOXEL_COUNTER(VOXELSPAWNER_API, STAT_VoxelNumCollisionInstances, "Num Collision Instances");
@@ -23,6 +25,20 @@ struct VOXELSPAWNER_API FVoxelInstancedCollisionDataImpl
 	TVoxelArray<FTransform3f> Transforms;
 	TVoxelArray<TSharedPtr<FBodyInstance>> InstanceBodies;
 
+	// Aggregate collision only: set when instances were removed, as they have no body to delete
+	bool bAggregateDirty = false;
+
+	// Aggregate collision only: instance each element of the aggregate body was built from
+	struct FAggregateShape
+	{
+		EAggCollisionShape::Type Type = EAggCollisionShape::Unknown;
+		int32 ElementIndex = -1;
+		int32 Index = -1;
+	};
+	TVoxelArray<FAggregateShape> AggregateShapes;
+	// Aggregate collision only: bounds of AggregateShapes relative to the component, payload is the shape index
+	TSharedPtr<FVoxelAABBTree> AggregateShapeTree;
+
 	FVoxelFastCriticalSection CriticalSection;
 	TVoxelArray<TWeakPtr<FBodyInstance>> AllBodyInstances_RequiresLock;
 
@@ -34,12 +50,16 @@ class VOXELSPAWNER_API FVoxelInstancedCollisionData
 public:
 	const FVoxelStaticMesh Mesh;
 	const FVoxelPointChunkRef ChunkRef;
+	// If true, a single compound body is created for all the instances instead of one body per instance
+	const bool bAggregate;
 
 	FVoxelInstancedCollisionData(
 		const FVoxelStaticMesh& Mesh,
-		const FVoxelPointChunkRef& ChunkRef)
+		const FVoxelPointChunkRef& ChunkRef,
+		const bool bAggregate)
 		: Mesh(Mesh)
 		, ChunkRef(ChunkRef)
+		, bAggregate(bAggregate)
 	{
 	}
 
@@ -80,6 +100,9 @@ public:
 	virtual bool TryGetPointHandle(
 		int32 ItemIndex,
 		FVoxelPointHandle& OutHandle) const override;
+	virtual bool TryGetPointHandleFromHit(
+		const FHitResult& HitResult,
+		FVoxelPointHandle& OutHandle) const override;
 	//~ End IVoxelPointHandleProvider Interface
 
 	void SetData(const TSharedRef<FVoxelInstancedCollisionData>& NewData);
@@ -87,6 +110,7 @@ public:
 	void Update();
 
 	TSharedRef<FBodyInstance> MakeBodyInstance(int32 Index) const;
+	UBodySetup* GetMeshBodySetup() const;
 
 	FORCEINLINE TSharedPtr<FVoxelInstancedCollisionData> GetData() const
 	{
@@ -94,11 +118,21 @@ public:
 	}
 
 private:
+	// Aggregate collision only: holds the shapes of all the instances, relative to the component
+	UPROPERTY(Transient)
+	TObjectPtr<UBodySetup> AggregateBodySetup;
+
 	TSharedPtr<FVoxelInstancedCollisionData> Data;
 	TSharedPtr<FVoxelPointOverrideChunk> OverrideChunk;
 	FSharedVoidPtr OverrideChunkDelegatePtr;
 
+	// Aggregate collision only: mesh convexes baked at the scale of the instances, keyed by convex index & scale
+	// Chaos ignores the scale of convex element transforms
+	TVoxelMap<TPair<int32, FVector3f>, FKConvexElem> ScaledConvexElems;
+
 	VOXEL_COUNTER_HELPER(STAT_VoxelNumCollisionInstances, NumInstances);
 
+	void UpdateAggregate_RequiresLock(FVoxelInstancedCollisionDataImpl& DataImpl);
+
 	friend class FVoxelInstancedCollisionSceneProxy;
 };
\ No newline at end of file
@@ -28,6 +28,10 @@ struct VOXELSPAWNER_API FVoxelPointCollisionExecNode : public FVoxelExecNode
 	// Priority offset, added to the task distance from camera
 	// Closest tasks are computed first, so set this to a very low value (eg, -1000000) if you want it to be computed first
 	VOXEL_INPUT_PIN(double, PriorityOffset, -1000000, ConstantPin, AdvancedDisplay);
+	// If true, all the instances of a mesh in a chunk are merged into a single compound body instead of one body per instance
+	// Much cheaper to create & to add to the physics scene, but any instance change rebuilds the chunk body
+	// Only simple collision is used, and overlaps cannot be resolved to a point
+	VOXEL_INPUT_PIN(bool, AggregateCollision, false, ConstantPin, AdvancedDisplay);
 
 	virtual TVoxelUniquePtr<FVoxelExecNodeRuntime> CreateExecRuntime(const TSharedRef<const FVoxelExecNode>& SharedThis) const override;
 };